@@ -61,13 +61,31 @@
 // #define UCT_DEMO
 
 #ifndef DISABLE_PERFECT_AI
-#ifdef _MSC_VER
-#ifndef __clang__
 // #define MADWEASEL_MUEHLE_PERFECT_AI
-#endif
 #ifdef MADWEASEL_MUEHLE_PERFECT_AI
 #define MADWEASEL_MUEHLE_RULE
+#ifndef PERFECT_AI_DATABASE_DIR
+#ifdef _WIN32
 #define PERFECT_AI_DATABASE_DIR "D:\\Muehle\\Muehle"
+#else
+#define PERFECT_AI_DATABASE_DIR "Muehle"
+#endif
+#endif
+// Memory for the completed layers in MB. 0 reads them from file.
+#ifndef PERFECT_AI_MEMORY_BUDGET_MB
+#define PERFECT_AI_MEMORY_BUDGET_MB 0
+#endif
+// Memory for the queues of the retro analysis in MB
+#ifndef PERFECT_AI_QUEUE_MEMORY_MB
+#define PERFECT_AI_QUEUE_MEMORY_MB 1024
+#endif
+// Memory for the layers calculated at the same time in MB
+#ifndef PERFECT_AI_CALC_MEMORY_MB
+#define PERFECT_AI_CALC_MEMORY_MB 4096
+#endif
+// Seconds between two checkpoints of the retro analysis. 0 disables them.
+#ifndef PERFECT_AI_CHECKPOINT_INTERVAL
+#define PERFECT_AI_CHECKPOINT_INTERVAL 600
 #endif
 #endif
 #endif
@@ -96,6 +114,13 @@ constexpr auto DEPTH_ADJUST = 0;
 // #define TRANSPOSITION_TABLE_64BIT_KEY
 // #define TT_MOVE_ENABLE
 // #define TRANSPOSITION_TABLE_DEBUG
+#define TRANSPOSITION_TABLE_CUTOFF
+#endif
+
+#define EVALUATION_CACHE_ENABLE
+
+#ifdef EVALUATION_CACHE_ENABLE
+// #define EVALUATION_CACHE_DEBUG
 #endif
 
 // #define DISABLE_PREFETCH
@@ -109,9 +134,6 @@ constexpr auto DEPTH_ADJUST = 0;
 #define DO_NOT_USE_POPCNT
 #endif
 
-/// Opening book (WIP)
-// #define OPENING_BOOK
-
 /// Endgame learning (WIP)
 // #define ENDGAME_LEARNING
 // #define ENDGAME_LEARNING_FORCE
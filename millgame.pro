@@ -27,6 +27,11 @@ SOURCES += \
     src/movepick.cpp \
     src/thread.cpp \
     src/tt.cpp \
+    src/record.cpp \
+    src/symmetry.cpp \
+    src/book.cpp \
+    src/nnue/evaluate_nnue.cpp \
+    src/tune.cpp \
     src/misc.cpp \
     src/uci.cpp \
     src/ucioption.cpp \
@@ -58,6 +63,12 @@ HEADERS  += \
     src/movepick.h \
     src/thread.h \
     src/tt.h \
+    src/record.h \
+    src/symmetry.h \
+    src/book.h \
+    src/nnue/nnue_architecture.h \
+    src/nnue/evaluate_nnue.h \
+    src/tune.h \
     src/hashnode.h \
     src/debug.h \
     src/hashMap.h \
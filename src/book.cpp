@@ -0,0 +1,328 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "book.h"
+#include "misc.h"
+#include "movegen.h"
+#include "option.h"
+#include "position.h"
+#include "record.h"
+#include "rule.h"
+#include "symmetry.h"
+#include "uci.h"
+
+using std::string;
+
+namespace {
+
+MappedFile file;
+string fileName;
+const Book::Entry *entries = nullptr;
+size_t count = 0;
+
+/// Stats counts the results of a move in the games read by the builder, from
+/// the point of view of the side which played it.
+
+struct Stats
+{
+    int wins {0};
+    int draws {0};
+    int losses {0};
+};
+
+} // namespace
+
+namespace Book {
+
+/// open() maps an opening book file. The book is empty if the file is
+/// missing or not valid.
+
+bool open(const string &name)
+{
+    FileHeader header;
+
+    fileName = name;
+    entries = nullptr;
+    count = 0;
+
+    if (!file.map(fileName) || file.size() < sizeof(header)) {
+        file.unmap();
+        return false;
+    }
+
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != FILE_MAGIC || header.keySize != sizeof(Key) ||
+        file.size() != sizeof(header) + header.count * sizeof(Entry)) {
+        file.unmap();
+        return false;
+    }
+
+    entries = reinterpret_cast<const Entry *>(
+        static_cast<const char *>(file.data()) + sizeof(header));
+    count = size_t(header.count);
+
+    return true;
+}
+
+/// probe() looks for the position in the book and picks one of its legal
+/// moves at random, in proportion to their weights, as the Shuffling and
+/// ShufflingSeed options say. It returns MOVE_NONE if the position is not in
+/// the book. With canonical keys, the book moves are those of the canonical
+/// image of the position and are mapped back to it.
+
+Move probe(Position &pos)
+{
+    if (!count) {
+        return MOVE_NONE;
+    }
+
+    int sym = 0;
+    const Key key = gameOptions.getCanonicalKeys() ?
+                        Symmetry::canonical_key(pos, sym) :
+                        pos.key();
+    const int inv = Symmetry::inverse(sym);
+    const Entry *first = std::lower_bound(
+        entries, entries + count, key,
+        [](const Entry &e, Key k) { return e.key < k; });
+    const Entry *last = first;
+    const MoveList<LEGAL> legal(pos);
+    uint32_t sum = 0;
+
+    // Another position with the same key may be in the book
+    for (; last != entries + count && last->key == key; ++last) {
+        if (legal.contains(
+                Symmetry::transform(static_cast<Move>(last->move), inv))) {
+            sum += last->weight;
+        }
+    }
+
+    if (sum == 0) {
+        return MOVE_NONE;
+    }
+
+    // Without shuffling the move with the highest weight is played, the
+    // first one in the book on a tie
+    if (!gameOptions.getShufflingEnabled()) {
+        const Entry *best = nullptr;
+
+        for (const Entry *e = first; e != last; ++e) {
+            if ((best == nullptr || e->weight > best->weight) &&
+                legal.contains(
+                    Symmetry::transform(static_cast<Move>(e->move), inv))) {
+                best = e;
+            }
+        }
+
+        return Symmetry::transform(static_cast<Move>(best->move), inv);
+    }
+
+    // A fixed ShufflingSeed picks the same move in the same position, so the
+    // games can be repeated
+    const int seed = gameOptions.getShufflingSeed();
+    thread_local PRNG timeRng(uint64_t(now()) | 1);
+    PRNG seedRng((uint64_t(seed) ^ key) | 1);
+    PRNG &rng = seed ? seedRng : timeRng;
+    uint32_t r = uint32_t(rng.rand<uint64_t>() % sum);
+
+    for (const Entry *e = first; e != last; ++e) {
+        const Move m = Symmetry::transform(static_cast<Move>(e->move), inv);
+
+        if (!legal.contains(m)) {
+            continue;
+        }
+
+        if (r < e->weight) {
+            return m;
+        }
+
+        r -= e->weight;
+    }
+
+    return MOVE_NONE;
+}
+
+/// build() reads a file of game records and writes the opening book of their
+/// first plies. Each line of the file is a game: its result, 1-0, 0-1 or
+/// 1/2-1/2, followed by its moves as in the "position" command. A record file
+/// written by the "records" command is read as well, without its games of
+/// other rules. The weight of a move is two per win and one per draw of the
+/// side which played it, the moves which never scored are left out. The book
+/// is keyed as the CanonicalKeys option says, which must be the same when it
+/// is used. The command is:
+///
+/// book <games file> [book file = book.bin] [plies = 24]
+
+void build(std::istream &is, const string &startFen)
+{
+    string gamesFile, bookFile = "book.bin", token;
+    int maxPly = 24;
+
+    is >> gamesFile;
+
+    if (is >> token) {
+        bookFile = token;
+    }
+
+    if (is >> token) {
+        std::istringstream ss(token);
+
+        if (!(ss >> maxPly) || !ss.eof() || maxPly <= 0) {
+            sync_cout << "info string Invalid plies " << token << sync_endl;
+            return;
+        }
+    }
+
+    std::map<std::pair<Key, Move>, Stats> stats;
+    Position pos;
+    size_t gameCount = 0;
+
+    // add() counts the move m of pos in a game won by White (1), drawn (0) or
+    // lost by White (-1)
+    const auto add = [&stats](Position &p, Move m, int whiteScore) {
+        const int score = p.side_to_move() == WHITE ? whiteScore : -whiteScore;
+        int sym = 0;
+        const Key key = gameOptions.getCanonicalKeys() ?
+                            Symmetry::canonical_key(p, sym) :
+                            p.key();
+        Stats &st = stats[{key, Symmetry::transform(m, sym)}];
+
+        (score > 0 ? st.wins : score < 0 ? st.losses : st.draws)++;
+    };
+
+    Record::Reader records;
+
+    if (records.open(gamesFile)) {
+        // Record file, games of other rules are skipped
+        while (records.next()) {
+            const int result = int(records.result());
+
+            if (result > int(Record::Result::whiteWins) ||
+                strcmp(rule.name, RULES[records.rule()].name)) {
+                continue;
+            }
+
+            int ply = 0;
+
+            gameCount++;
+            records.replay(pos, [&](Position &p, Move m) {
+                add(p, m, result - 1);
+                return ++ply < maxPly;
+            });
+        }
+    } else {
+        std::ifstream games(gamesFile);
+
+        if (!games) {
+            sync_cout << "info string Cannot read " << gamesFile << sync_endl;
+            return;
+        }
+
+        string line;
+
+        while (std::getline(games, line)) {
+            std::istringstream ss(line);
+            int whiteScore;
+
+            if (!(ss >> token)) {
+                continue;
+            }
+
+            if (token == "1-0") {
+                whiteScore = 1;
+            } else if (token == "0-1") {
+                whiteScore = -1;
+            } else if (token == "1/2-1/2") {
+                whiteScore = 0;
+            } else {
+                continue;
+            }
+
+            gameCount++;
+            pos.set(startFen, nullptr);
+
+            for (int ply = 0; ply < maxPly && ss >> token; ply++) {
+                const Move m = UCI::to_move(&pos, token);
+
+                if (m == MOVE_NONE) {
+                    break;
+                }
+
+                add(pos, m, whiteScore);
+                pos.do_move(m);
+            }
+        }
+    }
+
+    std::vector<Entry> book;
+
+    for (const auto &[km, st] : stats) {
+        const int weight = std::min(2 * st.wins + st.draws, 0xFFFF);
+
+        if (weight > 0) {
+            book.push_back({km.first, static_cast<int16_t>(km.second),
+                            static_cast<uint16_t>(weight),
+                            st.wins - st.losses});
+        }
+    }
+
+    std::stable_sort(book.begin(), book.end(),
+                     [](const Entry &a, const Entry &b) {
+                         return a.key < b.key ||
+                                (a.key == b.key && a.weight > b.weight);
+                     });
+
+    // The book in use must not be mapped while it is rewritten
+    const bool inUse = bookFile == fileName;
+
+    if (inUse) {
+        file.unmap();
+        entries = nullptr;
+        count = 0;
+    }
+
+    std::ofstream out(bookFile, std::ios::binary | std::ios::trunc);
+    const FileHeader header {FILE_MAGIC, sizeof(Key), book.size()};
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(book.data()),
+              book.size() * sizeof(Entry));
+
+    out.close();
+
+    if (inUse) {
+        open(fileName);
+    }
+
+    if (!out) {
+        sync_cout << "info string Cannot write " << bookFile << sync_endl;
+        return;
+    }
+
+    sync_cout << "info string " << gameCount << " games, " << book.size()
+              << " book moves written to " << bookFile << sync_endl;
+}
+
+} // namespace Book
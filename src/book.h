@@ -0,0 +1,57 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BOOK_H_INCLUDED
+#define BOOK_H_INCLUDED
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "types.h"
+
+class Position;
+
+namespace Book {
+
+/// Book::Entry is a record of the opening book file. The entries are sorted
+/// by key, then by decreasing weight, and follow a header like the one of the
+/// endgame files. All the fields are little-endian.
+
+struct Entry
+{
+    Key key;         // Position::key() before the move
+    int16_t move;    // The Move
+    uint16_t weight; // Relative probability of the move to be played
+    int32_t learn;   // Wins minus losses of the side to move in the games
+};
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t keySize; // sizeof(Key) of the engine which wrote the file
+    uint64_t count;
+};
+
+constexpr uint32_t FILE_MAGIC = 0x314B4253; // "SBK1"
+
+bool open(const std::string &fileName);
+Move probe(Position &pos);
+void build(std::istream &is, const std::string &startFen);
+
+} // namespace Book
+
+#endif // #ifndef BOOK_H_INCLUDED
@@ -15,45 +15,261 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "endgame.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <string>
 
 using std::string;
 
+/// EndgameFile::open() maps an endgame file. It returns false if the file is
+/// missing or not valid, the view is then empty.
+
+bool EndgameFile::open(const string &fileName)
+{
+    close();
+
+    EndgameFileHeader header;
+
+    if (!file.map(fileName) || file.size() < sizeof(header)) {
+        close();
+        return false;
+    }
+
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != ENDGAME_FILE_MAGIC || header.keySize != sizeof(Key) ||
+        file.size() != sizeof(header) + header.count * sizeof(Key) +
+                           (header.count + 3) / 4) {
+        close();
+        return false;
+    }
+
+    const auto base = static_cast<const char *>(file.data()) + sizeof(header);
+
+    count = size_t(header.count);
+    keys = reinterpret_cast<const Key *>(base);
+    results = reinterpret_cast<const uint8_t *>(base + count * sizeof(Key));
+
+    return true;
+}
+
+void EndgameFile::close()
+{
+    file.unmap();
+    keys = nullptr;
+    results = nullptr;
+    count = 0;
+}
+
+/// EndgameFile::lower_bound() returns the index of the first key which is not
+/// less than the given one, by a branchless binary search.
+
+size_t EndgameFile::lower_bound(Key key) const
+{
+    if (!count) {
+        return 0;
+    }
+
+    const Key *base = keys;
+    size_t n = count;
+
+    while (n > 1) {
+        const size_t half = n / 2;
+        base = base[half] < key ? base + half : base;
+        n -= half;
+    }
+
+    return size_t(base - keys) + (*base < key);
+}
+
+bool EndgameFile::probe(Key key, EndGameType &type) const
+{
+    const size_t i = lower_bound(key);
+
+    if (i == count || keys[i] != key) {
+        return false;
+    }
+
+    type = result(i);
+
+    return true;
+}
+
+/// EndgameFile::write() writes sorted entries with unique keys to an endgame
+/// file.
+
+bool EndgameFile::write(const string &fileName,
+                        const std::vector<Entry> &entries)
+{
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    const EndgameFileHeader header {ENDGAME_FILE_MAGIC, sizeof(Key),
+                                    entries.size()};
+    std::vector<Key> keys(entries.size());
+    std::vector<uint8_t> results((entries.size() + 3) / 4, 0);
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        keys[i] = entries[i].first;
+        results[i / 4] |= static_cast<uint8_t>(
+            static_cast<uint32_t>(entries[i].second) << (2 * (i % 4)));
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(keys.data()),
+               keys.size() * sizeof(Key));
+    file.write(reinterpret_cast<const char *>(results.data()), results.size());
+
+    return bool(file);
+}
+
 #ifdef ENDGAME_LEARNING
-static constexpr int endgameHashSize = 0x1000000; // 16M
-HashMap<Key, Endgame> endgameHashMap(endgameHashSize);
 
-void mergeEndgameFile(const string &file1, const string &file2,
-                      const string &mergedFile)
+EndgameDB endgameDB;
+
+namespace {
+
+string log_name(const string &fileName)
+{
+    return fileName + ".log";
+}
+
+} // namespace
+
+/// EndgameDB::open() maps an endgame file and replays its log. A missing file
+/// is an empty database, the file is only written by compact().
+
+bool EndgameDB::open(const string &name)
 {
-    HashMap<Key, Endgame> map1(endgameHashSize);
-    HashMap<Key, Endgame> map2(endgameHashSize);
+    std::unique_lock<std::shared_mutex> lock(mutex);
 
-    map1.load(file1);
-    map2.load(file2);
+    fileName = name;
+    pending.clear();
 
-    map1.merge(map2);
+    const bool valid = file.open(fileName) ||
+                       !std::ifstream(fileName).is_open();
+
+    std::ifstream log(log_name(fileName), std::ios::binary);
+    EndgameRecord r;
+
+    while (log.read(reinterpret_cast<char *>(&r), sizeof(r))) {
+        pending[r.key] = static_cast<EndGameType>(r.type & 3);
+    }
 
-    map1.dump(mergedFile);
+    debugPrintf("[endgame] Open %s: %zu entries, %zu in log\n",
+                fileName.c_str(), file.size(), pending.size());
 
-    debugPrintf("[endgame] Merge %s to %s and save to %s\n", file2.c_str(),
-                file1.c_str(), mergedFile.c_str());
+    return valid;
 }
 
-int mergeEndgameFile_main()
+/// EndgameDB::compact() merges the log into the file and truncates it. The new
+/// file is written next to the old one and then renamed over it.
+
+bool EndgameDB::compact()
 {
-    string filename;
+    std::unique_lock<std::shared_mutex> lock(mutex);
 
-    for (char ch = '0'; ch <= '9'; ch++) {
-        filename = ch + "/endgame.txt";
-        mergeEndgameFile("endgame.txt", filename, "endgame.txt");
+    if (fileName.empty() || pending.empty()) {
+        return true;
     }
 
+    std::vector<EndgameFile::Entry> newer(pending.begin(), pending.end());
+    std::vector<EndgameFile::Entry> merged;
+
+    std::sort(newer.begin(), newer.end());
+    merged.reserve(file.size() + newer.size());
+
+    // Merge the file with the log, whose results win
+    size_t i = 0;
+
+    for (const auto &e : newer) {
+        for (; i < file.size() && file.key(i) < e.first; i++) {
+            merged.emplace_back(file.key(i), file.result(i));
+        }
+
+        if (i < file.size() && file.key(i) == e.first) {
+            i++;
+        }
+
+        merged.push_back(e);
+    }
+
+    for (; i < file.size(); i++) {
+        merged.emplace_back(file.key(i), file.result(i));
+    }
+
+    const string tmpName = fileName + ".tmp";
+
+    if (!EndgameFile::write(tmpName, merged)) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+
+    file.close(); // Windows cannot replace a mapped file
+
 #ifdef _WIN32
-    system("pause");
+    std::remove(fileName.c_str());
 #endif
 
-    return 0;
+    if (std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        return false;
+    }
+
+    std::ofstream(log_name(fileName), std::ios::binary | std::ios::trunc);
+    pending.clear();
+    file.open(fileName);
+
+    debugPrintf("[endgame] Compact %s: %zu entries\n", fileName.c_str(),
+                file.size());
+
+    return true;
+}
+
+/// EndgameDB::close() unmaps the file. The entries which are not compacted
+/// yet stay in the log.
+
+void EndgameDB::close()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    file.close();
+    pending.clear();
+}
+
+/// EndgameDB::probe() looks for a key in the log, then in the file.
+
+bool EndgameDB::probe(Key key, Endgame &endgame) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    if (!pending.empty()) {
+        const auto it = pending.find(key);
+
+        if (it != pending.end()) {
+            endgame.type = it->second;
+            return true;
+        }
+    }
+
+    return file.probe(key, endgame.type);
+}
+
+/// EndgameDB::record() adds an endgame to the log.
+
+void EndgameDB::record(Key key, const Endgame &endgame)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    pending[key] = endgame.type;
+
+    if (fileName.empty()) {
+        return;
+    }
+
+    const EndgameRecord r {key, static_cast<uint32_t>(endgame.type)};
+    std::ofstream log(log_name(fileName), std::ios::binary | std::ios::app);
+    log.write(reinterpret_cast<const char *>(&r), sizeof(r));
 }
 
 #endif // ENDGAME_LEARNING
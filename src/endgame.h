@@ -19,15 +19,16 @@
 
 #include "config.h"
 
-#ifdef ENDGAME_LEARNING
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-#include "hashmap.h"
+#include "misc.h"
 #include "types.h"
 
-using CTSL::HashMap;
-
-static const int SAVE_ENDGAME_EVERY_N_GAMES = 256;
-
 enum class EndGameType : uint32_t {
     none,
     whiteWin,
@@ -40,7 +41,87 @@ struct Endgame
     EndGameType type;
 };
 
-extern HashMap<Key, Endgame> endgameHashMap;
+/// EndgameFileHeader starts an endgame file. It is followed by the sorted
+/// keys, then by their results packed four in a byte, the first one in the
+/// low bits. All the fields are little-endian.
+
+struct EndgameFileHeader
+{
+    uint32_t magic;
+    uint32_t keySize; // sizeof(Key) of the engine which wrote the file
+    uint64_t count;
+};
+
+constexpr uint32_t ENDGAME_FILE_MAGIC = 0x31474553; // "SEG1"
+
+/// EndgameFile is a read-only view of a memory mapped endgame file.
+
+class EndgameFile
+{
+public:
+    using Entry = std::pair<Key, EndGameType>;
+
+    bool open(const std::string &fileName);
+    void close();
+
+    size_t size() const { return count; }
+    Key key(size_t i) const { return keys[i]; }
+
+    EndGameType result(size_t i) const
+    {
+        return static_cast<EndGameType>((results[i / 4] >> (2 * (i % 4))) &
+                                        3);
+    }
+
+    size_t lower_bound(Key key) const;
+    bool probe(Key key, EndGameType &type) const;
+
+    static bool write(const std::string &fileName,
+                      const std::vector<Entry> &entries);
+
+private:
+    MappedFile file;
+    const Key *keys {nullptr};
+    const uint8_t *results {nullptr};
+    size_t count {0};
+};
+
+#ifdef ENDGAME_LEARNING
+
+static const int SAVE_ENDGAME_EVERY_N_GAMES = 256;
+
+/// EndgameRecord is a record of the log, the endgames learned since the file
+/// was last compacted.
+
+struct EndgameRecord
+{
+    Key key;
+    uint32_t type;
+};
+
+/// EndgameDB is the database of the learned endgames. The compact file is
+/// memory mapped, so that opening it is instant. The new endgames are
+/// appended to a log and merged into the file by compact(), the last result
+/// of a key winning.
+
+class EndgameDB
+{
+public:
+    bool open(const std::string &fileName);
+    bool compact();
+    void close();
+
+    bool probe(Key key, Endgame &endgame) const;
+    void record(Key key, const Endgame &endgame);
+
+private:
+    mutable std::shared_mutex mutex;
+    std::string fileName;
+    EndgameFile file;
+    std::unordered_map<Key, EndGameType> pending;
+};
+
+extern EndgameDB endgameDB;
 
 #endif // ENDGAME_LEARNING
 
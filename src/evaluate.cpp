@@ -14,11 +14,52 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifdef USE_AVX2
+#include <immintrin.h>
+#endif
+
 #include "evaluate.h"
 #include "bitboard.h"
+#include "nnue/evaluate_nnue.h"
 #include "option.h"
 #include "thread.h"
 
+namespace Eval {
+
+Weights weights = {
+    {
+        GRAIN * VALUE_EACH_PIECE_INHAND,
+        GRAIN * VALUE_EACH_PIECE_ONBOARD,
+        GRAIN * VALUE_EACH_PIECE_PLACING_NEEDREMOVE,
+        GRAIN * VALUE_EACH_PIECE_MOVING_NEEDREMOVE,
+        4,  // Mobility in the placing phase
+        2,  // Mobility in the moving phase
+        -4, // Blocked piece
+        2,  // Open two-in-a-row
+        8,  // Double threat
+        12, // Double mill
+        8,  // Threat of a side which can fly
+    },
+    {
+        RATING_ONE_MILL,
+        RATING_BLOCK_ONE_MILL,
+        RATING_STAR_SQUARE,
+    },
+};
+
+const char *const Weights::FieldNames[FIELD_NB] = {
+    "PieceInHand",     "PieceOnBoard",   "PlacingRemove", "MovingRemove",
+    "MobilityPlacing", "MobilityMoving", "BlockedPiece",  "OpenTwo",
+    "DoubleThreat",    "DoubleMill",     "FlyThreat",     "RatingOneMill",
+    "RatingBlockOneMill", "RatingStarSquare",
+};
+
+} // namespace Eval
+
 namespace {
 
 class Evaluation
@@ -30,77 +71,177 @@ public:
     { }
     Evaluation &operator=(const Evaluation &) = delete;
     Value value();
+    void trace(int terms[Eval::TERM_NB]);
 
 private:
+    void features(Color us, int sign, int terms[Eval::TERM_NB]);
+
     Position &pos;
 };
 
-// Evaluation::value() is the main function of the class. It computes the
-// various parts of the evaluation and returns the value of the position from
-// the point of view of the side to move.
+// Evaluation::features() counts the bitboard features of one side: mobility,
+// blocked pieces, open two-in-a-rows, double threats and double mills, and the
+// threats of a side which is able to fly.
 
-Value Evaluation::value()
+void Evaluation::features(Color us, int sign, int terms[Eval::TERM_NB])
 {
-    Value value = VALUE_ZERO;
+    using namespace Eval;
 
-    int pieceInHandDiffCount;
-    int pieceOnBoardDiffCount;
-    int pieceToRemoveCount = (pos.side_to_move() == WHITE) ?
-                                 pos.piece_to_remove_count() :
-                                 -pos.piece_to_remove_count();
+    const bool moving = pos.get_phase() == Phase::moving;
+    const bool canFly = rule.mayFly && pos.piece_on_board_count(us) +
+                                               pos.piece_in_hand_count(us) <=
+                                           rule.flyPieceCount;
 
-    switch (pos.get_phase()) {
-    case Phase::ready:
-        break;
+    // A flying piece is never blocked
+    if (gameOptions.getConsiderMobility()) {
+        if (!moving) {
+            terms[TERM_MOBILITY_PLACING] += sign * pos.mobility(us);
+        } else if (!canFly) {
+            terms[TERM_MOBILITY_MOVING] += sign * pos.mobility(us);
+            terms[TERM_BLOCKED_PIECE] += sign * pos.blocked_count(us);
+        }
+    }
 
-    case Phase::placing:
-        if (gameOptions.getConsiderMobility()) {
-            value += pos.get_mobility_diff();
+    terms[TERM_OPEN_TWO] += sign * pos.open_two_count(us);
+
+    if (pos.open_two_count(us) == 0) {
+        return;
+    }
+
+    // Look for the empty squares which would close a mill. In the moving
+    // phase one of our pieces must be able to step in from outside the line.
+    const Bitboard ours = pos.byColorBB[us];
+    const Bitboard empty = ~pos.byTypeBB[ALL_PIECES];
+    int threatCount = 0;
+    bool doubleThreat = false;
+    bool doubleMill = false;
+
+    for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
+        if (!(empty & s)) {
+            continue;
         }
 
-        pieceInHandDiffCount = pos.piece_in_hand_count(WHITE) -
-                               pos.piece_in_hand_count(BLACK);
-        value += VALUE_EACH_PIECE_INHAND * pieceInHandDiffCount;
+        int lineCount = 0;
 
-        pieceOnBoardDiffCount = pos.piece_on_board_count(WHITE) -
-                                pos.piece_on_board_count(BLACK);
-        value += VALUE_EACH_PIECE_ONBOARD * pieceOnBoardDiffCount;
+        for (int ld = 0; ld < LD_NB; ld++) {
+            const Bitboard mt = Position::millTableBB[s][ld];
 
-        switch (pos.get_action()) {
-        case Action::select:
-        case Action::place:
-            break;
+            if (mt == ~0U || (ours & mt) != mt) {
+                continue;
+            }
 
-        case Action::remove:
-            value += VALUE_EACH_PIECE_PLACING_NEEDREMOVE * pieceToRemoveCount;
-            break;
-        default:
-            break;
+            if (!moving || canFly) {
+                lineCount++;
+                continue;
+            }
+
+            for (MoveDirection d = MD_BEGIN; d < MD_NB; ++d) {
+                const Square t = MoveList<LEGAL>::adjacentSquares[s][d];
+
+                if (!t || !(ours & t) || (mt & t)) {
+                    continue;
+                }
+
+                lineCount++;
+
+                // The piece leaves a mill to close another one, and can
+                // go back and forth between them
+                if (pos.mills_count(t)) {
+                    doubleMill = true;
+                }
+
+                break;
+            }
+        }
+
+        if (lineCount > 0) {
+            threatCount++;
+        }
+
+        if (lineCount > 1) {
+            doubleThreat = true;
+        }
+    }
+
+    if (threatCount > 1 || doubleThreat) {
+        terms[TERM_DOUBLE_THREAT] += sign;
+    }
+
+    if (doubleMill) {
+        terms[TERM_DOUBLE_MILL] += sign;
+    }
+
+    if (moving && canFly && threatCount > 0) {
+        terms[TERM_FLY_THREAT] += sign;
+    }
+}
+
+// Evaluation::trace() counts the weighted terms of a placing or moving
+// position, as the difference between White and Black.
+
+void Evaluation::trace(int terms[Eval::TERM_NB])
+{
+    using namespace Eval;
+
+    std::fill(terms, terms + TERM_NB, 0);
+
+    const int pieceToRemoveCount = (pos.side_to_move() == WHITE) ?
+                                       pos.piece_to_remove_count() :
+                                       -pos.piece_to_remove_count();
+
+    switch (pos.get_phase()) {
+    case Phase::placing:
+        terms[TERM_PIECE_IN_HAND] = pos.piece_in_hand_count(WHITE) -
+                                    pos.piece_in_hand_count(BLACK);
+        terms[TERM_PIECE_ON_BOARD] = pos.piece_on_board_count(WHITE) -
+                                     pos.piece_on_board_count(BLACK);
+
+        if (pos.get_action() == Action::remove) {
+            terms[TERM_PLACING_REMOVE] = pieceToRemoveCount;
         }
 
         break;
 
     case Phase::moving:
-        if (gameOptions.getConsiderMobility()) {
-            value += pos.get_mobility_diff();
+        terms[TERM_PIECE_ON_BOARD] = pos.piece_on_board_count(WHITE) -
+                                     pos.piece_on_board_count(BLACK);
+
+        if (pos.get_action() == Action::remove) {
+            terms[TERM_MOVING_REMOVE] = pieceToRemoveCount;
         }
 
-        value = (pos.piece_on_board_count(WHITE) -
-                 pos.piece_on_board_count(BLACK)) *
-                VALUE_EACH_PIECE_ONBOARD;
+        break;
 
-        switch (pos.get_action()) {
-        case Action::select:
-        case Action::place:
-            break;
+    default:
+        return;
+    }
 
-        case Action::remove:
-            value += VALUE_EACH_PIECE_MOVING_NEEDREMOVE * pieceToRemoveCount;
-            break;
-        default:
+    features(WHITE, 1, terms);
+    features(BLACK, -1, terms);
+}
+
+// Evaluation::value() is the main function of the class. It computes the
+// various parts of the evaluation and returns the value of the position from
+// the point of view of the side to move.
+
+Value Evaluation::value()
+{
+    Value value = VALUE_ZERO;
+    int terms[Eval::TERM_NB];
+
+    switch (pos.get_phase()) {
+    case Phase::ready:
+        break;
+
+    case Phase::placing:
+    case Phase::moving:
+        if (Eval::NNUE::is_enabled()) {
+            value = Eval::NNUE::evaluate(pos);
             break;
         }
 
+        trace(terms);
+        value = Eval::evaluate(terms, Eval::weights);
         break;
 
     case Phase::gameOver:
@@ -167,5 +308,524 @@ Value Evaluation::value()
 
 Value Eval::evaluate(Position &pos)
 {
+#ifdef EVALUATION_CACHE_ENABLE
+    Thread *th = pos.this_thread();
+
+    // Only the placing and moving phases are worth caching
+    if (th != nullptr && (pos.get_phase() == Phase::placing ||
+                          pos.get_phase() == Phase::moving)) {
+        const Key key = pos.key();
+        Entry *e = th->evalTable[key];
+
+        if (e->key == key && e->value != VALUE_NONE) {
+#ifdef EVALUATION_CACHE_DEBUG
+            th->evalCacheHitCount++;
+#endif
+            return e->value;
+        }
+
+#ifdef EVALUATION_CACHE_DEBUG
+        th->evalCacheMissCount++;
+#endif
+
+        e->key = key;
+        e->value = Evaluation(pos).value();
+
+        return e->value;
+    }
+#endif // EVALUATION_CACHE_ENABLE
+
     return Evaluation(pos).value();
 }
+
+/// Eval::evaluate() weights the traced terms of a placing or moving position.
+/// The result is from White's point of view.
+
+Value Eval::evaluate(const int terms[TERM_NB], const Weights &w)
+{
+    int score = 0;
+
+    for (int i = 0; i < TERM_NB; i++) {
+        score += w.term[i] * terms[i];
+    }
+
+    return Value(std::clamp(score / GRAIN, -(int)VALUE_MATE + 1,
+                            (int)VALUE_MATE - 1));
+}
+
+/// Eval::trace() fills the terms of a placing or moving position, and zeroes
+/// them in the other phases.
+
+void Eval::trace(Position &pos, int terms[TERM_NB])
+{
+    Evaluation(pos).trace(terms);
+}
+
+/// Eval::Batch::add() appends a position to the batch.
+
+void Eval::Batch::add(const Position &pos)
+{
+    white.push_back(static_cast<int32_t>(pos.byColorBB[WHITE]));
+    black.push_back(static_cast<int32_t>(pos.byColorBB[BLACK]));
+    ban.push_back(static_cast<int32_t>(pos.byTypeBB[BAN]));
+    sideToMove.push_back(pos.side_to_move());
+    phase.push_back(static_cast<int32_t>(pos.get_phase()));
+    action.push_back(static_cast<int32_t>(pos.get_action()));
+    whiteInHand.push_back(pos.piece_in_hand_count(WHITE));
+    blackInHand.push_back(pos.piece_in_hand_count(BLACK));
+    toRemove.push_back(pos.piece_to_remove_count());
+}
+
+void Eval::Batch::clear()
+{
+    for (auto *v : {&white, &black, &ban, &sideToMove, &phase, &action,
+                    &whiteInHand, &blackInHand, &toRemove}) {
+        v->clear();
+    }
+}
+
+namespace {
+
+// The batch evaluation runs the same code on one position per lane. Lanes
+// hold int32_t, conditions are 0 or 1. ScalarLanes is the fallback and the
+// reference, Avx2Lanes scores 8 positions at a time.
+
+struct ScalarLanes
+{
+    using V = int32_t;
+    static constexpr int N = 1;
+
+    static V load(const int32_t *p) { return *p; }
+    static void store(int32_t *p, V a) { *p = a; }
+    static V set1(int32_t x) { return x; }
+    // Wrapping like the vector instructions
+    static V add(V a, V b) { return V(uint32_t(a) + uint32_t(b)); }
+    static V sub(V a, V b) { return V(uint32_t(a) - uint32_t(b)); }
+    static V mul(V a, V b) { return V(uint32_t(a) * uint32_t(b)); }
+    static V and_(V a, V b) { return a & b; }
+    static V or_(V a, V b) { return a | b; }
+    static V bit(V a, int n) { return (static_cast<uint32_t>(a) >> n) & 1; }
+    static V sra(V a, int n) { return a >> n; }
+    static V eq(V a, V b) { return a == b; }
+    static V gt(V a, V b) { return a > b; }
+    static V min(V a, V b) { return std::min(a, b); }
+    static V max(V a, V b) { return std::max(a, b); }
+};
+
+#ifdef USE_AVX2
+struct Avx2Lanes
+{
+    using V = __m256i;
+    static constexpr int N = 8;
+
+    static V load(const int32_t *p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    static void store(int32_t *p, V a)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), a);
+    }
+    static V set1(int32_t x) { return _mm256_set1_epi32(x); }
+    static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_epi32(a, b); }
+    static V mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+    static V and_(V a, V b) { return _mm256_and_si256(a, b); }
+    static V or_(V a, V b) { return _mm256_or_si256(a, b); }
+    static V bit(V a, int n)
+    {
+        return _mm256_and_si256(_mm256_srl_epi32(a, _mm_cvtsi32_si128(n)),
+                                _mm256_set1_epi32(1));
+    }
+    static V sra(V a, int n)
+    {
+        return _mm256_sra_epi32(a, _mm_cvtsi32_si128(n));
+    }
+    static V eq(V a, V b)
+    {
+        return _mm256_and_si256(_mm256_cmpeq_epi32(a, b),
+                                _mm256_set1_epi32(1));
+    }
+    static V gt(V a, V b)
+    {
+        return _mm256_and_si256(_mm256_cmpgt_epi32(a, b),
+                                _mm256_set1_epi32(1));
+    }
+    static V min(V a, V b) { return _mm256_min_epi32(a, b); }
+    static V max(V a, V b) { return _mm256_max_epi32(a, b); }
+};
+#endif
+
+/// BoardTables lists the neighbours and the lines of each square of the
+/// current rule, taken from the tables of Position and MoveList.
+
+struct BoardTables
+{
+    int adjacent[SQUARE_NB][MD_NB]; // -1 when none
+    int lines[SQUARE_NB][LD_NB][2]; // The two other squares, -1 when none
+    int distinctLines[SQUARE_NB][3];
+    int distinctLineCount;
+
+    BoardTables()
+    {
+        distinctLineCount = 0;
+
+        for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
+            const int i = s - SQ_BEGIN;
+
+            for (MoveDirection d = MD_BEGIN; d < MD_NB; ++d) {
+                const Square t = MoveList<LEGAL>::adjacentSquares[s][d];
+                adjacent[i][d] = t ? t - SQ_BEGIN : -1;
+            }
+
+            for (int ld = 0; ld < LD_NB; ld++) {
+                const Bitboard mt = Position::millTableBB[s][ld];
+                int *other = lines[i][ld];
+
+                other[0] = other[1] = -1;
+
+                if (mt == ~0U) {
+                    continue;
+                }
+
+                int k = 0;
+
+                for (Square t = SQ_BEGIN; t < SQ_END; ++t) {
+                    if (mt & t) {
+                        other[k++] = t - SQ_BEGIN;
+                    }
+                }
+
+                // Each line once, from its lowest square
+                if (!(mt & (square_bb(s) - 1))) {
+                    int *line = distinctLines[distinctLineCount++];
+                    line[0] = i;
+                    line[1] = other[0];
+                    line[2] = other[1];
+                }
+            }
+        }
+    }
+};
+
+/// side_terms() adds the terms of one side, as Evaluation::features() does,
+/// with the given sign.
+
+template <typename L>
+void side_terms(const BoardTables &tb, typename L::V own,
+                typename L::V empty, typename L::V moving,
+                typename L::V canFly, int sign, typename L::V *terms)
+{
+    using V = typename L::V;
+    using namespace Eval;
+
+    const V zero = L::set1(0);
+    const V one = L::set1(1);
+    const V s1 = L::set1(sign);
+
+    V ownBit[SQUARE_NB], emptyBit[SQUARE_NB];
+
+    for (int i = 0; i < SQUARE_NB; i++) {
+        ownBit[i] = L::bit(own, i + SQ_BEGIN);
+        emptyBit[i] = L::bit(empty, i + SQ_BEGIN);
+    }
+
+    // Mobility and blocked pieces
+    if (gameOptions.getConsiderMobility()) {
+        V mobility = zero, blocked = zero;
+
+        for (int i = 0; i < SQUARE_NB; i++) {
+            V n = zero;
+
+            for (int d = MD_BEGIN; d < MD_NB; d++) {
+                if (tb.adjacent[i][d] >= 0) {
+                    n = L::add(n, emptyBit[tb.adjacent[i][d]]);
+                }
+            }
+
+            mobility = L::add(mobility, L::mul(ownBit[i], n));
+            blocked = L::add(blocked, L::and_(ownBit[i], L::eq(n, zero)));
+        }
+
+        const V placing = L::sub(one, moving);
+        const V slide = L::mul(moving, L::sub(one, canFly));
+
+        terms[TERM_MOBILITY_PLACING] = L::add(
+            terms[TERM_MOBILITY_PLACING], L::mul(s1, L::mul(placing, mobility)));
+        terms[TERM_MOBILITY_MOVING] = L::add(
+            terms[TERM_MOBILITY_MOVING], L::mul(s1, L::mul(slide, mobility)));
+        terms[TERM_BLOCKED_PIECE] = L::add(
+            terms[TERM_BLOCKED_PIECE], L::mul(s1, L::mul(slide, blocked)));
+    }
+
+    // Open two-in-a-rows
+    V openTwo = zero;
+
+    for (int k = 0; k < tb.distinctLineCount; k++) {
+        const int *line = tb.distinctLines[k];
+        const V e = L::add(L::add(emptyBit[line[0]], emptyBit[line[1]]),
+                           emptyBit[line[2]]);
+        const V o = L::add(L::add(ownBit[line[0]], ownBit[line[1]]),
+                           ownBit[line[2]]);
+
+        openTwo = L::add(openTwo,
+                         L::and_(L::eq(e, one), L::eq(o, L::set1(2))));
+    }
+
+    terms[TERM_OPEN_TWO] = L::add(terms[TERM_OPEN_TWO], L::mul(s1, openTwo));
+
+    // Squares in a closed mill of ours
+    V inMill[SQUARE_NB];
+
+    for (int i = 0; i < SQUARE_NB; i++) {
+        inMill[i] = zero;
+
+        for (int ld = 0; ld < LD_NB; ld++) {
+            const int *other = tb.lines[i][ld];
+
+            if (other[0] >= 0) {
+                inMill[i] = L::or_(inMill[i], L::and_(ownBit[other[0]],
+                                                      ownBit[other[1]]));
+            }
+        }
+    }
+
+    // Mill threats, as in Evaluation::features()
+    const V anywhere = L::or_(L::sub(one, moving), canFly);
+    V threatCount = zero, doubleThreat = zero, doubleMill = zero;
+
+    for (int i = 0; i < SQUARE_NB; i++) {
+        V lineCount = zero;
+
+        for (int ld = 0; ld < LD_NB; ld++) {
+            const int *other = tb.lines[i][ld];
+
+            if (other[0] < 0) {
+                continue;
+            }
+
+            const V full = L::and_(emptyBit[i],
+                                   L::and_(ownBit[other[0]], ownBit[other[1]]));
+            V found = zero, firstInMill = zero;
+
+            for (int d = MD_BEGIN; d < MD_NB; d++) {
+                const int t = tb.adjacent[i][d];
+
+                if (t < 0 || t == other[0] || t == other[1]) {
+                    continue;
+                }
+
+                const V candidate = L::and_(ownBit[t], L::sub(one, found));
+                firstInMill = L::or_(firstInMill,
+                                     L::and_(candidate, inMill[t]));
+                found = L::or_(found, candidate);
+            }
+
+            lineCount = L::add(lineCount,
+                               L::and_(full, L::or_(anywhere, found)));
+            doubleMill = L::or_(doubleMill,
+                                L::and_(L::and_(full, firstInMill),
+                                        L::sub(one, anywhere)));
+        }
+
+        threatCount = L::add(threatCount, L::gt(lineCount, zero));
+        doubleThreat = L::or_(doubleThreat, L::gt(lineCount, one));
+    }
+
+    terms[TERM_DOUBLE_THREAT] = L::add(
+        terms[TERM_DOUBLE_THREAT],
+        L::mul(s1, L::or_(L::gt(threatCount, one), doubleThreat)));
+    terms[TERM_DOUBLE_MILL] = L::add(terms[TERM_DOUBLE_MILL],
+                                     L::mul(s1, doubleMill));
+    terms[TERM_FLY_THREAT] = L::add(
+        terms[TERM_FLY_THREAT],
+        L::mul(s1, L::and_(L::and_(moving, canFly),
+                           L::gt(threatCount, zero))));
+}
+
+/// popcount32() counts the bits of each lane.
+
+template <typename L>
+typename L::V popcount32(typename L::V x)
+{
+    x = L::sub(x, L::and_(L::sra(x, 1), L::set1(0x55555555)));
+    x = L::add(L::and_(x, L::set1(0x33333333)),
+               L::and_(L::sra(x, 2), L::set1(0x33333333)));
+    x = L::and_(L::add(x, L::sra(x, 4)), L::set1(0x0F0F0F0F));
+
+    return L::and_(L::sra(L::mul(x, L::set1(0x01010101)), 24),
+                   L::set1(0xFF));
+}
+
+/// evaluate_lanes() scores L::N positions of the batch from index i.
+
+template <typename L>
+void evaluate_lanes(const BoardTables &tb, const Eval::Batch &b, size_t i,
+                    int32_t *out)
+{
+    using V = typename L::V;
+    using namespace Eval;
+
+    const V zero = L::set1(0);
+    const V one = L::set1(1);
+
+    const V white = L::load(&b.white[i]);
+    const V black = L::load(&b.black[i]);
+    const V empty = L::sub(L::set1(-1),
+                           L::or_(L::or_(white, black), L::load(&b.ban[i])));
+    const V phase = L::load(&b.phase[i]);
+    const V placing = L::eq(phase, L::set1(int32_t(Phase::placing)));
+    const V moving = L::eq(phase, L::set1(int32_t(Phase::moving)));
+    const V remove = L::eq(L::load(&b.action[i]),
+                           L::set1(int32_t(Action::remove)));
+    const V black2move = L::eq(L::load(&b.sideToMove[i]), L::set1(BLACK));
+    const V whiteInHand = L::load(&b.whiteInHand[i]);
+    const V blackInHand = L::load(&b.blackInHand[i]);
+    const V whiteOnBoard = popcount32<L>(white);
+    const V blackOnBoard = popcount32<L>(black);
+
+    // +toRemove for White to move, -toRemove for Black
+    const V toRemove = L::mul(L::load(&b.toRemove[i]),
+                              L::sub(one, L::add(black2move, black2move)));
+
+    V terms[TERM_NB];
+
+    for (auto &t : terms) {
+        t = zero;
+    }
+
+    terms[TERM_PIECE_IN_HAND] = L::mul(placing,
+                                       L::sub(whiteInHand, blackInHand));
+    terms[TERM_PIECE_ON_BOARD] = L::sub(whiteOnBoard, blackOnBoard);
+    terms[TERM_PLACING_REMOVE] = L::mul(L::and_(placing, remove), toRemove);
+    terms[TERM_MOVING_REMOVE] = L::mul(L::and_(moving, remove), toRemove);
+
+    const V flyCount = L::set1(rule.flyPieceCount);
+    const V mayFly = L::set1(rule.mayFly ? 1 : 0);
+    const V whiteCanFly = L::and_(
+        mayFly, L::sub(one, L::gt(L::add(whiteOnBoard, whiteInHand), flyCount)));
+    const V blackCanFly = L::and_(
+        mayFly, L::sub(one, L::gt(L::add(blackOnBoard, blackInHand), flyCount)));
+
+    side_terms<L>(tb, white, empty, moving, whiteCanFly, 1, terms);
+    side_terms<L>(tb, black, empty, moving, blackCanFly, -1, terms);
+
+    V score = zero;
+
+    for (int t = 0; t < TERM_NB; t++) {
+        score = L::add(score, L::mul(L::set1(weights.term[t]), terms[t]));
+    }
+
+    // Truncating division by GRAIN, like the scalar evaluator
+    static_assert(GRAIN == 4, "GRAIN must be 4");
+    score = L::sra(L::add(score, L::and_(L::sra(score, 31), L::set1(3))), 2);
+    score = L::max(L::min(score, L::set1(VALUE_MATE - 1)),
+                   L::set1(-VALUE_MATE + 1));
+
+    // Point of view of the side to move, VALUE_ZERO out of the game
+    score = L::mul(score, L::sub(one, L::add(black2move, black2move)));
+    score = L::mul(score, L::or_(placing, moving));
+
+    L::store(out, score);
+}
+
+} // namespace
+
+/// Eval::evaluate_batch() scores the positions of a batch from the point of
+/// view of their side to move, as Eval::evaluate() does with the classic
+/// evaluation.
+
+void Eval::evaluate_batch(const Batch &batch, Value *values)
+{
+    const BoardTables tb;
+    const size_t n = batch.size();
+    size_t i = 0;
+
+#ifdef USE_AVX2
+    for (; i + Avx2Lanes::N <= n; i += Avx2Lanes::N) {
+        int32_t out[Avx2Lanes::N];
+
+        evaluate_lanes<Avx2Lanes>(tb, batch, i, out);
+
+        for (int k = 0; k < Avx2Lanes::N; k++) {
+            values[i + k] = Value(out[k]);
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        int32_t out;
+
+        evaluate_lanes<ScalarLanes>(tb, batch, i, &out);
+        values[i] = Value(out);
+    }
+}
+
+/// Eval::load_weights() reads a weights file: one "name value" pair per line,
+/// '#' starts a comment. Weights not in the file keep their value. Returns
+/// false, leaving the weights untouched, if the file cannot be read or has an
+/// unknown name.
+
+bool Eval::load_weights(const std::string &fileName)
+{
+    std::ifstream file(fileName);
+
+    if (!file) {
+        return false;
+    }
+
+    Weights w = weights;
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::istringstream is(line.substr(0, line.find('#')));
+        std::string name;
+        int value;
+
+        if (!(is >> name)) {
+            continue;
+        }
+
+        int *field = w.find(name);
+
+        if (field == nullptr || !(is >> value)) {
+            return false;
+        }
+
+        *field = value;
+    }
+
+    weights = w;
+
+    return true;
+}
+
+/// Eval::save_weights() writes the weights in the format read by
+/// load_weights().
+
+bool Eval::save_weights(const std::string &fileName, const Weights &w)
+{
+    std::ofstream file(fileName);
+
+    file << "# Sanmill evaluation weights, in grains of 1/" << GRAIN
+         << " value\n";
+
+    for (int i = 0; i < Weights::FIELD_NB; i++) {
+        file << Weights::FieldNames[i] << " " << w.field(i) << "\n";
+    }
+
+    return bool(file);
+}
+
+/// Eval::Weights::find() returns the weight of the given name, or nullptr.
+
+int *Eval::Weights::find(const std::string &name)
+{
+    for (int i = 0; i < FIELD_NB; i++) {
+        if (name == FieldNames[i]) {
+            return &field(i);
+        }
+    }
+
+    return nullptr;
+}
@@ -18,15 +18,111 @@
 #define EVALUATE_H_INCLUDED
 
 #include <string>
+#include <vector>
 
+#include "misc.h"
 #include "types.h"
 
 class Position;
 
 namespace Eval {
 
+// The weights of the evaluation terms are in grains, a quarter of a Value, so
+// that the small features are not lost in the rounding.
+constexpr int GRAIN = 4;
+
+/// Eval::Term enumerates the weighted terms of the evaluation. Each term is a
+/// feature count of White minus the same count of Black.
+
+enum Term : int {
+    TERM_PIECE_IN_HAND,
+    TERM_PIECE_ON_BOARD,
+    TERM_PLACING_REMOVE,
+    TERM_MOVING_REMOVE,
+    TERM_MOBILITY_PLACING,
+    TERM_MOBILITY_MOVING,
+    TERM_BLOCKED_PIECE,
+    TERM_OPEN_TWO,
+    TERM_DOUBLE_THREAT,
+    TERM_DOUBLE_MILL,
+    TERM_FLY_THREAT,
+    TERM_NB
+};
+
+/// Eval::RatingWeight enumerates the move ordering ratings of MovePicker.
+
+enum RatingWeight : int {
+    RATING_WEIGHT_ONE_MILL,
+    RATING_WEIGHT_BLOCK_ONE_MILL,
+    RATING_WEIGHT_STAR_SQUARE,
+    RATING_WEIGHT_NB
+};
+
+/// Eval::Weights holds the evaluation and move ordering weights. The defaults
+/// are compiled in, a weights file can override them at runtime.
+
+struct Weights
+{
+    static constexpr int FIELD_NB = TERM_NB + RATING_WEIGHT_NB;
+    static const char *const FieldNames[FIELD_NB];
+
+    int term[TERM_NB];
+    int rating[RATING_WEIGHT_NB];
+
+    int &field(int i) { return i < TERM_NB ? term[i] : rating[i - TERM_NB]; }
+
+    int field(int i) const
+    {
+        return i < TERM_NB ? term[i] : rating[i - TERM_NB];
+    }
+
+    int *find(const std::string &name);
+};
+
+extern Weights weights;
+
 Value evaluate(Position &pos);
+Value evaluate(const int terms[TERM_NB], const Weights &w);
+void trace(Position &pos, int terms[TERM_NB]);
+
+/// Eval::Batch is a structure of arrays of placing and moving positions, for
+/// scoring many positions at once with evaluate_batch(). Other phases are
+/// scored VALUE_ZERO. The fields are int32_t so that they load as vectors.
+
+struct Batch
+{
+    std::vector<int32_t> white; // Bitboards
+    std::vector<int32_t> black;
+    std::vector<int32_t> ban;
+    std::vector<int32_t> sideToMove;
+    std::vector<int32_t> phase;
+    std::vector<int32_t> action;
+    std::vector<int32_t> whiteInHand;
+    std::vector<int32_t> blackInHand;
+    std::vector<int32_t> toRemove;
+
+    size_t size() const { return white.size(); }
+
+    void add(const Position &pos);
+    void clear();
+};
+
+void evaluate_batch(const Batch &batch, Value *values);
+
+bool load_weights(const std::string &fileName);
+bool save_weights(const std::string &fileName, const Weights &w);
+
+/// Eval::Entry caches the static evaluation of a position. Each thread has a
+/// small direct-mapped table of them, indexed by the position key.
+
+struct Entry
+{
+    Key key {0};
+    Value value {VALUE_NONE};
+};
+
+using Table = HashTable<Entry, 16384>;
 
-}
+} // namespace Eval
 
 #endif // #ifndef EVALUATE_H_INCLUDED
@@ -15,6 +15,8 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "bitboard.h"
+#include "book.h"
+#include "evaluate.h"
 #include "position.h"
 #include "search.h"
 #include "thread.h"
@@ -38,15 +40,25 @@ int main(int argc, char *argv[])
 #endif
 
     UCI::init(Options);
+    Eval::load_weights(Options["EvalFile"]); // Built-in weights if missing
+    Book::open(Options["BookFile"]);          // Empty book if missing
     Bitboards::init();
     Position::init();
     Threads.set(size_t(Options["Threads"]));
     Search::clear(); // After threads are up
 
+#ifdef ENDGAME_LEARNING
+    Thread::openEndgameFile(); // Instant, the file is memory mapped
+#endif // ENDGAME_LEARNING
+
 #ifndef UNIT_TEST_MODE
     UCI::loop(argc, argv);
 #endif
 
+#ifdef ENDGAME_LEARNING
+    Thread::compactEndgameFile();
+#endif // ENDGAME_LEARNING
+
     Threads.set(0);
     return 0;
 }
@@ -367,18 +367,32 @@ void mill_table_init()
     }
 }
 
+namespace {
+
+// std::shuffle() and the standard engines are implementation defined, so the
+// Fisher-Yates shuffle is done with our own PRNG to give the same order for a
+// given seed on every platform.
+template <size_t N>
+void shuffle(std::array<Square, N> &list, PRNG &rng)
+{
+    for (size_t i = N - 1; i > 0; i--) {
+        std::swap(list[i], list[rng.rand<uint64_t>() % (i + 1)]);
+    }
+}
+
+} // namespace
+
 void move_priority_list_shuffle()
 {
+    const int seed = gameOptions.getShufflingSeed();
+    PRNG rng(seed ? uint64_t(seed) : uint64_t(now()));
+
     if (gameOptions.getSkillLevel() == 1) {
         for (auto i = 8; i < 32; i++) { // TODO(calcitem): SQ_BEGIN & SQ_END
             MoveList<LEGAL>::movePriorityList[i - int(SQ_BEGIN)] = (Square)i;
         }
         if (gameOptions.getShufflingEnabled()) {
-            const uint32_t seed = static_cast<uint32_t>(now());
-
-            std::shuffle(MoveList<LEGAL>::movePriorityList.begin(),
-                         MoveList<LEGAL>::movePriorityList.end(),
-                         std::default_random_engine(seed));
+            shuffle(MoveList<LEGAL>::movePriorityList, rng);
         }
         return;
     }
@@ -405,16 +419,10 @@ void move_priority_list_shuffle()
     }
 
     if (gameOptions.getShufflingEnabled()) {
-        const uint32_t seed = static_cast<uint32_t>(now());
-
-        std::shuffle(movePriorityList0.begin(), movePriorityList0.end(),
-                     std::default_random_engine(seed));
-        std::shuffle(movePriorityList1.begin(), movePriorityList1.end(),
-                     std::default_random_engine(seed));
-        std::shuffle(movePriorityList2.begin(), movePriorityList2.end(),
-                     std::default_random_engine(seed));
-        std::shuffle(movePriorityList3.begin(), movePriorityList3.end(),
-                     std::default_random_engine(seed));
+        shuffle(movePriorityList0, rng);
+        shuffle(movePriorityList1, rng);
+        shuffle(movePriorityList2, rng);
+        shuffle(movePriorityList3, rng);
     }
 
     for (size_t i = 0; i < 4; i++) {
@@ -49,6 +49,13 @@ typedef bool (*fun3_t)(HANDLE, CONST GROUP_AFFINITY *, PGROUP_AFFINITY);
 #include <sys/mman.h>
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #if defined(__APPLE__) || defined(__ANDROID__) || defined(__OpenBSD__) || \
     (defined(__GLIBCXX__) && !defined(_GLIBCXX_HAVE_ALIGNED_ALLOC) && \
      !defined(_WIN32))
@@ -408,6 +415,109 @@ void std_aligned_free(void *ptr)
 #endif
 }
 
+/// MappedFile::map() maps a file read-only, after unmapping the previous one.
+/// It returns false if the file cannot be mapped or is empty.
+
+bool MappedFile::map(const std::string &fileName)
+{
+    unmap();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0,
+                                    nullptr);
+
+        if (mapping) {
+            ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+
+        if (ptr) {
+            length = size_t(fileSize.QuadPart);
+        } else if (mapping) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+    }
+
+    CloseHandle(file);
+#else
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd,
+                       0);
+
+        if (p != MAP_FAILED) {
+            ptr = p;
+            length = size_t(st.st_size);
+        }
+    }
+
+    ::close(fd); // The mapping keeps its own reference to the file
+#endif
+
+    return ptr != nullptr;
+}
+
+void MappedFile::unmap()
+{
+    if (!ptr) {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(ptr);
+    CloseHandle(mapping);
+    mapping = nullptr;
+#else
+    munmap(const_cast<void *>(ptr), length);
+#endif
+
+    ptr = nullptr;
+    length = 0;
+}
+
+/// MappedFile::advise() tells the system how the bytes [offset, offset + len)
+/// will be accessed. madvise() wants a page aligned address, so the range is
+/// widened to whole pages. It is only a hint, and a no-op on Windows.
+
+void MappedFile::advise(size_t offset, size_t len, Advice advice) const
+{
+    if (!ptr || offset >= length) {
+        return;
+    }
+
+    len = std::min(len, length - offset);
+
+#if defined(_WIN32)
+    (void)advice;
+#else
+    static const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset / pageSize * pageSize;
+    static const int flags[] = {MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL,
+                                MADV_WILLNEED, MADV_DONTNEED};
+
+    madvise(const_cast<char *>(static_cast<const char *>(ptr)) + begin,
+            offset + len - begin, flags[advice]);
+#endif
+}
+
 #ifdef ALIGNED_LARGE_PAGES
 
 /// aligned_large_pages_alloc() will return suitably aligned memory, if possible
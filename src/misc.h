@@ -17,6 +17,7 @@
 #ifndef MISC_H_INCLUDED
 #define MISC_H_INCLUDED
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstdint>
@@ -41,6 +42,37 @@ void *aligned_large_pages_alloc(size_t allocSize);
 void aligned_large_pages_free(void *mem);
 #endif // ALIGNED_LARGE_PAGES
 
+/// MappedFile maps a whole file read-only in memory. The mapping is shared
+/// with the page cache, so that opening even a large file is instant and only
+/// the pages which are read are loaded from disk. An empty or missing file is
+/// not mapped.
+
+class MappedFile
+{
+public:
+    enum Advice { NORMAL, RANDOM, SEQUENTIAL, WILL_NEED, DONT_NEED };
+
+    MappedFile() = default;
+    ~MappedFile() { unmap(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool map(const std::string &fileName);
+    void unmap();
+    void advise(size_t offset, size_t len, Advice advice) const;
+
+    const void *data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+    const void *ptr {nullptr};
+    size_t length {0};
+#ifdef _WIN32
+    void *mapping {nullptr};
+#endif
+};
+
 void dbg_hit_on(bool b) noexcept;
 void dbg_hit_on(bool c, bool b) noexcept;
 void dbg_mean_of(int v) noexcept;
@@ -63,6 +95,8 @@ struct HashTable
 {
     Entry *operator[](Key key) { return &table[(uint32_t)key & (Size - 1)]; }
 
+    void clear() { std::fill(table.begin(), table.end(), Entry()); }
+
 private:
     std::vector<Entry> table = std::vector<Entry>(Size); // Allocate on the heap
 };
@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "movepick.h"
+#include "evaluate.h"
 
 // partial_insertion_sort() sorts moves in descending order up to and including
 // a given limit. The order of moves smaller than the limit is left unspecified.
@@ -53,6 +54,14 @@ void MovePicker::score()
     int bannedCount = 0;
     int emptyCount = 0;
 
+    // The ratings can be overridden by a weights file
+    const int ratingOneMill =
+        Eval::weights.rating[Eval::RATING_WEIGHT_ONE_MILL];
+    const int ratingBlockOneMill =
+        Eval::weights.rating[Eval::RATING_WEIGHT_BLOCK_ONE_MILL];
+    const int ratingStarSquare =
+        Eval::weights.rating[Eval::RATING_WEIGHT_STAR_SQUARE];
+
     while (cur++->move != MOVE_NONE) {
         m = cur->move;
 
@@ -68,12 +77,12 @@ void MovePicker::score()
         if (type_of(m) != MOVETYPE_REMOVE) {
             // all phrase, check if place sq can close mill
             if (ourMillsCount > 0) {
-                cur->value += RATING_ONE_MILL * ourMillsCount;
+                cur->value += ratingOneMill * ourMillsCount;
             } else if (pos.get_phase() == Phase::placing) {
                 // placing phrase, check if place sq can block their close mill
                 theirMillsCount = pos.potential_mills_count(
                     to, ~pos.side_to_move());
-                cur->value += RATING_BLOCK_ONE_MILL * theirMillsCount;
+                cur->value += ratingBlockOneMill * theirMillsCount;
             } else if (pos.get_phase() == Phase::moving) {
                 // moving phrase, check if place sq can block their close mill
                 theirMillsCount = pos.potential_mills_count(
@@ -88,10 +97,10 @@ void MovePicker::score()
                                                 emptyCount);
 
                     if (to % 2 == 0 && theirPiecesCount == 3) {
-                        cur->value += RATING_BLOCK_ONE_MILL * theirMillsCount;
+                        cur->value += ratingBlockOneMill * theirMillsCount;
                     } else if (to % 2 == 1 && theirPiecesCount == 2 &&
                                rule.hasDiagonalLines) {
-                        cur->value += RATING_BLOCK_ONE_MILL * theirMillsCount;
+                        cur->value += ratingBlockOneMill * theirMillsCount;
                     }
                 }
             }
@@ -105,7 +114,7 @@ void MovePicker::score()
                 pos.count<ON_BOARD>(BLACK) < 2 && // patch: only when black 2nd
                                                   // move
                 Position::is_star_square(static_cast<Square>(m))) {
-                cur->value += RATING_STAR_SQUARE;
+                cur->value += ratingStarSquare;
             }
         } else { // Remove
             ourPieceCount = theirPiecesCount = bannedCount = emptyCount = 0;
@@ -0,0 +1,311 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Code for calculating NNUE evaluation function
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#if defined(USE_AVX2)
+#include <immintrin.h>
+#elif defined(USE_SSSE3)
+#include <tmmintrin.h>
+#elif defined(USE_SSE2)
+#include <emmintrin.h>
+#endif
+
+#include "../bitboard.h"
+#include "../position.h"
+#include "evaluate_nnue.h"
+
+namespace Eval::NNUE {
+
+uint32_t generation = 0;
+
+namespace {
+
+/// Network holds the parameters of the network, in the order of the file
+/// after its header.
+
+struct Network
+{
+    alignas(64) int16_t ftBiases[L1];
+    alignas(64) int16_t ftWeights[INPUT_DIMENSIONS][L1];
+    alignas(64) int32_t l2Biases[L2];
+    alignas(64) int8_t l2Weights[L2][L1];
+    int32_t outBias;
+    alignas(64) int8_t outWeights[L2];
+};
+
+std::unique_ptr<Network> network;
+bool enabled = false;
+uint32_t lastGeneration = 0;
+
+// apply_row() adds or subtracts a row of the feature transformer to the
+// accumulator.
+
+template <bool Add>
+void apply_row(int16_t *acc, const int16_t *row)
+{
+#if defined(USE_AVX2)
+    auto a = reinterpret_cast<__m256i *>(acc);
+    auto r = reinterpret_cast<const __m256i *>(row);
+
+    for (int i = 0; i < L1 / 16; i++) {
+        a[i] = Add ? _mm256_add_epi16(a[i], r[i]) :
+                     _mm256_sub_epi16(a[i], r[i]);
+    }
+#elif defined(USE_SSE2)
+    auto a = reinterpret_cast<__m128i *>(acc);
+    auto r = reinterpret_cast<const __m128i *>(row);
+
+    for (int i = 0; i < L1 / 8; i++) {
+        a[i] = Add ? _mm_add_epi16(a[i], r[i]) : _mm_sub_epi16(a[i], r[i]);
+    }
+#else
+    for (int i = 0; i < L1; i++) {
+        acc[i] = static_cast<int16_t>(Add ? acc[i] + row[i] : acc[i] - row[i]);
+    }
+#endif
+}
+
+// clipped_relu() clamps the accumulator to [0, 127] and packs it to bytes.
+
+void clipped_relu(const int16_t *in, uint8_t *out)
+{
+#if defined(USE_AVX2)
+    auto i = reinterpret_cast<const __m256i *>(in);
+    auto o = reinterpret_cast<__m256i *>(out);
+    const __m256i max = _mm256_set1_epi8(127);
+
+    for (int k = 0; k < L1 / 32; k++) {
+        // packus works within 128-bit lanes, restore the order afterwards
+        const __m256i packed = _mm256_packus_epi16(i[2 * k], i[2 * k + 1]);
+        o[k] = _mm256_min_epu8(_mm256_permute4x64_epi64(packed, 0xD8), max);
+    }
+#elif defined(USE_SSE2)
+    auto i = reinterpret_cast<const __m128i *>(in);
+    auto o = reinterpret_cast<__m128i *>(out);
+    const __m128i max = _mm_set1_epi8(127);
+
+    for (int k = 0; k < L1 / 16; k++) {
+        o[k] = _mm_min_epu8(_mm_packus_epi16(i[2 * k], i[2 * k + 1]), max);
+    }
+#else
+    for (int k = 0; k < L1; k++) {
+        out[k] = static_cast<uint8_t>(std::clamp<int>(in[k], 0, 127));
+    }
+#endif
+}
+
+// dot() returns the dot product of n activations and n weights. n must be a
+// multiple of 32. The activations are at most 127, so that the pairwise sums
+// of maddubs never saturate and all the paths give the same result.
+
+int32_t dot(const uint8_t *x, const int8_t *w, int n)
+{
+#if defined(USE_AVX2)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int i = 0; i < n; i += 32) {
+        const __m256i p = _mm256_maddubs_epi16(
+            _mm256_load_si256(reinterpret_cast<const __m256i *>(x + i)),
+            _mm256_load_si256(reinterpret_cast<const __m256i *>(w + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(p, ones));
+    }
+
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                              _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+
+    return _mm_cvtsi128_si32(s);
+#elif defined(USE_SSSE3)
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+
+    for (int i = 0; i < n; i += 16) {
+        const __m128i p = _mm_maddubs_epi16(
+            _mm_load_si128(reinterpret_cast<const __m128i *>(x + i)),
+            _mm_load_si128(reinterpret_cast<const __m128i *>(w + i)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(p, ones));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+
+    for (int i = 0; i < n; i++) {
+        sum += x[i] * w[i];
+    }
+
+    return sum;
+#endif
+}
+
+void update_generation()
+{
+    generation = (network && enabled) ? ++lastGeneration : 0;
+}
+
+} // namespace
+
+/// load() reads a network file: a header of four uint32, the format version
+/// and the input, L1 and L2 dimensions, followed by the parameters of Network,
+/// all little-endian. The current network is kept if the file is not valid.
+
+bool load(const std::string &fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    uint32_t header[4];
+
+    if (!file.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        header[0] != VERSION || header[1] != INPUT_DIMENSIONS ||
+        header[2] != L1 || header[3] != L2) {
+        return false;
+    }
+
+    auto net = std::make_unique<Network>();
+
+    file.read(reinterpret_cast<char *>(net->ftBiases), sizeof(net->ftBiases));
+    file.read(reinterpret_cast<char *>(net->ftWeights), sizeof(net->ftWeights));
+    file.read(reinterpret_cast<char *>(net->l2Biases), sizeof(net->l2Biases));
+    file.read(reinterpret_cast<char *>(net->l2Weights), sizeof(net->l2Weights));
+    file.read(reinterpret_cast<char *>(&net->outBias), sizeof(net->outBias));
+    file.read(reinterpret_cast<char *>(net->outWeights),
+              sizeof(net->outWeights));
+
+    if (!file || file.peek() != std::ifstream::traits_type::eof()) {
+        return false;
+    }
+
+    network = std::move(net);
+    update_generation();
+
+    return true;
+}
+
+/// set_enabled() switches the NNUE evaluation on or off. It is only used once
+/// a network is loaded.
+
+void set_enabled(bool e)
+{
+    enabled = e;
+    update_generation();
+}
+
+/// refresh() computes the accumulator of a position from scratch.
+
+void refresh(Position &pos)
+{
+    Accumulator &acc = pos.accumulator;
+
+    acc.generation = generation;
+
+    if (!generation) {
+        return;
+    }
+
+    std::memcpy(acc.values, network->ftBiases, sizeof(acc.values));
+
+    for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
+        for (const Color c : {WHITE, BLACK}) {
+            if (pos.byColorBB[c] & square_bb(s)) {
+                apply_row<true>(acc.values,
+                                network->ftWeights[piece_square_index(c, s)]);
+            }
+        }
+    }
+}
+
+/// update() adds (sign 1) or removes (sign -1) a piece of the accumulator.
+
+void update(Accumulator &acc, Color c, Square s, int sign)
+{
+    const int16_t *row = network->ftWeights[piece_square_index(c, s)];
+
+    if (sign > 0) {
+        apply_row<true>(acc.values, row);
+    } else {
+        apply_row<false>(acc.values, row);
+    }
+}
+
+/// evaluate() returns the evaluation of a placing or moving position, from
+/// White's point of view.
+
+Value evaluate(Position &pos)
+{
+    if (!is_valid(pos.accumulator)) {
+        refresh(pos);
+    }
+
+    const Network &net = *network;
+    alignas(32) int16_t sum[L1];
+
+    std::memcpy(sum, pos.accumulator.values, sizeof(sum));
+
+    // The state of the game is not kept in the accumulator
+    const int whiteInHand = std::min(pos.piece_in_hand_count(WHITE),
+                                     IN_HAND_MAX);
+    const int blackInHand = std::min(pos.piece_in_hand_count(BLACK),
+                                     IN_HAND_MAX);
+    const int phase = pos.get_phase() == Phase::moving ? 3 : 0;
+    int action;
+
+    switch (pos.get_action()) {
+    case Action::place:
+        action = 1;
+        break;
+    case Action::remove:
+        action = 2;
+        break;
+    default:
+        action = 0;
+        break;
+    }
+
+    apply_row<true>(sum, net.ftWeights[IN_HAND_OFFSET + whiteInHand]);
+    apply_row<true>(sum, net.ftWeights[IN_HAND_OFFSET + IN_HAND_MAX + 1 +
+                                       blackInHand]);
+    apply_row<true>(sum,
+                    net.ftWeights[SIDE_OFFSET + (pos.side_to_move() == BLACK)]);
+    apply_row<true>(sum, net.ftWeights[PHASE_ACTION_OFFSET + phase + action]);
+
+    alignas(32) uint8_t x1[L1];
+    alignas(32) uint8_t x2[L2];
+
+    clipped_relu(sum, x1);
+
+    for (int j = 0; j < L2; j++) {
+        const int32_t v = (net.l2Biases[j] + dot(x1, net.l2Weights[j], L1)) >>
+                          WEIGHT_SCALE_BITS;
+        x2[j] = static_cast<uint8_t>(std::clamp<int32_t>(v, 0, 127));
+    }
+
+    const int32_t out = net.outBias + dot(x2, net.outWeights, L2);
+
+    return Value(std::clamp(out / OUTPUT_SCALE, -int(VALUE_MATE) + 1,
+                            int(VALUE_MATE) - 1));
+}
+
+} // namespace Eval::NNUE
@@ -0,0 +1,52 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// header used in NNUE evaluation function
+
+#ifndef NNUE_EVALUATE_NNUE_H_INCLUDED
+#define NNUE_EVALUATE_NNUE_H_INCLUDED
+
+#include <string>
+
+#include "nnue_architecture.h"
+
+class Position;
+
+namespace Eval::NNUE {
+
+// Generation of the accumulators, 0 when the NNUE evaluation is off
+extern uint32_t generation;
+
+inline bool is_enabled()
+{
+    return generation != 0;
+}
+
+inline bool is_valid(const Accumulator &acc)
+{
+    return generation != 0 && acc.generation == generation;
+}
+
+bool load(const std::string &fileName);
+void set_enabled(bool enabled);
+
+void refresh(Position &pos);
+void update(Accumulator &acc, Color c, Square s, int sign);
+Value evaluate(Position &pos);
+
+} // namespace Eval::NNUE
+
+#endif // #ifndef NNUE_EVALUATE_NNUE_H_INCLUDED
@@ -0,0 +1,71 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Input features and network structure used in NNUE evaluation function
+
+#ifndef NNUE_ARCHITECTURE_H_INCLUDED
+#define NNUE_ARCHITECTURE_H_INCLUDED
+
+#include <cstdint>
+
+#include "../types.h"
+
+namespace Eval::NNUE {
+
+// Input features, all of them binary. The pieces on the board are updated
+// incrementally, the state of the game is added at evaluation time.
+constexpr int PIECE_SQUARE_NB = 2 * SQUARE_NB; // Color x square
+constexpr int IN_HAND_MAX = 12;
+constexpr int IN_HAND_NB = 2 * (IN_HAND_MAX + 1); // Color x pieces in hand
+constexpr int SIDE_NB = 2;                        // Side to move
+constexpr int PHASE_ACTION_NB = 6; // Placing/moving x select/place/remove
+
+constexpr int IN_HAND_OFFSET = PIECE_SQUARE_NB;
+constexpr int SIDE_OFFSET = IN_HAND_OFFSET + IN_HAND_NB;
+constexpr int PHASE_ACTION_OFFSET = SIDE_OFFSET + SIDE_NB;
+constexpr int INPUT_DIMENSIONS = PHASE_ACTION_OFFSET + PHASE_ACTION_NB;
+
+// Layer sizes. The network is
+// INPUT_DIMENSIONS -> L1 (int16 accumulator) -> ClippedReLU -> L2 (int8
+// weights) -> ClippedReLU -> 1
+constexpr int L1 = 64;
+constexpr int L2 = 32;
+
+// Fixed point scales of the hidden and output layers
+constexpr int WEIGHT_SCALE_BITS = 6;
+constexpr int OUTPUT_SCALE = 256;
+
+// Version of the network file format
+constexpr uint32_t VERSION = 0x5A4E0001;
+
+constexpr int piece_square_index(Color c, Square s)
+{
+    return (c == WHITE ? 0 : SQUARE_NB) + (s - SQ_BEGIN);
+}
+
+/// Accumulator holds the first layer of the network for the pieces on the
+/// board. It lives in the Position, so that it is restored with it, and is
+/// valid when its generation is the one of the loaded network.
+
+struct Accumulator
+{
+    alignas(32) int16_t values[L1];
+    uint32_t generation;
+};
+
+} // namespace Eval::NNUE
+
+#endif // #ifndef NNUE_ARCHITECTURE_H_INCLUDED
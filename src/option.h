@@ -70,6 +70,13 @@ public:
         shufflingEnabled = enabled;
     }
 
+    // Seed of the shuffling, 0 to seed it from the clock. A fixed seed makes
+    // the games reproducible.
+
+    void setShufflingSeed(int val) noexcept { shufflingSeed = val; }
+
+    int getShufflingSeed() const noexcept { return shufflingSeed; }
+
     bool getLearnEndgameEnabled() const noexcept { return learnEndgame; }
 
     void setLearnEndgameEnabled(bool enabled) noexcept
@@ -97,6 +104,18 @@ public:
 
     bool getPerfectAiEnabled() const noexcept { return perfectAiEnabled; }
 
+    // PerfectDatabaseMemory
+
+    void setPerfectDatabaseMemory(int mb) noexcept
+    {
+        perfectDatabaseMemory = mb;
+    }
+
+    int getPerfectDatabaseMemory() const noexcept
+    {
+        return perfectDatabaseMemory;
+    }
+
     void setIDSEnabled(bool enabled) noexcept { IDSEnabled = enabled; }
 
     bool getIDSEnabled() const noexcept { return IDSEnabled; }
@@ -107,12 +126,51 @@ public:
 
     bool getDepthExtension() const noexcept { return depthExtension; }
 
+    // FutilityPruning
+
+    void setFutilityPruning(bool enabled) noexcept
+    {
+        futilityPruning = enabled;
+    }
+
+    bool getFutilityPruning() const noexcept { return futilityPruning; }
+
+    // LateMoveReduction
+
+    void setLateMoveReduction(bool enabled) noexcept
+    {
+        lateMoveReduction = enabled;
+    }
+
+    bool getLateMoveReduction() const noexcept { return lateMoveReduction; }
+
+    // VerifiedNullMove
+
+    void setVerifiedNullMove(bool enabled) noexcept
+    {
+        verifiedNullMove = enabled;
+    }
+
+    bool getVerifiedNullMove() const noexcept { return verifiedNullMove; }
+
+    // MultiPV
+
+    void setMultiPV(int val) noexcept { multiPV = val; }
+
+    int getMultiPV() const noexcept { return multiPV; }
+
     // OpeningBook
 
     void setOpeningBook(bool enabled) noexcept { openingBook = enabled; }
 
     bool getOpeningBook() const noexcept { return openingBook; }
 
+    // CanonicalKeys
+
+    void setCanonicalKeys(bool enabled) noexcept { canonicalKeys = enabled; }
+
+    bool getCanonicalKeys() const noexcept { return canonicalKeys; }
+
     // Algorithm
 
     void setAlphaBetaAlgorithm(bool enabled) noexcept
@@ -213,6 +271,7 @@ private:
     bool isAutoChangeFirstMove {false};
     bool resignIfMostLose {false};
     bool shufflingEnabled {true};
+    int shufflingSeed {0};
 #ifdef ENDGAME_LEARNING_FORCE
     bool learnEndgame {true};
 #else
@@ -220,9 +279,15 @@ private:
 #endif
     int algorithm {2};
     bool perfectAiEnabled {false};
+    int perfectDatabaseMemory {0};
     bool IDSEnabled {false};
     bool depthExtension {true};
+    bool futilityPruning {false};
+    bool lateMoveReduction {false};
+    bool verifiedNullMove {false};
+    int multiPV {1};
     bool openingBook {false};
+    bool canonicalKeys {false};
     bool drawOnHumanExperience {true};
     bool considerMobility {true};
     bool developerMode {false};
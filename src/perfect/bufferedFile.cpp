@@ -11,6 +11,7 @@
 #ifdef MADWEASEL_MUEHLE_PERFECT_AI
 
 #include "bufferedFile.h"
+#include <cstring>
 
 //-----------------------------------------------------------------------------
 // BufferedFile()
@@ -25,7 +26,7 @@ BufferedFile::BufferedFile(uint32_t nThreads, uint32_t bufSizeInBytes,
 
     // Init blocks
     bufSize = bufSizeInBytes;
-    nThreads = nThreads;
+    threadCount = nThreads;
     readBuf = new unsigned char[nThreads * bufSize];
     std::memset(readBuf, 0, nThreads * bufSize);
     writeBuf = new unsigned char[nThreads * bufSize];
@@ -46,19 +47,9 @@ BufferedFile::BufferedFile(uint32_t nThreads, uint32_t bufSizeInBytes,
         bytesInWriteBuf[thd] = 0;
     }
 
-    InitializeCriticalSection(&csIO);
-
     // Open Database-File
-    // (FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH |
-    // FILE_FLAG_RANDOM_ACCESS)
-    hFile = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
-                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-
-    // opened file successfully
-    if (hFile == INVALID_HANDLE_VALUE) {
-        hFile = nullptr;
+    if (!file.open(fileName))
         return;
-    }
 
     // update file size
     getFileSize();
@@ -72,7 +63,6 @@ BufferedFile::~BufferedFile()
 {
     // flush bufs
     flushBuffers();
-    DeleteCriticalSection(&csIO);
 
     // delete arrays
     delete[] readBuf;
@@ -81,10 +71,6 @@ BufferedFile::~BufferedFile()
     delete[] curWritingPtr;
     delete[] bytesInReadBuf;
     delete[] bytesInWriteBuf;
-
-    // close file
-    if (hFile != nullptr)
-        CloseHandle(hFile);
 }
 
 //-----------------------------------------------------------------------------
@@ -93,9 +79,7 @@ BufferedFile::~BufferedFile()
 //-----------------------------------------------------------------------------
 int64_t BufferedFile::getFileSize()
 {
-    LARGE_INTEGER liFileSize;
-    GetFileSizeEx(hFile, &liFileSize);
-    fileSize = liFileSize.QuadPart;
+    fileSize = file.getFileSize();
 
     return fileSize;
 }
@@ -107,7 +91,7 @@ int64_t BufferedFile::getFileSize()
 bool BufferedFile::flushBuffers()
 {
     for (uint32_t thd = 0; thd < threadCount; thd++) {
-        writeDataToFile(hFile, curWritingPtr[thd] - bytesInWriteBuf[thd],
+        writeDataToFile(curWritingPtr[thd] - bytesInWriteBuf[thd],
                         bytesInWriteBuf[thd], &writeBuf[thd * bufSize + 0]);
         bytesInWriteBuf[thd] = 0;
     }
@@ -117,67 +101,25 @@ bool BufferedFile::flushBuffers()
 
 //-----------------------------------------------------------------------------
 // writeDataToFile()
-// Writes 'sizeInBytes'-bytes to the position 'offset' to the file.
+// Writes 'sizeInBytes'-bytes to the position 'offset' to the file. The threads
+// write to different positions, so that no lock is needed.
 //-----------------------------------------------------------------------------
-void BufferedFile::writeDataToFile(HANDLE fd, int64_t offset,
-                                   uint32_t sizeInBytes, void *pData)
+void BufferedFile::writeDataToFile(int64_t offset, uint32_t sizeInBytes,
+                                   void *pData)
 {
-    DWORD dwBytesWritten;
-    LARGE_INTEGER liDistanceToMove;
-    uint32_t restingBytes = sizeInBytes;
-
-    liDistanceToMove.QuadPart = offset;
-
-    EnterCriticalSection(&csIO);
-
-    while (!SetFilePointerEx(fd, liDistanceToMove, nullptr, FILE_BEGIN))
-        cout << endl << "SetFilePointerEx  failed!";
-
-    while (restingBytes > 0) {
-        if (WriteFile(fd, pData, sizeInBytes, &dwBytesWritten, nullptr) ==
-            TRUE) {
-            restingBytes -= dwBytesWritten;
-            pData = (void *)(((unsigned char *)pData) + dwBytesWritten);
-            if (restingBytes > 0)
-                cout << endl << "Still " << restingBytes << " to write!";
-        } else {
-            cout << endl << "WriteFile Failed!";
-        }
-    }
-
-    LeaveCriticalSection(&csIO);
+    if (file.write(offset, sizeInBytes, pData) != sizeInBytes)
+        cout << endl << "WriteFile Failed!";
 }
 
 //-----------------------------------------------------------------------------
 // readDataFromFile()
 // Reads 'sizeInBytes'-bytes from the position 'offset' of the file.
 //-----------------------------------------------------------------------------
-void BufferedFile::readDataFromFile(HANDLE fd, int64_t offset,
-                                    uint32_t sizeInBytes, void *pData)
+void BufferedFile::readDataFromFile(int64_t offset, uint32_t sizeInBytes,
+                                    void *pData)
 {
-    DWORD dwBytesRead;
-    LARGE_INTEGER liDistanceToMove;
-    uint32_t restingBytes = sizeInBytes;
-
-    liDistanceToMove.QuadPart = offset;
-
-    EnterCriticalSection(&csIO);
-
-    while (!SetFilePointerEx(fd, liDistanceToMove, nullptr, FILE_BEGIN))
-        cout << endl << "SetFilePointerEx failed!";
-
-    while (restingBytes > 0) {
-        if (ReadFile(fd, pData, sizeInBytes, &dwBytesRead, nullptr) == TRUE) {
-            restingBytes -= dwBytesRead;
-            pData = (void *)(((unsigned char *)pData) + dwBytesRead);
-            if (restingBytes > 0)
-                cout << endl << "Still " << restingBytes << " to read!";
-        } else {
-            cout << endl << "ReadFile Failed!";
-        }
-    }
-
-    LeaveCriticalSection(&csIO);
+    if (file.read(offset, sizeInBytes, pData) != sizeInBytes)
+        cout << endl << "ReadFile Failed!";
 }
 
 //-----------------------------------------------------------------------------
@@ -212,8 +154,7 @@ bool BufferedFile::writeBytes(uint32_t threadNo, int64_t positionInFile,
     if (bytesInWriteBuf[threadNo] &&
         (positionInFile != curWritingPtr[threadNo] ||
          bytesInWriteBuf[threadNo] + nBytes >= bufSize)) {
-        writeDataToFile(hFile,
-                        curWritingPtr[threadNo] - bytesInWriteBuf[threadNo],
+        writeDataToFile(curWritingPtr[threadNo] - bytesInWriteBuf[threadNo],
                         bytesInWriteBuf[threadNo],
                         &writeBuf[threadNo * bufSize + 0]);
         bytesInWriteBuf[threadNo] = 0;
@@ -262,7 +203,7 @@ bool BufferedFile::readBytes(uint32_t threadNo, int64_t positionInFile,
         if (bytesInReadBuf[threadNo] < nBytes)
             return false;
         readDataFromFile(
-            hFile, positionInFile, bytesInReadBuf[threadNo],
+            positionInFile, bytesInReadBuf[threadNo],
             &readBuf[threadNo * bufSize + bufSize - bytesInReadBuf[threadNo]]);
     }
 
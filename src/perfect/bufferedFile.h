@@ -9,9 +9,10 @@
 #ifndef BUFFERED_FILE_H_INCLUDED
 #define BUFFERED_FILE_H_INCLUDED
 
+#include "fileIO.h"
+#include <cstdint>
 #include <iostream>
 #include <string>
-#include <windows.h>
 
 using namespace std;
 
@@ -20,8 +21,8 @@ class BufferedFile
 private:
     // Variables
 
-    // Handle of the file
-    HANDLE hFile {nullptr};
+    // the file, accessed at explicit offsets by all threads
+    RandomAccessFile file;
 
     // number of threads
     uint32_t threadCount {0};
@@ -49,13 +50,9 @@ private:
     // size in bytes
     int64_t fileSize {0};
 
-    CRITICAL_SECTION csIO;
-
     // Functions
-    void writeDataToFile(HANDLE hFile, int64_t offset, uint32_t sizeInBytes,
-                         void *pData);
-    void readDataFromFile(HANDLE hFile, int64_t offset, uint32_t sizeInBytes,
-                          void *pData);
+    void writeDataToFile(int64_t offset, uint32_t sizeInBytes, void *pData);
+    void readDataFromFile(int64_t offset, uint32_t sizeInBytes, void *pData);
 
 public:
     // Constructor / destructor
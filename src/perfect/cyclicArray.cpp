@@ -11,119 +11,266 @@
 #ifdef MADWEASEL_MUEHLE_PERFECT_AI
 
 #include "cyclicArray.h"
+#include <cstdio>
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+// ~CyclicArrayMemory()
+// Stops the writer thread. All arrays must have been destroyed before.
+//-----------------------------------------------------------------------------
+CyclicArrayMemory::~CyclicArrayMemory()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAdded.notify_one();
+
+    if (writer.joinable())
+        writer.join();
+}
+
+//-----------------------------------------------------------------------------
+// reserve()
+// Adds 'nBytes' to the bytes in memory. Returns false and leaves them unchanged
+// if they would exceed the threshold. Concurrent calls never overshoot it.
+//-----------------------------------------------------------------------------
+bool CyclicArrayMemory::reserve(int64_t nBytes)
+{
+    const int64_t bytes = bytesInMemory.fetch_add(nBytes) + nBytes;
+    int64_t peak = peakBytesInMemory;
+
+    if (bytes > threshold) {
+        bytesInMemory -= nBytes;
+        return false;
+    }
+
+    while (peak < bytes &&
+           !peakBytesInMemory.compare_exchange_weak(peak, bytes)) { }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// spill()
+// Lets the writer thread write the spilling block of 'array' to its file.
+//-----------------------------------------------------------------------------
+void CyclicArrayMemory::spill(CyclicArray *array, int64_t offset)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!writer.joinable())
+            writer = std::thread(&CyclicArrayMemory::writerProc, this);
+        array->spillPending = true;
+        jobs.push_back({array, offset});
+    }
+    jobAdded.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+// waitForSpill()
+// Waits until the spilling block of 'array' is written. Returns false if one of
+// its blocks could not be written.
+//-----------------------------------------------------------------------------
+bool CyclicArrayMemory::waitForSpill(CyclicArray *array)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    jobDone.wait(lock, [array] { return !array->spillPending; });
+
+    return !array->spillFailed;
+}
+
+//-----------------------------------------------------------------------------
+// writerProc()
+// Writes the queued blocks in order until the memory is destroyed.
+//-----------------------------------------------------------------------------
+void CyclicArrayMemory::writerProc()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (jobs.empty())
+            return;
+
+        const SpillJob job = jobs.front();
+        jobs.pop_front();
+
+        lock.unlock();
+        const bool ok = job.array->writeDataToFile(
+            job.fileOffset, job.array->blockSize, job.array->spillingBlock);
+        lock.lock();
+
+        job.array->spillPending = false;
+        job.array->spillFailed |= !ok;
+        jobDone.notify_all();
+    }
+}
 
 //-----------------------------------------------------------------------------
 // CyclicArray()
-// Creates a cyclic array. The passed file is used as temporary data buf for
-// the cyclic array.
-//-----------------------------F------------------------------------------------
+// Creates a cyclic array. The full blocks are kept in memory as long as
+// 'queueMemory' allows it. Otherwise they are written to the passed file, which
+// then has room for 'nBlocks' blocks.
+//-----------------------------------------------------------------------------
 CyclicArray::CyclicArray(uint32_t blockSizeInBytes, uint32_t nBlocks,
-                         const char *fileName)
+                         const char *filePath, CyclicArrayMemory *queueMemory)
 {
     // Init blocks
     blockSize = blockSizeInBytes;
     blockCount = nBlocks;
-    readingBlock = new unsigned char[blockSize];
-    std::memset(readingBlock, 0, blockSize);
     writingBlock = new unsigned char[blockSize];
     std::memset(writingBlock, 0, blockSize);
-    curReadingPtr = writingBlock;
-    curWritingPtr = writingBlock;
-    readWriteInSameRound = true;
+    readingBlock = nullptr;
+    readPos = 0;
+    writePos = 0;
     curReadingBlock = 0;
     curWritingBlock = 0;
 
-    // Open Database-File (FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH |
-    // FILE_FLAG_RANDOM_ACCESS)
-    hFile = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE,
-                        FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
-                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-
-    // opened file successfully
-    if (hFile == INVALID_HANDLE_VALUE) {
-        hFile = nullptr;
-        return;
-    }
+    fileName = filePath;
+    memory = queueMemory;
 }
 
 //-----------------------------------------------------------------------------
-// ~RandomAI()
-// RandomAI class destructor
+// ~CyclicArray()
+// CyclicArray class destructor
 //-----------------------------------------------------------------------------
 CyclicArray::~CyclicArray()
 {
+    finishSpilling();
+
     // delete arrays
+    for (auto &block : fullBlocks) {
+        if (block.data != nullptr) {
+            delete[] block.data;
+            memory->bytesInMemory -= blockSize;
+        }
+    }
+
     delete[] readingBlock;
     delete[] writingBlock;
+    delete[] spillingBlock;
 
-    // close file
-    if (hFile != nullptr)
-        CloseHandle(hFile);
+    // the file is only temporary
+    if (file.isOpen()) {
+        file.close();
+        std::remove(fileName.c_str());
+    }
 }
 
 //-----------------------------------------------------------------------------
 // writeDataToFile()
 // Writes 'sizeInBytes'-bytes to the position 'offset' to the file.
 //-----------------------------------------------------------------------------
-void CyclicArray::writeDataToFile(HANDLE fd, int64_t offset,
-                                  uint32_t sizeInBytes, void *pData)
+bool CyclicArray::writeDataToFile(int64_t offset, uint32_t sizeInBytes,
+                                  void *pData)
 {
-    DWORD dwBytesWritten;
-    LARGE_INTEGER liDistanceToMove;
-    uint32_t restingBytes = sizeInBytes;
-
-    liDistanceToMove.QuadPart = offset;
-
-    while (!SetFilePointerEx(fd, liDistanceToMove, nullptr, FILE_BEGIN))
-        cout << std::endl << "SetFilePointerEx  failed!";
-
-    while (restingBytes > 0) {
-        if (WriteFile(fd, pData, sizeInBytes, &dwBytesWritten, nullptr) ==
-            TRUE) {
-            restingBytes -= dwBytesWritten;
-            pData = (void *)(((unsigned char *)pData) + dwBytesWritten);
-            if (restingBytes > 0)
-                cout << std::endl << "Still " << restingBytes << " to write!";
-        } else {
-            cout << std::endl << "WriteFile Failed!";
-        }
+    if (file.write(offset, sizeInBytes, pData) != sizeInBytes) {
+        cout << std::endl << "WriteFile Failed!";
+        return false;
     }
+
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 // readDataFromFile()
 // Reads 'sizeInBytes'-bytes from the position 'offset' of the file.
 //-----------------------------------------------------------------------------
-void CyclicArray::readDataFromFile(HANDLE fd, int64_t offset,
-                                   uint32_t sizeInBytes, void *pData)
+bool CyclicArray::readDataFromFile(int64_t offset, uint32_t sizeInBytes,
+                                   void *pData)
 {
-    DWORD dwBytesRead;
-    LARGE_INTEGER liDistanceToMove;
-    uint32_t restingBytes = sizeInBytes;
+    if (file.read(offset, sizeInBytes, pData) != sizeInBytes) {
+        cout << std::endl << "ReadFile Failed!";
+        return false;
+    }
 
-    liDistanceToMove.QuadPart = offset;
+    return true;
+}
 
-    while (!SetFilePointerEx(fd, liDistanceToMove, nullptr, FILE_BEGIN))
-        cout << std::endl << "SetFilePointerEx failed!";
+//-----------------------------------------------------------------------------
+// spillWritingBlock()
+// Writes the full writing block to the file in the background. Returns false
+// if the blocks between the reading and the writing one do not fit into the
+// file or if the previous block could not be written.
+//-----------------------------------------------------------------------------
+bool CyclicArray::spillWritingBlock()
+{
+    // will the slot of the reading block be overwritten?
+    if (curWritingBlock - curReadingBlock >= blockCount)
+        return false;
 
-    while (restingBytes > 0) {
-        if (ReadFile(fd, pData, sizeInBytes, &dwBytesRead, nullptr) == TRUE) {
-            restingBytes -= dwBytesRead;
-            pData = (void *)(((unsigned char *)pData) + dwBytesRead);
-            if (restingBytes > 0)
-                cout << std::endl << "Still " << restingBytes << " to read!";
-        } else {
-            cout << std::endl << "ReadFile Failed!";
-        }
+    // the previous block must be written before its buffer is reused
+    if (!finishSpilling())
+        return false;
+
+    if (!file.isOpen() && !file.open(fileName.c_str())) {
+        cout << std::endl << "Cannot open " << fileName;
+        return false;
     }
+
+    if (spillingBlock == nullptr)
+        spillingBlock = new unsigned char[blockSize];
+
+    std::swap(writingBlock, spillingBlock);
+
+    const int64_t offset = ((int64_t)blockSize) *
+                           ((int64_t)(curWritingBlock % blockCount));
+    fullBlocks.push_back({nullptr, offset});
+    memory->blocksSpilled++;
+
+    memory->spill(this, offset);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// finishSpilling()
+// Waits until the last spilled block is in the file. Returns false if a block
+// of this array could not be written.
+//-----------------------------------------------------------------------------
+bool CyclicArray::finishSpilling()
+{
+    return memory->waitForSpill(this);
+}
+
+//-----------------------------------------------------------------------------
+// nextReadingBlock()
+// Continues reading with the oldest full block, or with the writing block if
+// there is none. Returns false if the block could not be read from the file.
+//-----------------------------------------------------------------------------
+bool CyclicArray::nextReadingBlock()
+{
+    delete[] readingBlock;
+    readingBlock = nullptr;
+    readPos = 0;
+    curReadingBlock++;
+
+    if (fullBlocks.empty())
+        return true;
+
+    FullBlock block = fullBlocks.front();
+    fullBlocks.pop_front();
+
+    if (block.data != nullptr) {
+        readingBlock = block.data;
+        memory->bytesInMemory -= blockSize;
+    } else {
+        // the block might still be on its way to the file
+        readingBlock = new unsigned char[blockSize];
+        memory->blocksReloaded++;
+        return finishSpilling() &&
+               readDataFromFile(block.fileOffset, blockSize, readingBlock);
+    }
+
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 // addBytes()
-// Add the passed data to the cyclic array. If the writing pointer reaches the
-// end of a block,
-//       the data of the whole block is written to the file and the next block
-//       is considered for writing.
+// Add the passed data to the cyclic array. If the writing block is full,
+//       the whole block is kept in memory or written to the file and the next
+//       block is considered for writing.
 //-----------------------------------------------------------------------------
 bool CyclicArray::addBytes(uint32_t nBytes, unsigned char *pData)
 {
@@ -132,36 +279,29 @@ bool CyclicArray::addBytes(uint32_t nBytes, unsigned char *pData)
 
     // write each byte
     while (bytesWritten < nBytes) {
-        // store byte in current reading block
-        *curWritingPtr = *pData;
-        curWritingPtr++;
-        bytesWritten++;
-        pData++;
-
-        // when block is full then save current one to file and begin new one
-        if (curWritingPtr == writingBlock + blockSize) {
-            // copy data into reading block?
-            if (curReadingBlock == curWritingBlock) {
-                memcpy(readingBlock, writingBlock, blockSize);
-                curReadingPtr = readingBlock + (curReadingPtr - writingBlock);
-            }
-
-            // will reading block be overwritten?
-            if (curReadingBlock == curWritingBlock && !readWriteInSameRound)
+        // when block is full then keep it and begin new one
+        if (writePos == blockSize) {
+            if (readingBlock == nullptr) {
+                // reading continues in the full block
+                readingBlock = writingBlock;
+                writingBlock = new unsigned char[blockSize];
+            } else if (memory->reserve(blockSize)) {
+                fullBlocks.push_back({writingBlock, 0});
+                writingBlock = new unsigned char[blockSize];
+            } else if (!spillWritingBlock()) {
                 return false;
+            }
 
-            // store bock in file
-            writeDataToFile(hFile,
-                            ((int64_t)blockSize) * ((int64_t)curWritingBlock),
-                            blockSize, writingBlock);
-
-            // set pointer to beginning of writing block
-            curWritingPtr = writingBlock;
-            curWritingBlock = (curWritingBlock + 1) % blockCount;
-
-            if (curWritingBlock == 0)
-                readWriteInSameRound = false;
+            // set position to beginning of writing block
+            writePos = 0;
+            curWritingBlock++;
         }
+
+        // store byte in current writing block
+        writingBlock[writePos] = *pData;
+        writePos++;
+        bytesWritten++;
+        pData++;
     }
 
     // everything ok
@@ -172,7 +312,9 @@ bool CyclicArray::addBytes(uint32_t nBytes, unsigned char *pData)
 // takeBytes()
 // Load data from the cyclic array. If the reading pointer reaches the end of a
 // block,
-//       the data of the next whole block is read from the file.
+//       the next full block is taken from memory or read from the file.
+//       Returns false if there are not enough bytes or the block could not be
+//       read, getBytesToTake() tells both apart.
 //-----------------------------------------------------------------------------
 bool CyclicArray::takeBytes(uint32_t nBytes, unsigned char *pData)
 {
@@ -181,41 +323,88 @@ bool CyclicArray::takeBytes(uint32_t nBytes, unsigned char *pData)
 
     // read each byte
     while (bytesRead < nBytes) {
-        // was current reading byte already written ?
-        if (curReadingBlock == curWritingBlock &&
-            curReadingPtr == curWritingPtr && readWriteInSameRound)
+        // load next block?
+        if (readingBlock != nullptr && readPos == blockSize &&
+            !nextReadingBlock())
             return false;
 
-        // read current byte
-        *pData = *curReadingPtr;
-        curReadingPtr++;
-        bytesRead++;
-        pData++;
+        if (readingBlock == nullptr) {
+            // was current reading byte already written ?
+            if (readPos == writePos)
+                return false;
 
-        // load next block?
-        if (curReadingPtr == readingBlock + blockSize) {
-            // go to next block
-            curReadingBlock = (curReadingBlock + 1) % blockCount;
-            if (curReadingBlock == 0)
-                readWriteInSameRound = true;
-
-            // writing block reached ?
-            if (curReadingBlock == curWritingBlock) {
-                curReadingPtr = writingBlock;
-            } else {
-                // set pointer to beginning of reading block
-                curReadingPtr = readingBlock;
-
-                // read whole block from file
-                readDataFromFile(
-                    hFile, ((int64_t)blockSize) * ((int64_t)curReadingBlock),
-                    blockSize, readingBlock);
-            }
+            *pData = writingBlock[readPos];
+        } else {
+            *pData = readingBlock[readPos];
         }
+
+        readPos++;
+        bytesRead++;
+        pData++;
     }
 
     // everything ok
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// getBytesToTake()
+//
+//-----------------------------------------------------------------------------
+int64_t CyclicArray::getBytesToTake() const
+{
+    if (readingBlock == nullptr)
+        return writePos - readPos;
+
+    return (int64_t)(blockSize - readPos) +
+           (int64_t)fullBlocks.size() * blockSize + writePos;
+}
+
+//-----------------------------------------------------------------------------
+// copyToFile()
+// Writes the bytes, which were not taken yet, oldest first to 'dest' from
+// 'offset' on. They stay in the array.
+//-----------------------------------------------------------------------------
+bool CyclicArray::copyToFile(RandomAccessFile &dest, int64_t offset)
+{
+    // locals
+    unsigned char *buffer = nullptr;
+    uint32_t nBytes;
+    bool ok = finishSpilling();
+
+    // rest of the reading block
+    if (ok && readingBlock != nullptr) {
+        nBytes = blockSize - readPos;
+        ok = dest.write(offset, nBytes, readingBlock + readPos) == nBytes;
+        offset += nBytes;
+    }
+
+    // full blocks, the spilled ones are read back from the file
+    for (auto &block : fullBlocks) {
+        if (!ok)
+            break;
+
+        if (block.data == nullptr) {
+            if (buffer == nullptr)
+                buffer = new unsigned char[blockSize];
+            ok = file.read(block.fileOffset, blockSize, buffer) == blockSize &&
+                 dest.write(offset, blockSize, buffer) == blockSize;
+        } else {
+            ok = dest.write(offset, blockSize, block.data) == blockSize;
+        }
+        offset += blockSize;
+    }
+
+    // writing block
+    if (ok) {
+        const uint32_t begin = readingBlock == nullptr ? readPos : 0;
+        nBytes = writePos - begin;
+        ok = dest.write(offset, nBytes, writingBlock + begin) == nBytes;
+    }
+
+    delete[] buffer;
+
+    return ok;
+}
+
 #endif // MADWEASEL_MUEHLE_PERFECT_AI
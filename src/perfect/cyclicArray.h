@@ -9,61 +9,128 @@
 #ifndef CYLCIC_ARRAY_H_INCLUDED
 #define CYLCIC_ARRAY_H_INCLUDED
 
+#include "fileIO.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <string>
-#include <windows.h>
+#include <thread>
 
 using std::cout;
 using std::string;
 
+class CyclicArray;
+
+// Shared by all the cyclic arrays of a calculation. Full blocks are kept in
+// memory as long as all arrays together hold less than 'threshold' bytes,
+// further blocks are written to the file of their array by one writer thread.
+struct CyclicArrayMemory
+{
+    int64_t threshold {0};
+    std::atomic<int64_t> bytesInMemory {0};
+    std::atomic<int64_t> peakBytesInMemory {0};
+    std::atomic<int64_t> blocksSpilled {0};
+    std::atomic<int64_t> blocksReloaded {0};
+
+    ~CyclicArrayMemory();
+
+    bool reserve(int64_t nBytes);
+    void spill(CyclicArray *array, int64_t offset);
+    bool waitForSpill(CyclicArray *array);
+
+private:
+    struct SpillJob
+    {
+        CyclicArray *array;
+        int64_t fileOffset;
+    };
+
+    void writerProc();
+
+    // started with the first spilled block, runs until destruction
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable jobAdded;
+    std::condition_variable jobDone;
+    std::deque<SpillJob> jobs;
+    bool stopping {false};
+};
+
 class CyclicArray
 {
+    friend struct CyclicArrayMemory;
+
 private:
+    // structures
+    struct FullBlock
+    {
+        unsigned char *data {nullptr}; // nullptr if the block is in the file
+        int64_t fileOffset {0};
+    };
+
     // Variables
-    HANDLE hFile; // Handle of the file
+    RandomAccessFile file; // the file holding the spilled blocks
+    string fileName;       // the file is only created when needed
+    CyclicArrayMemory *memory {nullptr};
+
+    // full blocks between the reading and the writing block, oldest first
+    std::deque<FullBlock> fullBlocks;
+
     // Array of size [blockSize] containing the data of the block, where reading
-    // is taking place
+    // is taking place. nullptr if reading takes place in the writing block.
     unsigned char *readingBlock {nullptr};
 
     // ''
     unsigned char *writingBlock {nullptr};
 
-    // pointer to the byte which is currently read
-    unsigned char *curReadingPtr {nullptr};
+    // the block written to the file by the writer thread of 'memory'. the
+    // flags are guarded by its mutex, a failed write is reported by every
+    // further call of finishSpilling()
+    unsigned char *spillingBlock {nullptr};
+    bool spillPending {false};
+    bool spillFailed {false};
+
+    // position of the byte which is currently read in the reading block
+    uint32_t readPos {0};
 
     // ''
-    unsigned char *curWritingPtr {nullptr};
+    uint32_t writePos {0};
 
     // size in bytes of a block
     uint32_t blockSize {0};
 
-    // index of the block, where reading is taking place
-    uint32_t curReadingBlock {0};
+    // number of the block, where reading is taking place
+    uint64_t curReadingBlock {0};
 
-    // index of the block, where writing is taking place
-    uint32_t curWritingBlock {0};
+    // number of the block, where writing is taking place
+    uint64_t curWritingBlock {0};
 
-    // amount of blocks
+    // amount of blocks fitting into the file
     uint32_t blockCount {0};
 
-    // true if curReadingBlock > curWritingBlock, false otherwise
-    bool readWriteInSameRound {false};
-
     // Functions
-    void writeDataToFile(HANDLE hFile, int64_t offset, uint32_t sizeInBytes,
-                         void *pData);
-    void readDataFromFile(HANDLE hFile, int64_t offset, uint32_t sizeInBytes,
-                          void *pData);
+    bool writeDataToFile(int64_t offset, uint32_t sizeInBytes, void *pData);
+    bool readDataFromFile(int64_t offset, uint32_t sizeInBytes, void *pData);
+    bool spillWritingBlock();
+    bool finishSpilling();
+    bool nextReadingBlock();
 
 public:
     // Constructor / destructor
     CyclicArray(uint32_t blockSizeInBytes, uint32_t nBlocks,
-                const char *fileName);
+                const char *filePath, CyclicArrayMemory *queueMemory);
     ~CyclicArray();
 
     // Functions
     bool addBytes(uint32_t nBytes, unsigned char *pData);
     bool takeBytes(uint32_t nBytes, unsigned char *pData);
+
+    // the bytes which were added but not taken yet
+    int64_t getBytesToTake() const;
+    bool copyToFile(RandomAccessFile &dest, int64_t offset);
 };
 
 #endif // CYLCIC_ARRAY_H_INCLUDED
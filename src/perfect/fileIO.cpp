@@ -0,0 +1,260 @@
+/*********************************************************************
+    fileIO.cpp
+    Copyright (C) 2021 The Sanmill developers (see AUTHORS file)
+    Licensed under the GPLv3 License.
+    https://github.com/madweasel/Muehle
+\*********************************************************************/
+
+#include "config.h"
+
+#ifdef MADWEASEL_MUEHLE_PERFECT_AI
+
+#include "fileIO.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// ~RandomAccessFile()
+// RandomAccessFile class destructor
+//-----------------------------------------------------------------------------
+RandomAccessFile::~RandomAccessFile()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------
+// open()
+//
+//-----------------------------------------------------------------------------
+bool RandomAccessFile::open(const char *fileName)
+{
+    close();
+
+#ifdef _WIN32
+    // (FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH |
+    // FILE_FLAG_RANDOM_ACCESS)
+    HANDLE h = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (h == INVALID_HANDLE_VALUE)
+        return false;
+
+    hFile = h;
+#else
+    fd = ::open(fileName, O_RDWR | O_CREAT, 0644);
+
+    if (fd == -1)
+        return false;
+#endif
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// close()
+//
+//-----------------------------------------------------------------------------
+void RandomAccessFile::close()
+{
+#ifdef _WIN32
+    if (hFile != nullptr)
+        CloseHandle(hFile);
+    hFile = nullptr;
+#else
+    if (fd != -1)
+        ::close(fd);
+    fd = -1;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// isOpen()
+//
+//-----------------------------------------------------------------------------
+bool RandomAccessFile::isOpen() const
+{
+#ifdef _WIN32
+    return hFile != nullptr;
+#else
+    return fd != -1;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// getFileSize()
+// Returns -1 if the file is not open.
+//-----------------------------------------------------------------------------
+int64_t RandomAccessFile::getFileSize() const
+{
+#ifdef _WIN32
+    LARGE_INTEGER liFileSize;
+
+    if (hFile == nullptr || !GetFileSizeEx(hFile, &liFileSize))
+        return -1;
+
+    return liFileSize.QuadPart;
+#else
+    struct stat st;
+
+    if (fd == -1 || fstat(fd, &st) != 0)
+        return -1;
+
+    return st.st_size;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// read()
+// Reads 'nBytes'-bytes from the position 'offset' of the file.
+//-----------------------------------------------------------------------------
+uint32_t RandomAccessFile::read(int64_t offset, uint32_t nBytes,
+                                void *pData) const
+{
+    uint32_t bytesRead = 0;
+
+    while (bytesRead < nBytes) {
+        unsigned char *p = (unsigned char *)pData + bytesRead;
+        const int64_t pos = offset + bytesRead;
+#ifdef _WIN32
+        OVERLAPPED ov {};
+        DWORD n = 0;
+
+        ov.Offset = (DWORD)pos;
+        ov.OffsetHigh = (DWORD)(pos >> 32);
+
+        if (!ReadFile(hFile, p, nBytes - bytesRead, &n, &ov) || n == 0)
+            break;
+#else
+        const ssize_t n = pread(fd, p, nBytes - bytesRead, (off_t)pos);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            break;
+#endif
+        bytesRead += (uint32_t)n;
+    }
+
+    return bytesRead;
+}
+
+//-----------------------------------------------------------------------------
+// write()
+// Writes 'nBytes'-bytes to the position 'offset' of the file.
+//-----------------------------------------------------------------------------
+uint32_t RandomAccessFile::write(int64_t offset, uint32_t nBytes,
+                                 const void *pData)
+{
+    uint32_t bytesWritten = 0;
+
+    while (bytesWritten < nBytes) {
+        const unsigned char *p = (const unsigned char *)pData + bytesWritten;
+        const int64_t pos = offset + bytesWritten;
+#ifdef _WIN32
+        OVERLAPPED ov {};
+        DWORD n = 0;
+
+        ov.Offset = (DWORD)pos;
+        ov.OffsetHigh = (DWORD)(pos >> 32);
+
+        if (!WriteFile(hFile, p, nBytes - bytesWritten, &n, &ov) || n == 0)
+            break;
+#else
+        const ssize_t n = pwrite(fd, p, nBytes - bytesWritten, (off_t)pos);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            break;
+#endif
+        bytesWritten += (uint32_t)n;
+    }
+
+    return bytesWritten;
+}
+
+//-----------------------------------------------------------------------------
+// sync()
+//
+//-----------------------------------------------------------------------------
+bool RandomAccessFile::sync()
+{
+#ifdef _WIN32
+    return hFile != nullptr && FlushFileBuffers(hFile);
+#else
+    return fd != -1 && fsync(fd) == 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// prefetch()
+//
+//-----------------------------------------------------------------------------
+void RandomAccessFile::prefetch(int64_t offset, int64_t nBytes) const
+{
+#if defined(_WIN32) || defined(__APPLE__)
+    (void)offset;
+    (void)nBytes;
+#else
+    if (fd != -1 && nBytes > 0)
+        posix_fadvise(fd, (off_t)offset, (off_t)nBytes, POSIX_FADV_WILLNEED);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// createDirectory()
+// Returns true if the directory exists afterwards.
+//-----------------------------------------------------------------------------
+bool createDirectory(const char *path)
+{
+#ifdef _WIN32
+    CreateDirectoryA(path, nullptr);
+#else
+    mkdir(path, 0755);
+#endif
+
+    return pathExists(path);
+}
+
+//-----------------------------------------------------------------------------
+// replaceFile()
+// Renames 'from' to 'to', replacing 'to' in one step if it exists. A crash
+// leaves either the old or the new file at 'to'.
+//-----------------------------------------------------------------------------
+bool replaceFile(const char *from, const char *to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from, to,
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    return std::rename(from, to) == 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// pathExists()
+//
+//-----------------------------------------------------------------------------
+bool pathExists(const char *path)
+{
+#ifdef _WIN32
+    return GetFileAttributesA(path) != INVALID_FILE_ATTRIBUTES;
+#else
+    struct stat st;
+
+    return stat(path, &st) == 0;
+#endif
+}
+
+#endif // MADWEASEL_MUEHLE_PERFECT_AI
@@ -0,0 +1,59 @@
+/*********************************************************************\
+    fileIO.h
+    Copyright (C) 2021 The Sanmill developers (see AUTHORS file)
+    Licensed under the GPLv3 License.
+    https://github.com/madweasel/Muehle
+\*********************************************************************/
+
+#ifndef FILE_IO_H_INCLUDED
+#define FILE_IO_H_INCLUDED
+
+#include <cstdint>
+
+// Positional file I/O. Every read and write passes its own offset (pread() and
+// pwrite() on POSIX, an OVERLAPPED offset on Windows), there is no shared file
+// pointer, so that any number of threads can access the same file without a
+// lock.
+class RandomAccessFile
+{
+private:
+    // Variables
+#ifdef _WIN32
+    void *hFile {nullptr};
+#else
+    int fd {-1};
+#endif
+
+public:
+    // Constructor / destructor
+    RandomAccessFile() = default;
+    RandomAccessFile(const RandomAccessFile &) = delete;
+    RandomAccessFile &operator=(const RandomAccessFile &) = delete;
+    ~RandomAccessFile();
+
+    // Functions
+
+    // opens the file for reading and writing, it is created if it is missing
+    bool open(const char *fileName);
+    void close();
+    bool isOpen() const;
+    int64_t getFileSize() const;
+
+    // return the number of bytes transferred, which is less than 'nBytes'
+    // only at the end of the file or on an error
+    uint32_t read(int64_t offset, uint32_t nBytes, void *pData) const;
+    uint32_t write(int64_t offset, uint32_t nBytes, const void *pData);
+
+    // returns when the written data is on the disk
+    bool sync();
+
+    // asks the system to read a part of the file into the page cache in the
+    // background. no-op where this is not supported
+    void prefetch(int64_t offset, int64_t nBytes) const;
+};
+
+bool createDirectory(const char *path);
+bool pathExists(const char *path);
+bool replaceFile(const char *from, const char *to);
+
+#endif // FILE_IO_H_INCLUDED
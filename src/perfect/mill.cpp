@@ -12,6 +12,7 @@
 
 #include "mill.h"
 #include <cassert>
+#include <cstring>
 
 //-----------------------------------------------------------------------------
 // Mill()
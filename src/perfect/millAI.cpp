@@ -240,12 +240,8 @@ void fieldStruct::createBoard()
 //-----------------------------------------------------------------------------
 void fieldStruct::deleteBoard()
 {
-    try {
-        SAFE_DELETE(curPlayer);
-        SAFE_DELETE(oppPlayer);
-    } catch (const char *msg) {
-        cerr << msg << endl;
-    }
+    SAFE_DELETE(curPlayer);
+    SAFE_DELETE(oppPlayer);
 }
 
 //-----------------------------------------------------------------------------
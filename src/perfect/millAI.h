@@ -131,10 +131,10 @@ private:
                      uint32_t secondNeighbor1);
 };
 
-#ifdef __clang__ // TODO(calcitem)
-class MillAI
-#else
+#ifdef _MSC_VER
 class MillAI abstract
+#else
+class MillAI
 #endif
 {
 protected:
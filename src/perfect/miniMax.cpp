@@ -19,8 +19,6 @@
 MiniMax::MiniMax()
 {
     // init default values
-    hFileShortKnotValues = nullptr;
-    hFilePlyInfo = nullptr;
     memoryUsed2 = 0;
     arrayInfos.c = this;
     arrayInfos.arrayInfosToBeUpdated.clear();
@@ -35,26 +33,23 @@ MiniMax::MiniMax()
     layerStats = nullptr;
     plyInfos = nullptr;
     fileDir.assign("");
-    InitializeCriticalSection(&csDatabase);
-    InitializeCriticalSection(&csOsPrint);
 
     // for I/O operations per second measurement
-    QueryPerformanceFrequency(&frequency);
     nReadSkvOps = 0;
     nWriteSkvOps = 0;
     nReadPlyOps = 0;
     nWritePlyOps = 0;
 
     if (MEASURE_ONLY_IO) {
-        readSkvInterval.QuadPart = 0;
-        writeSkvInterval.QuadPart = 0;
-        readPlyInterval.QuadPart = 0;
-        writePlyInterval.QuadPart = 0;
+        readSkvInterval = Clock::time_point();
+        writeSkvInterval = Clock::time_point();
+        readPlyInterval = Clock::time_point();
+        writePlyInterval = Clock::time_point();
     } else {
-        QueryPerformanceCounter(&readSkvInterval);
-        QueryPerformanceCounter(&writeSkvInterval);
-        QueryPerformanceCounter(&readPlyInterval);
-        QueryPerformanceCounter(&writePlyInterval);
+        readSkvInterval = Clock::now();
+        writeSkvInterval = Clock::now();
+        readPlyInterval = Clock::now();
+        writePlyInterval = Clock::now();
     }
 
     // The algorithm assumes that each player does only one move.
@@ -84,8 +79,6 @@ MiniMax::MiniMax()
 MiniMax::~MiniMax()
 {
     closeDatabase();
-    DeleteCriticalSection(&csOsPrint);
-    DeleteCriticalSection(&csDatabase);
 }
 
 //-----------------------------------------------------------------------------
@@ -94,8 +87,8 @@ MiniMax::~MiniMax()
 //-----------------------------------------------------------------------------
 bool MiniMax::falseOrStop()
 {
-    if (stopOnCriticalError)
-        WaitForSingleObject(GetCurrentProcess(), INFINITE);
+    while (stopOnCriticalError)
+        std::this_thread::sleep_for(std::chrono::hours(1));
 
     return false;
 }
@@ -130,10 +123,24 @@ void *MiniMax::getBestChoice(uint32_t tilLevel, uint32_t *choice,
     // pass best choice and close database
     *choice = root.bestMoveId;
 
+    // warm the layers of the next moves meanwhile
+    prefetchLayers(alphaBetaVars.layerNumber);
+
     // Return the best branch of the root
     return pRootPossibilities;
 }
 
+//-----------------------------------------------------------------------------
+// setCalcMemoryLimit()
+// Limits the memory kept by the layers calculated at the same time to
+// 'bytes', see getLayerCalcMemory(). A layer, which needs more, is calculated
+// alone.
+//-----------------------------------------------------------------------------
+void MiniMax::setCalcMemoryLimit(int64_t bytes)
+{
+    calcMemoryLimit = std::max((int64_t)0, bytes);
+}
+
 //-----------------------------------------------------------------------------
 // calculateDatabase()
 // Calculates the database, which must be already open.
@@ -153,7 +160,7 @@ void MiniMax::calculateDatabase(uint32_t maxDepthOfTree, bool onlyPrepLayer)
     prepareDatabaseCalc();
 
     // when database not completed then do it
-    if (hFileShortKnotValues != nullptr && skvfHeader.completed == false) {
+    if (skvFile.isOpen() && skvfHeader.completed == false) {
         // reserve memory
         lastCalculatedLayer.clear();
         fullTreeDepth = maxDepthOfTree;
@@ -164,30 +171,33 @@ void MiniMax::calculateDatabase(uint32_t maxDepthOfTree, bool onlyPrepLayer)
                                            skvfHeader.LayerCount,
                                        arrayInfos.listArrays.end());
 
-        // calculate layer after layer, beginning with the last one
-        for (curCalculatedLayer = 0; curCalculatedLayer < skvfHeader.LayerCount;
-             curCalculatedLayer++) {
-            // layer already calculated?
-            if (layerStats[curCalculatedLayer].layerIsCompletedAndInFile)
-                continue;
+        // calculate the layers in the order of their dependencies. the ready
+        // ones, which fit into the memory limit together, are calculated at
+        // the same time, each by a part of the threads.
+        vector<bool> layerCalculated(skvfHeader.LayerCount, false);
+        vector<uint32_t> layers;
 
-            // don't calculate if neither the layer nor the partner layer has
-            // any knots
-            if (layerStats[curCalculatedLayer].knotsInLayer == 0 &&
-                layerStats[layerStats[curCalculatedLayer].partnerLayer]
-                        .knotsInLayer == 0)
-                continue;
+        for (getLayersToCalcTogether(layerCalculated, layers); !layers.empty();
+             getLayersToCalcTogether(layerCalculated, layers)) {
+            // read the layers needed next while these are calculated. the
+            // next layer is predicted before these are marked calculated,
+            // so that only the layers completed by now are taken as ready.
+            prefetchLayersForCalc(getNextLayerToCalc(layerCalculated, layers));
 
             // calculate
-            abortCalc = (!calcLayer(curCalculatedLayer));
+            abortCalc = (!calcLayersTogether(layers));
+            for (uint32_t layerNumber : layers)
+                layerCalculated[layerNumber] = true;
 
             // release memory
             unloadAllLayers();
             unloadAllPlyInfos();
 
             // don't save layer and header when only preparing layers
-            if (onlyPrepLayer)
+            if (onlyPrepLayer) {
+                stopPrefetchThread();
                 return;
+            }
             if (abortCalc)
                 break;
 
@@ -196,6 +206,8 @@ void MiniMax::calculateDatabase(uint32_t maxDepthOfTree, bool onlyPrepLayer)
             saveHeader(&plyInfoHeader, plyInfos);
         }
 
+        stopPrefetchThread();
+
         // don't save layer and header when only preparing layers or when
         if (onlyPrepLayer)
             return;
@@ -209,10 +221,13 @@ void MiniMax::calculateDatabase(uint32_t maxDepthOfTree, bool onlyPrepLayer)
             plyInfoHeader.plyInfoCompleted = true;
             saveHeader(&skvfHeader, layerStats);
             saveHeader(&plyInfoHeader, plyInfos);
+            mapCompletedDatabase();
         }
 
         // free memory
         curCalcActionId = MM_ACTION_NONE;
+        if (memoryBudget)
+            showCacheStats();
     } else {
         PRINT(1, this, "\nThe database is already fully calculated.\n");
     }
@@ -225,6 +240,257 @@ void MiniMax::calculateDatabase(uint32_t maxDepthOfTree, bool onlyPrepLayer)
     PRINT(1, this, "*************************");
 }
 
+//-----------------------------------------------------------------------------
+// layerNeedsCalculation()
+// Layers without any knots, also in the partner layer, are never calculated.
+//-----------------------------------------------------------------------------
+bool MiniMax::layerNeedsCalculation(uint32_t layerNumber,
+                                    const vector<bool> &layerCalculated)
+{
+    return !layerCalculated[layerNumber] &&
+           !layerStats[layerNumber].layerIsCompletedAndInFile &&
+           (layerStats[layerNumber].knotsInLayer != 0 ||
+            layerStats[layerStats[layerNumber].partnerLayer].knotsInLayer != 0);
+}
+
+//-----------------------------------------------------------------------------
+// getLayerDependencies()
+// Returns the layers, which must be completed before 'layerNumber' can be
+// calculated. When retro analysis is used, the partner layer is calculated
+// at the same time, so its succeeding layers are needed as well.
+//-----------------------------------------------------------------------------
+void MiniMax::getLayerDependencies(uint32_t layerNumber,
+                                   vector<uint32_t> &dependencies)
+{
+    // locals
+    const uint32_t partnerLayer = layerStats[layerNumber].partnerLayer;
+    const bool withPartner = partnerLayer != layerNumber &&
+                             shallRetroAnalysisBeUsed(layerNumber);
+    uint32_t layer, i;
+
+    dependencies.clear();
+
+    for (layer = layerNumber;; layer = partnerLayer) {
+        for (i = 0; i < layerStats[layer].succeedingLayerCount; i++) {
+            const uint32_t succLayer = layerStats[layer].succeedingLayers[i];
+
+            if (succLayer == layerNumber ||
+                (withPartner && succLayer == partnerLayer))
+                continue;
+
+            if (std::find(dependencies.begin(), dependencies.end(),
+                          succLayer) == dependencies.end())
+                dependencies.push_back(succLayer);
+        }
+
+        if (!withPartner || layer == partnerLayer)
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// isLayerReady()
+// Returns true if all the layers, which 'layerNumber' depends on, are
+// completed.
+//-----------------------------------------------------------------------------
+bool MiniMax::isLayerReady(uint32_t layerNumber,
+                           const vector<bool> &layerCalculated,
+                           vector<uint32_t> &dependencies)
+{
+    getLayerDependencies(layerNumber, dependencies);
+
+    return std::none_of(dependencies.begin(), dependencies.end(),
+                        [&](uint32_t layer) {
+                            return layerNeedsCalculation(layer,
+                                                         layerCalculated);
+                        });
+}
+
+//-----------------------------------------------------------------------------
+// getNextLayerToCalc()
+// Returns the next layer to calculate, or 'LayerCount' if all are done. Of
+// the ready layers, the one with the most bytes of its dependencies in the
+// layer cache is taken, otherwise the lowest one. 'layersToSkip' and their
+// partner layers are not considered. If no layer is ready, the lowest one
+// which is not calculated yet is returned.
+//-----------------------------------------------------------------------------
+uint32_t MiniMax::getNextLayerToCalc(const vector<bool> &layerCalculated,
+                                     const vector<uint32_t> &layersToSkip)
+{
+    // locals
+    uint32_t bestLayer = skvfHeader.LayerCount;
+    uint32_t firstLayer = skvfHeader.LayerCount;
+    int64_t bestBytesInCache = -1;
+    int64_t bytesInCache;
+    vector<uint32_t> dependencies;
+    uint32_t layerNumber;
+
+    for (layerNumber = 0; layerNumber < skvfHeader.LayerCount; layerNumber++) {
+        if (!layerNeedsCalculation(layerNumber, layerCalculated))
+            continue;
+
+        if (std::any_of(layersToSkip.begin(), layersToSkip.end(),
+                        [&](uint32_t layer) {
+                            return layerNumber == layer ||
+                                   layerNumber ==
+                                       layerStats[layer].partnerLayer;
+                        }))
+            continue;
+
+        if (firstLayer == skvfHeader.LayerCount)
+            firstLayer = layerNumber;
+
+        if (!isLayerReady(layerNumber, layerCalculated, dependencies))
+            continue;
+
+        bytesInCache = memoryBudget > 0 ? getBytesInCache(dependencies) : 0;
+
+        if (bytesInCache > bestBytesInCache) {
+            bestLayer = layerNumber;
+            bestBytesInCache = bytesInCache;
+        }
+    }
+
+    return bestLayer < skvfHeader.LayerCount ? bestLayer : firstLayer;
+}
+
+//-----------------------------------------------------------------------------
+// getLayersToCalcTogether()
+// Returns the layers to calculate next at the same time in 'layers', which is
+// empty if all are done. The first one is the one of getNextLayerToCalc().
+// Further ready layers are added as long as each one gets a thread and all
+// of them fit into 'calcMemoryLimit'. None of them depends on another, since
+// only completed layers make a layer ready.
+//-----------------------------------------------------------------------------
+void MiniMax::getLayersToCalcTogether(const vector<bool> &layerCalculated,
+                                      vector<uint32_t> &layers)
+{
+    // locals
+    vector<uint32_t> dependencies;
+    uint32_t layerNumber;
+    int64_t bytes;
+
+    layers.clear();
+    layerNumber = getNextLayerToCalc(layerCalculated, layers);
+
+    if (layerNumber >= skvfHeader.LayerCount)
+        return;
+
+    layers.push_back(layerNumber);
+    bytes = getLayerCalcMemory(layerNumber);
+
+    while (layers.size() < threadManager.getThreadCount()) {
+        layerNumber = getNextLayerToCalc(layerCalculated, layers);
+
+        if (layerNumber >= skvfHeader.LayerCount ||
+            !isLayerReady(layerNumber, layerCalculated, dependencies) ||
+            bytes + getLayerCalcMemory(layerNumber) > calcMemoryLimit)
+            break;
+
+        layers.push_back(layerNumber);
+        bytes += getLayerCalcMemory(layerNumber);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// getLayerCalcMemory()
+// Returns the bytes, which the calculation of 'layerNumber' keeps in memory:
+// the knot values and ply infos of the layer and, with retro analysis, of its
+// partner layer together with their count arrays. The queues of the retro
+// analysis are not counted, since the layers calculated at the same time
+// share 'queueMemoryThreshold'.
+//-----------------------------------------------------------------------------
+int64_t MiniMax::getLayerCalcMemory(uint32_t layerNumber)
+{
+    // locals
+    const uint32_t partnerLayer = layerStats[layerNumber].partnerLayer;
+    const bool retroAnalysis = shallRetroAnalysisBeUsed(layerNumber);
+    int64_t bytes = 0;
+
+    for (uint32_t layer = layerNumber;; layer = partnerLayer) {
+        bytes += layerStats[layer].sizeInBytes + plyInfos[layer].sizeInBytes;
+
+        if (retroAnalysis)
+            bytes += (int64_t)layerStats[layer].knotsInLayer *
+                     sizeof(CountArrayVarType);
+
+        if (!retroAnalysis || layer == partnerLayer)
+            break;
+    }
+
+    return bytes;
+}
+
+//-----------------------------------------------------------------------------
+// calcLayersTogether()
+// Calculates the passed layers at the same time, each one on a thread of its
+// own by a part of the threads in proportion to its number of knots. A single
+// layer is calculated by all threads.
+//-----------------------------------------------------------------------------
+bool MiniMax::calcLayersTogether(const vector<uint32_t> &layers)
+{
+    // locals
+    vector<std::unique_ptr<LayerCalcJob>> jobs;
+    vector<int64_t> knotCount;
+    int64_t knotsLeft = 0;
+    uint32_t threadsLeft = threadManager.getThreadCount();
+    uint32_t firstThreadSlot = 0;
+    uint32_t threadCount;
+    uint32_t i;
+    bool succeeded = true;
+
+    if (layers.size() == 1)
+        return calcLayer(layers[0]);
+
+    for (uint32_t layerNumber : layers) {
+        const uint32_t partnerLayer = layerStats[layerNumber].partnerLayer;
+
+        knotCount.push_back(layerStats[layerNumber].knotsInLayer);
+        if (partnerLayer != layerNumber &&
+            shallRetroAnalysisBeUsed(layerNumber))
+            knotCount.back() += layerStats[partnerLayer].knotsInLayer;
+        knotsLeft += knotCount.back();
+    }
+
+    PRINT(1, this, "*** Calculate " << layers.size() << " layers at once ***");
+
+    // each layer gets at least one thread and the last one those left
+    for (i = 0; i < layers.size(); i++) {
+        const uint32_t jobsLeft = (uint32_t)(layers.size() - i);
+
+        threadCount = knotsLeft > 0 ?
+                          (uint32_t)(threadsLeft * knotCount[i] / knotsLeft) :
+                          threadsLeft / jobsLeft;
+        threadCount = std::max(
+            1u, std::min(threadCount, threadsLeft - jobsLeft + 1));
+        if (jobsLeft == 1)
+            threadCount = threadsLeft;
+
+        jobs.push_back(std::make_unique<LayerCalcJob>());
+        jobs.back()->layerNumber = layers[i];
+        jobs.back()->threadManager.setThreadCount(threadCount);
+        jobs.back()->threadManager.setFirstThreadSlot(firstThreadSlot);
+
+        firstThreadSlot += threadCount;
+        threadsLeft -= threadCount;
+        knotsLeft -= knotCount[i];
+    }
+
+    for (auto &job : jobs) {
+        job->thread = std::thread([this, job = job.get()] {
+            job->threadManager.runsOnThisThread();
+            job->succeeded = calcLayer(job->layerNumber);
+        });
+    }
+
+    for (auto &job : jobs) {
+        job->thread.join();
+        succeeded = succeeded && job->succeeded;
+    }
+
+    return succeeded;
+}
+
 //-----------------------------------------------------------------------------
 // calcLayer()
 //
@@ -234,6 +500,8 @@ bool MiniMax::calcLayer(uint32_t layerNumber)
     // locals
     vector<uint32_t> layersToCalc;
 
+    curCalculatedLayer = layerNumber;
+
     // moves can be done reverse, leading to too depth searching trees
     if (shallRetroAnalysisBeUsed(layerNumber)) {
         // calculate values for all states of layer
@@ -274,13 +542,13 @@ bool MiniMax::calcLayer(uint32_t layerNumber)
     }
 
     // update output info
-    EnterCriticalSection(&csOsPrint);
+    csOsPrint.lock();
     if (shallRetroAnalysisBeUsed(layerNumber) &&
         layerNumber != layerStats[layerNumber].partnerLayer) {
         lastCalculatedLayer.push_back(layerStats[layerNumber].partnerLayer);
     }
     lastCalculatedLayer.push_back(layerNumber);
-    LeaveCriticalSection(&csOsPrint);
+    csOsPrint.unlock();
 
     return true;
 }
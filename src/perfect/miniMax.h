@@ -9,26 +9,31 @@
 #ifndef MINIMAX_H_INCLUDED
 #define MINIMAX_H_INCLUDED
 
-#include "Shlwapi.h"
 #include "bufferedFile.h"
 #include "cyclicArray.h"
+#include "fileIO.h"
+#include "misc.h"
 #include "strLib.h"
 #include "threadManager.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
-#include <intrin.h>
+#include <cstring>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <sstream>
 #include <time.h>
 #include <vector>
-#include <windows.h>
 
+#ifdef _MSC_VER
 #pragma warning(disable : 4100)
 #pragma warning(disable : 4238)
 #pragma warning(disable : 4244)
-
-#pragma intrinsic(_rotl8, _rotr8) // for shifting bits
+#endif
 
 using std::iostream; // use standard library namespace
 
@@ -111,6 +116,23 @@ constexpr auto PRED_LAYER_COUNT_MAX = 2;
 // constant to identify the header
 constexpr auto SKV_FILE_HEADER_CODE = 0xF4F5;
 constexpr auto PLYINFO_HEADER_CODE = 0xF3F2;
+constexpr auto SKV_COMPRESSED_HEADER_CODE = 0xF6F7;
+constexpr auto RETRO_CHECKPOINT_HEADER_CODE = 0xF8F9;
+constexpr auto ALPHA_BETA_CHECKPOINT_HEADER_CODE = 0xFAFB;
+
+// size in bytes of the uncompressed blocks of the compressed short knot value
+// file
+constexpr auto SKV_BLOCK_SIZE_MIN = 4096;
+constexpr auto SKV_BLOCK_SIZE_MAX = 65536;
+constexpr auto SKV_BLOCK_SIZE_DEFAULT = 16384;
+
+// number of decompressed blocks kept in memory
+constexpr auto SKV_BLOCK_CACHE_SLOTS = 256;
+
+// after a move, the layers reachable within this number of moves are
+// prefetched, but not more than PREFETCH_BYTES_MAX bytes
+constexpr auto PREFETCH_LAYER_DEPTH = 3;
+constexpr auto PREFETCH_BYTES_MAX = 256 * 1024 * 1024;
 
 // print progress every n-thread processed knot
 constexpr auto OUTPUT_EVERY_N_STATES = 10000000;
@@ -119,6 +141,23 @@ constexpr auto OUTPUT_EVERY_N_STATES = 10000000;
 // in bytes for the cyclic arrays
 constexpr auto BLOCK_SIZE_IN_CYCLIC_ARRAY = 10000;
 
+// bytes the cyclic arrays of the retro analysis keep in memory together,
+// before they write further blocks to file
+constexpr auto QUEUE_MEMORY_THRESHOLD_DEFAULT = (int64_t)1024 * 1024 * 1024;
+
+// seconds between two checkpoints of the retro analysis or the alpha-beta
+// calculation of a layer. the retro analysis only writes a checkpoint when all
+// states of a ply number have been processed
+constexpr auto RETRO_CHECKPOINT_INTERVAL_DEFAULT = 600;
+
+// bytes the layers calculated at the same time keep in memory together, see
+// getLayerCalcMemory()
+constexpr auto CALC_MEMORY_LIMIT_DEFAULT = (int64_t)4096 * 1024 * 1024;
+
+// number of count value increments a thread collects for the states of
+// another thread, before it passes them on
+constexpr auto COUNT_INCREMENT_BATCH_SIZE = 4096;
+
 // maximum number of predecessors. important for array sizes
 constexpr auto PREDECESSOR_COUNT_MAX = 10000;
 
@@ -178,12 +217,11 @@ enum MmAction {
 #define PRINT(v, c, t) \
     { \
         if (c->verbosity > v) { \
-            EnterCriticalSection(&c->csOsPrint); \
+            std::lock_guard<std::mutex> lockOsPrint(c->csOsPrint); \
             *c->osPrint << endl << t; \
             if (c->userPrintFunc != nullptr) { \
                 c->userPrintFunc(c->pDataForUserPrintFunc); \
             } \
-            LeaveCriticalSection(&c->csOsPrint); \
         } \
     }
 
@@ -209,6 +247,9 @@ public:
     // 4 Bytes for addressing states within a layer
     typedef uint32_t StateNumberVarType;
 
+    // clock for the I/O operations per second
+    typedef std::chrono::steady_clock Clock;
+
     /*** protected structures
      * ************************************************************************/
 
@@ -228,6 +269,60 @@ public:
         uint32_t headerAndStatsSize {0};
     };
 
+    // follows the layer stats in the compressed short knot value file. it is
+    // followed by the index of the first block of each layer, the file offset
+    // of each block and the blocks themselves
+    struct CompressedSkvFileHeader
+    {
+        // = SKV_COMPRESSED_HEADER_CODE
+        uint32_t headerCode {0};
+
+        // size in bytes of an uncompressed block. the last block of a layer
+        // may be shorter
+        uint32_t blockSize {0};
+
+        // number of blocks of all layers
+        uint32_t blockCount {0};
+
+        // size in bytes of all headers plus both index arrays
+        uint32_t headerAndIndexSize {0};
+    };
+
+    // begins the checkpoint file of the retro analysis. it is followed by the
+    // numbers of the calculated layers, the arrays of each of these layers and
+    // the queued states of each ply number from 'nextPlyNumber' on
+    struct RetroCheckpointHeader
+    {
+        // = RETRO_CHECKPOINT_HEADER_CODE
+        uint32_t headerCode {0};
+
+        // number of layers in 'layersToCalculate'
+        uint32_t layerCount {0};
+
+        // number of threads, which wrote the queues
+        uint32_t threadCount {0};
+
+        // the iteration continues with this ply number
+        uint32_t nextPlyNumber {0};
+
+        // number of queues of each thread
+        uint32_t plyCount {0};
+    };
+
+    // begins the checkpoint file of the alpha-beta calculation of a layer. it
+    // is followed by the short knot values and the ply infos of the layer
+    struct AlphaBetaCheckpointHeader
+    {
+        // = ALPHA_BETA_CHECKPOINT_HEADER_CODE
+        uint32_t headerCode {0};
+
+        // the calculated layer
+        uint32_t layerNumber {0};
+
+        // number of states in the layer
+        uint32_t knotsInLayer {0};
+    };
+
     struct PlyInfoFileHeader
     {
         // true if ply info has been calculated for all game states
@@ -403,10 +498,13 @@ public:
     // Testing functions
     bool testLayer(uint32_t layerNumber);
     bool testIfSymStatesHaveSameValue(uint32_t layerNumber);
+    bool testRetroAnalysisResume();
 
     // Statistics
     bool calcLayerStatistics(char *statisticsFileName);
     uint32_t getThreadCount();
+    uint32_t getThreadSlot(uint32_t threadNo);
+    void showCacheStats();
 
     // Main function for getting the best choice
     void *getBestChoice(uint32_t tilLevel, uint32_t *choice,
@@ -419,6 +517,12 @@ public:
     void closeDatabase();
     void unloadAllLayers();
     void unloadAllPlyInfos();
+    void setMemoryBudget(int64_t bytes);
+    void setQueueMemoryThreshold(int64_t bytes);
+    void setCheckpointInterval(int64_t seconds);
+    void setCalcMemoryLimit(int64_t bytes);
+    bool compressDatabase(uint32_t blockSize);
+    void prefetchLayers(uint32_t layerNumber);
 
     // Virtual Functions
     virtual void prepareBestChoiceCalc()
@@ -584,6 +688,39 @@ public:
     };
 
 private:
+    /*** layer cache
+     * *****************************************************************************************/
+
+    // a completed layer held in memory, either its short knot values or its
+    // ply info
+    struct CacheEntry
+    {
+        unsigned char *data {nullptr};
+        int64_t sizeInBytes {0};
+
+        // set by each read, cleared by the clock hand passing by
+        std::atomic<bool> referenced {false};
+    };
+
+    // a decompressed block of the compressed short knot value file
+    struct BlockCacheSlot
+    {
+        std::mutex cs;
+        uint32_t blockNumber {UINT32_MAX};
+        unsigned char *data {nullptr};
+        vector<unsigned char> compressed {};
+    };
+
+    // a layer calculated at the same time as others by its own threads. the
+    // state of the calculation is held by the global vars of the algorithm
+    struct LayerCalcJob
+    {
+        uint32_t layerNumber {0};
+        ThreadManager threadManager;
+        std::thread thread;
+        bool succeeded {false};
+    };
+
     /*** classes for testing
      * *****************************************************************************************/
 
@@ -592,7 +729,8 @@ private:
         MiniMax *pMiniMax;
         uint32_t curThreadNo;
         uint32_t layerNumber;
-        LONGLONG statesProcessed;
+        int64_t statesProcessed;
+        std::atomic<int64_t> *stateProcessedCount; // by all threads
         TwoBit *subValueInDatabase;
         PlyInfoVarType *subPlyInfos;
         bool *hasCurPlayerChanged;
@@ -622,15 +760,22 @@ private:
         // number of knots of all layers to be calculated
         int64_t knotToCalcCount;
 
+        // states processed by all threads in the current step
+        std::atomic<int64_t> stateProcessedCount {0};
+
         vector<AlphaBetaThreadVars> thread;
         uint32_t statsValueCounter[SKV_VALUE_COUNT];
         MiniMax *pMiniMax;
 
+        // file holding the last checkpoint of the calculation
+        string checkpointFilePath;
+        Clock::time_point lastCheckpointTime;
+
         AlphaBetaGlobalVars(MiniMax *pMiniMax, uint32_t layerNumber)
         {
-            this->thread.resize(pMiniMax->threadManager.getThreadCount());
+            this->thread.resize(pMiniMax->getThreadManager().getThreadCount());
             for (uint32_t threadNo = 0;
-                 threadNo < pMiniMax->threadManager.getThreadCount();
+                 threadNo < pMiniMax->getThreadManager().getThreadCount();
                  threadNo++) {
                 this->thread[threadNo].stateToProcessCount = 0;
                 this->thread[threadNo].threadNo = threadNo;
@@ -655,7 +800,7 @@ private:
         MiniMax *pMiniMax;
         AlphaBetaGlobalVars *alphaBetaVars;
         uint32_t layerNumber;
-        LONGLONG statesProcessed;
+        int64_t statesProcessed;
         uint32_t statsValueCounter[SKV_VALUE_COUNT];
 
         AlphaBetaDefaultThreadVars() { }
@@ -676,7 +821,7 @@ private:
 
         void reduceDefault()
         {
-            pMiniMax->stateProcessedCount += this->statesProcessed;
+            alphaBetaVars->stateProcessedCount += this->statesProcessed;
             for (uint32_t curStateValue = 0; curStateValue < SKV_VALUE_COUNT;
                  curStateValue++) {
                 alphaBetaVars->statsValueCounter[curStateValue] +=
@@ -764,6 +909,21 @@ private:
         PlyInfoVarType plyTillCurStateCount;
     };
 
+    // increment of the count value of a state, passed to the thread owning it
+    struct CountIncrement
+    {
+        uint32_t layerId; // index in 'layersToCalculate'
+        StateNumberVarType stateNumber;
+    };
+
+    // batches of count value increments collected by the other threads
+    struct CountIncrementInbox
+    {
+        std::mutex cs;
+        vector<vector<CountIncrement>> batches;
+        std::atomic<bool> notEmpty {false};
+    };
+
     // thread specific variables for each thread in the retro analysis
     struct RetroAnalysisThreadVars
     {
@@ -795,15 +955,45 @@ private:
         // layers which shall be calculated
         vector<uint32_t> layersToCalculate;
 
+        // [layerNumber]. index in 'layersToCalculate', or its size if the
+        // layer is not calculated
+        vector<uint32_t> layerIdOfLayer;
+
+        // [layerId]. while the succeeders are counted, thread t is the only
+        // one writing the count values of the states from
+        // t * ownedStateCount[layerId] on
+        vector<StateNumberVarType> ownedStateCount;
+
+        // [threadNo]
+        vector<CountIncrementInbox> countInboxes;
+
         // total numbers of knots which have to be stored in memory
         int64_t totalKnotCount;
 
         // number of knots of all layers to be calculated
         int64_t knotToCalcCount;
 
+        // states processed by all threads in the current step
+        std::atomic<int64_t> stateProcessedCount {0};
+
         vector<RetroAnalysisThreadVars> thread;
         uint32_t statsValueCounter[SKV_VALUE_COUNT];
         MiniMax *pMiniMax;
+
+        // memory of the 'statesToProcess' cyclic arrays of all threads
+        CyclicArrayMemory queueMemory;
+
+        // the iteration begins with this ply number. it is not 0 when a
+        // checkpoint has been loaded
+        uint32_t firstPlyNumber {0};
+
+        // file holding the last checkpoint of the iteration
+        string checkpointFilePath;
+        Clock::time_point lastCheckpointTime;
+
+        // ply number after which thread 0 writes a checkpoint. it is set by
+        // thread 0 before the threads wait for each other, -1 if none is due
+        std::atomic<int64_t> checkpointPlyNumber {-1};
     };
 
     struct RetroAnalysisDefaultThreadVars
@@ -811,7 +1001,7 @@ private:
         MiniMax *pMiniMax;
         retroAnalysisGlobalVars *retroVars;
         uint32_t layerNumber;
-        LONGLONG statesProcessed;
+        int64_t statesProcessed;
         uint32_t statsValueCounter[SKV_VALUE_COUNT];
 
         RetroAnalysisDefaultThreadVars() { }
@@ -832,7 +1022,7 @@ private:
 
         void reduceDefault()
         {
-            pMiniMax->stateProcessedCount += this->statesProcessed;
+            retroVars->stateProcessedCount += this->statesProcessed;
             for (uint32_t curStateValue = 0; curStateValue < SKV_VALUE_COUNT;
                  curStateValue++) {
                 retroVars->statsValueCounter[curStateValue] +=
@@ -869,6 +1059,10 @@ private:
     {
         RetroAnalysisPredVars predVars[PREDECESSOR_COUNT_MAX];
 
+        // [threadNo]. count value increments for the states of each thread
+        vector<vector<CountIncrement>> countIncrements;
+        bool countIncrementFailed = false;
+
         AddNumSucceedersVars() { }
 
         AddNumSucceedersVars(MiniMax *pMiniMax,
@@ -879,7 +1073,18 @@ private:
 
         void initElement(AddNumSucceedersVars &master) { *this = master; };
 
-        void reduce() { reduceDefault(); }
+        // passes the increments which are left to their threads
+        void reduce()
+        {
+            for (uint32_t threadNo = 0; threadNo < countIncrements.size();
+                 threadNo++) {
+                if (!countIncrements[threadNo].empty())
+                    pMiniMax->sendCountIncrements(*retroVars,
+                                                  countIncrements[threadNo],
+                                                  threadNo);
+            }
+            reduceDefault();
+        }
     };
 
     /*** private variables
@@ -895,11 +1100,16 @@ private:
     // true, if the database is currently being calculated
     bool calcDatabase = false;
 
-    // handle of the file for the short knot value
-    HANDLE hFileShortKnotValues = nullptr;
+    // file for the short knot value
+    RandomAccessFile skvFile;
+
+    // file for the ply info
+    RandomAccessFile plyInfoFile;
 
-    // handle of the file for the ply info
-    HANDLE hFilePlyInfo = nullptr;
+    // read-only mappings of the two files, as soon as the database is
+    // completed. lookups are then plain memory reads
+    MappedFile skvMap;
+    MappedFile plyInfoMap;
 
     // short knot value file header
     SkvFileHeader skvfHeader;
@@ -925,10 +1135,11 @@ private:
 
     ThreadManager threadManager;
 
-    CRITICAL_SECTION csDatabase;
+    // for loading the layers into memory. the files are read without it
+    std::mutex csDatabase;
 
     // for thread safety when output is passed to osPrint
-    CRITICAL_SECTION csOsPrint;
+    std::mutex csOsPrint;
 
     // called every time output is passed to osPrint
     void (*userPrintFunc)(void *) = nullptr;
@@ -943,9 +1154,69 @@ private:
 
     // memory in bytes used for storing: ply info, short knot value and
     // ...
-    LONGLONG memoryUsed2 = 0;
+    std::atomic<int64_t> memoryUsed2 {0};
+
+    // upper limit for memoryUsed2. completed layers are kept in the layer
+    // cache as long as they fit into it, the least recently used ones are
+    // evicted first. 0 disables the cache
+    int64_t memoryBudget = 0;
+
+    // [layerNumber]. readers hold csCache shared, loading and evicting hold it
+    // exclusively
+    CacheEntry *skvCache = nullptr;
+    CacheEntry *plyInfoCache = nullptr;
+    std::shared_mutex csCache;
+
+    // position of the clock hand, runs over the skv and then the ply info
+    // entries
+    uint32_t cacheClockHand = 0;
+
+    // layer cache statistics
+    std::atomic<int64_t> cacheHits {0};
+    std::atomic<int64_t> cacheMisses {0};
+    std::atomic<int64_t> cacheEvictions {0};
+
+    // see QUEUE_MEMORY_THRESHOLD_DEFAULT
+    int64_t queueMemoryThreshold = QUEUE_MEMORY_THRESHOLD_DEFAULT;
 
-    LONGLONG stateProcessedCount = 0;
+    // see RETRO_CHECKPOINT_INTERVAL_DEFAULT. 0 disables the checkpoints
+    int64_t checkpointInterval = RETRO_CHECKPOINT_INTERVAL_DEFAULT;
+
+    // see CALC_MEMORY_LIMIT_DEFAULT
+    int64_t calcMemoryLimit = CALC_MEMORY_LIMIT_DEFAULT;
+
+    // the retro analysis writes a checkpoint before this ply number and is
+    // cancelled then. only set by testRetroAnalysisResume(), -1 otherwise
+    int64_t retroAnalysisStopPly = -1;
+
+    // true if skvFile is the block-compressed file
+    bool skvFileIsCompressed = false;
+
+    // header of the compressed short knot value file
+    CompressedSkvFileHeader cskvHeader;
+
+    // [layerNumber], LayerCount + 1 entries
+    uint32_t *firstBlockOfLayer = nullptr;
+
+    // [blockNumber], blockCount + 1 entries. file offset of each block
+    int64_t *blockOffset = nullptr;
+
+    // [blockNumber % SKV_BLOCK_CACHE_SLOTS]
+    BlockCacheSlot *blockCache = nullptr;
+
+    // block cache statistics
+    std::atomic<int64_t> blockCacheHits {0};
+    std::atomic<int64_t> blockCacheMisses {0};
+
+    // warms the layers passed by prefetchLayers() in the background. while
+    // the database is calculated, they are only read into the page cache
+    std::thread prefetchThread;
+    std::mutex csPrefetch;
+    std::condition_variable prefetchRequested;
+    vector<uint32_t> layersToPrefetch;
+    bool prefetchIntoLayerCache = true;
+    std::atomic<bool> stopPrefetching {false};
+    std::atomic<int64_t> prefetchedLayers {0};
 
     // maximum number of branches/moves
     uint32_t maxNumBranches = 0;
@@ -954,10 +1225,10 @@ private:
     uint32_t fullTreeDepth = 0;
 
     // id of the currently calculated layer
-    uint32_t curCalculatedLayer = 0;
+    std::atomic<uint32_t> curCalculatedLayer {0};
 
     // one of ...
-    uint32_t curCalcActionId = 0;
+    std::atomic<uint32_t> curCalcActionId {0};
 
     // true if the current considered layer has already been calculated and
     // stored in the database
@@ -996,14 +1267,12 @@ private:
     // number of write operations done since start of the program
     int64_t nWritePlyOps = 0;
 
-    // time of interval for read operations
-    LARGE_INTEGER readSkvInterval;
-    LARGE_INTEGER writeSkvInterval;
-    LARGE_INTEGER readPlyInterval;
-    LARGE_INTEGER writePlyInterval;
-
-    // performance-counter frequency, in counts per second
-    LARGE_INTEGER frequency;
+    // time of interval for read operations. the time since the epoch of the
+    // clock when only the io-operations are measured
+    Clock::time_point readSkvInterval;
+    Clock::time_point writeSkvInterval;
+    Clock::time_point readPlyInterval;
+    Clock::time_point writePlyInterval;
 
     /*** private functions
      * ************************************************************************/
@@ -1011,7 +1280,24 @@ private:
     // database functions
     void openSkvFile(const char *path, uint32_t branchCountMax);
     void openPlyInfoFile(const char *path);
+    void mapCompletedDatabase();
+    void adviseLayer(uint32_t layerNumber, MappedFile::Advice advice);
     bool calcLayer(uint32_t layerNumber);
+    bool layerNeedsCalculation(uint32_t layerNumber,
+                               const vector<bool> &layerCalculated);
+    void getLayerDependencies(uint32_t layerNumber,
+                              vector<uint32_t> &dependencies);
+    bool isLayerReady(uint32_t layerNumber, const vector<bool> &layerCalculated,
+                      vector<uint32_t> &dependencies);
+    uint32_t getNextLayerToCalc(const vector<bool> &layerCalculated,
+                                const vector<uint32_t> &layersToSkip);
+    void getLayersToCalcTogether(const vector<bool> &layerCalculated,
+                                 vector<uint32_t> &layers);
+    int64_t getLayerCalcMemory(uint32_t layerNumber);
+    bool calcLayersTogether(const vector<uint32_t> &layers);
+    ThreadManager &getThreadManager();
+    int64_t getBytesInCache(const vector<uint32_t> &layers);
+    void prefetchLayersForCalc(uint32_t layerNumber);
     void unloadPlyInfo(uint32_t layerNumber);
     void unloadLayer(uint32_t layerNumber);
     void saveHeader(SkvFileHeader *dbH, LayerStats *lStats);
@@ -1028,16 +1314,36 @@ private:
                                  TwoBit knotValue);
     void savePlyInfoInDatabase(uint32_t layerNumber, uint32_t stateNumber,
                                PlyInfoVarType value);
-    void loadBytesFromFile(HANDLE hFile, int64_t offset, uint32_t nBytes,
-                           void *pBytes);
-    void saveBytesToFile(HANDLE hFile, int64_t offset, uint32_t nBytes,
-                         void *pBytes);
+    void loadBytesFromFile(RandomAccessFile &file, int64_t offset,
+                           uint32_t nBytes, void *pBytes);
+    void saveBytesToFile(RandomAccessFile &file, int64_t offset,
+                         uint32_t nBytes, void *pBytes);
     void saveLayerToFile(uint32_t layerNumber);
-    inline void measureIops(int64_t &nOps, LARGE_INTEGER &interval,
-                            LARGE_INTEGER &curTimeBefore, char text[]);
+    bool readFromCache(bool plyInfo, uint32_t layerNumber, int64_t offset,
+                       uint32_t nBytes, void *pBytes);
+    bool loadIntoCache(bool plyInfo, uint32_t layerNumber);
+    bool makeRoomInCache(int64_t bytes);
+    CacheEntry &getCacheEntry(bool plyInfo, uint32_t layerNumber);
+    bool prefetchIntoCache(bool plyInfo, uint32_t layerNumber);
+    void prefetchThreadProc();
+    void startPrefetching(vector<uint32_t> &layers, bool intoLayerCache);
+    int64_t prefetchLayer(uint32_t layerNumber, bool intoLayerCache);
+    void stopPrefetchThread();
+    void evictFromCache(bool plyInfo, uint32_t layerNumber);
+    void clearCache();
+    bool loadBlockIndex();
+    void closeCompressedSkvFile();
+    unsigned char readCompressedByte(uint32_t layerNumber,
+                                     uint32_t byteNumber);
+    static uint32_t compressBlock(const unsigned char *src, uint32_t nBytes,
+                                  unsigned char *dst);
+    static bool decompressBlock(const unsigned char *src, uint32_t srcSize,
+                                unsigned char *dst, uint32_t nBytes);
+    inline void measureIops(int64_t &nOps, Clock::time_point &interval,
+                            Clock::time_point &curTimeBefore, char text[]);
 
     // Testing functions
-    static DWORD testLayerThreadProc(void *pParam, uint32_t index);
+    static uint32_t testLayerThreadProc(void *pParam, uint32_t index);
 
     // Alpha-Beta-Algorithm
     bool calcKnotValuesByAlphaBeta(uint32_t layerNumber);
@@ -1061,8 +1367,10 @@ private:
     void alphaBetaSaveInDatabase(uint32_t threadNo, uint32_t layerNumber,
                                  uint32_t stateNumber, TwoBit knotValue,
                                  PlyInfoVarType plyValue, bool invertValue);
-    static DWORD initAlphaBetaThreadProc(void *pParam, uint32_t index);
-    static DWORD runAlphaBetaThreadProc(void *pParam, uint32_t index);
+    static uint32_t initAlphaBetaThreadProc(void *pParam, uint32_t index);
+    static uint32_t runAlphaBetaThreadProc(void *pParam, uint32_t index);
+    bool saveAlphaBetaCheckpoint(AlphaBetaGlobalVars &alphaBetaVars);
+    bool loadAlphaBetaCheckpoint(AlphaBetaGlobalVars &alphaBetaVars);
 
     // Retro Analysis
     bool calcKnotValuesByRetroAnalysis(vector<uint32_t> &layersToCalculate);
@@ -1073,14 +1381,31 @@ private:
     bool addStateToProcessQueue(retroAnalysisGlobalVars &retroVars,
                                 RetroAnalysisThreadVars &threadVars,
                                 uint32_t plyNumber, StateAdress *pState);
+    bool saveRetroAnalysisCheckpoint(retroAnalysisGlobalVars &retroVars,
+                                     uint32_t nextPlyNumber);
+    bool loadRetroAnalysisCheckpoint(retroAnalysisGlobalVars &retroVars);
+    string getRetroCheckpointFilePath(const vector<uint32_t> &layersToCalc);
+    bool readRetroAnalysisCheckpointLayout(
+        retroAnalysisGlobalVars &retroVars, RandomAccessFile &file,
+        RetroCheckpointHeader &header, vector<uint32_t> &arrayFlags);
     static bool retroAnalysisQueueStateComp(const RetroAnalysisQueueState &a,
                                             const RetroAnalysisQueueState &b)
     {
         return a.stateNumber < b.stateNumber;
     };
-    static DWORD initRetroAnalysisThreadProc(void *pParam, uint32_t index);
-    static DWORD addNumSucceedersThreadProc(void *pParam, uint32_t index);
-    static DWORD performRetroAnalysisThreadProc(void *pParam);
+    static uint32_t initRetroAnalysisThreadProc(void *pParam, uint32_t index);
+    static uint32_t addNumSucceedersThreadProc(void *pParam, uint32_t index);
+    static uint32_t applyCountIncrementsThreadProc(void *pParam);
+    bool applyLeftCountIncrements(
+        ThreadManager::ThreadVarsArray<AddNumSucceedersVars> &tva);
+    void sendCountIncrements(retroAnalysisGlobalVars &retroVars,
+                             vector<CountIncrement> &increments,
+                             uint32_t threadNo);
+    bool applyCountIncrements(retroAnalysisGlobalVars &retroVars,
+                              uint32_t threadNo);
+    bool incrementCountValue(retroAnalysisGlobalVars &retroVars,
+                             uint32_t layerId, StateNumberVarType stateNumber);
+    static uint32_t performRetroAnalysisThreadProc(void *pParam);
 
     // Progress report functions
     void showLayerStats(uint32_t layerNumber);
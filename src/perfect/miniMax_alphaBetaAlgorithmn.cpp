@@ -20,12 +20,17 @@ bool MiniMax::calcKnotValuesByAlphaBeta(uint32_t layerNumber)
 {
     // locals
     AlphaBetaGlobalVars alphaBetaVars(this, layerNumber); // multi-thread vars
+    stringstream ssCheckpointPath;
 
     // Version 10:
     PRINT(1, this,
           "*** Calculate layer " << layerNumber
                                  << " by alpha-beta-algorithmn ***" << endl);
     curCalcActionId = MM_ACTION_PERFORM_ALPHA_BETA;
+    ssCheckpointPath << fileDir << (fileDir.size() ? "/" : "") << "checkpoint";
+    createDirectory(ssCheckpointPath.str().c_str());
+    ssCheckpointPath << "/alphaBeta " << layerNumber << ".dat";
+    alphaBetaVars.checkpointFilePath = ssCheckpointPath.str();
 
     // initialization
     PRINT(2, this, "  Bytes in memory: " << memoryUsed2 << endl);
@@ -33,11 +38,17 @@ bool MiniMax::calcKnotValuesByAlphaBeta(uint32_t layerNumber)
         return false;
     }
 
+    // continue an interrupted calculation
+    if (!loadAlphaBetaCheckpoint(alphaBetaVars)) {
+        return false;
+    }
+
     // run alpha-beta algorithm
     PRINT(2, this, "  Bytes in memory: " << memoryUsed2 << endl);
     if (!runAlphaBeta(alphaBetaVars)) {
         return false;
     }
+    std::remove(alphaBetaVars.checkpointFilePath.c_str());
 
     // update layerStats[].wonStateCount, etc.
     PRINT(2, this, "  Bytes in memory: " << memoryUsed2 << endl);
@@ -96,7 +107,6 @@ void MiniMax::alphaBetaSaveInDatabase(uint32_t threadNo, uint32_t layerNumber,
 //-----------------------------------------------------------------------------
 bool MiniMax::initAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
 {
-#ifndef __clang__ // TODO(calcitem)
     // locals
     BufferedFile *invalidArray;
 
@@ -116,20 +126,20 @@ bool MiniMax::initAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
 
     // file names
     ssInvArrayDir.str("");
-    ssInvArrayDir << fileDir << (fileDir.size() ? "\\" : "") << "invalidStates";
+    ssInvArrayDir << fileDir << (fileDir.size() ? "/" : "") << "invalidStates";
     ssInvArrayFilePath.str("");
-    ssInvArrayFilePath << fileDir << (fileDir.size() ? "\\" : "")
-                       << "invalidStates\\invalidStatesOfLayer"
+    ssInvArrayFilePath << fileDir << (fileDir.size() ? "/" : "")
+                       << "invalidStates/invalidStatesOfLayer"
                        << alphaBetaVars.layerNumber << ".dat";
 
     // does initialization file exist ?
-    CreateDirectoryA(ssInvArrayDir.str().c_str(), nullptr);
-    invalidArray = new BufferedFile(threadManager.getThreadCount(),
+    createDirectory(ssInvArrayDir.str().c_str());
+    invalidArray = new BufferedFile(getThreadManager().getThreadCount(),
                                     FILE_BUFFER_SIZE,
                                     ssInvArrayFilePath.str().c_str());
 
     if (invalidArray->getFileSize() ==
-        (LONGLONG)layerStats[alphaBetaVars.layerNumber].knotsInLayer) {
+        (int64_t)layerStats[alphaBetaVars.layerNumber].knotsInLayer) {
         PRINT(2, this,
               "  Loading invalid states from file: "
                   << ssInvArrayFilePath.str());
@@ -137,21 +147,20 @@ bool MiniMax::initAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
     }
 
     // prepare params
-    stateProcessedCount = 0;
+    alphaBetaVars.stateProcessedCount = 0;
     alphaBetaVars.statsValueCounter[SKV_VALUE_GAME_WON] = 0;
     alphaBetaVars.statsValueCounter[SKV_VALUE_GAME_LOST] = 0;
     alphaBetaVars.statsValueCounter[SKV_VALUE_GAME_DRAWN] = 0;
     alphaBetaVars.statsValueCounter[SKV_VALUE_INVALID] = 0;
+    InitAlphaBetaVars masterVars(
+        this, &alphaBetaVars, alphaBetaVars.layerNumber, invalidArray, initAlreadyDone);
     ThreadManager::ThreadVarsArray<InitAlphaBetaVars> tva(
-        threadManager.getThreadCount(),
-        (InitAlphaBetaVars &)InitAlphaBetaVars(this, &alphaBetaVars,
-                                               alphaBetaVars.layerNumber,
-                                               invalidArray, initAlreadyDone));
+        getThreadManager().getThreadCount(), masterVars);
 
     // process each state in the current layer
-    switch (threadManager.execParallelLoop(
+    switch (getThreadManager().execParallelLoop(
         initAlphaBetaThreadProc, tva.getPointerToArray(), tva.getArraySize(),
-        TM_SCHED_STATIC, 0,
+        TM_SCHED_GUIDED, 0,
         layerStats[alphaBetaVars.layerNumber].knotsInLayer - 1, 1)) {
     case TM_RETVAL_OK:
         break;
@@ -175,7 +184,7 @@ bool MiniMax::initAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
 
     // reduce and delete thread specific data
     tva.reduce();
-    if (stateProcessedCount <
+    if (alphaBetaVars.stateProcessedCount <
         layerStats[alphaBetaVars.layerNumber].knotsInLayer) {
         SAFE_DELETE(invalidArray);
         return falseOrStop();
@@ -200,7 +209,6 @@ bool MiniMax::initAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
     PRINT(2, this,
           "    invalid states: "
               << alphaBetaVars.statsValueCounter[SKV_VALUE_INVALID]);
-#endif // __clang__
     return true;
 }
 
@@ -210,7 +218,7 @@ bool MiniMax::initAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
 // and knotAlreadyCalculated to true or false, whether setSituation() returns
 // true or false
 //-----------------------------------------------------------------------------
-DWORD MiniMax::initAlphaBetaThreadProc(void *pParam, uint32_t index)
+uint32_t MiniMax::initAlphaBetaThreadProc(void *pParam, uint32_t index)
 {
     // locals
     InitAlphaBetaVars *iabVars = (InitAlphaBetaVars *)pParam;
@@ -226,10 +234,10 @@ DWORD MiniMax::initAlphaBetaThreadProc(void *pParam, uint32_t index)
 
     // print status
     if (iabVars->statesProcessed % OUTPUT_EVERY_N_STATES == 0) {
-        m->stateProcessedCount += OUTPUT_EVERY_N_STATES;
+        iabVars->alphaBetaVars->stateProcessedCount += OUTPUT_EVERY_N_STATES;
         PRINT(2, m,
               "Already initialized "
-                  << m->stateProcessedCount << " of "
+                  << iabVars->alphaBetaVars->stateProcessedCount << " of "
                   << m->layerStats[curState.layerNumber].knotsInLayer
                   << " states");
     }
@@ -294,29 +302,34 @@ DWORD MiniMax::initAlphaBetaThreadProc(void *pParam, uint32_t index)
 //-----------------------------------------------------------------------------
 bool MiniMax::runAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
 {
-#ifndef __clang__ // TODO(calcitem)
     // prepare params
     PRINT(1, this,
           "  Calculate layer " << alphaBetaVars.layerNumber
                                << " with function letTheTreeGrow():");
-    stateProcessedCount = 0;
+    alphaBetaVars.stateProcessedCount = 0;
     alphaBetaVars.statsValueCounter[SKV_VALUE_GAME_WON] = 0;
     alphaBetaVars.statsValueCounter[SKV_VALUE_GAME_LOST] = 0;
     alphaBetaVars.statsValueCounter[SKV_VALUE_GAME_DRAWN] = 0;
     alphaBetaVars.statsValueCounter[SKV_VALUE_INVALID] = 0;
+    RunAlphaBetaVars masterVars(
+        this, &alphaBetaVars, alphaBetaVars.layerNumber);
     ThreadManager::ThreadVarsArray<RunAlphaBetaVars> tva(
-        threadManager.getThreadCount(),
-        (RunAlphaBetaVars &)RunAlphaBetaVars(this, &alphaBetaVars,
-                                             alphaBetaVars.layerNumber));
+        getThreadManager().getThreadCount(), masterVars);
 
     // so far no multi-threading implemented
-    threadManager.setThreadCount(1);
+    ThreadManager &threads = getThreadManager();
+    const uint32_t threadCount = threads.getThreadCount();
+    threads.setThreadCount(1);
+    alphaBetaVars.lastCheckpointTime = Clock::now();
 
     // process each state in the current layer
-    switch (threadManager.execParallelLoop(
+    const uint32_t returnValue = threads.execParallelLoop(
         runAlphaBetaThreadProc, tva.getPointerToArray(), tva.getArraySize(),
-        TM_SCHED_STATIC, 0,
-        layerStats[alphaBetaVars.layerNumber].knotsInLayer - 1, 1)) {
+        TM_SCHED_DYNAMIC, 0,
+        layerStats[alphaBetaVars.layerNumber].knotsInLayer - 1, 1);
+    threads.setThreadCount(threadCount);
+
+    switch (returnValue) {
     case TM_RETVAL_OK:
         break;
     case TM_RETVAL_EXEC_CANCELLED:
@@ -331,11 +344,9 @@ bool MiniMax::runAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
         return falseOrStop();
     }
 
-    threadManager.setThreadCount(4);
-
     // reduce and delete thread specific data
     tva.reduce();
-    if (stateProcessedCount <
+    if (alphaBetaVars.stateProcessedCount <
         layerStats[alphaBetaVars.layerNumber].knotsInLayer)
         return falseOrStop();
 
@@ -352,7 +363,6 @@ bool MiniMax::runAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
     PRINT(2, this,
           "    invalid states: "
               << alphaBetaVars.statsValueCounter[SKV_VALUE_INVALID]);
-#endif // __clang__
     return true;
 }
 
@@ -360,7 +370,7 @@ bool MiniMax::runAlphaBeta(AlphaBetaGlobalVars &alphaBetaVars)
 // runAlphaBetaThreadProc()
 //
 //-----------------------------------------------------------------------------
-DWORD MiniMax::runAlphaBetaThreadProc(void *pParam, uint32_t index)
+uint32_t MiniMax::runAlphaBetaThreadProc(void *pParam, uint32_t index)
 {
     // locals
     RunAlphaBetaVars *rabVars = (RunAlphaBetaVars *)pParam;
@@ -375,13 +385,24 @@ DWORD MiniMax::runAlphaBetaThreadProc(void *pParam, uint32_t index)
 
     // print status
     if (rabVars->statesProcessed % OUTPUT_EVERY_N_STATES == 0) {
-        m->stateProcessedCount += OUTPUT_EVERY_N_STATES;
+        rabVars->alphaBetaVars->stateProcessedCount += OUTPUT_EVERY_N_STATES;
         PRINT(2, m,
-              "  Processed " << m->stateProcessedCount << " of "
+              "  Processed " << rabVars->alphaBetaVars->stateProcessedCount
+                             << " of "
                              << m->layerStats[curState.layerNumber].knotsInLayer
                              << " states");
     }
 
+    // the calculation runs on one thread, so that the arrays of the layer do
+    // not change while they are written to the checkpoint
+    if (m->checkpointInterval > 0 &&
+        m->getThreadManager().getThreadCount() == 1 &&
+        Clock::now() - rabVars->alphaBetaVars->lastCheckpointTime >=
+            std::chrono::seconds(m->checkpointInterval)) {
+        m->saveAlphaBetaCheckpoint(*rabVars->alphaBetaVars);
+        rabVars->alphaBetaVars->lastCheckpointTime = Clock::now();
+    }
+
     // Version 10: state already calculated? if so leave.
     m->readPlyInfoFromDatabase(curState.layerNumber, curState.stateNumber,
                                plyInfo);
@@ -398,13 +419,153 @@ DWORD MiniMax::runAlphaBetaThreadProc(void *pParam, uint32_t index)
     } else {
         // should not occur, because already tested by plyInfo ==
         // PLYINFO_VALUE_UNCALCULATED
-        MessageBoxW(nullptr,
-                    L"This event should never occur. if (!m->setSituation())",
-                    L"ERROR", MB_OK);
+        PRINT(0, m,
+              "ERROR: This event should never occur. if (!m->setSituation())");
     }
     return TM_RETVAL_OK;
 }
 
+//-----------------------------------------------------------------------------
+// saveAlphaBetaCheckpoint()
+// Writes the short knot values and ply infos of the layer being calculated to
+// the checkpoint file. The states calculated so far have a ply info other than
+// PLYINFO_VALUE_UNCALCULATED and are skipped after a restart. Must only be
+// called while no other thread modifies the arrays. The previous checkpoint is
+// only replaced by a complete one.
+//-----------------------------------------------------------------------------
+bool MiniMax::saveAlphaBetaCheckpoint(AlphaBetaGlobalVars &alphaBetaVars)
+{
+    // locals
+    RandomAccessFile file;
+    AlphaBetaCheckpointHeader header;
+    const uint32_t layerNumber = alphaBetaVars.layerNumber;
+    const string tmpFilePath = alphaBetaVars.checkpointFilePath + ".tmp";
+    int64_t offset = 0;
+    bool ok;
+
+    // writes large arrays in parts
+    auto writeBytes = [&](int64_t n, const void *p) {
+        const unsigned char *pBytes = (const unsigned char *)p;
+        while (n > 0) {
+            const uint32_t part = (uint32_t)std::min(n, (int64_t)1 << 26);
+            if (file.write(offset, part, pBytes) != part)
+                return false;
+            offset += part;
+            pBytes += part;
+            n -= part;
+        }
+        return true;
+    };
+
+    // both arrays are in memory since the initialization
+    if (!layerStats[layerNumber].layerIsLoaded ||
+        !plyInfos[layerNumber].plyInfoIsLoaded)
+        return false;
+
+    header.headerCode = ALPHA_BETA_CHECKPOINT_HEADER_CODE;
+    header.layerNumber = layerNumber;
+    header.knotsInLayer = layerStats[layerNumber].knotsInLayer;
+
+    std::remove(tmpFilePath.c_str());
+    if (!file.open(tmpFilePath.c_str())) {
+        PRINT(0, this, "ERROR: Could not create " << tmpFilePath << "!");
+        return false;
+    }
+
+    PRINT(1, this,
+          "    Write checkpoint to " << alphaBetaVars.checkpointFilePath);
+
+    ok = writeBytes(sizeof(AlphaBetaCheckpointHeader), &header) &&
+         writeBytes(layerStats[layerNumber].sizeInBytes,
+                    layerStats[layerNumber].shortKnotValueByte) &&
+         writeBytes((int64_t)plyInfos[layerNumber].knotsInLayer *
+                        sizeof(PlyInfoVarType),
+                    plyInfos[layerNumber].plyInfo) &&
+         file.sync();
+    file.close();
+
+    if (!ok) {
+        PRINT(0, this, "ERROR: Could not write " << tmpFilePath << "!");
+        std::remove(tmpFilePath.c_str());
+        return false;
+    }
+
+    // replaces the previous checkpoint at once
+    if (!replaceFile(tmpFilePath.c_str(),
+                     alphaBetaVars.checkpointFilePath.c_str())) {
+        PRINT(0, this, "ERROR: Could not rename " << tmpFilePath << "!");
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// loadAlphaBetaCheckpoint()
+// Replaces the arrays of the initialized layer by those of the checkpoint
+// file, if there is a complete one. Returns false only if the file could not
+// be read after the arrays had been modified.
+//-----------------------------------------------------------------------------
+bool MiniMax::loadAlphaBetaCheckpoint(AlphaBetaGlobalVars &alphaBetaVars)
+{
+    // locals
+    RandomAccessFile file;
+    AlphaBetaCheckpointHeader header;
+    const uint32_t layerNumber = alphaBetaVars.layerNumber;
+    const int64_t plyInfoSize = (int64_t)plyInfos[layerNumber].knotsInLayer *
+                                sizeof(PlyInfoVarType);
+    int64_t offset = sizeof(AlphaBetaCheckpointHeader);
+
+    // reads large arrays in parts
+    auto readBytes = [&](int64_t n, void *p) {
+        unsigned char *pBytes = (unsigned char *)p;
+        while (n > 0) {
+            const uint32_t part = (uint32_t)std::min(n, (int64_t)1 << 26);
+            if (file.read(offset, part, pBytes) != part)
+                return false;
+            offset += part;
+            pBytes += part;
+            n -= part;
+        }
+        return true;
+    };
+
+    if (!pathExists(alphaBetaVars.checkpointFilePath.c_str()) ||
+        !file.open(alphaBetaVars.checkpointFilePath.c_str()))
+        return true;
+
+    if (file.read(0, sizeof(AlphaBetaCheckpointHeader), &header) !=
+            sizeof(AlphaBetaCheckpointHeader) ||
+        header.headerCode != ALPHA_BETA_CHECKPOINT_HEADER_CODE ||
+        header.layerNumber != layerNumber ||
+        header.knotsInLayer != layerStats[layerNumber].knotsInLayer ||
+        file.getFileSize() != offset + layerStats[layerNumber].sizeInBytes +
+                                  plyInfoSize ||
+        !layerStats[layerNumber].layerIsLoaded ||
+        !plyInfos[layerNumber].plyInfoIsLoaded) {
+        PRINT(1, this,
+              "  Ignore invalid checkpoint: "
+                  << alphaBetaVars.checkpointFilePath);
+        file.close();
+        std::remove(alphaBetaVars.checkpointFilePath.c_str());
+        return true;
+    }
+
+    PRINT(1, this,
+          "  Continue from checkpoint: " << alphaBetaVars.checkpointFilePath);
+
+    if (!readBytes(layerStats[layerNumber].sizeInBytes,
+                   layerStats[layerNumber].shortKnotValueByte) ||
+        !readBytes(plyInfoSize, plyInfos[layerNumber].plyInfo)) {
+        PRINT(0, this,
+              "ERROR: Could not read " << alphaBetaVars.checkpointFilePath
+                                       << "!");
+        return falseOrStop();
+    }
+
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // letTheTreeGrow()
 //
@@ -493,7 +654,7 @@ void MiniMax::letTheTreeGrow(Knot *knot, RunAlphaBetaVars *rabVars,
         }
 
         // save value and best branch into database and set value as valid
-        if (calcDatabase && hFileShortKnotValues && hFilePlyInfo)
+        if (calcDatabase && skvFile.isOpen() && plyInfoFile.isOpen())
             alphaBetaSaveInDatabase(rabVars->curThreadNo, layerNumber,
                                     stateNumber, knot->shortValue,
                                     knot->plyInfo, knot->isOpponentLevel);
@@ -519,7 +680,7 @@ bool MiniMax::alphaBetaTryDatabase(Knot *knot, RunAlphaBetaVars *rabVars,
     PlyInfoVarType plyInfo = PLYINFO_VALUE_UNCALCULATED;
 
     // use database ?
-    if (hFilePlyInfo != nullptr && hFileShortKnotValues != nullptr &&
+    if (plyInfoFile.isOpen() && skvFile.isOpen() &&
         (calcDatabase || layerInDatabase)) {
         // situation already existed in database ?
         readKnotValueFromDatabase(rabVars->curThreadNo, layerNumber,
@@ -632,7 +793,7 @@ void MiniMax::alphaBetaTryPossibilities(Knot *knot, RunAlphaBetaVars *rabVars,
                 maxWonfreqValuesSubMoves =
                     rabVars->freqValuesSubMoves[SKV_VALUE_GAME_WON];
             }
-            if (hFileShortKnotValues != nullptr && layerInDatabase) {
+            if (skvFile.isOpen() && layerInDatabase) {
                 storeMoveValue(rabVars->curThreadNo, idPossibility[curPoss],
                                pPossibilities,
                                knot->branches[curPoss].shortValue,
@@ -660,11 +821,11 @@ void MiniMax::alphaBetaTryPossibilities(Knot *knot, RunAlphaBetaVars *rabVars,
         }
 
         // don't use alpha beta if using database
-        if (hFileShortKnotValues != nullptr && calcDatabase) {
+        if (skvFile.isOpen() && calcDatabase) {
             continue;
         }
 
-        if (hFileShortKnotValues != nullptr && tilLevel + 1 >= fullTreeDepth) {
+        if (skvFile.isOpen() && tilLevel + 1 >= fullTreeDepth) {
             continue;
         }
 
@@ -840,7 +1001,7 @@ void MiniMax::alphaBetaChooseBestMove(Knot *knot, RunAlphaBetaVars *rabVars,
         // check every possible move
         for (nBestChoices = 0, i = 0; i < knot->possibilityCount; i++) {
             // use info in database
-            if (layerInDatabase && hFileShortKnotValues != nullptr) {
+            if (layerInDatabase && skvFile.isOpen()) {
                 // selected move with equal knot value
                 if (knot->branches[i].shortValue == knot->shortValue) {
                     // best move lead to drawn state
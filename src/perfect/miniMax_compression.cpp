@@ -0,0 +1,483 @@
+/*********************************************************************
+    miniMax_compression.cpp
+    Copyright (C) 2021 The Sanmill developers (see AUTHORS file)
+    Licensed under the GPLv3 License.
+    https://github.com/madweasel/Muehle
+\*********************************************************************/
+
+#include "config.h"
+
+#ifdef MADWEASEL_MUEHLE_PERFECT_AI
+
+#include "miniMax.h"
+#include <cstdio>
+
+// first byte of each compressed block
+constexpr unsigned char SKV_BLOCK_STORED = 0;
+constexpr unsigned char SKV_BLOCK_LZ77 = 2;
+
+// the blocks are coded as a sequence of literal bytes and matches, i.e.
+// copies of bytes already decoded. runs are matches with an offset of one
+// byte. a token byte holds the number of literals in its upper and the match
+// length minus SKV_MATCH_MIN in its lower four bits. a nibble of 15 is
+// continued by bytes, which are added until one below 255. the literals follow
+// the token and then the 16-bit little-endian offset of the match. the last
+// sequence of a block has literals only.
+constexpr uint32_t SKV_MATCH_MIN = 4;
+constexpr uint32_t SKV_NIBBLE_MAX = 15;
+
+// the compressor finds matches by a hash of the next SKV_MATCH_MIN bytes and
+// tries this number of earlier positions with the same hash at most
+constexpr uint32_t SKV_HASH_BITS = 16;
+constexpr uint32_t SKV_MATCH_TRIES = 64;
+
+//-----------------------------------------------------------------------------
+// writeLength()
+// Appends the part of a length, which does not fit into the token nibble.
+//-----------------------------------------------------------------------------
+static void writeLength(uint32_t length, unsigned char *dst, uint32_t &out)
+{
+    for (length -= SKV_NIBBLE_MAX; length >= 255; length -= 255)
+        dst[out++] = 255;
+    dst[out++] = (unsigned char)length;
+}
+
+//-----------------------------------------------------------------------------
+// readLength()
+// Adds the continuation bytes of a length nibble. Returns false at the end of
+// the block.
+//-----------------------------------------------------------------------------
+static bool readLength(const unsigned char *src, uint32_t srcSize,
+                       uint32_t &in, uint32_t &length)
+{
+    unsigned char c;
+
+    if (length < SKV_NIBBLE_MAX)
+        return true;
+
+    do {
+        if (in >= srcSize)
+            return false;
+        c = src[in++];
+        length += c;
+    } while (c == 255);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// compressBlock()
+// Writes the compressed block to 'dst', which must hold 'nBytes' + 1 bytes.
+// Returns the size of the compressed block.
+//-----------------------------------------------------------------------------
+uint32_t MiniMax::compressBlock(const unsigned char *src, uint32_t nBytes,
+                                unsigned char *dst)
+{
+    // locals
+    vector<int32_t> head(1 << SKV_HASH_BITS, -1);
+    vector<int32_t> prev(nBytes);
+    uint32_t i = 0;
+    uint32_t out = 1;
+    uint32_t literalStart = 0;
+    uint32_t bestLength, bestOffset, length, tries;
+    int32_t candidate;
+
+    // hash of the SKV_MATCH_MIN bytes at position p
+    auto hash = [src](uint32_t p) {
+        uint32_t v;
+        std::memcpy(&v, &src[p], sizeof(v));
+        return (v * 2654435761u) >> (32 - SKV_HASH_BITS);
+    };
+    auto insert = [&](uint32_t p) {
+        if (p + SKV_MATCH_MIN <= nBytes) {
+            const uint32_t h = hash(p);
+            prev[p] = head[h];
+            head[h] = (int32_t)p;
+        }
+    };
+
+    // appends a sequence and returns false, if the block does not get smaller
+    auto writeSequence = [&](uint32_t nLiterals, uint32_t matchLength,
+                             uint32_t offset) {
+        const uint32_t maxSize = 1 + nLiterals / 255 + 1 + nLiterals + 2 +
+                                 matchLength / 255 + 1;
+        if (out + maxSize > nBytes)
+            return false;
+
+        const uint32_t matchCode = matchLength ? matchLength - SKV_MATCH_MIN
+                                               : 0;
+        dst[out++] = (unsigned char)(
+            (std::min(nLiterals, SKV_NIBBLE_MAX) << 4) |
+            std::min(matchCode, SKV_NIBBLE_MAX));
+        if (nLiterals >= SKV_NIBBLE_MAX)
+            writeLength(nLiterals, dst, out);
+        std::memcpy(&dst[out], &src[literalStart], nLiterals);
+        out += nLiterals;
+
+        if (matchLength) {
+            dst[out++] = (unsigned char)(offset & 0xFF);
+            dst[out++] = (unsigned char)(offset >> 8);
+            if (matchCode >= SKV_NIBBLE_MAX)
+                writeLength(matchCode, dst, out);
+        }
+        return true;
+    };
+
+    dst[0] = SKV_BLOCK_LZ77;
+
+    while (i < nBytes) {
+        bestLength = 0;
+        bestOffset = 0;
+
+        // longest match among the latest positions with the same hash
+        if (i + SKV_MATCH_MIN <= nBytes) {
+            for (candidate = head[hash(i)], tries = 0;
+                 candidate >= 0 && tries < SKV_MATCH_TRIES;
+                 candidate = prev[candidate], tries++) {
+                for (length = 0; i + length < nBytes &&
+                                 src[candidate + length] == src[i + length];
+                     length++) {
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestOffset = i - candidate;
+                }
+            }
+        }
+
+        if (bestLength < SKV_MATCH_MIN) {
+            insert(i++);
+            continue;
+        }
+
+        if (!writeSequence(i - literalStart, bestLength, bestOffset))
+            break;
+
+        for (length = 0; length < bestLength; length++)
+            insert(i++);
+        literalStart = i;
+    }
+
+    // store the block as it is, if it does not get smaller
+    if (i < nBytes ||
+        (i > literalStart && !writeSequence(i - literalStart, 0, 0))) {
+        dst[0] = SKV_BLOCK_STORED;
+        std::memcpy(&dst[1], src, nBytes);
+        return nBytes + 1;
+    }
+
+    return out;
+}
+
+//-----------------------------------------------------------------------------
+// decompressBlock()
+// Returns false if the block is corrupt.
+//-----------------------------------------------------------------------------
+bool MiniMax::decompressBlock(const unsigned char *src, uint32_t srcSize,
+                              unsigned char *dst, uint32_t nBytes)
+{
+    // locals
+    uint32_t in = 1;
+    uint32_t out = 0;
+    uint32_t nLiterals, matchLength, offset;
+
+    if (srcSize == 0)
+        return false;
+
+    if (src[0] == SKV_BLOCK_STORED) {
+        if (srcSize != nBytes + 1)
+            return false;
+        std::memcpy(dst, &src[1], nBytes);
+        return true;
+    }
+
+    if (src[0] != SKV_BLOCK_LZ77)
+        return false;
+
+    while (in < srcSize) {
+        const unsigned char token = src[in++];
+
+        // literals
+        nLiterals = token >> 4;
+        if (!readLength(src, srcSize, in, nLiterals) ||
+            in + nLiterals > srcSize || out + nLiterals > nBytes)
+            return false;
+        std::memcpy(&dst[out], &src[in], nLiterals);
+        in += nLiterals;
+        out += nLiterals;
+
+        // the last sequence has no match
+        if (in == srcSize)
+            break;
+
+        // match, which may overlap the bytes it produces
+        if (in + 2 > srcSize)
+            return false;
+        offset = src[in] | (src[in + 1] << 8);
+        in += 2;
+        matchLength = token & 0x0F;
+        if (!readLength(src, srcSize, in, matchLength))
+            return false;
+        matchLength += SKV_MATCH_MIN;
+        if (offset == 0 || offset > out || out + matchLength > nBytes)
+            return false;
+
+        // the bytes from 'from' on are repeated, which are twice as many
+        // after each copy
+        const uint32_t from = out - offset;
+        while (matchLength > 0) {
+            const uint32_t n = std::min(matchLength, out - from);
+            std::memcpy(&dst[out], &dst[from], n);
+            out += n;
+            matchLength -= n;
+        }
+    }
+
+    return out == nBytes;
+}
+
+//-----------------------------------------------------------------------------
+// compressDatabase()
+// Writes the short knot values of the completed database block by block
+// compressed to the file 'shortKnotValue.cmp'. It is used instead of
+// 'shortKnotValue.dat', when the latter does not exist.
+//-----------------------------------------------------------------------------
+bool MiniMax::compressDatabase(uint32_t blockSize)
+{
+    // locals
+    stringstream ssFile;
+    string fileName, tmpFileName;
+    RandomAccessFile cmpFile;
+    CompressedSkvFileHeader header;
+    vector<uint32_t> firstBlock;
+    vector<int64_t> offsets;
+    vector<unsigned char> block, compressed, check;
+    int64_t curOffset;
+    uint32_t curBlock = 0;
+    uint32_t i, b;
+
+    if (!skvFile.isOpen() || !skvfHeader.completed || skvFileIsCompressed) {
+        PRINT(0, this,
+              "ERROR: Only a completed, uncompressed database can be "
+              "compressed!");
+        return false;
+    }
+
+    if (blockSize < SKV_BLOCK_SIZE_MIN || blockSize > SKV_BLOCK_SIZE_MAX) {
+        PRINT(0, this, "ERROR: Invalid block size " << blockSize << "!");
+        return false;
+    }
+
+    // index of the first block of each layer
+    firstBlock.resize(skvfHeader.LayerCount + 1);
+    for (i = 0; i < skvfHeader.LayerCount; i++) {
+        firstBlock[i + 1] = firstBlock[i] +
+                            (layerStats[i].sizeInBytes + blockSize - 1) /
+                                blockSize;
+    }
+
+    header.headerCode = SKV_COMPRESSED_HEADER_CODE;
+    header.blockSize = blockSize;
+    header.blockCount = firstBlock[skvfHeader.LayerCount];
+    header.headerAndIndexSize = skvfHeader.headerAndStatsSize +
+                                sizeof(CompressedSkvFileHeader) +
+                                sizeof(uint32_t) * (skvfHeader.LayerCount + 1) +
+                                sizeof(int64_t) * (header.blockCount + 1);
+    offsets.resize(header.blockCount + 1);
+
+    // the file only gets its final name once it is complete
+    ssFile << fileDir << (fileDir.size() ? "/" : "") << "shortKnotValue.cmp";
+    fileName = ssFile.str();
+    tmpFileName = fileName + ".tmp";
+    std::remove(tmpFileName.c_str());
+
+    if (!cmpFile.open(tmpFileName.c_str())) {
+        PRINT(0, this, "ERROR: Could not create " << tmpFileName << "!");
+        return false;
+    }
+
+    PRINT(1, this,
+          "Compress short knot values into " << fileName << " using "
+                                             << header.blockCount
+                                             << " blocks of " << blockSize
+                                             << " bytes.");
+
+    block.resize(blockSize);
+    check.resize(blockSize);
+    compressed.resize(blockSize + 1);
+    curOffset = header.headerAndIndexSize;
+
+    for (i = 0; i < skvfHeader.LayerCount; i++) {
+        for (b = 0; b < layerStats[i].sizeInBytes; b += blockSize) {
+            const uint32_t nBytes = std::min(blockSize,
+                                             layerStats[i].sizeInBytes - b);
+
+            loadBytesFromFile(skvFile,
+                              skvfHeader.headerAndStatsSize +
+                                  layerStats[i].layerOffset + b,
+                              nBytes, block.data());
+            const uint32_t size = compressBlock(block.data(), nBytes,
+                                                compressed.data());
+
+            // a block, which cannot be read back, must not get into the file
+            if (!decompressBlock(compressed.data(), size, check.data(),
+                                 nBytes) ||
+                std::memcmp(block.data(), check.data(), nBytes) != 0) {
+                PRINT(0, this,
+                      "ERROR: Block " << b / blockSize << " of layer " << i
+                                      << " could not be compressed!");
+                cmpFile.close();
+                std::remove(tmpFileName.c_str());
+                return false;
+            }
+
+            saveBytesToFile(cmpFile, curOffset, size, compressed.data());
+            offsets[curBlock++] = curOffset;
+            curOffset += size;
+        }
+    }
+    offsets[curBlock] = curOffset;
+
+    // headers and index
+    saveBytesToFile(cmpFile, 0, sizeof(SkvFileHeader), &skvfHeader);
+    saveBytesToFile(cmpFile, sizeof(SkvFileHeader),
+                    sizeof(LayerStats) * skvfHeader.LayerCount, layerStats);
+    saveBytesToFile(cmpFile, skvfHeader.headerAndStatsSize,
+                    sizeof(CompressedSkvFileHeader), &header);
+    saveBytesToFile(cmpFile,
+                    skvfHeader.headerAndStatsSize +
+                        sizeof(CompressedSkvFileHeader),
+                    sizeof(uint32_t) * (skvfHeader.LayerCount + 1),
+                    firstBlock.data());
+    saveBytesToFile(cmpFile,
+                    skvfHeader.headerAndStatsSize +
+                        sizeof(CompressedSkvFileHeader) +
+                        sizeof(uint32_t) * (skvfHeader.LayerCount + 1),
+                    sizeof(int64_t) * (header.blockCount + 1), offsets.data());
+    cmpFile.close();
+
+    if (!replaceFile(tmpFileName.c_str(), fileName.c_str())) {
+        PRINT(0, this, "ERROR: Could not rename " << tmpFileName << "!");
+        return false;
+    }
+
+    PRINT(1, this,
+          "Compressed " << skvfHeader.headerAndStatsSize +
+                               layerStats[skvfHeader.LayerCount - 1]
+                                   .layerOffset +
+                               layerStats[skvfHeader.LayerCount - 1]
+                                   .sizeInBytes
+                        << " bytes to " << curOffset << " bytes.");
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// loadBlockIndex()
+// Reads the header and the index of the compressed short knot value file,
+// after the layer stats have been read.
+//-----------------------------------------------------------------------------
+bool MiniMax::loadBlockIndex()
+{
+    // locals
+    const int64_t indexOffset = skvfHeader.headerAndStatsSize +
+                                sizeof(CompressedSkvFileHeader);
+
+    if (skvFile.read(skvfHeader.headerAndStatsSize,
+                     sizeof(CompressedSkvFileHeader),
+                     &cskvHeader) != sizeof(CompressedSkvFileHeader) ||
+        cskvHeader.headerCode != SKV_COMPRESSED_HEADER_CODE ||
+        cskvHeader.blockSize < SKV_BLOCK_SIZE_MIN ||
+        cskvHeader.blockSize > SKV_BLOCK_SIZE_MAX || !skvfHeader.completed) {
+        PRINT(0, this, "ERROR: Invalid compressed short knot value file!");
+        return false;
+    }
+
+    firstBlockOfLayer = new uint32_t[skvfHeader.LayerCount + 1];
+    blockOffset = new int64_t[cskvHeader.blockCount + 1];
+    loadBytesFromFile(skvFile, indexOffset,
+                      sizeof(uint32_t) * (skvfHeader.LayerCount + 1),
+                      firstBlockOfLayer);
+    loadBytesFromFile(skvFile,
+                      indexOffset +
+                          sizeof(uint32_t) * (skvfHeader.LayerCount + 1),
+                      sizeof(int64_t) * (cskvHeader.blockCount + 1),
+                      blockOffset);
+
+    blockCache = new BlockCacheSlot[SKV_BLOCK_CACHE_SLOTS];
+    skvFileIsCompressed = true;
+
+    PRINT(2, this,
+          "Short knot values are compressed in " << cskvHeader.blockCount
+                                                 << " blocks of "
+                                                 << cskvHeader.blockSize
+                                                 << " bytes.");
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// closeCompressedSkvFile()
+//
+//-----------------------------------------------------------------------------
+void MiniMax::closeCompressedSkvFile()
+{
+    if (blockCache != nullptr) {
+        for (uint32_t i = 0; i < SKV_BLOCK_CACHE_SLOTS; i++) {
+            SAFE_DELETE_ARRAY(blockCache[i].data);
+        }
+    }
+
+    SAFE_DELETE_ARRAY(blockCache);
+    SAFE_DELETE_ARRAY(firstBlockOfLayer);
+    SAFE_DELETE_ARRAY(blockOffset);
+    skvFileIsCompressed = false;
+}
+
+//-----------------------------------------------------------------------------
+// readCompressedByte()
+// Returns the byte 'byteNumber' of a layer, decompressing its block if it is
+// not in the block cache.
+//-----------------------------------------------------------------------------
+unsigned char MiniMax::readCompressedByte(uint32_t layerNumber,
+                                          uint32_t byteNumber)
+{
+    // locals
+    const uint32_t blockInLayer = byteNumber / cskvHeader.blockSize;
+    const uint32_t blockNumber = firstBlockOfLayer[layerNumber] + blockInLayer;
+    BlockCacheSlot &slot = blockCache[blockNumber % SKV_BLOCK_CACHE_SLOTS];
+    std::lock_guard<std::mutex> lock(slot.cs);
+
+    if (slot.blockNumber == blockNumber) {
+        blockCacheHits.fetch_add(1, std::memory_order_relaxed);
+        return slot.data[byteNumber % cskvHeader.blockSize];
+    }
+
+    blockCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
+    const uint32_t nBytes = std::min(cskvHeader.blockSize,
+                                     layerStats[layerNumber].sizeInBytes -
+                                         blockInLayer * cskvHeader.blockSize);
+    const uint32_t size = (uint32_t)(blockOffset[blockNumber + 1] -
+                                     blockOffset[blockNumber]);
+
+    if (slot.data == nullptr)
+        slot.data = new unsigned char[cskvHeader.blockSize];
+    slot.compressed.resize(size);
+    loadBytesFromFile(skvFile, blockOffset[blockNumber], size,
+                      slot.compressed.data());
+
+    if (!decompressBlock(slot.compressed.data(), size, slot.data, nBytes)) {
+        PRINT(0, this,
+              "ERROR: Block " << blockInLayer << " of layer " << layerNumber
+                              << " is corrupt!");
+        slot.blockNumber = UINT32_MAX;
+        return SKV_WHOLE_BYTE_IS_INVALID;
+    }
+
+    slot.blockNumber = blockNumber;
+
+    return slot.data[byteNumber % cskvHeader.blockSize];
+}
+
+#endif // MADWEASEL_MUEHLE_PERFECT_AI
@@ -12,8 +12,10 @@
 
 #include "miniMax.h"
 
+#ifdef _MSC_VER
 #pragma warning(disable : 4127)
 #pragma warning(disable : 4706)
+#endif
 
 //-----------------------------------------------------------------------------
 // ~MiniMax()
@@ -21,20 +23,24 @@
 //-----------------------------------------------------------------------------
 void MiniMax::closeDatabase()
 {
+    stopPrefetchThread();
+    clearCache();
+    skvMap.unmap();
+    plyInfoMap.unmap();
+
     // close database
-    if (hFileShortKnotValues != nullptr) {
+    if (skvFile.isOpen()) {
+        closeCompressedSkvFile();
         unloadAllLayers();
         SAFE_DELETE_ARRAY(layerStats);
-        CloseHandle(hFileShortKnotValues);
-        hFileShortKnotValues = nullptr;
+        skvFile.close();
     }
 
     // close ply info file
-    if (hFilePlyInfo != nullptr) {
+    if (plyInfoFile.isOpen()) {
         unloadAllPlyInfos();
         SAFE_DELETE_ARRAY(plyInfos);
-        CloseHandle(hFilePlyInfo);
-        hFilePlyInfo = nullptr;
+        plyInfoFile.close();
     }
 }
 
@@ -45,6 +51,10 @@ void MiniMax::closeDatabase()
 void MiniMax::unloadPlyInfo(uint32_t layerNumber)
 {
     PlyInfo *myPis = &plyInfos[layerNumber];
+
+    if (!myPis->plyInfoIsLoaded)
+        return;
+
     memoryUsed2 -= myPis->sizeInBytes;
     arrayInfos.removeArray(layerNumber, ArrayInfo::arrayType_plyInfos,
                            myPis->sizeInBytes, 0);
@@ -59,6 +69,10 @@ void MiniMax::unloadPlyInfo(uint32_t layerNumber)
 void MiniMax::unloadLayer(uint32_t layerNumber)
 {
     LayerStats *myLss = &layerStats[layerNumber];
+
+    if (!myLss->layerIsLoaded)
+        return;
+
     SAFE_DELETE_ARRAY(myLss->shortKnotValueByte);
     memoryUsed2 -= myLss->sizeInBytes;
     arrayInfos.removeArray(layerNumber, ArrayInfo::arrayType_layerStats,
@@ -89,76 +103,524 @@ void MiniMax::unloadAllLayers()
 }
 
 //-----------------------------------------------------------------------------
-// saveBytesToFile()
-//
+// setMemoryBudget()
+// Limits the memory used for the layers to 'bytes'. Completed layers are then
+// kept in the layer cache instead of being read state by state from file.
+// Layers under calculation are counted, but never evicted. 0 disables the
+// cache.
+//-----------------------------------------------------------------------------
+void MiniMax::setMemoryBudget(int64_t bytes)
+{
+    if (bytes <= 0) {
+        clearCache();
+        memoryBudget = 0;
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(csCache);
+    std::lock_guard<std::mutex> lockDatabase(csDatabase);
+    memoryBudget = bytes;
+    makeRoomInCache(0);
+}
+
 //-----------------------------------------------------------------------------
-void MiniMax::saveBytesToFile(HANDLE hFile, int64_t offset, uint32_t nBytes,
-                              void *pBytes)
-{
-    DWORD dwBytesWritten;
-    LARGE_INTEGER liDistanceToMove;
-    uint32_t restingBytes = nBytes;
-    void *myPointer = pBytes;
-    bool errorPrint = false;
-
-    liDistanceToMove.QuadPart = offset;
-
-    while (errorPrint = !SetFilePointerEx(hFile, liDistanceToMove, nullptr,
-                                          FILE_BEGIN)) {
-        if (!errorPrint)
-            PRINT(1, this, "ERROR: SetFilePointerEx  failed!");
-    }
-
-    while (restingBytes > 0) {
-        if (WriteFile(hFile, myPointer, restingBytes, &dwBytesWritten,
-                      nullptr) == TRUE) {
-            restingBytes -= dwBytesWritten;
-            myPointer = (void *)(((unsigned char *)myPointer) + dwBytesWritten);
-            if (restingBytes > 0)
-                PRINT(2, this, "Still " << restingBytes << " to write!");
-        } else {
-            if (!errorPrint)
-                PRINT(0, this, "ERROR: WriteFile Failed!");
-            errorPrint = true;
+// readFromCache()
+// Copies 'nBytes'-bytes at 'offset' of a completed layer out of the layer
+// cache, loading the layer if necessary. Returns false if the layer cannot be
+// cached, the caller has to read from file then.
+//-----------------------------------------------------------------------------
+bool MiniMax::readFromCache(bool plyInfo, uint32_t layerNumber, int64_t offset,
+                            uint32_t nBytes, void *pBytes)
+{
+    // only layers which do not change anymore
+    if (memoryBudget <= 0)
+        return false;
+
+    if (plyInfo) {
+        if (!(plyInfoHeader.plyInfoCompleted ||
+              plyInfos[layerNumber].plyInfoIsCompletedAndInFile) ||
+            plyInfos[layerNumber].sizeInBytes > memoryBudget)
+            return false;
+    } else {
+        if (!(skvfHeader.completed ||
+              layerStats[layerNumber].layerIsCompletedAndInFile) ||
+            layerStats[layerNumber].sizeInBytes > memoryBudget)
+            return false;
+    }
+
+    // hit
+    {
+        std::shared_lock<std::shared_mutex> lock(csCache);
+        CacheEntry *cache = plyInfo ? plyInfoCache : skvCache;
+
+        if (cache != nullptr && cache[layerNumber].data != nullptr) {
+            std::memcpy(pBytes, cache[layerNumber].data + offset, nBytes);
+            if (!cache[layerNumber].referenced.load(std::memory_order_relaxed))
+                cache[layerNumber].referenced = true;
+            cacheHits.fetch_add(1, std::memory_order_relaxed);
+            return true;
         }
     }
+
+    // miss, unless another thread was faster
+    std::unique_lock<std::shared_mutex> lock(csCache);
+    CacheEntry *cache = plyInfo ? plyInfoCache : skvCache;
+
+    if (cache != nullptr && cache[layerNumber].data != nullptr) {
+        cacheHits.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        cacheMisses.fetch_add(1, std::memory_order_relaxed);
+        if (!loadIntoCache(plyInfo, layerNumber))
+            return false;
+        cache = plyInfo ? plyInfoCache : skvCache;
+    }
+
+    std::memcpy(pBytes, cache[layerNumber].data + offset, nBytes);
+    cache[layerNumber].referenced = true;
+
+    return true;
 }
 
 //-----------------------------------------------------------------------------
-// loadBytesFromFile()
+// loadIntoCache()
+// Reads a whole completed layer from file. csCache must be held exclusively.
+//-----------------------------------------------------------------------------
+bool MiniMax::loadIntoCache(bool plyInfo, uint32_t layerNumber)
+{
+    std::lock_guard<std::mutex> lockDatabase(csDatabase);
+
+    CacheEntry &entry = getCacheEntry(plyInfo, layerNumber);
+    const int64_t sizeInBytes = plyInfo ? plyInfos[layerNumber].sizeInBytes :
+                                          layerStats[layerNumber].sizeInBytes;
+
+    if (!makeRoomInCache(sizeInBytes))
+        return false;
+
+    entry.data = new unsigned char[sizeInBytes];
+    entry.sizeInBytes = sizeInBytes;
+    entry.referenced = true;
+
+    if (plyInfo) {
+        loadBytesFromFile(plyInfoFile,
+                          plyInfoHeader.headerAndPlyInfosSize +
+                              plyInfos[layerNumber].layerOffset,
+                          (uint32_t)sizeInBytes, entry.data);
+    } else {
+        loadBytesFromFile(skvFile,
+                          skvfHeader.headerAndStatsSize +
+                              layerStats[layerNumber].layerOffset,
+                          (uint32_t)sizeInBytes, entry.data);
+    }
+
+    memoryUsed2 += sizeInBytes;
+    PRINT(3, this,
+          "Cached " << sizeInBytes << " bytes of the "
+                    << (plyInfo ? "ply info" : "knot values") << " of layer "
+                    << layerNumber << ".");
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// getCacheEntry()
+// Creates the cache entries on first use. csCache and csDatabase must be held.
+//-----------------------------------------------------------------------------
+MiniMax::CacheEntry &MiniMax::getCacheEntry(bool plyInfo, uint32_t layerNumber)
+{
+    if (skvCache == nullptr) {
+        skvCache = new CacheEntry[skvfHeader.LayerCount];
+        plyInfoCache = new CacheEntry[plyInfoHeader.LayerCount];
+    }
+
+    return plyInfo ? plyInfoCache[layerNumber] : skvCache[layerNumber];
+}
+
+//-----------------------------------------------------------------------------
+// prefetchIntoCache()
+// Like loadIntoCache(), but nothing is evicted for a layer, which might not
+// be read at all. The file is read without holding csCache, so that the
+// readers are not held up meanwhile.
+//-----------------------------------------------------------------------------
+bool MiniMax::prefetchIntoCache(bool plyInfo, uint32_t layerNumber)
+{
+    // locals
+    const int64_t sizeInBytes = plyInfo ? plyInfos[layerNumber].sizeInBytes :
+                                          layerStats[layerNumber].sizeInBytes;
+    unsigned char *data;
+
+    {
+        std::shared_lock<std::shared_mutex> lock(csCache);
+        std::lock_guard<std::mutex> lockDatabase(csDatabase);
+        CacheEntry *cache = plyInfo ? plyInfoCache : skvCache;
+
+        if ((cache != nullptr && cache[layerNumber].data != nullptr) ||
+            memoryUsed2 + sizeInBytes > memoryBudget)
+            return false;
+    }
+
+    data = new unsigned char[sizeInBytes];
+    if (plyInfo) {
+        loadBytesFromFile(plyInfoFile,
+                          plyInfoHeader.headerAndPlyInfosSize +
+                              plyInfos[layerNumber].layerOffset,
+                          (uint32_t)sizeInBytes, data);
+    } else {
+        loadBytesFromFile(skvFile,
+                          skvfHeader.headerAndStatsSize +
+                              layerStats[layerNumber].layerOffset,
+                          (uint32_t)sizeInBytes, data);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(csCache);
+    std::lock_guard<std::mutex> lockDatabase(csDatabase);
+    CacheEntry &entry = getCacheEntry(plyInfo, layerNumber);
+
+    // loaded by a reader or no room anymore
+    if (entry.data != nullptr || memoryUsed2 + sizeInBytes > memoryBudget) {
+        delete[] data;
+        return false;
+    }
+
+    // not referenced yet, so it is the first to go if it is never read
+    entry.data = data;
+    entry.sizeInBytes = sizeInBytes;
+    entry.referenced = false;
+    memoryUsed2 += sizeInBytes;
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// makeRoomInCache()
+// Evicts cached layers until 'bytes' more fit into the memory budget. The
+// clock hand clears the reference bit of a recently used layer and evicts it
+// only if it has not been used again when the hand comes by the next time.
+// csCache and csDatabase must be held.
+//-----------------------------------------------------------------------------
+bool MiniMax::makeRoomInCache(int64_t bytes)
+{
+    const uint32_t nEntries = skvfHeader.LayerCount +
+                              plyInfoHeader.LayerCount;
+
+    if (skvCache == nullptr || nEntries == 0)
+        return memoryUsed2 + bytes <= memoryBudget;
+
+    // two rounds, since the first one might only clear the reference bits
+    for (uint32_t i = 0;
+         i < 2 * nEntries && memoryUsed2 + bytes > memoryBudget; i++) {
+        const bool plyInfo = cacheClockHand >= skvfHeader.LayerCount;
+        const uint32_t layerNumber = plyInfo ?
+                                         cacheClockHand -
+                                             skvfHeader.LayerCount :
+                                         cacheClockHand;
+        CacheEntry &entry = plyInfo ? plyInfoCache[layerNumber] :
+                                      skvCache[layerNumber];
+
+        cacheClockHand = (cacheClockHand + 1) % nEntries;
+
+        if (entry.data == nullptr)
+            continue;
+
+        if (entry.referenced) {
+            entry.referenced = false;
+            continue;
+        }
+
+        evictFromCache(plyInfo, layerNumber);
+    }
+
+    return memoryUsed2 + bytes <= memoryBudget;
+}
+
+//-----------------------------------------------------------------------------
+// evictFromCache()
+// csCache and csDatabase must be held.
+//-----------------------------------------------------------------------------
+void MiniMax::evictFromCache(bool plyInfo, uint32_t layerNumber)
+{
+    CacheEntry &entry = plyInfo ? plyInfoCache[layerNumber] :
+                                  skvCache[layerNumber];
+
+    memoryUsed2 -= entry.sizeInBytes;
+    SAFE_DELETE_ARRAY(entry.data);
+    entry.sizeInBytes = 0;
+    entry.referenced = false;
+    cacheEvictions.fetch_add(1, std::memory_order_relaxed);
+    PRINT(3, this,
+          "Evicted the " << (plyInfo ? "ply info" : "knot values")
+                         << " of layer " << layerNumber << " from the cache.");
+}
+
+//-----------------------------------------------------------------------------
+// clearCache()
 //
 //-----------------------------------------------------------------------------
-void MiniMax::loadBytesFromFile(HANDLE hFile, int64_t offset, uint32_t nBytes,
-                                void *pBytes)
+void MiniMax::clearCache()
 {
-    DWORD dwBytesRead;
-    LARGE_INTEGER liDistanceToMove;
-    uint32_t restingBytes = nBytes;
-    void *myPointer = pBytes;
-    bool errorPrint = false;
+    std::unique_lock<std::shared_mutex> lock(csCache);
+    std::lock_guard<std::mutex> lockDatabase(csDatabase);
+
+    if (skvCache == nullptr)
+        return;
+
+    for (uint32_t i = 0; i < skvfHeader.LayerCount; i++) {
+        memoryUsed2 -= skvCache[i].sizeInBytes;
+        SAFE_DELETE_ARRAY(skvCache[i].data);
+    }
+
+    for (uint32_t i = 0; i < plyInfoHeader.LayerCount; i++) {
+        memoryUsed2 -= plyInfoCache[i].sizeInBytes;
+        SAFE_DELETE_ARRAY(plyInfoCache[i].data);
+    }
 
-    liDistanceToMove.QuadPart = offset;
+    SAFE_DELETE_ARRAY(skvCache);
+    SAFE_DELETE_ARRAY(plyInfoCache);
+    cacheClockHand = 0;
+}
 
-    while (errorPrint = !SetFilePointerEx(hFile, liDistanceToMove, nullptr,
-                                          FILE_BEGIN)) {
-        if (!errorPrint)
-            PRINT(0, this, "ERROR: SetFilePointerEx failed!");
+//-----------------------------------------------------------------------------
+// getBytesInCache()
+// Returns the number of bytes of the passed layers, which are in the layer
+// cache.
+//-----------------------------------------------------------------------------
+int64_t MiniMax::getBytesInCache(const vector<uint32_t> &layers)
+{
+    // locals
+    std::shared_lock<std::shared_mutex> lock(csCache);
+    int64_t bytes = 0;
+
+    for (uint32_t layerNumber : layers) {
+        if (skvCache != nullptr && skvCache[layerNumber].data != nullptr)
+            bytes += skvCache[layerNumber].sizeInBytes;
+        if (plyInfoCache != nullptr &&
+            plyInfoCache[layerNumber].data != nullptr)
+            bytes += plyInfoCache[layerNumber].sizeInBytes;
     }
 
-    while (restingBytes > 0) {
-        if (ReadFile(hFile, pBytes, restingBytes, &dwBytesRead, nullptr) ==
-            TRUE) {
-            restingBytes -= dwBytesRead;
-            myPointer = (void *)(((unsigned char *)myPointer) + dwBytesRead);
-            if (restingBytes > 0) {
-                PRINT(2, this, "Still " << restingBytes << " bytes to read!");
+    return bytes;
+}
+
+//-----------------------------------------------------------------------------
+// prefetchLayers()
+// Warms the layers, which can be reached from 'layerNumber' within
+// PREFETCH_LAYER_DEPTH moves, in the background. A move leads to the partner
+// layer or, when a piece is removed, to one of the succeeding layers. A new
+// call replaces the layers of the previous one, which are not done yet.
+//-----------------------------------------------------------------------------
+void MiniMax::prefetchLayers(uint32_t layerNumber)
+{
+    // locals
+    vector<uint32_t> layers;
+    vector<bool> layerAdded;
+    size_t begin = 0, end, i;
+    uint32_t depth, j;
+
+    if (!skvFile.isOpen() || calcDatabase ||
+        layerNumber >= skvfHeader.LayerCount)
+        return;
+
+    // breadth first, so that the nearest layers come first
+    layerAdded.resize(skvfHeader.LayerCount, false);
+    layers.push_back(layerNumber);
+    layerAdded[layerNumber] = true;
+
+    for (depth = 0; depth < PREFETCH_LAYER_DEPTH; depth++) {
+        for (end = layers.size(), i = begin; i < end; i++) {
+            LayerStats *myLss = &layerStats[layers[i]];
+
+            if (!layerAdded[myLss->partnerLayer]) {
+                layerAdded[myLss->partnerLayer] = true;
+                layers.push_back(myLss->partnerLayer);
+            }
+
+            for (j = 0; j < myLss->succeedingLayerCount; j++) {
+                if (!layerAdded[myLss->succeedingLayers[j]]) {
+                    layerAdded[myLss->succeedingLayers[j]] = true;
+                    layers.push_back(myLss->succeedingLayers[j]);
+                }
             }
-        } else {
-            if (!errorPrint)
-                PRINT(0, this, "ERROR: ReadFile Failed!");
-            errorPrint = true;
         }
+        begin = end;
+    }
+
+    // the current layer has just been read
+    layers.erase(layers.begin());
+
+    startPrefetching(layers, true);
+}
+
+//-----------------------------------------------------------------------------
+// prefetchLayersForCalc()
+// Reads the completed layers, which 'layerNumber' depends on, into the page
+// cache in the background, while the current layer is calculated. The layer
+// cache is not touched, since the calculation changes memoryUsed2 without
+// holding csDatabase.
+//-----------------------------------------------------------------------------
+void MiniMax::prefetchLayersForCalc(uint32_t layerNumber)
+{
+    // locals
+    vector<uint32_t> layers;
+
+    if (layerNumber >= skvfHeader.LayerCount)
+        return;
+
+    getLayerDependencies(layerNumber, layers);
+    layers.erase(std::remove_if(layers.begin(), layers.end(),
+                                [this](uint32_t layer) {
+                                    return !layerStats[layer]
+                                                .layerIsCompletedAndInFile;
+                                }),
+                 layers.end());
+
+    if (!layers.empty())
+        startPrefetching(layers, false);
+}
+
+//-----------------------------------------------------------------------------
+// startPrefetching()
+// Passes the layers to the prefetch thread, which is started if necessary.
+// They replace the layers of the previous call, which are not done yet.
+//-----------------------------------------------------------------------------
+void MiniMax::startPrefetching(vector<uint32_t> &layers, bool intoLayerCache)
+{
+    {
+        std::lock_guard<std::mutex> lock(csPrefetch);
+        layersToPrefetch.swap(layers);
+        prefetchIntoLayerCache = intoLayerCache;
+
+        if (!prefetchThread.joinable()) {
+            stopPrefetching = false;
+            prefetchThread = std::thread(&MiniMax::prefetchThreadProc, this);
+        }
+    }
+
+    prefetchRequested.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+// prefetchThreadProc()
+//
+//-----------------------------------------------------------------------------
+void MiniMax::prefetchThreadProc()
+{
+    // locals
+    vector<uint32_t> layers;
+    int64_t bytesPrefetched;
+    bool intoLayerCache;
+    std::unique_lock<std::mutex> lock(csPrefetch);
+
+    while (true) {
+        prefetchRequested.wait(lock, [this] {
+            return stopPrefetching || !layersToPrefetch.empty();
+        });
+
+        if (stopPrefetching)
+            return;
+
+        layers.clear();
+        layers.swap(layersToPrefetch);
+        intoLayerCache = prefetchIntoLayerCache;
+        lock.unlock();
+
+        bytesPrefetched = 0;
+        for (uint32_t layerNumber : layers) {
+            if (stopPrefetching || bytesPrefetched >= PREFETCH_BYTES_MAX)
+                break;
+            bytesPrefetched += prefetchLayer(layerNumber, intoLayerCache);
+        }
+
+        lock.lock();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// prefetchLayer()
+// Returns the number of bytes requested. Only completed layers are warmed,
+// each in the way it is going to be read. The layer cache is only filled if
+// 'intoLayerCache' is set.
+//-----------------------------------------------------------------------------
+int64_t MiniMax::prefetchLayer(uint32_t layerNumber, bool intoLayerCache)
+{
+    // locals
+    LayerStats *myLss = &layerStats[layerNumber];
+    PlyInfo *myPis = &plyInfos[layerNumber];
+    int64_t bytes = 0;
+
+    if (skvfHeader.completed || myLss->layerIsCompletedAndInFile) {
+        if (skvMap.data()) {
+            adviseLayer(layerNumber, MappedFile::WILL_NEED);
+        } else if (skvFileIsCompressed) {
+            skvFile.prefetch(blockOffset[firstBlockOfLayer[layerNumber]],
+                             blockOffset[firstBlockOfLayer[layerNumber + 1]] -
+                                 blockOffset[firstBlockOfLayer[layerNumber]]);
+        } else if (memoryBudget <= 0 || !intoLayerCache ||
+                   !prefetchIntoCache(false, layerNumber)) {
+            skvFile.prefetch(skvfHeader.headerAndStatsSize + myLss->layerOffset,
+                             myLss->sizeInBytes);
+        }
+        bytes += myLss->sizeInBytes;
+    }
+
+    if (plyInfoHeader.plyInfoCompleted || myPis->plyInfoIsCompletedAndInFile) {
+        if (plyInfoMap.data()) {
+            if (!skvMap.data())
+                adviseLayer(layerNumber, MappedFile::WILL_NEED);
+        } else if (memoryBudget <= 0 || !intoLayerCache ||
+                   !prefetchIntoCache(true, layerNumber)) {
+            plyInfoFile.prefetch(plyInfoHeader.headerAndPlyInfosSize +
+                                     myPis->layerOffset,
+                                 myPis->sizeInBytes);
+        }
+        bytes += myPis->sizeInBytes;
+    }
+
+    if (bytes)
+        prefetchedLayers.fetch_add(1, std::memory_order_relaxed);
+
+    return bytes;
+}
+
+//-----------------------------------------------------------------------------
+// stopPrefetchThread()
+//
+//-----------------------------------------------------------------------------
+void MiniMax::stopPrefetchThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(csPrefetch);
+        stopPrefetching = true;
+        layersToPrefetch.clear();
     }
+
+    prefetchRequested.notify_one();
+
+    if (prefetchThread.joinable())
+        prefetchThread.join();
+
+    stopPrefetching = false;
+}
+
+//-----------------------------------------------------------------------------
+// saveBytesToFile()
+//
+//-----------------------------------------------------------------------------
+void MiniMax::saveBytesToFile(RandomAccessFile &file, int64_t offset,
+                              uint32_t nBytes, void *pBytes)
+{
+    if (file.write(offset, nBytes, pBytes) != nBytes)
+        PRINT(0, this, "ERROR: WriteFile Failed!");
+}
+
+//-----------------------------------------------------------------------------
+// loadBytesFromFile()
+// The file is read at an explicit offset, so that the threads can call it
+// concurrently.
+//-----------------------------------------------------------------------------
+void MiniMax::loadBytesFromFile(RandomAccessFile &file, int64_t offset,
+                                uint32_t nBytes, void *pBytes)
+{
+    if (file.read(offset, nBytes, pBytes) != nBytes)
+        PRINT(0, this, "ERROR: ReadFile Failed!");
 }
 
 //-----------------------------------------------------------------------------
@@ -169,7 +631,7 @@ bool MiniMax::isCurStateInDatabase(uint32_t threadNo)
 {
     uint32_t layerNum, stateNumber;
 
-    if (hFileShortKnotValues == nullptr) {
+    if (!skvFile.isOpen()) {
         return false;
     } else {
         getLayerAndStateNumber(threadNo, layerNum, stateNumber);
@@ -183,12 +645,9 @@ bool MiniMax::isCurStateInDatabase(uint32_t threadNo)
 //-----------------------------------------------------------------------------
 void MiniMax::saveHeader(SkvFileHeader *dbH, LayerStats *lStats)
 {
-    DWORD dwBytesWritten;
-    SetFilePointer(hFileShortKnotValues, 0, nullptr, FILE_BEGIN);
-    WriteFile(hFileShortKnotValues, dbH, sizeof(SkvFileHeader), &dwBytesWritten,
-              nullptr);
-    WriteFile(hFileShortKnotValues, lStats,
-              sizeof(LayerStats) * dbH->LayerCount, &dwBytesWritten, nullptr);
+    saveBytesToFile(skvFile, 0, sizeof(SkvFileHeader), dbH);
+    saveBytesToFile(skvFile, sizeof(SkvFileHeader),
+                    sizeof(LayerStats) * dbH->LayerCount, lStats);
 }
 
 //-----------------------------------------------------------------------------
@@ -197,12 +656,9 @@ void MiniMax::saveHeader(SkvFileHeader *dbH, LayerStats *lStats)
 //-----------------------------------------------------------------------------
 void MiniMax::saveHeader(PlyInfoFileHeader *piH, PlyInfo *pInfo)
 {
-    DWORD dwBytesWritten;
-    SetFilePointer(hFilePlyInfo, 0, nullptr, FILE_BEGIN);
-    WriteFile(hFilePlyInfo, piH, sizeof(PlyInfoFileHeader), &dwBytesWritten,
-              nullptr);
-    WriteFile(hFilePlyInfo, pInfo, sizeof(PlyInfo) * piH->LayerCount,
-              &dwBytesWritten, nullptr);
+    saveBytesToFile(plyInfoFile, 0, sizeof(PlyInfoFileHeader), piH);
+    saveBytesToFile(plyInfoFile, sizeof(PlyInfoFileHeader),
+                    sizeof(PlyInfo) * piH->LayerCount, pInfo);
 }
 
 //-----------------------------------------------------------------------------
@@ -211,15 +667,90 @@ void MiniMax::saveHeader(PlyInfoFileHeader *piH, PlyInfo *pInfo)
 //-----------------------------------------------------------------------------
 bool MiniMax::openDatabase(const char *dir, uint32_t branchCountMax)
 {
-    if (strlen(dir) && !PathFileExistsA(dir)) {
+    if (strlen(dir) && !pathExists(dir)) {
         PRINT(0, this, "ERROR: Database path " << dir << " not valid!");
         return falseOrStop();
     }
     openSkvFile(dir, branchCountMax);
     openPlyInfoFile(dir);
+    mapCompletedDatabase();
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// mapCompletedDatabase()
+// Maps the files of a completed database read-only into memory. A file, which
+// is shorter than its layers, is read through the file functions instead.
+//-----------------------------------------------------------------------------
+void MiniMax::mapCompletedDatabase()
+{
+    // locals
+    stringstream ssFile;
+    uint32_t i;
+
+    if (skvFile.isOpen() && skvfHeader.completed && !skvMap.data() &&
+        !skvFileIsCompressed) {
+        LayerStats *lastLss = &layerStats[skvfHeader.LayerCount - 1];
+
+        ssFile << fileDir << (fileDir.size() ? "/" : "")
+               << "shortKnotValue.dat";
+        if (skvMap.map(ssFile.str()) &&
+            (int64_t)skvMap.size() < skvfHeader.headerAndStatsSize +
+                                         lastLss->layerOffset +
+                                         lastLss->sizeInBytes)
+            skvMap.unmap();
+    }
+
+    if (plyInfoFile.isOpen() && plyInfoHeader.plyInfoCompleted &&
+        !plyInfoMap.data()) {
+        PlyInfo *lastPis = &plyInfos[plyInfoHeader.LayerCount - 1];
+
+        ssFile.str("");
+        ssFile << fileDir << (fileDir.size() ? "/" : "") << "plyInfo.dat";
+        if (plyInfoMap.map(ssFile.str()) &&
+            (int64_t)plyInfoMap.size() <
+                plyInfoHeader.headerAndPlyInfosSize + lastPis->layerOffset +
+                    lastPis->sizeInBytes)
+            plyInfoMap.unmap();
+    }
+
+    if (!skvMap.data() && !plyInfoMap.data())
+        return;
+
+    PRINT(2, this,
+          "Mapped completed database into memory: short knot values "
+              << (skvMap.data() ? "yes" : "no") << ", ply info "
+              << (plyInfoMap.data() ? "yes" : "no"));
+
+    // the layer cache is not read anymore
+    if (skvMap.data() && plyInfoMap.data())
+        clearCache();
+
+    // a move selection touches a few states spread over each layer
+    for (i = 0; i < skvfHeader.LayerCount; i++) {
+        adviseLayer(i, MappedFile::RANDOM);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// adviseLayer()
+// Passes an access hint for the mapped part of a layer to the system.
+//-----------------------------------------------------------------------------
+void MiniMax::adviseLayer(uint32_t layerNumber, MappedFile::Advice advice)
+{
+    if (skvMap.data() && layerNumber < skvfHeader.LayerCount) {
+        skvMap.advise(skvfHeader.headerAndStatsSize +
+                          layerStats[layerNumber].layerOffset,
+                      layerStats[layerNumber].sizeInBytes, advice);
+    }
+
+    if (plyInfoMap.data() && layerNumber < plyInfoHeader.LayerCount) {
+        plyInfoMap.advise(plyInfoHeader.headerAndPlyInfosSize +
+                              plyInfos[layerNumber].layerOffset,
+                          plyInfos[layerNumber].sizeInBytes, advice);
+    }
+}
+
 //-----------------------------------------------------------------------------
 // openSkvFile()
 //
@@ -227,47 +758,53 @@ bool MiniMax::openDatabase(const char *dir, uint32_t branchCountMax)
 void MiniMax::openSkvFile(const char *dir, uint32_t branchCountMax)
 {
     // locals
-    stringstream ssDatabaseFile;
-    DWORD dwBytesRead;
+    stringstream ssDatabaseFile, ssCompressedFile;
+    uint32_t bytesRead;
     uint32_t i;
+    bool compressed;
 
     // don't open file twice
-    if (hFileShortKnotValues != nullptr)
+    if (skvFile.isOpen())
         return;
 
     // remember dir name
     fileDir.assign(dir);
-    ssDatabaseFile << fileDir << (strlen(dir) ? "\\" : "")
+    ssDatabaseFile << fileDir << (strlen(dir) ? "/" : "")
                    << "shortKnotValue.dat";
+
+    // use the compressed file, if it replaces the uncompressed one
+    ssCompressedFile << fileDir << (strlen(dir) ? "/" : "")
+                     << "shortKnotValue.cmp";
+    compressed = !pathExists(ssDatabaseFile.str().c_str()) &&
+                 pathExists(ssCompressedFile.str().c_str());
+    if (compressed) {
+        ssDatabaseFile.str(ssCompressedFile.str());
+    }
+
     PRINT(2, this,
-          "Open short knot value file: " << fileDir << (strlen(dir) ? "\\" : "")
-                                         << "shortKnotValue.dat" << endl);
-
-    // Open Database-File (FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH |
-    // FILE_FLAG_RANDOM_ACCESS)
-    hFileShortKnotValues = CreateFileA(ssDatabaseFile.str().c_str(),
-                                       GENERIC_READ | GENERIC_WRITE,
-                                       FILE_SHARE_READ | FILE_SHARE_WRITE,
-                                       nullptr, OPEN_ALWAYS,
-                                       FILE_ATTRIBUTE_NORMAL, nullptr);
-
-    // opened file successfully
-    if (hFileShortKnotValues == INVALID_HANDLE_VALUE) {
-        hFileShortKnotValues = nullptr;
+          "Open short knot value file: " << ssDatabaseFile.str() << endl);
+
+    // Open Database-File
+    if (!skvFile.open(ssDatabaseFile.str().c_str()))
         return;
-    }
 
     // set header to invalid
     skvfHeader.headerCode = 0;
     maxNumBranches = branchCountMax;
 
     // database complete ?
-    if (!ReadFile(hFileShortKnotValues, &skvfHeader, sizeof(SkvFileHeader),
-                  &dwBytesRead, nullptr))
+    bytesRead = skvFile.read(0, sizeof(SkvFileHeader), &skvfHeader);
+
+    // the compressed file is never written
+    if (compressed && (bytesRead != sizeof(SkvFileHeader) ||
+                       skvfHeader.headerCode != SKV_FILE_HEADER_CODE)) {
+        PRINT(0, this, "ERROR: Invalid compressed short knot value file!");
+        skvFile.close();
         return;
+    }
 
     // invalid file ?
-    if (dwBytesRead != sizeof(SkvFileHeader) ||
+    if (bytesRead != sizeof(SkvFileHeader) ||
         skvfHeader.headerCode != SKV_FILE_HEADER_CODE) {
         // create default header
         skvfHeader.completed = false;
@@ -308,14 +845,18 @@ void MiniMax::openSkvFile(const char *dir, uint32_t branchCountMax)
     } else {
         layerStats = new LayerStats[skvfHeader.LayerCount];
         std::memset(layerStats, 0, sizeof(LayerStats) * skvfHeader.LayerCount);
-        if (!ReadFile(hFileShortKnotValues, layerStats,
-                      sizeof(LayerStats) * skvfHeader.LayerCount, &dwBytesRead,
-                      nullptr))
-            return;
+        loadBytesFromFile(skvFile, sizeof(SkvFileHeader),
+                          sizeof(LayerStats) * skvfHeader.LayerCount,
+                          layerStats);
         for (i = 0; i < skvfHeader.LayerCount; i++) {
             layerStats[i].shortKnotValueByte = nullptr;
             layerStats[i].skvCompressed = nullptr;
         }
+
+        if (compressed && !loadBlockIndex()) {
+            SAFE_DELETE_ARRAY(layerStats);
+            skvFile.close();
+        }
     }
 }
 
@@ -327,40 +868,29 @@ void MiniMax::openPlyInfoFile(const char *dir)
 {
     // locals
     stringstream ssFile;
-    DWORD dwBytesRead;
+    uint32_t bytesRead;
     uint32_t i;
 
     // don't open file twice
-    if (hFilePlyInfo != nullptr)
+    if (plyInfoFile.isOpen())
         return;
 
     // remember dir name
-    ssFile << dir << (strlen(dir) ? "\\" : "") << "plyInfo.dat";
+    ssFile << dir << (strlen(dir) ? "/" : "") << "plyInfo.dat";
     PRINT(2, this, "Open ply info file: " << ssFile.str() << endl << endl);
 
-    // Open Database-File (FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH |
-    // FILE_FLAG_RANDOM_ACCESS)
-    hFilePlyInfo = CreateFileA(ssFile.str().c_str(),
-                               GENERIC_READ | GENERIC_WRITE,
-                               FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
-                               OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-
-    // opened file successfully
-    if (hFilePlyInfo == INVALID_HANDLE_VALUE) {
-        hFilePlyInfo = nullptr;
+    // Open Database-File
+    if (!plyInfoFile.open(ssFile.str().c_str()))
         return;
-    }
 
     // set header to invalid
     plyInfoHeader.headerCode = 0;
 
     // database complete ?
-    if (!ReadFile(hFilePlyInfo, &plyInfoHeader, sizeof(plyInfoHeader),
-                  &dwBytesRead, nullptr))
-        return;
+    bytesRead = plyInfoFile.read(0, sizeof(plyInfoHeader), &plyInfoHeader);
 
     // invalid file ?
-    if (dwBytesRead != sizeof(plyInfoHeader) ||
+    if (bytesRead != sizeof(plyInfoHeader) ||
         plyInfoHeader.headerCode != PLYINFO_HEADER_CODE) {
         // create default header
         plyInfoHeader.plyInfoCompleted = false;
@@ -395,10 +925,8 @@ void MiniMax::openPlyInfoFile(const char *dir)
     } else {
         plyInfos = new PlyInfo[plyInfoHeader.LayerCount];
         std::memset(plyInfos, 0, sizeof(PlyInfo) * plyInfoHeader.LayerCount);
-        if (!ReadFile(hFilePlyInfo, plyInfos,
-                      sizeof(PlyInfo) * plyInfoHeader.LayerCount, &dwBytesRead,
-                      nullptr))
-            return;
+        loadBytesFromFile(plyInfoFile, sizeof(plyInfoHeader),
+                          sizeof(PlyInfo) * plyInfoHeader.LayerCount, plyInfos);
         for (i = 0; i < plyInfoHeader.LayerCount; i++) {
             plyInfos[i].plyInfo = nullptr;
             plyInfos[i].plyInfoCompressed = nullptr;
@@ -423,10 +951,10 @@ void MiniMax::saveLayerToFile(uint32_t layerNumber)
     if (myLss->sizeInBytes) {
         // short knot values & ply info
         curCalcActionId = MM_ACTION_SAVING_LAYER_TO_FILE;
-        saveBytesToFile(hFileShortKnotValues,
+        saveBytesToFile(skvFile,
                         skvfHeader.headerAndStatsSize + myLss->layerOffset,
                         myLss->sizeInBytes, myLss->shortKnotValueByte);
-        saveBytesToFile(hFilePlyInfo,
+        saveBytesToFile(plyInfoFile,
                         plyInfoHeader.headerAndPlyInfosSize +
                             myPis->layerOffset,
                         myPis->sizeInBytes, myPis->plyInfo);
@@ -441,11 +969,11 @@ void MiniMax::saveLayerToFile(uint32_t layerNumber)
 // measureIops()
 //
 //-----------------------------------------------------------------------------
-inline void MiniMax::measureIops(int64_t &nOps, LARGE_INTEGER &interval,
-                                 LARGE_INTEGER &curTimeBefore, char text[])
+inline void MiniMax::measureIops(int64_t &nOps, Clock::time_point &interval,
+                                 Clock::time_point &curTimeBefore, char text[])
 {
     // locals
-    LARGE_INTEGER curTimeAfter;
+    Clock::time_point curTimeAfter;
 
     if (!MEASURE_IOPS)
         return;
@@ -453,30 +981,30 @@ inline void MiniMax::measureIops(int64_t &nOps, LARGE_INTEGER &interval,
 
     // only the time for the io-operation is considered and accumulated
     if (MEASURE_ONLY_IO) {
-        QueryPerformanceCounter(&curTimeAfter);
-        interval.QuadPart += curTimeAfter.QuadPart -
-                             curTimeBefore.QuadPart; // ... not thread-safe !!!
-        double totalTimeGone = (double)interval.QuadPart /
-                               frequency.QuadPart; // ... not thread-safe !!!
+        curTimeAfter = Clock::now();
+        interval += curTimeAfter - curTimeBefore; // ... not thread-safe !!!
+        double totalTimeGone = std::chrono::duration<double>(
+                                   interval.time_since_epoch())
+                                   .count(); // ... not thread-safe !!!
         if (totalTimeGone >= 5.0) {
             PRINT(0, this,
                   text << "operations per second for last interval: "
                        << (int)(nOps / totalTimeGone));
-            interval.QuadPart = 0; // ... not thread-safe !!!
-            nOps = 0;              // ... not thread-safe !!!
+            interval = Clock::time_point(); // ... not thread-safe !!!
+            nOps = 0;                       // ... not thread-safe !!!
         }
         // the whole time passed since the beginning of the interval is
         // considered
     } else if (nOps >= MEASURE_TIME_FREQUENCY) {
-        QueryPerformanceCounter(&curTimeAfter);
-        double totalTimeGone = (double)(curTimeAfter.QuadPart -
-                                        interval.QuadPart) /
-                               frequency.QuadPart; // ... not thread-safe !!!
+        curTimeAfter = Clock::now();
+        double totalTimeGone = std::chrono::duration<double>(curTimeAfter -
+                                                             interval)
+                                   .count(); // ... not thread-safe !!!
         PRINT(0, this,
               text << "operations per second for last interval: "
                    << nOps / totalTimeGone);
-        interval.QuadPart = curTimeAfter.QuadPart; // ... not thread-safe !!!
-        nOps = 0;                                  // ... not thread-safe !!!
+        interval = curTimeAfter; // ... not thread-safe !!!
+        nOps = 0;                // ... not thread-safe !!!
     }
 }
 
@@ -524,8 +1052,6 @@ void MiniMax::readKnotValueFromDatabase(uint32_t layerNumber,
 {
     // locals
     TwoBit databaseByte;
-    int64_t bytesAllocated;
-    // TwoBit defValue = SKV_WHOLE_BYTE_IS_INVALID;
     LayerStats *myLss = &layerStats[layerNumber];
 
     // valid state and layer number ?
@@ -538,60 +1064,36 @@ void MiniMax::readKnotValueFromDatabase(uint32_t layerNumber,
         return;
     }
 
-    //  if database is complete get whole byte from file
-    if (skvfHeader.completed || layerInDatabase ||
-        myLss->layerIsCompletedAndInFile) {
-        EnterCriticalSection(&csDatabase);
-        loadBytesFromFile(hFileShortKnotValues,
-                          skvfHeader.headerAndStatsSize + myLss->layerOffset +
-                              stateNumber / 4,
-                          1, &databaseByte);
-        LeaveCriticalSection(&csDatabase);
-    } else {
-        // is layer already loaded
-        if (!myLss->layerIsLoaded) {
-            EnterCriticalSection(&csDatabase);
-
-            if (!myLss->layerIsLoaded) {
-                // if layer is in database and completed, then load layer from
-                // file into memory, set default value otherwise
-                myLss->shortKnotValueByte =
-                    new unsigned char[myLss->sizeInBytes];
-                std::memset(myLss->shortKnotValueByte, 0,
-                            sizeof(unsigned char) * myLss->sizeInBytes);
-                if (myLss->layerIsCompletedAndInFile) {
-                    loadBytesFromFile(
-                        hFileShortKnotValues,
-                        skvfHeader.headerAndStatsSize + myLss->layerOffset,
-                        myLss->sizeInBytes, myLss->shortKnotValueByte);
-                } else {
-                    memset(myLss->shortKnotValueByte, SKV_WHOLE_BYTE_IS_INVALID,
-                           myLss->sizeInBytes);
-                }
-                bytesAllocated = myLss->sizeInBytes;
-                arrayInfos.addArray(layerNumber,
-                                    ArrayInfo::arrayType_layerStats,
-                                    myLss->sizeInBytes, 0);
-
-                // output
-                myLss->layerIsLoaded = true;
-                memoryUsed2 += bytesAllocated;
-                PRINT(3, this,
-                      "Allocated "
-                          << bytesAllocated
-                          << " bytes in memory for knot values of layer "
-                          << layerNumber << ", which is "
-                          << (myLss->layerIsCompletedAndInFile ? "" : " NOT ")
-                          << " fully calculated, due to read operation.");
-            }
-
-            LeaveCriticalSection(&csDatabase);
+    // a mapped database is read straight from memory
+    if (skvMap.data()) {
+        const unsigned char *pLayer = (const unsigned char *)skvMap.data() +
+                                      skvfHeader.headerAndStatsSize +
+                                      myLss->layerOffset;
+        databaseByte = pLayer[stateNumber / 4];
+
+        // a compressed database is read block by block
+    } else if (skvFileIsCompressed) {
+        databaseByte = readCompressedByte(layerNumber, stateNumber / 4);
+
+        //  if database is complete get whole byte from file
+    } else if (skvfHeader.completed || layerInDatabase ||
+               myLss->layerIsCompletedAndInFile) {
+        if (!readFromCache(false, layerNumber, stateNumber / 4, 1,
+                           &databaseByte)) {
+            loadBytesFromFile(skvFile,
+                              skvfHeader.headerAndStatsSize +
+                                  myLss->layerOffset + stateNumber / 4,
+                              1, &databaseByte);
         }
 
+        // nothing has been written to a layer, which is not loaded
+    } else if (!myLss->layerIsLoaded) {
+        databaseByte = SKV_WHOLE_BYTE_IS_INVALID;
+    } else {
         // measure io-operations per second
-        LARGE_INTEGER curTimeBefore;
+        Clock::time_point curTimeBefore;
         if (MEASURE_IOPS && MEASURE_ONLY_IO) {
-            QueryPerformanceCounter(&curTimeBefore);
+            curTimeBefore = Clock::now();
         }
 
         // read ply info from array
@@ -603,7 +1105,7 @@ void MiniMax::readKnotValueFromDatabase(uint32_t layerNumber,
     }
 
     // make half byte
-    knotValue = _rotr8(databaseByte, 2 * (stateNumber % 4)) & 3;
+    knotValue = (databaseByte >> (2 * (stateNumber % 4))) & 3;
 }
 
 //-----------------------------------------------------------------------------
@@ -615,9 +1117,6 @@ void MiniMax::readPlyInfoFromDatabase(uint32_t layerNumber,
                                       PlyInfoVarType &value)
 {
     // locals
-    uint32_t curKnot;
-    PlyInfoVarType defValue = PLYINFO_VALUE_UNCALCULATED;
-    int64_t bytesAllocated;
     PlyInfo *myPis = &plyInfos[layerNumber];
 
     // valid state and layer number ?
@@ -630,57 +1129,35 @@ void MiniMax::readPlyInfoFromDatabase(uint32_t layerNumber,
         return;
     }
 
-    // if database is complete get whole byte from file
-    if (plyInfoHeader.plyInfoCompleted || layerInDatabase ||
-        myPis->plyInfoIsCompletedAndInFile) {
-        EnterCriticalSection(&csDatabase);
-        loadBytesFromFile(hFilePlyInfo,
-                          plyInfoHeader.headerAndPlyInfosSize +
-                              myPis->layerOffset +
-                              sizeof(PlyInfoVarType) * stateNumber,
-                          sizeof(PlyInfoVarType), &value);
-        LeaveCriticalSection(&csDatabase);
-    } else {
-        // is layer already in memory?
-        if (!myPis->plyInfoIsLoaded) {
-            EnterCriticalSection(&csDatabase);
-            if (!myPis->plyInfoIsLoaded) {
-                // if layer is in database and completed, then load layer from
-                // file into memory; set default value otherwise
-                myPis->plyInfo = new PlyInfoVarType[myPis->knotsInLayer];
-                std::memset(myPis->plyInfo, 0,
-                            sizeof(PlyInfoVarType) * myPis->knotsInLayer);
-                if (myPis->plyInfoIsCompletedAndInFile) {
-                    loadBytesFromFile(hFilePlyInfo,
+    // a mapped database is read straight from memory
+    if (plyInfoMap.data()) {
+        const unsigned char *pLayer = (const unsigned char *)plyInfoMap.data() +
                                       plyInfoHeader.headerAndPlyInfosSize +
-                                          myPis->layerOffset,
-                                      myPis->sizeInBytes, myPis->plyInfo);
-                } else {
-                    for (curKnot = 0; curKnot < myPis->knotsInLayer;
-                         curKnot++) {
-                        myPis->plyInfo[curKnot] = defValue;
-                    }
-                }
-                bytesAllocated = myPis->sizeInBytes;
-                arrayInfos.addArray(layerNumber, ArrayInfo::arrayType_plyInfos,
-                                    myPis->sizeInBytes, 0);
-                myPis->plyInfoIsLoaded = true;
-                memoryUsed2 += bytesAllocated;
-                PRINT(3, this,
-                      "Allocated "
-                          << bytesAllocated
-                          << " bytes in memory for ply info of layer "
-                          << layerNumber << ", which is "
-                          << (myPis->plyInfoIsCompletedAndInFile ? "" : " NOT ")
-                          << " fully calculated, due to read operation.");
-            }
-            LeaveCriticalSection(&csDatabase);
+                                      myPis->layerOffset;
+        std::memcpy(&value, pLayer + sizeof(PlyInfoVarType) * stateNumber,
+                    sizeof(PlyInfoVarType));
+
+        // if database is complete get whole byte from file
+    } else if (plyInfoHeader.plyInfoCompleted || layerInDatabase ||
+               myPis->plyInfoIsCompletedAndInFile) {
+        if (!readFromCache(true, layerNumber,
+                           sizeof(PlyInfoVarType) * stateNumber,
+                           sizeof(PlyInfoVarType), &value)) {
+            loadBytesFromFile(plyInfoFile,
+                              plyInfoHeader.headerAndPlyInfosSize +
+                                  myPis->layerOffset +
+                                  sizeof(PlyInfoVarType) * stateNumber,
+                              sizeof(PlyInfoVarType), &value);
         }
 
+        // nothing has been written to a layer, which is not loaded
+    } else if (!myPis->plyInfoIsLoaded) {
+        value = PLYINFO_VALUE_UNCALCULATED;
+    } else {
         // measure io-operations per second
-        LARGE_INTEGER curTimeBefore;
+        Clock::time_point curTimeBefore;
         if (MEASURE_IOPS && MEASURE_ONLY_IO) {
-            QueryPerformanceCounter(&curTimeBefore);
+            curTimeBefore = Clock::now();
         }
 
         // read ply info from array
@@ -723,13 +1200,15 @@ void MiniMax::saveKnotValueInDatabase(uint32_t layerNumber,
 
     // is layer already loaded?
     if (!myLss->layerIsLoaded) {
-        EnterCriticalSection(&csDatabase);
+        std::lock_guard<std::mutex> lock(csDatabase);
         if (!myLss->layerIsLoaded) {
             // reserve memory for this layer & create array for ply info with
-            // default value
-            myLss->shortKnotValueByte = new TwoBit[myLss->sizeInBytes];
+            // default value. the array is padded to whole words, since the
+            // values are written below by a compare-and-swap on 32 bits.
+            const int64_t paddedSize = (myLss->sizeInBytes + 3) / 4 * 4;
+            myLss->shortKnotValueByte = new TwoBit[paddedSize];
             memset(myLss->shortKnotValueByte, SKV_WHOLE_BYTE_IS_INVALID,
-                   myLss->sizeInBytes);
+                   paddedSize);
             bytesAllocated = myLss->sizeInBytes;
             arrayInfos.addArray(layerNumber, ArrayInfo::arrayType_layerStats,
                                 myLss->sizeInBytes, 0);
@@ -742,31 +1221,30 @@ void MiniMax::saveKnotValueInDatabase(uint32_t layerNumber,
                                << layerNumber << " due to write operation!");
             myLss->layerIsLoaded = true;
         }
-        LeaveCriticalSection(&csDatabase);
     }
 
     // measure io-operations per second
-    LARGE_INTEGER curTimeBefore;
+    Clock::time_point curTimeBefore;
     if (MEASURE_IOPS && MEASURE_ONLY_IO) {
-        QueryPerformanceCounter(&curTimeBefore);
+        curTimeBefore = Clock::now();
     }
 
     // set value
-    long *pShortKnotValue = ((long *)myLss->shortKnotValueByte) +
-                            stateNumber / ((sizeof(long) * 8) / 2);
-    long nBitsToShift = 2 * (stateNumber %
-                             ((sizeof(long) * 8) / 2)); // little-endian
-                                                        // byte-order
-    long mask = 0x00000003 << nBitsToShift;
-    long curShortKnotValueLong, newShortKnotValueLong;
+    std::atomic<uint32_t> *pShortKnotValue =
+        ((std::atomic<uint32_t> *)myLss->shortKnotValueByte) +
+        stateNumber / ((sizeof(uint32_t) * 8) / 2);
+    uint32_t nBitsToShift = 2 * (stateNumber %
+                                 ((sizeof(uint32_t) * 8) / 2)); // little-endian
+                                                                // byte-order
+    uint32_t mask = 0x00000003u << nBitsToShift;
+    uint32_t curShortKnotValueLong = *pShortKnotValue;
+    uint32_t newShortKnotValueLong;
 
     do {
-        curShortKnotValueLong = *pShortKnotValue;
         newShortKnotValueLong = (curShortKnotValueLong & (~mask)) +
-                                (knotValue << nBitsToShift);
-    } while (InterlockedCompareExchange(pShortKnotValue, newShortKnotValueLong,
-                                        curShortKnotValueLong) !=
-             curShortKnotValueLong);
+                                ((uint32_t)knotValue << nBitsToShift);
+    } while (!pShortKnotValue->compare_exchange_weak(curShortKnotValueLong,
+                                                     newShortKnotValueLong));
 
     // measure io-operations per second
     measureIops(nWriteSkvOps, writeSkvInterval, curTimeBefore,
@@ -805,7 +1283,7 @@ void MiniMax::savePlyInfoInDatabase(uint32_t layerNumber, uint32_t stateNumber,
 
     // is layer already loaded
     if (!myPis->plyInfoIsLoaded) {
-        EnterCriticalSection(&csDatabase);
+        std::lock_guard<std::mutex> lock(csDatabase);
 
         if (!myPis->plyInfoIsLoaded) {
             // reserve memory for this layer & create array for ply info with
@@ -828,14 +1306,12 @@ void MiniMax::savePlyInfoInDatabase(uint32_t layerNumber, uint32_t stateNumber,
                                << " bytes in memory for ply info of layer "
                                << layerNumber << " due to write operation!");
         }
-
-        LeaveCriticalSection(&csDatabase);
     }
 
     // measure io-operations per second
-    LARGE_INTEGER curTimeBefore;
+    Clock::time_point curTimeBefore;
     if (MEASURE_IOPS && MEASURE_ONLY_IO) {
-        QueryPerformanceCounter(&curTimeBefore);
+        curTimeBefore = Clock::now();
     }
 
     // set value
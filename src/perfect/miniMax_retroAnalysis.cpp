@@ -12,6 +12,27 @@ s\*********************************************************************/
 
 #include "miniMax.h"
 
+//-----------------------------------------------------------------------------
+// setQueueMemoryThreshold()
+// Limits the memory the queues of the retro analysis use together. Further
+// states are written to file in the background. 0 writes every full block to
+// file.
+//-----------------------------------------------------------------------------
+void MiniMax::setQueueMemoryThreshold(int64_t bytes)
+{
+    queueMemoryThreshold = std::max((int64_t)0, bytes);
+}
+
+//-----------------------------------------------------------------------------
+// setCheckpointInterval()
+// Sets the minimum number of seconds between two checkpoints of the retro
+// analysis or the alpha-beta calculation. 0 disables them.
+//-----------------------------------------------------------------------------
+void MiniMax::setCheckpointInterval(int64_t seconds)
+{
+    checkpointInterval = std::max((int64_t)0, seconds);
+}
+
 //-----------------------------------------------------------------------------
 // calcKnotValuesByRetroAnalysis()
 //
@@ -33,11 +54,13 @@ bool MiniMax::calcKnotValuesByRetroAnalysis(vector<uint32_t> &layersToCalc)
     uint32_t plyCounter = 0;  // Counter variable
     uint32_t threadNo;
     stringstream ssLayers;
+    stringstream ssCheckpointPath;
     retroAnalysisGlobalVars retroVars;
 
     // init retro vars
-    retroVars.thread.resize(threadManager.getThreadCount());
-    for (threadNo = 0; threadNo < threadManager.getThreadCount(); threadNo++) {
+    retroVars.thread.resize(getThreadManager().getThreadCount());
+    for (threadNo = 0; threadNo < getThreadManager().getThreadCount();
+         threadNo++) {
         retroVars.thread[threadNo].statesToProcess.resize(PLYINFO_EXP_VALUE,
                                                           nullptr);
         retroVars.thread[threadNo].stateToProcessCount = 0;
@@ -48,6 +71,12 @@ bool MiniMax::calcKnotValuesByRetroAnalysis(vector<uint32_t> &layersToCalc)
     retroVars.layersToCalculate = layersToCalc;
     retroVars.pMiniMax = this;
 
+    // the layers calculated at the same time share the queue memory like the
+    // threads
+    retroVars.queueMemory.threshold = queueMemoryThreshold *
+                                      getThreadManager().getThreadCount() /
+                                      threadManager.getThreadCount();
+
     for (retroVars.totalKnotCount = 0, retroVars.knotToCalcCount = 0,
         curLayer = 0;
          curLayer < layersToCalc.size(); curLayer++) {
@@ -76,11 +105,30 @@ bool MiniMax::calcKnotValuesByRetroAnalysis(vector<uint32_t> &layersToCalc)
 
     retroVars.layerInitialized.assign(skvfHeader.LayerCount, false);
 
+    // who owns which count values while the succeeders are counted. the parts
+    // begin on cache line boundaries
+    retroVars.layerIdOfLayer.assign(skvfHeader.LayerCount,
+                                    (uint32_t)layersToCalc.size());
+    retroVars.ownedStateCount.resize(layersToCalc.size());
+    for (curLayer = 0; curLayer < layersToCalc.size(); curLayer++) {
+        retroVars.layerIdOfLayer[layersToCalc[curLayer]] = curLayer;
+        retroVars.ownedStateCount[curLayer] =
+            (layerStats[layersToCalc[curLayer]].knotsInLayer /
+                 getThreadManager().getThreadCount() / 64 +
+             1) *
+            64;
+    }
+    retroVars.countInboxes = vector<CountIncrementInbox>(
+        getThreadManager().getThreadCount());
+
     // output & filenames
     for (curLayer = 0; curLayer < layersToCalc.size(); curLayer++)
         ssLayers << " " << layersToCalc[curLayer];
     PRINT(0, this,
           "*** Calculate layers" << ssLayers.str() << " by retro analysis ***");
+    ssCheckpointPath << fileDir << (fileDir.size() ? "/" : "") << "checkpoint";
+    createDirectory(ssCheckpointPath.str().c_str());
+    retroVars.checkpointFilePath = getRetroCheckpointFilePath(layersToCalc);
 
     // initialization
     PRINT(2, this, "  Bytes in memory: " << memoryUsed2 << endl);
@@ -100,12 +148,19 @@ bool MiniMax::calcKnotValuesByRetroAnalysis(vector<uint32_t> &layersToCalc)
     if (onlyPrepareLayer)
         goto freeMem;
 
+    // continue an interrupted iteration
+    if (!loadRetroAnalysisCheckpoint(retroVars)) {
+        abortCalc = true;
+        goto freeMem;
+    }
+
     // iteration
     PRINT(2, this, "  Bytes in memory: " << memoryUsed2 << endl);
     if (!performRetroAnalysis(retroVars)) {
         abortCalc = true;
         goto freeMem;
     }
+    std::remove(retroVars.checkpointFilePath.c_str());
 
     // show output
     PRINT(2, this, "  Bytes in memory: " << memoryUsed2);
@@ -116,7 +171,8 @@ bool MiniMax::calcKnotValuesByRetroAnalysis(vector<uint32_t> &layersToCalc)
 
     // free memory
 freeMem:
-    for (threadNo = 0; threadNo < threadManager.getThreadCount(); threadNo++) {
+    for (threadNo = 0; threadNo < getThreadManager().getThreadCount();
+         threadNo++) {
         for (plyCounter = 0;
              plyCounter < retroVars.thread[threadNo].statesToProcess.size();
              plyCounter++) {
@@ -124,6 +180,14 @@ freeMem:
         }
     }
 
+    PRINT(1, this,
+          "  States to process: peak "
+              << retroVars.queueMemory.peakBytesInMemory
+              << " bytes in memory, " << retroVars.queueMemory.blocksSpilled
+              << " blocks written to file, "
+              << retroVars.queueMemory.blocksReloaded
+              << " blocks read back");
+
     for (curLayer = 0; curLayer < layersToCalc.size(); curLayer++) {
         if (retroVars.countArrays[curLayer] != nullptr) {
             memoryUsed2 -= layerStats[layersToCalc[curLayer]].knotsInLayer *
@@ -151,7 +215,6 @@ freeMem:
 //-----------------------------------------------------------------------------
 bool MiniMax::initRetroAnalysis(retroAnalysisGlobalVars &retroVars)
 {
-#ifndef __clang__ // TODO(calcitem)
     // locals
 
     // current processed layer within 'layersToCalculate'
@@ -184,19 +247,19 @@ bool MiniMax::initRetroAnalysis(retroAnalysisGlobalVars &retroVars)
 
         // file names
         ssInitArrayPath.str("");
-        ssInitArrayPath << fileDir << (fileDir.size() ? "\\" : "")
+        ssInitArrayPath << fileDir << (fileDir.size() ? "/" : "")
                         << "initLayer";
         ssInitArrayFilePath.str("");
-        ssInitArrayFilePath << fileDir << (fileDir.size() ? "\\" : "")
-                            << "initLayer\\initLayer" << layerNumber << ".dat";
+        ssInitArrayFilePath << fileDir << (fileDir.size() ? "/" : "")
+                            << "initLayer/initLayer" << layerNumber << ".dat";
 
         // does initialization file exist ?
-        CreateDirectoryA(ssInitArrayPath.str().c_str(), nullptr);
-        initArray = new BufferedFile(threadManager.getThreadCount(),
+        createDirectory(ssInitArrayPath.str().c_str());
+        initArray = new BufferedFile(getThreadManager().getThreadCount(),
                                      FILE_BUFFER_SIZE,
                                      ssInitArrayFilePath.str().c_str());
         if (initArray->getFileSize() ==
-            (LONGLONG)layerStats[layerNumber].knotsInLayer) {
+            (int64_t)layerStats[layerNumber].knotsInLayer) {
             PRINT(2, this,
                   "    Loading init states from file: "
                       << ssInitArrayFilePath.str());
@@ -210,20 +273,20 @@ bool MiniMax::initRetroAnalysis(retroAnalysisGlobalVars &retroVars)
             retroVars.layerInitialized[layerNumber] = true;
 
         // prepare params
-        stateProcessedCount = 0;
+        retroVars.stateProcessedCount = 0;
         retroVars.statsValueCounter[SKV_VALUE_GAME_WON] = 0;
         retroVars.statsValueCounter[SKV_VALUE_GAME_LOST] = 0;
         retroVars.statsValueCounter[SKV_VALUE_GAME_DRAWN] = 0;
         retroVars.statsValueCounter[SKV_VALUE_INVALID] = 0;
+        InitRetroAnalysisVars masterVars(
+            this, &retroVars, layerNumber, initArray, initAlreadyDone);
         ThreadManager::ThreadVarsArray<InitRetroAnalysisVars> tva(
-            threadManager.getThreadCount(),
-            (InitRetroAnalysisVars &)InitRetroAnalysisVars(
-                this, &retroVars, layerNumber, initArray, initAlreadyDone));
+            getThreadManager().getThreadCount(), masterVars);
 
         // process each state in the current layer
-        switch (threadManager.execParallelLoop(
+        switch (getThreadManager().execParallelLoop(
             initRetroAnalysisThreadProc, tva.getPointerToArray(),
-            tva.getArraySize(), TM_SCHED_STATIC, 0,
+            tva.getArraySize(), TM_SCHED_GUIDED, 0,
             layerStats[layerNumber].knotsInLayer - 1, 1)) {
         case TM_RETVAL_OK:
             break;
@@ -246,7 +309,8 @@ bool MiniMax::initRetroAnalysis(retroAnalysisGlobalVars &retroVars)
         initArray->flushBuffers();
         SAFE_DELETE(initArray);
 
-        if (stateProcessedCount < layerStats[layerNumber].knotsInLayer)
+        if (retroVars.stateProcessedCount <
+            layerStats[layerNumber].knotsInLayer)
             return falseOrStop();
 
         // when init file was created new then save it now
@@ -268,7 +332,6 @@ bool MiniMax::initRetroAnalysis(retroAnalysisGlobalVars &retroVars)
               "    invalid states: "
                   << retroVars.statsValueCounter[SKV_VALUE_INVALID]);
     }
-#endif // __clang__
     return true;
 }
 
@@ -276,7 +339,7 @@ bool MiniMax::initRetroAnalysis(retroAnalysisGlobalVars &retroVars)
 // initRetroAnalysisParallelSub()
 //
 //-----------------------------------------------------------------------------
-DWORD MiniMax::initRetroAnalysisThreadProc(void *pParam, uint32_t index)
+uint32_t MiniMax::initRetroAnalysisThreadProc(void *pParam, uint32_t index)
 {
     // locals
     InitRetroAnalysisVars *iraVars = (InitRetroAnalysisVars *)pParam;
@@ -291,10 +354,10 @@ DWORD MiniMax::initRetroAnalysisThreadProc(void *pParam, uint32_t index)
 
     // print status
     if (iraVars->statesProcessed % OUTPUT_EVERY_N_STATES == 0) {
-        m->stateProcessedCount += OUTPUT_EVERY_N_STATES;
+        iraVars->retroVars->stateProcessedCount += OUTPUT_EVERY_N_STATES;
         PRINT(2, m,
               "Already initialized "
-                  << m->stateProcessedCount << " of "
+                  << iraVars->retroVars->stateProcessedCount << " of "
                   << m->layerStats[curState.layerNumber].knotsInLayer
                   << " states");
     }
@@ -368,11 +431,10 @@ bool MiniMax::prepareCountArrays(retroAnalysisGlobalVars &retroVars)
     StateAdress curState;           // current state counter for loops
     uint32_t curLayer = 0;          // Counter variable
     CountArrayVarType defValue = 0; // default counter array value
-    DWORD dwWritten;
-    DWORD dwRead;
-    LARGE_INTEGER fileSize;
-    HANDLE hFileCountArray = nullptr; // file handle for loading and saving the
-                                      // arrays in 'countArrays'
+    uint32_t nBytes;
+    int64_t offset; // position in the file of the current array
+    RandomAccessFile countArrayFile; // file for loading and saving the arrays
+                                     // in 'countArrays'
     stringstream ssCountArrayPath;
     stringstream ssCountArrayFilePath;
     stringstream ssLayers;
@@ -382,9 +444,9 @@ bool MiniMax::prepareCountArrays(retroAnalysisGlobalVars &retroVars)
          curLayer++)
         ssLayers << " " << retroVars.layersToCalculate[curLayer];
 
-    ssCountArrayPath << fileDir << (fileDir.size() ? "\\" : "") << "countArray";
-    ssCountArrayFilePath << fileDir << (fileDir.size() ? "\\" : "")
-                         << "countArray\\countArray" << ssLayers.str()
+    ssCountArrayPath << fileDir << (fileDir.size() ? "/" : "") << "countArray";
+    ssCountArrayFilePath << fileDir << (fileDir.size() ? "/" : "")
+                         << "countArray/countArray" << ssLayers.str()
                          << ".dat";
     PRINT(2, this,
           "  *** Prepare count arrays for layers " << ssLayers.str() << " ***"
@@ -392,12 +454,9 @@ bool MiniMax::prepareCountArrays(retroAnalysisGlobalVars &retroVars)
     curCalcActionId = MM_ACTION_PREPARE_COUNT_ARRAY;
 
     // prepare count arrays
-    CreateDirectoryA(ssCountArrayPath.str().c_str(), nullptr);
+    createDirectory(ssCountArrayPath.str().c_str());
 
-    if ((hFileCountArray = CreateFileA(
-             ssCountArrayFilePath.str().c_str(), GENERIC_READ | GENERIC_WRITE,
-             FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
-             FILE_ATTRIBUTE_NORMAL, nullptr)) == INVALID_HANDLE_VALUE) {
+    if (!countArrayFile.open(ssCountArrayFilePath.str().c_str())) {
         PRINT(0, this,
               "ERROR: Could not open File " << ssCountArrayFilePath.str()
                                             << "!");
@@ -419,23 +478,24 @@ bool MiniMax::prepareCountArrays(retroAnalysisGlobalVars &retroVars)
                             nKnotsInCurLayer * sizeof(CountArrayVarType), 0);
     }
 
-    // load file if already existed
-    if (GetFileSizeEx(hFileCountArray, &fileSize) &&
-        fileSize.QuadPart == retroVars.knotToCalcCount) {
+    // load file if already existed. calcNumSucceeders() also puts the states
+    // of the layers below into the queues, so the file is only used when a
+    // checkpoint replaces the queues afterwards
+    if (countArrayFile.getFileSize() == (int64_t)retroVars.knotToCalcCount &&
+        pathExists(retroVars.checkpointFilePath.c_str())) {
         PRINT(2, this,
               "  Load number of succeeders from file: "
                   << ssCountArrayFilePath.str().c_str());
 
-        for (curLayer = 0; curLayer < retroVars.layersToCalculate.size();
-             curLayer++) {
+        for (curLayer = 0, offset = 0;
+             curLayer < retroVars.layersToCalculate.size(); curLayer++) {
             nKnotsInCurLayer = layerStats[retroVars.layersToCalculate[curLayer]]
                                    .knotsInLayer;
-            if (!ReadFile(hFileCountArray, retroVars.countArrays[curLayer],
-                          nKnotsInCurLayer * sizeof(CountArrayVarType), &dwRead,
-                          nullptr))
-                return falseOrStop();
-            if (dwRead != nKnotsInCurLayer * sizeof(CountArrayVarType))
+            nBytes = nKnotsInCurLayer * sizeof(CountArrayVarType);
+            if (countArrayFile.read(offset, nBytes,
+                                    retroVars.countArrays[curLayer]) != nBytes)
                 return falseOrStop();
+            offset += nBytes;
         }
 
         // else calculate number of succedding states
@@ -454,21 +514,19 @@ bool MiniMax::prepareCountArrays(retroAnalysisGlobalVars &retroVars)
 
         // calculate values
         if (!calcNumSucceeders(retroVars)) {
-            CloseHandle(hFileCountArray);
             return false;
         }
 
         // save to file
-        for (curLayer = 0, dwWritten = 0;
+        for (curLayer = 0, offset = 0;
              curLayer < retroVars.layersToCalculate.size(); curLayer++) {
             nKnotsInCurLayer = layerStats[retroVars.layersToCalculate[curLayer]]
                                    .knotsInLayer;
-            if (!WriteFile(hFileCountArray, retroVars.countArrays[curLayer],
-                           nKnotsInCurLayer * sizeof(CountArrayVarType),
-                           &dwWritten, nullptr))
-                return falseOrStop();
-            if (dwWritten != nKnotsInCurLayer * sizeof(CountArrayVarType))
+            nBytes = nKnotsInCurLayer * sizeof(CountArrayVarType);
+            if (countArrayFile.write(offset, nBytes,
+                                     retroVars.countArrays[curLayer]) != nBytes)
                 return falseOrStop();
+            offset += nBytes;
         }
 
         PRINT(2, this,
@@ -476,7 +534,6 @@ bool MiniMax::prepareCountArrays(retroAnalysisGlobalVars &retroVars)
     }
 
     // finish
-    CloseHandle(hFileCountArray);
     return true;
 }
 
@@ -486,7 +543,6 @@ bool MiniMax::prepareCountArrays(retroAnalysisGlobalVars &retroVars)
 //-----------------------------------------------------------------------------
 bool MiniMax::calcNumSucceeders(retroAnalysisGlobalVars &retroVars)
 {
-#ifndef __clang__ // TODO(calcitem)
     // locals
     uint32_t curLayerId;   // current processed layer within
                            // 'layersToCalculate'
@@ -509,16 +565,15 @@ bool MiniMax::calcNumSucceeders(retroAnalysisGlobalVars &retroVars)
         if (!succCalculated[layerNumber]) {
             // prepare params for multi threading
             succCalculated[layerNumber] = true;
-            stateProcessedCount = 0;
+            retroVars.stateProcessedCount = 0;
+            AddNumSucceedersVars masterVars(this, &retroVars, layerNumber);
             ThreadManager::ThreadVarsArray<AddNumSucceedersVars> tva(
-                threadManager.getThreadCount(),
-                (AddNumSucceedersVars &)AddNumSucceedersVars(this, &retroVars,
-                                                             layerNumber));
+                getThreadManager().getThreadCount(), masterVars);
 
             // process each state in the current layer
-            switch (threadManager.execParallelLoop(
+            switch (getThreadManager().execParallelLoop(
                 addNumSucceedersThreadProc, tva.getPointerToArray(),
-                tva.getArraySize(), TM_SCHED_STATIC, 0,
+                tva.getArraySize(), TM_SCHED_DYNAMIC, 0,
                 layerStats[layerNumber].knotsInLayer - 1, 1)) {
             case TM_RETVAL_OK:
                 break;
@@ -537,7 +592,12 @@ bool MiniMax::calcNumSucceeders(retroAnalysisGlobalVars &retroVars)
 
             // reduce and delete thread specific data
             tva.reduce();
-            if (stateProcessedCount < layerStats[layerNumber].knotsInLayer)
+            if (retroVars.stateProcessedCount <
+                layerStats[layerNumber].knotsInLayer)
+                return falseOrStop();
+
+            // apply the increments which are left
+            if (!applyLeftCountIncrements(tva))
                 return falseOrStop();
 
             // don't calculate layers twice
@@ -570,16 +630,16 @@ bool MiniMax::calcNumSucceeders(retroAnalysisGlobalVars &retroVars)
                       << (int)succState.layerNumber);
 
             // prepare params for multithreading
-            stateProcessedCount = 0;
+            retroVars.stateProcessedCount = 0;
+            AddNumSucceedersVars masterVars(
+                this, &retroVars, succState.layerNumber);
             ThreadManager::ThreadVarsArray<AddNumSucceedersVars> tva(
-                threadManager.getThreadCount(),
-                (AddNumSucceedersVars &)AddNumSucceedersVars(
-                    this, &retroVars, succState.layerNumber));
+                getThreadManager().getThreadCount(), masterVars);
 
             // process each state in the current layer
-            switch (threadManager.execParallelLoop(
+            switch (getThreadManager().execParallelLoop(
                 addNumSucceedersThreadProc, tva.getPointerToArray(),
-                tva.getArraySize(), TM_SCHED_STATIC, 0,
+                tva.getArraySize(), TM_SCHED_DYNAMIC, 0,
                 layerStats[succState.layerNumber].knotsInLayer - 1, 1)) {
             case TM_RETVAL_OK:
                 break;
@@ -598,12 +658,15 @@ bool MiniMax::calcNumSucceeders(retroAnalysisGlobalVars &retroVars)
 
             // reduce and delete thread specific data
             tva.reduce();
-            if (stateProcessedCount <
+            if (retroVars.stateProcessedCount <
                 layerStats[succState.layerNumber].knotsInLayer)
                 return falseOrStop();
+
+            // apply the increments which are left
+            if (!applyLeftCountIncrements(tva))
+                return falseOrStop();
         }
     }
-#endif // __clang__
 
     // everything fine
     return true;
@@ -613,7 +676,7 @@ bool MiniMax::calcNumSucceeders(retroAnalysisGlobalVars &retroVars)
 // addNumSucceedersThreadProc()
 //
 //-----------------------------------------------------------------------------
-DWORD MiniMax::addNumSucceedersThreadProc(void *pParam, uint32_t index)
+uint32_t MiniMax::addNumSucceedersThreadProc(void *pParam, uint32_t index)
 {
     // locals
     AddNumSucceedersVars *ansVars = (AddNumSucceedersVars *)pParam;
@@ -624,7 +687,7 @@ DWORD MiniMax::addNumSucceedersThreadProc(void *pParam, uint32_t index)
                          // 'layersToCalculate'
     uint32_t amountOfPred;
     uint32_t curPred;
-    CountArrayVarType countValue;
+    uint32_t owner; // thread owning the count value of the predecessor
     StateAdress predState;
     StateAdress curState;
     TwoBit curStateValue;
@@ -635,17 +698,25 @@ DWORD MiniMax::addNumSucceedersThreadProc(void *pParam, uint32_t index)
     curState.layerNumber = ansVars->layerNumber;
     curState.stateNumber = (StateNumberVarType)index;
 
+    if (ansVars->countIncrements.empty())
+        ansVars->countIncrements.resize(m->getThreadManager().getThreadCount());
+
     // print status
     ansVars->statesProcessed++;
     if (ansVars->statesProcessed % OUTPUT_EVERY_N_STATES == 0) {
-        m->stateProcessedCount += OUTPUT_EVERY_N_STATES;
+        ansVars->retroVars->stateProcessedCount += OUTPUT_EVERY_N_STATES;
         PRINT(2, m,
               "    Already processed "
-                  << m->stateProcessedCount << " of "
+                  << ansVars->retroVars->stateProcessedCount << " of "
                   << m->layerStats[curState.layerNumber].knotsInLayer
                   << " states");
     }
 
+    // apply the increments of the other threads
+    if (ansVars->retroVars->countInboxes[ansVars->curThreadNo].notEmpty &&
+        !m->applyCountIncrements(*ansVars->retroVars, ansVars->curThreadNo))
+        return TM_RETVAL_TERMINATE_ALL_THREADS;
+
     // invalid state ?
     m->readKnotValueFromDatabase(curState.layerNumber, curState.stateNumber,
                                  curStateValue);
@@ -669,11 +740,7 @@ DWORD MiniMax::addNumSucceedersThreadProc(void *pParam, uint32_t index)
         predState.stateNumber = ansVars->predVars[curPred].predStateNumbers;
 
         // don't calculate states from layers above yet
-        for (curLayerId = 0; curLayerId < nLayersToCalculate; curLayerId++) {
-            if (ansVars->retroVars->layersToCalculate[curLayerId] ==
-                predState.layerNumber)
-                break;
-        }
+        curLayerId = ansVars->retroVars->layerIdOfLayer[predState.layerNumber];
 
         if (curLayerId == nLayersToCalculate)
             continue;
@@ -691,43 +758,133 @@ DWORD MiniMax::addNumSucceedersThreadProc(void *pParam, uint32_t index)
             cuStateAddedToProcessQueue = true;
         }
 
-        // add this state as possible move
-        long *pCountValue =
-            ((long *)ansVars->retroVars->countArrays[curLayerId]) +
-            predState.stateNumber / (sizeof(long) / sizeof(CountArrayVarType));
-        long nBitsToShift = sizeof(CountArrayVarType) * 8 *
-                            (predState.stateNumber %
-                             (sizeof(long) /
-                              sizeof(CountArrayVarType))); // little-endian
-                                                           // byte-order
-        long mask = 0x000000ff << nBitsToShift;
-        long curCountLong, newCountLong;
-
-        do {
-#if 0
-            cout << "predState.stateNumber = " << predState.stateNumber << endl;
-            cout << "pCountValue = " << pCountValue << endl;
-#endif
-
-            curCountLong = *pCountValue;
-            long temp = (curCountLong & mask) >> nBitsToShift;
-            countValue = (CountArrayVarType)temp;
-            if (countValue == 255) {
-                PRINT(0, m, "ERROR: maximum value for Count[] reached!");
+        // add this state as possible move. the count value is only written by
+        // the thread owning it
+        owner = predState.stateNumber /
+                ansVars->retroVars->ownedStateCount[curLayerId];
+
+        if (owner == ansVars->curThreadNo) {
+            if (!m->incrementCountValue(*ansVars->retroVars, curLayerId,
+                                        predState.stateNumber))
                 return TM_RETVAL_TERMINATE_ALL_THREADS;
-            } else {
-                countValue++;
-                newCountLong = (curCountLong & (~mask)) +
-                               (countValue << nBitsToShift);
-            }
-        } while (InterlockedCompareExchange(pCountValue, newCountLong,
-                                            curCountLong) != curCountLong);
+        } else {
+            ansVars->countIncrements[owner].push_back(
+                {curLayerId, predState.stateNumber});
+            if (ansVars->countIncrements[owner].size() ==
+                COUNT_INCREMENT_BATCH_SIZE)
+                m->sendCountIncrements(*ansVars->retroVars,
+                                       ansVars->countIncrements[owner], owner);
+        }
     }
 
     // everything is fine
     return TM_RETVAL_OK;
 }
 
+//-----------------------------------------------------------------------------
+// applyLeftCountIncrements()
+// Lets each thread apply the count value increments the others passed to it
+// after it had finished its part of the loop.
+//-----------------------------------------------------------------------------
+bool MiniMax::applyLeftCountIncrements(
+    ThreadManager::ThreadVarsArray<AddNumSucceedersVars> &tva)
+{
+    if (getThreadManager().execInParallel(applyCountIncrementsThreadProc,
+                                     tva.getPointerToArray(),
+                                     tva.getArraySize()) != TM_RETVAL_OK)
+        return false;
+
+    for (uint32_t threadNo = 0; threadNo < tva.threadCount; threadNo++) {
+        if (tva.item[threadNo].countIncrementFailed)
+            return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// applyCountIncrementsThreadProc()
+//
+//-----------------------------------------------------------------------------
+uint32_t MiniMax::applyCountIncrementsThreadProc(void *pParam)
+{
+    AddNumSucceedersVars *ansVars = (AddNumSucceedersVars *)pParam;
+
+    ansVars->countIncrementFailed = !ansVars->pMiniMax->applyCountIncrements(
+        *ansVars->retroVars, ansVars->curThreadNo);
+
+    return TM_RETVAL_OK;
+}
+
+//-----------------------------------------------------------------------------
+// sendCountIncrements()
+// Passes a batch of count value increments to the thread 'threadNo' owning
+// the states. 'increments' is empty afterwards.
+//-----------------------------------------------------------------------------
+void MiniMax::sendCountIncrements(retroAnalysisGlobalVars &retroVars,
+                                  vector<CountIncrement> &increments,
+                                  uint32_t threadNo)
+{
+    CountIncrementInbox &inbox = retroVars.countInboxes[threadNo];
+
+    {
+        std::lock_guard<std::mutex> lock(inbox.cs);
+        inbox.batches.push_back(std::move(increments));
+        inbox.notEmpty = true;
+    }
+
+    increments.clear();
+    increments.reserve(COUNT_INCREMENT_BATCH_SIZE);
+}
+
+//-----------------------------------------------------------------------------
+// applyCountIncrements()
+// Applies the batches the other threads passed to the thread 'threadNo'.
+// Must be called by that thread only.
+//-----------------------------------------------------------------------------
+bool MiniMax::applyCountIncrements(retroAnalysisGlobalVars &retroVars,
+                                   uint32_t threadNo)
+{
+    CountIncrementInbox &inbox = retroVars.countInboxes[threadNo];
+    vector<vector<CountIncrement>> batches;
+
+    {
+        std::lock_guard<std::mutex> lock(inbox.cs);
+        batches.swap(inbox.batches);
+        inbox.notEmpty = false;
+    }
+
+    for (auto &batch : batches) {
+        for (auto &increment : batch) {
+            if (!incrementCountValue(retroVars, increment.layerId,
+                                     increment.stateNumber))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// incrementCountValue()
+//
+//-----------------------------------------------------------------------------
+bool MiniMax::incrementCountValue(retroAnalysisGlobalVars &retroVars,
+                                  uint32_t layerId,
+                                  StateNumberVarType stateNumber)
+{
+    CountArrayVarType &countValue = retroVars.countArrays[layerId][stateNumber];
+
+    if (countValue == 255) {
+        PRINT(0, this, "ERROR: maximum value for Count[] reached!");
+        return false;
+    }
+
+    countValue++;
+
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // performRetroAnalysis()
 //
@@ -741,11 +898,13 @@ bool MiniMax::performRetroAnalysis(retroAnalysisGlobalVars &retroVars)
                           // 'layersToCalculate'
 
     PRINT(2, this, "  *** Begin Iteration ***");
-    stateProcessedCount = 0;
+    retroVars.stateProcessedCount = 0;
     curCalcActionId = MM_ACTION_PERFORM_RETRO_ANAL;
+    retroVars.lastCheckpointTime = Clock::now();
+    retroVars.checkpointPlyNumber = -1;
 
     // process each state in the current layer
-    switch (threadManager.execInParallel(performRetroAnalysisThreadProc,
+    switch (getThreadManager().execInParallel(performRetroAnalysisThreadProc,
                                          (void **)&retroVars, 0)) {
     case TM_RETVAL_OK:
         break;
@@ -762,8 +921,8 @@ bool MiniMax::performRetroAnalysis(retroAnalysisGlobalVars &retroVars)
     }
 
     // if there are still states to process, than something went wrong
-    for (uint32_t curThreadNo = 0; curThreadNo < threadManager.getThreadCount();
-         curThreadNo++) {
+    for (uint32_t curThreadNo = 0;
+         curThreadNo < getThreadManager().getThreadCount(); curThreadNo++) {
         if (retroVars.thread[curThreadNo].stateToProcessCount) {
             PRINT(0, this,
                   "ERROR: There are still states to process after performing "
@@ -805,12 +964,12 @@ bool MiniMax::performRetroAnalysis(retroAnalysisGlobalVars &retroVars)
 // performRetroAnalysisThreadProc()
 //
 //-----------------------------------------------------------------------------
-DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
+uint32_t MiniMax::performRetroAnalysisThreadProc(void *pParam)
 {
     // locals
     retroAnalysisGlobalVars *retroVars = (retroAnalysisGlobalVars *)pParam;
     MiniMax *m = retroVars->pMiniMax;
-    uint32_t threadNo = m->threadManager.getThreadNumber();
+    uint32_t threadNo = m->getThreadManager().getThreadNumber();
     RetroAnalysisThreadVars *threadVars = &retroVars->thread[threadNo];
 
     TwoBit predStateValue;
@@ -831,7 +990,8 @@ DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
     TwoBit curStateValue; // current state value
     RetroAnalysisPredVars predVars[PREDECESSOR_COUNT_MAX];
 
-    for (stateProcessedCount = 0, curNumPlies = 0;
+    for (stateProcessedCount = 0,
+        curNumPlies = (PlyInfoVarType)retroVars->firstPlyNumber;
          curNumPlies < threadVars->statesToProcess.size(); curNumPlies++) {
         // skip empty and uninitialized cyclic arrays
         if (threadVars->statesToProcess[curNumPlies] != nullptr) {
@@ -841,7 +1001,7 @@ DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
                           << (uint32_t)curNumPlies << "/"
                           << threadVars->statesToProcess.size());
                 for (threadCounter = 0;
-                     threadCounter < m->threadManager.getThreadCount();
+                     threadCounter < m->getThreadManager().getThreadCount();
                      threadCounter++) {
                     PRINT(0, m,
                           "      States to process for thread "
@@ -854,7 +1014,7 @@ DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
             while (threadVars->statesToProcess[curNumPlies]->takeBytes(
                 sizeof(StateAdress), (unsigned char *)&curState)) {
                 // execution canceled by user?
-                if (m->threadManager.wasExecCancelled()) {
+                if (m->getThreadManager().wasExecCancelled()) {
                     PRINT(0, m,
                           "\n****************************************\nSub-"
                           "thread no. "
@@ -882,9 +1042,9 @@ DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
                 stateProcessedCount++;
                 threadVars->stateToProcessCount--;
                 if (stateProcessedCount % OUTPUT_EVERY_N_STATES == 0) {
-                    m->stateProcessedCount += OUTPUT_EVERY_N_STATES;
+                    retroVars->stateProcessedCount += OUTPUT_EVERY_N_STATES;
                     for (totalNumStatesToProcess = 0, threadCounter = 0;
-                         threadCounter < m->threadManager.getThreadCount();
+                         threadCounter < m->getThreadManager().getThreadCount();
                          threadCounter++) {
                         totalNumStatesToProcess += retroVars
                                                        ->thread[threadCounter]
@@ -892,7 +1052,7 @@ DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
                     }
                     PRINT(2, m,
                           "    states already processed: "
-                              << m->stateProcessedCount
+                              << retroVars->stateProcessedCount
                               << " \t states still in list: "
                               << totalNumStatesToProcess);
                 }
@@ -914,13 +1074,8 @@ DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
                     predState.stateNumber = predVars[curPred].predStateNumbers;
 
                     // don't calculate states from layers above yet
-                    for (curLayerId = 0;
-                         curLayerId < retroVars->layersToCalculate.size();
-                         curLayerId++) {
-                        if (retroVars->layersToCalculate[curLayerId] ==
-                            predState.layerNumber)
-                            break;
-                    }
+                    curLayerId =
+                        retroVars->layerIdOfLayer[predState.layerNumber];
                     if (curLayerId == retroVars->layersToCalculate.size())
                         continue;
 
@@ -962,37 +1117,39 @@ DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
                             // is not an option any more for all predecessors
                         } else {
                             // reduce count value by one
-                            long *pCountValue =
-                                ((long *)retroVars->countArrays[curLayerId]) +
+                            std::atomic<uint32_t> *pCountValue =
+                                ((std::atomic<uint32_t> *)
+                                     retroVars->countArrays[curLayerId]) +
                                 predState.stateNumber /
-                                    (sizeof(long) / sizeof(CountArrayVarType));
-                            long nBitsToShift =
+                                    (sizeof(uint32_t) /
+                                     sizeof(CountArrayVarType));
+                            uint32_t nBitsToShift =
                                 sizeof(CountArrayVarType) * 8 *
                                 (predState.stateNumber %
-                                 (sizeof(long) /
+                                 (sizeof(uint32_t) /
                                   sizeof(CountArrayVarType))); // little-endian
                                                                // byte-order
-                            long mask = 0x000000ff << nBitsToShift;
-                            long curCountLong, newCountLong;
+                            uint32_t mask = 0x000000ffu << nBitsToShift;
+                            uint32_t curCountLong = *pCountValue;
+                            uint32_t newCountLong;
 
                             do {
-                                curCountLong = *pCountValue;
-                                long temp = (curCountLong & mask) >>
-                                            nBitsToShift;
+                                uint32_t temp = (curCountLong & mask) >>
+                                                nBitsToShift;
                                 countValue = (CountArrayVarType)temp;
 
                                 if (countValue > 0) {
                                     countValue--;
-                                    newCountLong = (curCountLong & (~mask)) +
-                                                   (countValue << nBitsToShift);
+                                    newCountLong =
+                                        (curCountLong & (~mask)) +
+                                        ((uint32_t)countValue << nBitsToShift);
                                 } else {
                                     PRINT(0, m,
                                           "ERROR: Count is already zero!");
                                     return TM_RETVAL_TERMINATE_ALL_THREADS;
                                 }
-                            } while (InterlockedCompareExchange(
-                                         pCountValue, newCountLong,
-                                         curCountLong) != curCountLong);
+                            } while (!pCountValue->compare_exchange_weak(
+                                curCountLong, newCountLong));
 
                             // ply info (requirement: curNumPlies ==
                             // plyTillCurStateCount)
@@ -1031,11 +1188,45 @@ DWORD MiniMax::performRetroAnalysisThreadProc(void *pParam)
                     }
                 }
             }
+
+            // the queue is only left with states when a block of it could
+            // not be read back from its file
+            if (threadVars->statesToProcess[curNumPlies]->getBytesToTake() >=
+                (int64_t)sizeof(StateAdress)) {
+                PRINT(0, m, "ERROR: Could not read the states to process!");
+                return TM_RETVAL_TERMINATE_ALL_THREADS;
+            }
         }
 
+        // thread 0 decides whether a checkpoint is written after this ply
+        // number. the others read the decision after waiting
+        if (threadNo == 0 &&
+            ((m->checkpointInterval > 0 &&
+              Clock::now() - retroVars->lastCheckpointTime >=
+                  std::chrono::seconds(m->checkpointInterval)) ||
+             m->retroAnalysisStopPly == curNumPlies))
+            retroVars->checkpointPlyNumber = curNumPlies;
+
         // there might be other threads still processing states with this ply
         // number
-        m->threadManager.waitForOtherThreads(threadNo);
+        m->getThreadManager().waitForOtherThreads(threadNo);
+
+        // the queues up to this ply number are empty now. the other threads
+        // wait while thread 0 writes the checkpoint
+        if (retroVars->checkpointPlyNumber == curNumPlies) {
+            if (threadNo == 0) {
+                m->saveRetroAnalysisCheckpoint(*retroVars, curNumPlies + 1);
+                retroVars->lastCheckpointTime = Clock::now();
+
+                // interrupted as if the calculation had crashed here
+                if (m->retroAnalysisStopPly == curNumPlies)
+                    m->getThreadManager().cancelExec();
+            }
+            m->getThreadManager().waitForOtherThreads(threadNo);
+
+            if (m->getThreadManager().wasExecCancelled())
+                return TM_RETVAL_EXEC_CANCELLED;
+        }
     }
 
     // every thing ok
@@ -1053,7 +1244,8 @@ bool MiniMax::addStateToProcessQueue(retroAnalysisGlobalVars &retroVars,
     // resize vector if too small
     if (plyNumber >= threadVars.statesToProcess.size()) {
         threadVars.statesToProcess.resize(
-            max(plyNumber + 1, 10 * threadVars.statesToProcess.size()),
+            max((size_t)plyNumber + 1,
+                10 * threadVars.statesToProcess.size()),
             nullptr);
         PRINT(4, this,
               "    statesToProcess resized to "
@@ -1064,19 +1256,19 @@ bool MiniMax::addStateToProcessQueue(retroAnalysisGlobalVars &retroVars,
     if (threadVars.statesToProcess[plyNumber] == nullptr) {
         stringstream ssStatesToProcessFilePath;
         stringstream ssStatesToProcessPath;
-        ssStatesToProcessPath << fileDir << (fileDir.size() ? "\\" : "")
+        ssStatesToProcessPath << fileDir << (fileDir.size() ? "/" : "")
                               << "statesToProcess";
-        CreateDirectoryA(ssStatesToProcessPath.str().c_str(), nullptr);
+        createDirectory(ssStatesToProcessPath.str().c_str());
         ssStatesToProcessFilePath.str("");
         ssStatesToProcessFilePath
             << ssStatesToProcessPath.str()
-            << "\\statesToProcessWithPlyCounter=" << plyNumber
-            << "andThread=" << threadVars.threadNo << ".dat";
+            << "/statesToProcessWithPlyCounter=" << plyNumber
+            << "andThread=" << getThreadSlot(threadVars.threadNo) << ".dat";
         threadVars.statesToProcess[plyNumber] = new CyclicArray(
             BLOCK_SIZE_IN_CYCLIC_ARRAY * sizeof(StateAdress),
             (uint32_t)(retroVars.totalKnotCount / BLOCK_SIZE_IN_CYCLIC_ARRAY) +
                 1,
-            ssStatesToProcessFilePath.str().c_str());
+            ssStatesToProcessFilePath.str().c_str(), &retroVars.queueMemory);
         PRINT(4, this,
               "    Created cyclic array: " << ssStatesToProcessFilePath.str());
     }
@@ -1096,4 +1288,338 @@ bool MiniMax::addStateToProcessQueue(retroAnalysisGlobalVars &retroVars,
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// saveRetroAnalysisCheckpoint()
+// Writes the count arrays, the short knot values and ply infos of the layers
+// being calculated and the queued states of the ply numbers from
+// 'nextPlyNumber' on to the checkpoint file. Must only be called while no
+// other thread modifies them. The previous checkpoint is only replaced by a
+// complete one.
+//-----------------------------------------------------------------------------
+bool MiniMax::saveRetroAnalysisCheckpoint(retroAnalysisGlobalVars &retroVars,
+                                          uint32_t nextPlyNumber)
+{
+    // locals
+    RandomAccessFile file;
+    RetroCheckpointHeader header;
+    string tmpFilePath = retroVars.checkpointFilePath + ".tmp";
+    CyclicArray *queue;
+    uint32_t curLayerId;
+    uint32_t layerNumber;
+    uint32_t threadNo;
+    uint32_t curPly;
+    uint32_t flags;
+    int64_t offset = 0;
+    int64_t nBytes;
+    int64_t totalStateCount = 0;
+    bool ok;
+
+    // writes large arrays in parts
+    auto writeBytes = [&](int64_t n, const void *p) {
+        const unsigned char *pBytes = (const unsigned char *)p;
+        while (n > 0) {
+            const uint32_t part = (uint32_t)std::min(n, (int64_t)1 << 26);
+            if (file.write(offset, part, pBytes) != part)
+                return false;
+            offset += part;
+            pBytes += part;
+            n -= part;
+        }
+        return true;
+    };
+
+    header.headerCode = RETRO_CHECKPOINT_HEADER_CODE;
+    header.layerCount = (uint32_t)retroVars.layersToCalculate.size();
+    header.threadCount = getThreadManager().getThreadCount();
+    header.nextPlyNumber = nextPlyNumber;
+    for (threadNo = 0; threadNo < header.threadCount; threadNo++) {
+        header.plyCount = std::max(
+            header.plyCount,
+            (uint32_t)retroVars.thread[threadNo].statesToProcess.size());
+        totalStateCount += retroVars.thread[threadNo].stateToProcessCount;
+    }
+
+    // nothing left to resume
+    if (!totalStateCount)
+        return true;
+
+    std::remove(tmpFilePath.c_str());
+    if (!file.open(tmpFilePath.c_str())) {
+        PRINT(0, this, "ERROR: Could not create " << tmpFilePath << "!");
+        return false;
+    }
+
+    PRINT(1, this,
+          "    Write checkpoint before ply number " << nextPlyNumber << " to "
+                                                    << retroVars
+                                                           .checkpointFilePath);
+
+    ok = writeBytes(sizeof(RetroCheckpointHeader), &header) &&
+         writeBytes(sizeof(uint32_t) * header.layerCount,
+                    retroVars.layersToCalculate.data());
+
+    // arrays of each layer. those not in memory still have default values
+    for (curLayerId = 0; ok && curLayerId < header.layerCount; curLayerId++) {
+        layerNumber = retroVars.layersToCalculate[curLayerId];
+        flags = (layerStats[layerNumber].layerIsLoaded ? 1 : 0) |
+                (plyInfos[layerNumber].plyInfoIsLoaded ? 2 : 0);
+        ok = writeBytes(sizeof(uint32_t), &flags) &&
+             writeBytes((int64_t)layerStats[layerNumber].knotsInLayer *
+                            sizeof(CountArrayVarType),
+                        retroVars.countArrays[curLayerId]);
+        if (ok && (flags & 1))
+            ok = writeBytes(layerStats[layerNumber].sizeInBytes,
+                            layerStats[layerNumber].shortKnotValueByte);
+        if (ok && (flags & 2))
+            ok = writeBytes((int64_t)plyInfos[layerNumber].knotsInLayer *
+                                sizeof(PlyInfoVarType),
+                            plyInfos[layerNumber].plyInfo);
+    }
+
+    // queues, each preceded by its size
+    for (curPly = nextPlyNumber; ok && curPly < header.plyCount; curPly++) {
+        for (threadNo = 0; ok && threadNo < header.threadCount; threadNo++) {
+            RetroAnalysisThreadVars &threadVars = retroVars.thread[threadNo];
+            queue = curPly < threadVars.statesToProcess.size() ?
+                        threadVars.statesToProcess[curPly] :
+                        nullptr;
+            nBytes = queue != nullptr ? queue->getBytesToTake() : 0;
+            ok = writeBytes(sizeof(int64_t), &nBytes);
+            if (ok && nBytes) {
+                ok = queue->copyToFile(file, offset);
+                offset += nBytes;
+            }
+        }
+    }
+
+    ok = ok && file.sync();
+    file.close();
+
+    if (!ok) {
+        PRINT(0, this, "ERROR: Could not write " << tmpFilePath << "!");
+        std::remove(tmpFilePath.c_str());
+        return false;
+    }
+
+    // replaces the previous checkpoint at once
+    if (!replaceFile(tmpFilePath.c_str(),
+                     retroVars.checkpointFilePath.c_str())) {
+        PRINT(0, this, "ERROR: Could not rename " << tmpFilePath << "!");
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// getRetroCheckpointFilePath()
+// Returns the path of the checkpoint file of the retro analysis of the layers.
+//-----------------------------------------------------------------------------
+string MiniMax::getRetroCheckpointFilePath(const vector<uint32_t> &layersToCalc)
+{
+    stringstream ssPath;
+
+    ssPath << fileDir << (fileDir.size() ? "/" : "") << "checkpoint/checkpoint";
+    for (uint32_t layerNumber : layersToCalc)
+        ssPath << " " << layerNumber;
+    ssPath << ".dat";
+
+    return ssPath.str();
+}
+
+//-----------------------------------------------------------------------------
+// readRetroAnalysisCheckpointLayout()
+// Reads the header and the flags of the layer arrays of a checkpoint file and
+// checks whether the file belongs to the current calculation and is complete.
+//-----------------------------------------------------------------------------
+bool MiniMax::readRetroAnalysisCheckpointLayout(
+    retroAnalysisGlobalVars &retroVars, RandomAccessFile &file,
+    RetroCheckpointHeader &header, vector<uint32_t> &arrayFlags)
+{
+    // locals
+    vector<uint32_t> layers;
+    uint32_t curLayerId;
+    uint32_t layerNumber;
+    uint32_t curQueue;
+    int64_t offset;
+    int64_t nBytes;
+    const int64_t fileSize = file.getFileSize();
+
+    if (file.read(0, sizeof(RetroCheckpointHeader), &header) !=
+            sizeof(RetroCheckpointHeader) ||
+        header.headerCode != RETRO_CHECKPOINT_HEADER_CODE ||
+        header.layerCount != retroVars.layersToCalculate.size() ||
+        header.threadCount == 0 || header.nextPlyNumber > header.plyCount)
+        return false;
+
+    layers.resize(header.layerCount);
+    offset = sizeof(RetroCheckpointHeader);
+    if (file.read(offset, sizeof(uint32_t) * header.layerCount,
+                  layers.data()) != sizeof(uint32_t) * header.layerCount ||
+        layers != retroVars.layersToCalculate)
+        return false;
+    offset += sizeof(uint32_t) * header.layerCount;
+
+    arrayFlags.resize(header.layerCount);
+    for (curLayerId = 0; curLayerId < header.layerCount; curLayerId++) {
+        layerNumber = layers[curLayerId];
+        if (file.read(offset, sizeof(uint32_t), &arrayFlags[curLayerId]) !=
+                sizeof(uint32_t) ||
+            arrayFlags[curLayerId] > 3)
+            return false;
+        offset += sizeof(uint32_t) + (int64_t)layerStats[layerNumber]
+                                             .knotsInLayer *
+                                         sizeof(CountArrayVarType);
+        if (arrayFlags[curLayerId] & 1)
+            offset += layerStats[layerNumber].sizeInBytes;
+        if (arrayFlags[curLayerId] & 2)
+            offset += (int64_t)plyInfos[layerNumber].knotsInLayer *
+                      sizeof(PlyInfoVarType);
+    }
+
+    for (curQueue = 0; curQueue < (header.plyCount - header.nextPlyNumber) *
+                                      header.threadCount;
+         curQueue++) {
+        if (file.read(offset, sizeof(int64_t), &nBytes) != sizeof(int64_t) ||
+            nBytes < 0 || nBytes % sizeof(StateAdress))
+            return false;
+        offset += sizeof(int64_t) + nBytes;
+    }
+
+    return offset == fileSize;
+}
+
+//-----------------------------------------------------------------------------
+// loadRetroAnalysisCheckpoint()
+// Replaces the arrays and the queues prepared for the iteration by those of
+// the checkpoint file, if there is a complete one. Returns false only if the
+// file could not be read after the arrays had been modified.
+//-----------------------------------------------------------------------------
+bool MiniMax::loadRetroAnalysisCheckpoint(retroAnalysisGlobalVars &retroVars)
+{
+    // locals
+    RandomAccessFile file;
+    RetroCheckpointHeader header;
+    vector<uint32_t> arrayFlags;
+    vector<StateAdress> states(BLOCK_SIZE_IN_CYCLIC_ARRAY);
+    uint32_t curLayerId;
+    uint32_t layerNumber;
+    uint32_t threadNo;
+    uint32_t curPly;
+    uint32_t curState;
+    uint32_t nStates;
+    int64_t offset;
+    int64_t nBytes;
+    bool ok = true;
+
+    // reads large arrays in parts
+    auto readBytes = [&](int64_t n, void *p) {
+        unsigned char *pBytes = (unsigned char *)p;
+        while (n > 0) {
+            const uint32_t part = (uint32_t)std::min(n, (int64_t)1 << 26);
+            if (file.read(offset, part, pBytes) != part)
+                return false;
+            offset += part;
+            pBytes += part;
+            n -= part;
+        }
+        return true;
+    };
+
+    if (!pathExists(retroVars.checkpointFilePath.c_str()) ||
+        !file.open(retroVars.checkpointFilePath.c_str()))
+        return true;
+
+    if (!readRetroAnalysisCheckpointLayout(retroVars, file, header,
+                                           arrayFlags)) {
+        PRINT(1, this,
+              "  Ignore invalid checkpoint: " << retroVars.checkpointFilePath);
+        file.close();
+        std::remove(retroVars.checkpointFilePath.c_str());
+        return true;
+    }
+
+    PRINT(1, this,
+          "  Continue at ply number " << header.nextPlyNumber
+                                      << " from checkpoint: "
+                                      << retroVars.checkpointFilePath);
+
+    // arrays of each layer
+    offset = sizeof(RetroCheckpointHeader) +
+             sizeof(uint32_t) * header.layerCount;
+    for (curLayerId = 0; ok && curLayerId < header.layerCount; curLayerId++) {
+        layerNumber = retroVars.layersToCalculate[curLayerId];
+        offset += sizeof(uint32_t);
+        ok = readBytes((int64_t)layerStats[layerNumber].knotsInLayer *
+                           sizeof(CountArrayVarType),
+                       retroVars.countArrays[curLayerId]);
+
+        // saving a default value brings the array into memory
+        if (ok && (arrayFlags[curLayerId] & 1)) {
+            if (!layerStats[layerNumber].layerIsLoaded)
+                saveKnotValueInDatabase(layerNumber, 0, SKV_VALUE_INVALID);
+            ok = layerStats[layerNumber].shortKnotValueByte != nullptr &&
+                 readBytes(layerStats[layerNumber].sizeInBytes,
+                           layerStats[layerNumber].shortKnotValueByte);
+        }
+        if (ok && (arrayFlags[curLayerId] & 2)) {
+            if (!plyInfos[layerNumber].plyInfoIsLoaded)
+                savePlyInfoInDatabase(layerNumber, 0,
+                                      PLYINFO_VALUE_UNCALCULATED);
+            ok = plyInfos[layerNumber].plyInfo != nullptr &&
+                 readBytes((int64_t)plyInfos[layerNumber].knotsInLayer *
+                               sizeof(PlyInfoVarType),
+                           plyInfos[layerNumber].plyInfo);
+        }
+    }
+
+    if (!ok) {
+        PRINT(0, this,
+              "ERROR: Could not read " << retroVars.checkpointFilePath << "!");
+        return falseOrStop();
+    }
+
+    // the queues filled by the initialization are replaced. all threads get
+    // the same number of queues
+    for (threadNo = 0; threadNo < getThreadManager().getThreadCount();
+         threadNo++) {
+        RetroAnalysisThreadVars &threadVars = retroVars.thread[threadNo];
+        for (curPly = 0; curPly < threadVars.statesToProcess.size(); curPly++)
+            SAFE_DELETE(threadVars.statesToProcess[curPly]);
+        threadVars.statesToProcess.resize(
+            std::max((size_t)header.plyCount,
+                     threadVars.statesToProcess.size()),
+            nullptr);
+        threadVars.stateToProcessCount = 0;
+    }
+
+    // the states of thread t go to thread t modulo the current thread count
+    for (curPly = header.nextPlyNumber; curPly < header.plyCount; curPly++) {
+        for (threadNo = 0; threadNo < header.threadCount; threadNo++) {
+            RetroAnalysisThreadVars &threadVars =
+                retroVars
+                    .thread[threadNo % getThreadManager().getThreadCount()];
+            if (!readBytes(sizeof(int64_t), &nBytes))
+                return falseOrStop();
+            while (nBytes > 0) {
+                nStates = (uint32_t)std::min(
+                    nBytes / (int64_t)sizeof(StateAdress),
+                    (int64_t)states.size());
+                if (!readBytes(nStates * sizeof(StateAdress), states.data()))
+                    return falseOrStop();
+                for (curState = 0; curState < nStates; curState++) {
+                    if (!addStateToProcessQueue(retroVars, threadVars, curPly,
+                                                &states[curState]))
+                        return false;
+                }
+                nBytes -= nStates * sizeof(StateAdress);
+            }
+        }
+    }
+
+    retroVars.firstPlyNumber = header.nextPlyNumber;
+
+    return true;
+}
+
 #endif // MADWEASEL_MUEHLE_PERFECT_AI
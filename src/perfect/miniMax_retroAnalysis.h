@@ -70,7 +70,7 @@ struct InitRetroAnalysisVars
     MiniMax *pMiniMax {nullptr};
     uint32_t curThreadNo {0};
     uint32_t layerNumber {0};
-    LONGLONG statesProcessed {0};
+    int64_t statesProcessed {0};
     uint32_t statsValueCounter[SKV_VALUE_COUNT] {0};
     BufferedFile *bufferedFile {nullptr};
     RetroAnalysisVars *retroVars {nullptr};
@@ -100,7 +100,7 @@ struct AddNumSucceedersVars
     MiniMax *pMiniMax {nullptr};
     uint32_t curThreadNo {0};
     uint32_t layerNumber {0};
-    LONGLONG statesProcessed {0};
+    int64_t statesProcessed {0};
     RetroAnalysisVars *retroVars {nullptr};
     RetroAnalysisPredVars *predVars {nullptr};
 };
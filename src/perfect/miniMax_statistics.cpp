@@ -11,6 +11,7 @@
 #ifdef MADWEASEL_MUEHLE_PERFECT_AI
 
 #include "miniMax.h"
+#include <fstream>
 
 //-----------------------------------------------------------------------------
 // showMemoryStatus()
@@ -21,6 +22,63 @@ uint32_t MiniMax::getThreadCount()
     return threadManager.getThreadCount();
 }
 
+//-----------------------------------------------------------------------------
+// getThreadSlot()
+// Returns the index of the per thread variables of the derived class, which
+// thread 'threadNo' of the current layer uses. The layers calculated at the
+// same time use different ones.
+//-----------------------------------------------------------------------------
+uint32_t MiniMax::getThreadSlot(uint32_t threadNo)
+{
+    return getThreadManager().getThreadSlot(threadNo);
+}
+
+//-----------------------------------------------------------------------------
+// getThreadManager()
+// Returns the threads calculating the layer of the calling thread.
+//-----------------------------------------------------------------------------
+ThreadManager &MiniMax::getThreadManager()
+{
+    ThreadManager *threads = ThreadManager::getThreadManagerOfThisThread();
+
+    return threads != nullptr ? *threads : threadManager;
+}
+
+//-----------------------------------------------------------------------------
+// showCacheStats()
+//
+//-----------------------------------------------------------------------------
+void MiniMax::showCacheStats()
+{
+    const int64_t nHits = cacheHits;
+    const int64_t nMisses = cacheMisses;
+    int64_t memoryUsed;
+
+    // the prefetch thread might be loading a layer
+    {
+        std::lock_guard<std::mutex> lockDatabase(csDatabase);
+        memoryUsed = memoryUsed2;
+    }
+
+    PRINT(1, this, "LAYER CACHE");
+    PRINT(1, this, " memory budget: " << memoryBudget << " bytes");
+    PRINT(1, this, " memory used  : " << memoryUsed << " bytes");
+    PRINT(1, this, " hits         : " << nHits);
+    PRINT(1, this, " misses       : " << nMisses);
+    PRINT(1, this, " evictions    : " << cacheEvictions);
+    PRINT(1, this, " prefetched   : " << prefetchedLayers << " layers");
+    PRINT(1, this,
+          " hit rate     : "
+              << (nHits + nMisses ? 100.0 * nHits / (nHits + nMisses) : 0.0)
+              << " %");
+
+    if (skvFileIsCompressed) {
+        PRINT(1, this, "BLOCK CACHE");
+        PRINT(1, this, " hits         : " << blockCacheHits);
+        PRINT(1, this, " misses       : " << blockCacheMisses);
+    }
+}
+
 //-----------------------------------------------------------------------------
 // showLayerStats()
 //
@@ -71,8 +129,7 @@ void MiniMax::showLayerStats(uint32_t layerNumber)
 bool MiniMax::calcLayerStatistics(char *statisticsFileName)
 {
     // locals
-    HANDLE statFile;
-    DWORD dwBytesWritten;
+    std::ofstream statFile;
     StateAdress curState;
     uint32_t *statsValueCounter;
     TwoBit curStateValue;
@@ -80,17 +137,14 @@ bool MiniMax::calcLayerStatistics(char *statisticsFileName)
     string text("");
 
     // database must be open
-    if (hFileShortKnotValues == nullptr)
+    if (!skvFile.isOpen())
         return false;
 
     // Open statistics file
-    statFile = CreateFileA(statisticsFileName, GENERIC_WRITE,
-                           FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
-                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    statFile.open(statisticsFileName, std::ios::out | std::ios::binary);
 
     // opened file successfully?
-    if (statFile == INVALID_HANDLE_VALUE) {
-        statFile = nullptr;
+    if (!statFile.is_open()) {
         return false;
     }
 
@@ -144,8 +198,8 @@ bool MiniMax::calcLayerStatistics(char *statisticsFileName)
         }
 
         // add line
-        sprintf_s(
-            line, "%d\t%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
+        snprintf(
+            line, sizeof(line), "%d\t%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
             curState.layerNumber, getOutputInfo(curState.layerNumber).c_str(),
             statsValueCounter[4 * curState.layerNumber + SKV_VALUE_GAME_WON],
             statsValueCounter[4 * curState.layerNumber + SKV_VALUE_GAME_LOST],
@@ -161,9 +215,8 @@ bool MiniMax::calcLayerStatistics(char *statisticsFileName)
     }
 
     // write to file and close it
-    WriteFile(statFile, text.c_str(), (DWORD)text.length(), &dwBytesWritten,
-              nullptr);
-    CloseHandle(statFile);
+    statFile.write(text.c_str(), text.length());
+    statFile.close();
     SAFE_DELETE_ARRAY(statsValueCounter);
     return true;
 }
@@ -177,7 +230,7 @@ void MiniMax::ArrayInfoContainer::addArray(uint32_t layerNumber, uint32_t type,
                                            int64_t size, int64_t compressedSize)
 {
     // create new info object and add to list
-    EnterCriticalSection(&c->csOsPrint);
+    std::lock_guard<std::mutex> lockOsPrint(c->csOsPrint);
 
     ArrayInfo ais;
     ais.belongsToLayer = layerNumber;
@@ -201,8 +254,6 @@ void MiniMax::ArrayInfoContainer::addArray(uint32_t layerNumber, uint32_t type,
     if (c->userPrintFunc != nullptr) {
         c->userPrintFunc(c->pDataForUserPrintFunc);
     }
-
-    LeaveCriticalSection(&c->csOsPrint);
 }
 
 //-----------------------------------------------------------------------------
@@ -214,7 +265,7 @@ void MiniMax::ArrayInfoContainer::removeArray(uint32_t layerNumber,
                                               int64_t compressedSize)
 {
     // find info object in list
-    EnterCriticalSection(&c->csOsPrint);
+    std::lock_guard<std::mutex> lockOsPrint(c->csOsPrint);
 
     if (vectorArrays.size() > layerNumber * ArrayInfo::arrayTypeCount + type) {
         list<ArrayInfo>::iterator itr =
@@ -242,8 +293,6 @@ void MiniMax::ArrayInfoContainer::removeArray(uint32_t layerNumber,
     if (c->userPrintFunc != nullptr) {
         c->userPrintFunc(c->pDataForUserPrintFunc);
     }
-
-    LeaveCriticalSection(&c->csOsPrint);
 }
 
 #endif // MADWEASEL_MUEHLE_PERFECT_AI
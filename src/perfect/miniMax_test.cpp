@@ -21,9 +21,10 @@ bool MiniMax::testLayer(uint32_t layerNumber)
     // Locals
     uint32_t curThreadNo;
     uint32_t returnValue;
+    std::atomic<int64_t> stateProcessedCount {0};
 
     // database open?
-    if (hFileShortKnotValues == nullptr || hFilePlyInfo == nullptr) {
+    if (!skvFile.isOpen() || !plyInfoFile.isOpen()) {
         PRINT(0, this, "ERROR: Database file not open!");
         return falseOrStop();
     }
@@ -36,19 +37,20 @@ bool MiniMax::testLayer(uint32_t layerNumber)
     // prepare params for multithreading
     skvfHeader.completed = false;
     layerInDatabase = false;
-    stateProcessedCount = 0;
     curCalculatedLayer = layerNumber;
     curCalcActionId = MM_ACTION_TESTING_LAYER;
-    TestLayersVars *tlVars = new TestLayersVars[threadManager.getThreadCount()];
+    TestLayersVars *tlVars =
+        new TestLayersVars[getThreadManager().getThreadCount()];
     std::memset(tlVars, 0,
-                sizeof(TestLayersVars) * threadManager.getThreadCount());
+                sizeof(TestLayersVars) * getThreadManager().getThreadCount());
 
-    for (curThreadNo = 0; curThreadNo < threadManager.getThreadCount();
+    for (curThreadNo = 0; curThreadNo < getThreadManager().getThreadCount();
          curThreadNo++) {
         tlVars[curThreadNo].curThreadNo = curThreadNo;
         tlVars[curThreadNo].pMiniMax = this;
         tlVars[curThreadNo].layerNumber = layerNumber;
         tlVars[curThreadNo].statesProcessed = 0;
+        tlVars[curThreadNo].stateProcessedCount = &stateProcessedCount;
         tlVars[curThreadNo].subValueInDatabase = new TwoBit[maxNumBranches];
         std::memset(tlVars[curThreadNo].subValueInDatabase, 0,
                     sizeof(TwoBit) * maxNumBranches);
@@ -61,15 +63,15 @@ bool MiniMax::testLayer(uint32_t layerNumber)
     }
 
     // process each state in the current layer
-    returnValue = threadManager.execParallelLoop(
+    returnValue = getThreadManager().execParallelLoop(
         testLayerThreadProc, (void *)tlVars, sizeof(TestLayersVars),
-        TM_SCHED_STATIC, 0, layerStats[layerNumber].knotsInLayer - 1, 1);
+        TM_SCHED_DYNAMIC, 0, layerStats[layerNumber].knotsInLayer - 1, 1);
     switch (returnValue) {
     case TM_RETVAL_OK:
     case TM_RETVAL_EXEC_CANCELLED:
         // reduce and delete thread specific data
         for (stateProcessedCount = 0, curThreadNo = 0;
-             curThreadNo < threadManager.getThreadCount(); curThreadNo++) {
+             curThreadNo < getThreadManager().getThreadCount(); curThreadNo++) {
             stateProcessedCount += tlVars[curThreadNo].statesProcessed;
             SAFE_DELETE_ARRAY(tlVars[curThreadNo].subValueInDatabase);
             SAFE_DELETE_ARRAY(tlVars[curThreadNo].hasCurPlayerChanged);
@@ -104,7 +106,7 @@ bool MiniMax::testLayer(uint32_t layerNumber)
 // testLayerThreadProc()
 //
 //-----------------------------------------------------------------------------
-DWORD MiniMax::testLayerThreadProc(void *pParam, unsigned index)
+uint32_t MiniMax::testLayerThreadProc(void *pParam, unsigned index)
 {
     // locals
     TestLayersVars *tlVars = (TestLayersVars *)pParam;
@@ -133,9 +135,9 @@ DWORD MiniMax::testLayerThreadProc(void *pParam, unsigned index)
     // output
     tlVars->statesProcessed++;
     if (tlVars->statesProcessed % OUTPUT_EVERY_N_STATES == 0) {
-        m->stateProcessedCount += OUTPUT_EVERY_N_STATES;
+        *tlVars->stateProcessedCount += OUTPUT_EVERY_N_STATES;
         PRINT(0, m,
-              m->stateProcessedCount << " states of "
+              *tlVars->stateProcessedCount << " states of "
                                      << m->layerStats[layerNumber].knotsInLayer
                                      << " tested");
     }
@@ -480,7 +482,7 @@ bool MiniMax::testIfSymStatesHaveSameValue(uint32_t layerNumber)
     uint32_t i;
 
     // database open?
-    if (hFileShortKnotValues == nullptr || hFilePlyInfo == nullptr) {
+    if (!skvFile.isOpen() || !plyInfoFile.isOpen()) {
         PRINT(0, this, "ERROR: Database files not open!");
         layerNumber = 0;
         goto errorInDatabase;
@@ -572,4 +574,173 @@ errorInDatabase:
     return falseOrStop();
 }
 
+//-----------------------------------------------------------------------------
+// testRetroAnalysisResume()
+// Calculates the next layers of the database by retro analysis three times:
+// without interruption, cancelled right after a checkpoint halfway through the
+// plies, and resumed from that checkpoint. The resumed run must give the same
+// knot values and ply infos as the first one, which are not saved. Layers,
+// whose retro analysis ends before it can be interrupted, are calculated and
+// saved like by calculateDatabase() before.
+//-----------------------------------------------------------------------------
+bool MiniMax::testRetroAnalysisResume()
+{
+    // Locals
+    vector<uint32_t> layersToCalc;
+    vector<vector<TwoBit>> refKnotValues;
+    vector<vector<PlyInfoVarType>> refPlyInfos;
+    vector<bool> layerCalculated;
+    PlyInfoVarType maxPlies;
+    string checkpointFilePath;
+    uint32_t layerNumber;
+    uint32_t i;
+    bool result = false;
+
+    prepareDatabaseCalc();
+
+    // database open?
+    if (!skvFile.isOpen() || !plyInfoFile.isOpen()) {
+        PRINT(0, this, "ERROR: Database files not open!");
+        wrapUpDatabaseCalc(true);
+        return falseOrStop();
+    }
+
+    onlyPrepareLayer = false;
+    layerInDatabase = false;
+    calcDatabase = true;
+    getThreadManager().uncancelExec();
+    arrayInfos.vectorArrays.resize(ArrayInfo::arrayTypeCount *
+                                       skvfHeader.LayerCount,
+                                   arrayInfos.listArrays.end());
+    layerCalculated.assign(skvfHeader.LayerCount, false);
+
+    // uninterrupted run of the next layers
+    for (;;) {
+        layerNumber = getNextLayerToCalc(layerCalculated, {});
+
+        if (skvfHeader.completed || layerNumber >= skvfHeader.LayerCount) {
+            PRINT(0, this, "No layers left to test the resumption of the "
+                           "retro analysis on.");
+            result = true;
+            goto freeMem;
+        }
+
+        curCalculatedLayer = layerNumber;
+        maxPlies = 0;
+
+        if (shallRetroAnalysisBeUsed(layerNumber)) {
+            layersToCalc.assign(1, layerNumber);
+            if (layerNumber != layerStats[layerNumber].partnerLayer)
+                layersToCalc.push_back(layerStats[layerNumber].partnerLayer);
+
+            if (!calcKnotValuesByRetroAnalysis(layersToCalc)) {
+                PRINT(0, this, "ERROR: Retro analysis failed!");
+                goto freeMem;
+            }
+
+            refKnotValues.assign(layersToCalc.size(), vector<TwoBit>());
+            refPlyInfos.assign(layersToCalc.size(), vector<PlyInfoVarType>());
+
+            for (i = 0; i < layersToCalc.size(); i++) {
+                const LayerStats &lss = layerStats[layersToCalc[i]];
+                const PlyInfo &pis = plyInfos[layersToCalc[i]];
+
+                if (lss.layerIsLoaded)
+                    refKnotValues[i].assign(lss.shortKnotValueByte,
+                                            lss.shortKnotValueByte +
+                                                lss.sizeInBytes);
+
+                if (pis.plyInfoIsLoaded)
+                    refPlyInfos[i].assign(pis.plyInfo,
+                                          pis.plyInfo + pis.knotsInLayer);
+
+                for (PlyInfoVarType plies : refPlyInfos[i]) {
+                    if (plies < PLYINFO_VALUE_DRAWN)
+                        maxPlies = std::max(maxPlies, plies);
+                }
+            }
+
+            unloadAllLayers();
+            unloadAllPlyInfos();
+
+            // states are left after the first ply number
+            if (maxPlies > 0)
+                break;
+        }
+
+        if (!calcLayer(layerNumber)) {
+            PRINT(0, this, "ERROR: Layer calculation failed!");
+            goto freeMem;
+        }
+
+        unloadAllLayers();
+        unloadAllPlyInfos();
+        saveHeader(&skvfHeader, layerStats);
+        saveHeader(&plyInfoHeader, plyInfos);
+        layerCalculated[layerNumber] = true;
+    }
+
+    PRINT(1, this,
+          endl << "*** Test resuming the retro analysis of layer: "
+               << layerNumber << " ***");
+
+    // run cancelled after the checkpoint
+    checkpointFilePath = getRetroCheckpointFilePath(layersToCalc);
+    retroAnalysisStopPly = maxPlies / 2;
+    if (calcKnotValuesByRetroAnalysis(layersToCalc) ||
+        !pathExists(checkpointFilePath.c_str())) {
+        PRINT(0, this,
+              "ERROR: Retro analysis not interrupted at ply number "
+                  << retroAnalysisStopPly << "!");
+        goto freeMem;
+    }
+
+    retroAnalysisStopPly = -1;
+    getThreadManager().uncancelExec();
+    unloadAllLayers();
+    unloadAllPlyInfos();
+
+    // resumed run
+    if (!calcKnotValuesByRetroAnalysis(layersToCalc) ||
+        pathExists(checkpointFilePath.c_str())) {
+        PRINT(0, this, "ERROR: Retro analysis not resumed!");
+        goto freeMem;
+    }
+
+    for (i = 0; i < layersToCalc.size(); i++) {
+        const LayerStats &lss = layerStats[layersToCalc[i]];
+        const PlyInfo &pis = plyInfos[layersToCalc[i]];
+
+        if (refKnotValues[i].size() !=
+                (lss.layerIsLoaded ? lss.sizeInBytes : 0) ||
+            !std::equal(refKnotValues[i].begin(), refKnotValues[i].end(),
+                        lss.shortKnotValueByte) ||
+            refPlyInfos[i].size() !=
+                (pis.plyInfoIsLoaded ? pis.knotsInLayer : 0) ||
+            !std::equal(refPlyInfos[i].begin(), refPlyInfos[i].end(),
+                        pis.plyInfo)) {
+            PRINT(0, this,
+                  "ERROR: Resumed layer " << layersToCalc[i]
+                                          << " differs from the uninterrupted "
+                                             "one!");
+            goto freeMem;
+        }
+    }
+
+    // layers are ok
+    PRINT(0, this, "TEST PASSED !");
+    result = true;
+
+freeMem:
+    retroAnalysisStopPly = -1;
+    getThreadManager().uncancelExec();
+    unloadAllLayers();
+    unloadAllPlyInfos();
+    calcDatabase = false;
+    curCalcActionId = MM_ACTION_NONE;
+    wrapUpDatabaseCalc(!result);
+
+    return result;
+}
+
 #endif // MADWEASEL_MUEHLE_PERFECT_AI
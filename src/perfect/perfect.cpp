@@ -11,6 +11,7 @@
 #ifdef MADWEASEL_MUEHLE_PERFECT_AI
 
 #include "misc.h"
+#include "option.h"
 #include "perfect.h"
 #include "position.h"
 
@@ -27,6 +28,7 @@ int perfect_init(void)
     mill = new Mill();
     ai = new PerfectAI(PERFECT_AI_DATABASE_DIR);
     ai->setDatabasePath(PERFECT_AI_DATABASE_DIR);
+    perfect_set_memory_budget();
     mill->beginNewGame(ai, ai, fieldStruct::playerOne);
 
     return 0;
@@ -58,6 +60,16 @@ int perfect_reset(void)
     return 0;
 }
 
+// Keeps the completed layers in memory up to the size of the
+// "PerfectDatabaseMemory" option
+void perfect_set_memory_budget(void)
+{
+    if (ai != nullptr) {
+        ai->setMemoryBudget((int64_t)gameOptions.getPerfectDatabaseMemory() *
+                            1024 * 1024);
+    }
+}
+
 Square from_perfect_sq(uint32_t sq)
 {
     Square map[] = {SQ_31, SQ_24, SQ_25, SQ_23, SQ_16, SQ_17, SQ_15,
@@ -20,6 +20,7 @@ extern PerfectAI *ai;
 int perfect_init(void);
 int perfect_exit(void);
 int perfect_reset(void);
+void perfect_set_memory_budget(void);
 Square from_perfect_sq(uint32_t sq);
 Move from_perfect_move(uint32_t from, uint32_t to);
 unsigned to_perfect_sq(Square sq);
@@ -12,6 +12,7 @@
 
 #include "perfectAI.h"
 #include <cassert>
+#include <fstream>
 
 // clang-format off
 uint32_t soTableTurnLeft[] = {
@@ -177,7 +178,7 @@ uint32_t soTableMirrorDiag2[] = {
 
 // define the four groups
 uint32_t squareIdxGroupA[] = {3, 5, 20, 18};
-uint32_t squareIdxGroupB[8] = {4, 13, 19, 10};
+uint32_t squareIdxGroupB[] = {4, 13, 19, 10};
 uint32_t squareIdxGroupC[] = {0, 2, 23, 21, 6, 8, 17, 15};
 uint32_t squareIdxGroupD[] = {1, 7, 14, 12, 22, 16, 9, 11};
 
@@ -204,9 +205,7 @@ PerfectAI::PerfectAI(const char *dir)
     uint32_t myField[SQUARE_NB] {};
     uint32_t symField[SQUARE_NB];
     uint32_t *origStateCD_tmp[10][10] {};
-    DWORD dwBytesRead = 0;
-    DWORD dwBytesWritten = 0;
-    HANDLE hFilePreCalcVars;
+    std::fstream preCalcVarsFile;
     stringstream ssPreCalcVarsFilePath;
     PreCalcedVarsFileHeader preCalcVarsHeader;
 
@@ -230,85 +229,74 @@ PerfectAI::PerfectAI(const char *dir)
     }
 
     // Open File, which contains the precalculated vars
-    if (strlen(dir) && PathFileExistsA(dir)) {
-        ssPreCalcVarsFilePath << dir << "\\";
+    if (strlen(dir) && pathExists(dir)) {
+        ssPreCalcVarsFilePath << dir << "/";
     }
 
     ssPreCalcVarsFilePath << "preCalculatedVars.dat";
-    hFilePreCalcVars = CreateFileA(ssPreCalcVarsFilePath.str().c_str(),
-                                   GENERIC_READ /*| GENERIC_WRITE*/,
-                                   FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
-                                   OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (!ReadFile(hFilePreCalcVars, &preCalcVarsHeader,
-                  sizeof(PreCalcedVarsFileHeader), &dwBytesRead, nullptr))
-        return;
+    preCalcVarsFile.open(ssPreCalcVarsFilePath.str(),
+                         std::ios::in | std::ios::binary);
 
     // vars already stored in file?
-    if (dwBytesRead) {
+    if (preCalcVarsFile.read((char *)&preCalcVarsHeader,
+                             sizeof(PreCalcedVarsFileHeader))) {
         // Read from file
-        if (!ReadFile(hFilePreCalcVars, layer, sizeof(Layer) * LAYER_COUNT,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)layer, sizeof(Layer) * LAYER_COUNT))
             return;
-        if (!ReadFile(hFilePreCalcVars, layerIndex,
-                      sizeof(uint32_t) * 2 * PIECE_PER_PLAYER_PLUS_ONE_COUNT *
-                          PIECE_PER_PLAYER_PLUS_ONE_COUNT,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)layerIndex,
+                                  sizeof(uint32_t) * 2 *
+                                      PIECE_PER_PLAYER_PLUS_ONE_COUNT *
+                                      PIECE_PER_PLAYER_PLUS_ONE_COUNT))
             return;
-        if (!ReadFile(hFilePreCalcVars, nPositionsAB,
-                      sizeof(uint32_t) * PIECE_PER_PLAYER_PLUS_ONE_COUNT *
-                          PIECE_PER_PLAYER_PLUS_ONE_COUNT,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)nPositionsAB,
+                                  sizeof(uint32_t) *
+                                      PIECE_PER_PLAYER_PLUS_ONE_COUNT *
+                                      PIECE_PER_PLAYER_PLUS_ONE_COUNT))
             return;
-        if (!ReadFile(hFilePreCalcVars, nPositionsCD,
-                      sizeof(uint32_t) * PIECE_PER_PLAYER_PLUS_ONE_COUNT *
-                          PIECE_PER_PLAYER_PLUS_ONE_COUNT,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)nPositionsCD,
+                                  sizeof(uint32_t) *
+                                      PIECE_PER_PLAYER_PLUS_ONE_COUNT *
+                                      PIECE_PER_PLAYER_PLUS_ONE_COUNT))
             return;
-        if (!ReadFile(hFilePreCalcVars, indexAB,
-                      sizeof(uint32_t) * MAX_ANZ_POSITION_A *
-                          MAX_ANZ_POSITION_B,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)indexAB,
+                                  sizeof(uint32_t) * MAX_ANZ_POSITION_A *
+                                      MAX_ANZ_POSITION_B))
             return;
-        if (!ReadFile(hFilePreCalcVars, indexCD,
-                      sizeof(uint32_t) * MAX_ANZ_POSITION_C *
-                          MAX_ANZ_POSITION_D,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)indexCD,
+                                  sizeof(uint32_t) * MAX_ANZ_POSITION_C *
+                                      MAX_ANZ_POSITION_D))
             return;
-        if (!ReadFile(hFilePreCalcVars, symOpCD,
-                      sizeof(unsigned char) * MAX_ANZ_POSITION_C *
-                          MAX_ANZ_POSITION_D,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)symOpCD,
+                                  sizeof(unsigned char) * MAX_ANZ_POSITION_C *
+                                      MAX_ANZ_POSITION_D))
             return;
-        if (!ReadFile(hFilePreCalcVars, powerOfThree,
-                      sizeof(uint32_t) * (nSquaresGroupC + nSquaresGroupD),
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)powerOfThree,
+                                  sizeof(uint32_t) *
+                                      (nSquaresGroupC + nSquaresGroupD)))
             return;
-        if (!ReadFile(hFilePreCalcVars, symOpTable,
-                      sizeof(uint32_t) * SQUARE_NB * SO_COUNT, &dwBytesRead,
-                      nullptr))
+        if (!preCalcVarsFile.read((char *)symOpTable,
+                                  sizeof(uint32_t) * SQUARE_NB * SO_COUNT))
             return;
-        if (!ReadFile(hFilePreCalcVars, reverseSymOp,
-                      sizeof(uint32_t) * SO_COUNT, &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)reverseSymOp,
+                                  sizeof(uint32_t) * SO_COUNT))
             return;
-        if (!ReadFile(hFilePreCalcVars, concSymOp,
-                      sizeof(uint32_t) * SO_COUNT * SO_COUNT, &dwBytesRead,
-                      nullptr))
+        if (!preCalcVarsFile.read((char *)concSymOp,
+                                  sizeof(uint32_t) * SO_COUNT * SO_COUNT))
             return;
-        if (!ReadFile(hFilePreCalcVars, mOverN,
-                      sizeof(uint32_t) * (SQUARE_NB + 1) * (SQUARE_NB + 1),
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)mOverN,
+                                  sizeof(uint32_t) * (SQUARE_NB + 1) *
+                                      (SQUARE_NB + 1)))
             return;
-        if (!ReadFile(hFilePreCalcVars, moveValue,
-                      sizeof(unsigned char) * SQUARE_NB * SQUARE_NB,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)moveValue,
+                                  sizeof(unsigned char) * SQUARE_NB *
+                                      SQUARE_NB))
             return;
-        if (!ReadFile(hFilePreCalcVars, plyInfoForOutput,
-                      sizeof(PlyInfoVarType) * SQUARE_NB * SQUARE_NB,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)plyInfoForOutput,
+                                  sizeof(PlyInfoVarType) * SQUARE_NB *
+                                      SQUARE_NB))
             return;
-        if (!ReadFile(hFilePreCalcVars, incidencesValuesSubMoves,
-                      sizeof(uint32_t) * 4 * SQUARE_NB * SQUARE_NB,
-                      &dwBytesRead, nullptr))
+        if (!preCalcVarsFile.read((char *)incidencesValuesSubMoves,
+                                  sizeof(uint32_t) * 4 * SQUARE_NB * SQUARE_NB))
             return;
 
         // process origStateAB[][]
@@ -321,9 +309,9 @@ PerfectAI::PerfectAI(const char *dir)
                 std::memset(origStateAB[a][b], 0,
                             sizeof(uint32_t) * MAX_ANZ_POSITION_A *
                                 MAX_ANZ_POSITION_B);
-                if (!ReadFile(hFilePreCalcVars, origStateAB[a][b],
-                              sizeof(uint32_t) * nPositionsAB[a][b],
-                              &dwBytesRead, nullptr))
+                if (!preCalcVarsFile.read((char *)origStateAB[a][b],
+                                          sizeof(uint32_t) *
+                                              nPositionsAB[a][b]))
                     return;
             }
         }
@@ -334,13 +322,15 @@ PerfectAI::PerfectAI(const char *dir)
                 if (a + b > nSquaresGroupC + nSquaresGroupD)
                     continue;
                 origStateCD[a][b] =
-                    new uint32_t[MAX_ANZ_POSITION_A * MAX_ANZ_POSITION_B];
+                    new uint32_t[mOverN[nSquaresGroupC + nSquaresGroupD][a] *
+                                 mOverN[nSquaresGroupC + nSquaresGroupD - a][b]];
                 std::memset(origStateCD[a][b], 0,
-                            sizeof(uint32_t) * MAX_ANZ_POSITION_A *
-                                MAX_ANZ_POSITION_B);
-                if (!ReadFile(hFilePreCalcVars, origStateCD[a][b],
-                              sizeof(uint32_t) * nPositionsCD[a][b],
-                              &dwBytesRead, nullptr))
+                            sizeof(uint32_t) *
+                                mOverN[nSquaresGroupC + nSquaresGroupD][a] *
+                                mOverN[nSquaresGroupC + nSquaresGroupD - a][b]);
+                if (!preCalcVarsFile.read((char *)origStateCD[a][b],
+                                          sizeof(uint32_t) *
+                                              nPositionsCD[a][b]))
                     return;
             }
         }
@@ -470,10 +460,10 @@ PerfectAI::PerfectAI(const char *dir)
                 myField[squareIdxGroupA[1]] = (stateAB / powerOfThree[6]) % 3;
                 myField[squareIdxGroupA[2]] = (stateAB / powerOfThree[5]) % 3;
                 myField[squareIdxGroupA[3]] = (stateAB / powerOfThree[4]) % 3;
-                myField[squareIdxGroupB[4]] = (stateAB / powerOfThree[3]) % 3;
-                myField[squareIdxGroupB[5]] = (stateAB / powerOfThree[2]) % 3;
-                myField[squareIdxGroupB[6]] = (stateAB / powerOfThree[1]) % 3;
-                myField[squareIdxGroupB[7]] = (stateAB / powerOfThree[0]) % 3;
+                myField[squareIdxGroupB[0]] = (stateAB / powerOfThree[3]) % 3;
+                myField[squareIdxGroupB[1]] = (stateAB / powerOfThree[2]) % 3;
+                myField[squareIdxGroupB[2]] = (stateAB / powerOfThree[1]) % 3;
+                myField[squareIdxGroupB[3]] = (stateAB / powerOfThree[0]) % 3;
 
                 // count black and white pieces
                 for (a = 0, i = 0; i < SQUARE_NB; i++)
@@ -792,66 +782,63 @@ PerfectAI::PerfectAI(const char *dir)
         }
 
         // write vars into file
+        preCalcVarsFile.close();
+        preCalcVarsFile.clear();
+        preCalcVarsFile.open(ssPreCalcVarsFilePath.str(), std::ios::out |
+                                                              std::ios::binary |
+                                                              std::ios::trunc);
         preCalcVarsHeader.sizeInBytes = sizeof(PreCalcedVarsFileHeader);
 
-        WriteFile(hFilePreCalcVars, &preCalcVarsHeader,
-                  preCalcVarsHeader.sizeInBytes, &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, layer, sizeof(Layer) * LAYER_COUNT,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, layerIndex,
-                  sizeof(uint32_t) * 2 * PIECE_PER_PLAYER_PLUS_ONE_COUNT *
-                      PIECE_PER_PLAYER_PLUS_ONE_COUNT,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, nPositionsAB,
-                  sizeof(uint32_t) * PIECE_PER_PLAYER_PLUS_ONE_COUNT *
-                      PIECE_PER_PLAYER_PLUS_ONE_COUNT,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, nPositionsCD,
-                  sizeof(uint32_t) * PIECE_PER_PLAYER_PLUS_ONE_COUNT *
-                      PIECE_PER_PLAYER_PLUS_ONE_COUNT,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, indexAB,
-                  sizeof(uint32_t) * MAX_ANZ_POSITION_A * MAX_ANZ_POSITION_B,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, indexCD,
-                  sizeof(uint32_t) * MAX_ANZ_POSITION_C * MAX_ANZ_POSITION_D,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, symOpCD,
-                  sizeof(unsigned char) * MAX_ANZ_POSITION_C *
-                      MAX_ANZ_POSITION_D,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, powerOfThree,
-                  sizeof(uint32_t) * (nSquaresGroupC + nSquaresGroupD),
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, symOpTable,
-                  sizeof(uint32_t) * SQUARE_NB * SO_COUNT, &dwBytesWritten,
-                  nullptr);
-        WriteFile(hFilePreCalcVars, reverseSymOp, sizeof(uint32_t) * SO_COUNT,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, concSymOp,
-                  sizeof(uint32_t) * SO_COUNT * SO_COUNT, &dwBytesWritten,
-                  nullptr);
-        WriteFile(hFilePreCalcVars, mOverN,
-                  sizeof(uint32_t) * (SQUARE_NB + 1) * (SQUARE_NB + 1),
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, moveValue,
-                  sizeof(unsigned char) * SQUARE_NB * SQUARE_NB,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, plyInfoForOutput,
-                  sizeof(PlyInfoVarType) * SQUARE_NB * SQUARE_NB,
-                  &dwBytesWritten, nullptr);
-        WriteFile(hFilePreCalcVars, incidencesValuesSubMoves,
-                  sizeof(uint32_t) * 4 * SQUARE_NB * SQUARE_NB, &dwBytesWritten,
-                  nullptr);
+        preCalcVarsFile.write((const char *)&preCalcVarsHeader,
+                              preCalcVarsHeader.sizeInBytes);
+        preCalcVarsFile.write((const char *)layer, sizeof(Layer) * LAYER_COUNT);
+        preCalcVarsFile.write((const char *)layerIndex,
+                              sizeof(uint32_t) * 2 *
+                                  PIECE_PER_PLAYER_PLUS_ONE_COUNT *
+                                  PIECE_PER_PLAYER_PLUS_ONE_COUNT);
+        preCalcVarsFile.write((const char *)nPositionsAB,
+                              sizeof(uint32_t) *
+                                  PIECE_PER_PLAYER_PLUS_ONE_COUNT *
+                                  PIECE_PER_PLAYER_PLUS_ONE_COUNT);
+        preCalcVarsFile.write((const char *)nPositionsCD,
+                              sizeof(uint32_t) *
+                                  PIECE_PER_PLAYER_PLUS_ONE_COUNT *
+                                  PIECE_PER_PLAYER_PLUS_ONE_COUNT);
+        preCalcVarsFile.write((const char *)indexAB,
+                              sizeof(uint32_t) * MAX_ANZ_POSITION_A *
+                                  MAX_ANZ_POSITION_B);
+        preCalcVarsFile.write((const char *)indexCD,
+                              sizeof(uint32_t) * MAX_ANZ_POSITION_C *
+                                  MAX_ANZ_POSITION_D);
+        preCalcVarsFile.write((const char *)symOpCD,
+                              sizeof(unsigned char) * MAX_ANZ_POSITION_C *
+                                  MAX_ANZ_POSITION_D);
+        preCalcVarsFile.write((const char *)powerOfThree,
+                              sizeof(uint32_t) *
+                                  (nSquaresGroupC + nSquaresGroupD));
+        preCalcVarsFile.write((const char *)symOpTable,
+                              sizeof(uint32_t) * SQUARE_NB * SO_COUNT);
+        preCalcVarsFile.write((const char *)reverseSymOp,
+                              sizeof(uint32_t) * SO_COUNT);
+        preCalcVarsFile.write((const char *)concSymOp,
+                              sizeof(uint32_t) * SO_COUNT * SO_COUNT);
+        preCalcVarsFile.write((const char *)mOverN,
+                              sizeof(uint32_t) * (SQUARE_NB + 1) *
+                                  (SQUARE_NB + 1));
+        preCalcVarsFile.write((const char *)moveValue,
+                              sizeof(unsigned char) * SQUARE_NB * SQUARE_NB);
+        preCalcVarsFile.write((const char *)plyInfoForOutput,
+                              sizeof(PlyInfoVarType) * SQUARE_NB * SQUARE_NB);
+        preCalcVarsFile.write((const char *)incidencesValuesSubMoves,
+                              sizeof(uint32_t) * 4 * SQUARE_NB * SQUARE_NB);
 
         // process origStateAB[][]
         for (a = 0; a <= PIECE_PER_PLAYER_COUNT; a++) {
             for (b = 0; b <= PIECE_PER_PLAYER_COUNT; b++) {
                 if (a + b > nSquaresGroupA + nSquaresGroupB)
                     continue;
-                WriteFile(hFilePreCalcVars, origStateAB[a][b],
-                          sizeof(uint32_t) * nPositionsAB[a][b],
-                          &dwBytesWritten, nullptr);
+                preCalcVarsFile.write((const char *)origStateAB[a][b],
+                                      sizeof(uint32_t) * nPositionsAB[a][b]);
             }
         }
 
@@ -860,15 +847,14 @@ PerfectAI::PerfectAI(const char *dir)
             for (b = 0; b <= PIECE_PER_PLAYER_COUNT; b++) {
                 if (a + b > nSquaresGroupC + nSquaresGroupD)
                     continue;
-                WriteFile(hFilePreCalcVars, origStateCD[a][b],
-                          sizeof(uint32_t) * nPositionsCD[a][b],
-                          &dwBytesWritten, nullptr);
+                preCalcVarsFile.write((const char *)origStateCD[a][b],
+                                      sizeof(uint32_t) * nPositionsCD[a][b]);
             }
         }
     }
 
     // Close File
-    CloseHandle(hFilePreCalcVars);
+    preCalcVarsFile.close();
 }
 
 //-----------------------------------------------------------------------------
@@ -1241,7 +1227,7 @@ uint32_t *PerfectAI::getPossibilities(uint32_t threadNo,
     uint32_t i;
 
     // set opponentsMove
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     *opponentsMove = (tv->field->curPlayer->id == tv->ownId) ? false : true;
 
     // count completed mills
@@ -1281,7 +1267,7 @@ uint32_t *PerfectAI::getPossibilities(uint32_t threadNo,
 void PerfectAI::getSituationValue(uint32_t threadNo, float &floatValue,
                                   TwoBit &shortValue)
 {
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     floatValue = tv->floatValue;
     shortValue = tv->shortValue;
 }
@@ -1300,7 +1286,7 @@ void PerfectAI::undo(uint32_t threadNo, uint32_t idPossibility,
                      bool opponentsMove, void *pBackup, void *pPossibilities)
 {
     // locals
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     Backup *oldState = (Backup *)pBackup;
 
     // reset old value
@@ -1544,7 +1530,7 @@ void PerfectAI::move(uint32_t threadNo, uint32_t idPossibility,
                      bool opponentsMove, void **pBackup, void *pPossibilities)
 {
     // locals
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     Backup *oldState = &tv->oldStates[tv->curSearchDepth];
     Possibility *tmpPossibility = (Possibility *)pPossibilities;
     Player *tmpPlayer;
@@ -1635,7 +1621,7 @@ void PerfectAI::storeMoveValue(uint32_t threadNo, uint32_t idPossibility,
                                PlyInfoVarType plyInfo)
 {
     // locals
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     uint32_t i;
     Possibility *tmpPossibility = (Possibility *)pPossibilities;
 
@@ -1667,7 +1653,7 @@ void PerfectAI::printMoveInfo(uint32_t threadNo, uint32_t idPossibility,
                               void *pPossibilities)
 {
     // locals
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     Possibility *tmpPossibility = (Possibility *)pPossibilities;
 
     // move
@@ -1781,7 +1767,7 @@ void PerfectAI::applySymOpOnField(unsigned char symOpNumber,
 //-----------------------------------------------------------------------------
 uint32_t PerfectAI::getLayerNumber(uint32_t threadNo)
 {
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     uint32_t blackPieceCount = tv->field->oppPlayer->pieceCount;
     uint32_t whitePieceCount = tv->field->curPlayer->pieceCount;
     uint32_t phaseIndex = (tv->field->isPlacingPhase == true) ?
@@ -1798,7 +1784,7 @@ uint32_t PerfectAI::getLayerAndStateNumber(uint32_t threadNo,
                                            uint32_t &layerNum,
                                            uint32_t &stateNumber)
 {
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     return tv->getLayerAndStateNumber(layerNum, stateNumber);
 }
 
@@ -1904,7 +1890,7 @@ bool PerfectAI::setSituation(uint32_t threadNo, uint32_t layerNum,
         return false;
 
     // locals
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     uint32_t stateNumberWithInSubLayer;
     uint32_t stateNumberWithInAB;
     uint32_t stateNumberWithInCD;
@@ -2162,7 +2148,7 @@ string PerfectAI::getOutputInfo(uint32_t layerNum)
 //-----------------------------------------------------------------------------
 void PerfectAI::printBoard(uint32_t threadNo, unsigned char value)
 {
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     char wonStr[] = "WON";
     char lostStr[] = "LOST";
     char drawStr[] = "DRAW";
@@ -2191,7 +2177,7 @@ void PerfectAI::getLayerAndStateNumber(
 //-----------------------------------------------------------------------------
 void PerfectAI::setOpponentLevel(uint32_t threadNo, bool isOpponentLevel)
 {
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     tv->ownId = isOpponentLevel ? tv->field->oppPlayer->id :
                                   tv->field->curPlayer->id;
 }
@@ -2202,7 +2188,7 @@ void PerfectAI::setOpponentLevel(uint32_t threadNo, bool isOpponentLevel)
 //-----------------------------------------------------------------------------
 bool PerfectAI::getOpponentLevel(uint32_t threadNo)
 {
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     return (tv->ownId == tv->field->oppPlayer->id);
 }
 
@@ -2267,14 +2253,14 @@ void PerfectAI::getSymStateNumWithDoubles(uint32_t threadNo,
                                           uint32_t **symStateNumbers)
 {
     // locals
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     int origField[SQUARE_NB];
     uint32_t origPartOfMill[SQUARE_NB];
     uint32_t i, symOp;
     uint32_t layerNum, stateNum;
 
     *nSymStates = 0;
-    *symStateNumbers = symStateNumberArray;
+    *symStateNumbers = tv->symStateNumberArray;
 
     // save current board
     for (i = 0; i < SQUARE_NB; i++) {
@@ -2291,7 +2277,7 @@ void PerfectAI::getSymStateNumWithDoubles(uint32_t threadNo,
                           (uint32_t *)tv->field->piecePartOfMillCount);
 
         getLayerAndStateNumber(threadNo, layerNum, stateNum);
-        symStateNumberArray[*nSymStates] = stateNum;
+        tv->symStateNumberArray[*nSymStates] = stateNum;
         (*nSymStates)++;
     }
 
@@ -2503,7 +2489,7 @@ void PerfectAI::getPredecessors(uint32_t threadNo, uint32_t *amountOfPred,
     ////////////////////////////////////////////////////////////////////////////
 
     // locals
-    ThreadVars *tv = &threadVars[threadNo];
+    ThreadVars *tv = &threadVars[getThreadSlot(threadNo)];
     bool aPieceCanBeRemovedFromCurPlayer;
     bool millWasClosed;
     uint32_t from, to, dir, i;
@@ -186,9 +186,6 @@ protected:
     // contains the number of ...
     uint32_t incidencesValuesSubMoves[SQUARE_NB * SQUARE_NB][4] {{0}};
 
-    // array for state numbers
-    uint32_t symStateNumberArray[SO_COUNT] {0};
-
     // dir containing the database files
     string databaseDir;
 
@@ -225,6 +222,9 @@ protected:
         // for getPossNormalMove()-function
         Possibility *possibilities {nullptr};
 
+        // returned by getSymStateNumWithDoubles()
+        uint32_t symStateNumberArray[SO_COUNT] {0};
+
         PerfectAI *parent {nullptr};
 
         // constructor
@@ -15,8 +15,11 @@
 #include "perfectAI.h"
 
 #include <cstdio>
+#include <ctime>
 #include <iostream>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #include "rule.h"
 #include "types.h"
@@ -36,6 +39,12 @@ const bool calculateDatabase = true;
 const bool calculateDatabase = false;
 #endif
 
+#ifdef MADWEASEL_MUEHLE_PERFECT_AI_COMPRESS_DATABASE
+const bool compressDatabase = true;
+#else
+const bool compressDatabase = false;
+#endif
+
 #ifdef MADWEASEL_MUEHLE_PERFECT_AI_TEST
 int main(void)
 #else
@@ -52,8 +61,10 @@ int perfect_main(void)
     mill = new Mill();
     ai = new PerfectAI(PERFECT_AI_DATABASE_DIR);
 
+#ifdef _WIN32
     SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
-    srand(GetTickCount64());
+#endif
+    srand((unsigned)time(nullptr));
 
     // intro
     cout << "*************************" << endl;
@@ -71,6 +82,17 @@ int perfect_main(void)
 #endif // SELF_PLAY
 
     if (calculateDatabase) {
+        // limits of the calculation, see config.h
+        ai->setMemoryBudget((int64_t)PERFECT_AI_MEMORY_BUDGET_MB * 1024 * 1024);
+        ai->setQueueMemoryThreshold((int64_t)PERFECT_AI_QUEUE_MEMORY_MB * 1024 *
+                                    1024);
+        ai->setCheckpointInterval(PERFECT_AI_CHECKPOINT_INTERVAL);
+        ai->setCalcMemoryLimit((int64_t)PERFECT_AI_CALC_MEMORY_MB * 1024 *
+                               1024);
+
+        // resume an interrupted calculation of the next layers
+        ai->testRetroAnalysisResume();
+
         // calculate
         ai->calculateDatabase(TREE_DEPTH_MAX, false);
 
@@ -85,6 +107,14 @@ int perfect_main(void)
 
         ai->testLayers(startTestFromLayer, endTestAtLayer);
 
+        // the compressed file replaces shortKnotValue.dat, once the latter is
+        // deleted
+        if (compressDatabase) {
+            ai->openDatabase(PERFECT_AI_DATABASE_DIR, POSIBILE_MOVE_COUNT_MAX);
+            ai->compressDatabase(SKV_BLOCK_SIZE_DEFAULT);
+            ai->closeDatabase();
+        }
+
     } else {
 #ifdef SELF_PLAY
         int moveCount = 0;
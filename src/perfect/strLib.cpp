@@ -45,7 +45,7 @@ MyString::MyString(const char *cStr)
 // MyString()
 //
 //-----------------------------------------------------------------------------
-MyString::MyString(const WCHAR *cStr)
+MyString::MyString(const wchar_t *cStr)
 {
     assign(cStr);
 }
@@ -79,7 +79,6 @@ MyString::~MyString()
 MyString &MyString::assign(const char *cStr)
 {
     // locals
-    size_t convertedChars = 0;
     size_t newLen = strlen(cStr);
     size_t newReserved = (size_t)hiBit((uint32_t)newLen) * 2;
 
@@ -90,13 +89,13 @@ MyString &MyString::assign(const char *cStr)
         strA = new char[newReserved];
 
     if (strW == nullptr)
-        strW = new WCHAR[newReserved];
+        strW = new wchar_t[newReserved];
 
     reserved = newReserved;
     length = newLen;
 
-    strcpy_s(strA, newReserved, cStr);
-    mbstowcs_s(&convertedChars, strW, newLen + 1, cStr, _TRUNCATE);
+    std::strcpy(strA, cStr);
+    std::mbstowcs(strW, cStr, newLen + 1);
 
     return *this;
 }
@@ -105,10 +104,9 @@ MyString &MyString::assign(const char *cStr)
 // assign()
 //
 //-----------------------------------------------------------------------------
-MyString &MyString::assign(const WCHAR *cStr)
+MyString &MyString::assign(const wchar_t *cStr)
 {
     // locals
-    size_t retval;
     size_t newLen = wcslen(cStr);
     size_t newReserved = (size_t)hiBit((uint32_t)newLen) * 2;
 
@@ -119,13 +117,13 @@ MyString &MyString::assign(const WCHAR *cStr)
         strA = new char[newReserved];
 
     if (strW == nullptr)
-        strW = new WCHAR[newReserved];
+        strW = new wchar_t[newReserved];
 
     reserved = newReserved;
     length = newLen;
 
-    wcscpy_s(strW, newReserved, cStr);
-    wcstombs_s(&retval, strA, newLen + 1, cStr, newLen + 1);
+    std::wcscpy(strW, cStr);
+    std::wcstombs(strA, cStr, newLen + 1);
 
     return *this;
 }
@@ -10,11 +10,13 @@
 #define STRLIB_H_INCLUDED
 
 #include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
-#include <windows.h>
 
 using std::cout;
 using std::string;
@@ -23,7 +25,7 @@ class MyString
 {
 private:
     // variables
-    WCHAR *strW {nullptr};
+    wchar_t *strW {nullptr};
     char *strA {nullptr};
     size_t length {0};
     size_t reserved {0};
@@ -34,11 +36,11 @@ public:
     // functions
     MyString();
     explicit MyString(const char *cStr);
-    explicit MyString(const WCHAR *cStr);
+    explicit MyString(const wchar_t *cStr);
     ~MyString();
 
     MyString &assign(const char *cStr);
-    MyString &assign(const WCHAR *cStr);
+    MyString &assign(const wchar_t *cStr);
 
     static int hiBit(uint32_t n);
 };
@@ -11,6 +11,10 @@
 #ifdef MADWEASEL_MUEHLE_PERFECT_AI
 
 #include "threadManager.h"
+#include <algorithm>
+#include <cstdlib>
+
+thread_local ThreadManager *ThreadManager::ofThisThread = nullptr;
 
 //-----------------------------------------------------------------------------
 // ThreadManager()
@@ -18,33 +22,13 @@
 //-----------------------------------------------------------------------------
 ThreadManager::ThreadManager()
 {
-    // locals
-    uint32_t thd;
-    SYSTEM_INFO m_si = {0};
-
-    GetSystemInfo(&m_si);
-
     // init default values
     execPaused = false;
     execCancelled = false;
-    threadCount = m_si.dwNumberOfProcessors;
-    hThread = new HANDLE[threadCount];
-    std::memset(hThread, 0, sizeof(HANDLE) * threadCount);
-    threadId = new DWORD[threadCount];
-    std::memset(threadId, 0, sizeof(DWORD) * threadCount);
-    hBarrier = new HANDLE[threadCount];
-    std::memset(hBarrier, 0, sizeof(HANDLE) * threadCount);
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadId.resize(threadCount);
     threadPassedBarrierCount = 0;
     termineAllThreads = false;
-
-    InitializeCriticalSection(&csBarrier);
-    hEventBarrierPassedByEverybody = CreateEvent(nullptr, true, false, nullptr);
-
-    for (thd = 0; thd < threadCount; thd++) {
-        hThread[thd] = nullptr;
-        threadId[thd] = 0;
-        hBarrier[thd] = CreateEvent(nullptr, false, false, nullptr);
-    }
 }
 
 //-----------------------------------------------------------------------------
@@ -53,119 +37,48 @@ ThreadManager::ThreadManager()
 //-----------------------------------------------------------------------------
 ThreadManager::~ThreadManager()
 {
-    // locals
-    uint32_t thd;
-
-    for (thd = 0; thd < threadCount; thd++) {
-        CloseHandle(hBarrier[thd]);
+    for (auto &th : threads) {
+        if (th.joinable())
+            th.join();
     }
-
-    DeleteCriticalSection(&csBarrier);
-    CloseHandle(hEventBarrierPassedByEverybody);
-
-    if (hBarrier != nullptr)
-        delete[] hBarrier;
-    hBarrier = nullptr;
-
-    if (hThread != nullptr)
-        delete[] hThread;
-    hThread = nullptr;
-
-    if (threadId != nullptr)
-        delete[] threadId;
-    threadId = nullptr;
 }
 
 //-----------------------------------------------------------------------------
 // waitForOtherThreads()
-//
+// Returns when all the threads have called it. 'barrierRound' tells the
+// waiting threads apart from the ones of the next barrier. A thread spins
+// before it sleeps, since the others usually arrive shortly after.
 //-----------------------------------------------------------------------------
 void ThreadManager::waitForOtherThreads(uint32_t threadNo)
 {
-    // wait if other threads are still waiting at the barrier
+    (void)threadNo;
 
-#if 0
-    cout << endl
-         << "thread=" << threadNo
-         << ", threadPassedBarrierCount= " << threadPassedBarrierCount << ": "
-         << "while (threadPassedBarrierCount>0)";
-#endif
+    const uint32_t round = barrierRound.load(std::memory_order_acquire);
 
-    if (threadPassedBarrierCount > 0) {
-        WaitForSingleObject(hEventBarrierPassedByEverybody, INFINITE);
-    }
+    // the last one opens the door
+    if (threadPassedBarrierCount.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+        threadCount) {
+        threadPassedBarrierCount.store(0, std::memory_order_relaxed);
+        barrierRound.fetch_add(1, std::memory_order_release);
 
-    // a simple while (threadPassedBarrierCount>0) {}; does not work, since the
-    // variable 'threadPassedBarrierCount' is not updated, due to compiler
-    // optimizations
-
-    // set signal that barrier is reached
-
-#if 0
-    cout << endl
-         << "thread=" << threadNo
-         << ", threadPassedBarrierCount= " << threadPassedBarrierCount << ": "
-         << "SetEvent()";
-#endif
-
-    SetEvent(hBarrier[threadNo]);
-
-    // enter the barrier one by one
-
-#if 0
-    cout << endl
-         << "thread=" << threadNo
-         << ", threadPassedBarrierCount= " << threadPassedBarrierCount << ": "
-         << "EnterCriticalSection()";
-#endif
-
-    EnterCriticalSection(&csBarrier);
-
-    // if the first one which entered, then wait until other threads
-    if (threadPassedBarrierCount == 0) {
-#if 0
-        cout << endl
-             << "thread=" << threadNo
-             << ", threadPassedBarrierCount=
-                " << threadPassedBarrierCount << "
-            : " << " WaitForMultipleObjects() ";
-#endif
-        WaitForMultipleObjects(threadCount, hBarrier, TRUE, INFINITE);
-        ResetEvent(hEventBarrierPassedByEverybody);
+        // the sleeping threads check 'barrierRound' while holding the lock
+        {
+            std::lock_guard<std::mutex> lock(csBarrier);
+        }
+        barrierPassed.notify_all();
+        return;
     }
 
-// count threads which passed the barrier
-#if 0
-    cout << endl
-         << "thread=" << threadNo
-         << ", threadPassedBarrierCount= " << threadPassedBarrierCount << ": "
-         << "threadPassedBarrierCount++";
-#endif
-
-    threadPassedBarrierCount++;
-
-    // the last one closes the door
-#if 0
-    cout << endl
-         << "thread=" << threadNo
-         << ", threadPassedBarrierCount= " << threadPassedBarrierCount << ": "
-         << "if (threadPassedBarrierCount == threadCount) "
-            "threadPassedBarrierCount = 0";
-#endif
-
-    if (threadPassedBarrierCount == threadCount) {
-        threadPassedBarrierCount = 0;
-        SetEvent(hEventBarrierPassedByEverybody);
+    for (int spin = 0; spin < TM_BARRIER_SPIN_COUNT; spin++) {
+        if (barrierRound.load(std::memory_order_acquire) != round)
+            return;
+        std::this_thread::yield();
     }
 
-#if 0
-    cout << endl
-         << "thread=" << threadNo
-         << ", threadPassedBarrierCount= " << threadPassedBarrierCount << ": "
-         << "LeaveCriticalSection()";
-#endif
-
-    LeaveCriticalSection(&csBarrier);
+    std::unique_lock<std::mutex> lock(csBarrier);
+    barrierPassed.wait(lock, [&] {
+        return barrierRound.load(std::memory_order_acquire) != round;
+    });
 }
 
 //-----------------------------------------------------------------------------
@@ -184,47 +97,41 @@ uint32_t ThreadManager::getThreadCount()
 bool ThreadManager::setThreadCount(uint32_t newNumThreads)
 {
     // cancel if any thread running
-    EnterCriticalSection(&csBarrier);
+    std::lock_guard<std::mutex> lock(csBarrier);
 
-    for (uint32_t thd = 0; thd < threadCount; thd++) {
-        if (hThread[thd]) {
-            LeaveCriticalSection(&csBarrier);
-            return false;
-        }
-    }
-
-    for (uint32_t thd = 0; thd < threadCount; thd++) {
-        CloseHandle(hBarrier[thd]);
-    }
+    if (!threads.empty() || newNumThreads == 0)
+        return false;
 
     threadCount = newNumThreads;
-
-    for (uint32_t thd = 0; thd < threadCount; thd++) {
-        hBarrier[thd] = CreateEvent(nullptr, false, false, nullptr);
-    }
-
-    LeaveCriticalSection(&csBarrier);
+    threadId.assign(threadCount, std::thread::id());
 
     return true;
 }
 
 //-----------------------------------------------------------------------------
 // pauseExec()
-//
+// The threads stop before their next iteration until pauseExec() is called
+// again.
 //-----------------------------------------------------------------------------
 void ThreadManager::pauseExec()
 {
-    for (uint32_t thd = 0; thd < threadCount; thd++) {
-        // unsuspend all threads
-        if (!execPaused) {
-            SuspendThread(hThread[thd]);
-            // suspend all threads
-        } else {
-            ResumeThread(hThread[thd]);
-        }
-    }
+    std::lock_guard<std::mutex> lock(csPause);
+
+    execPaused = !execPaused;
 
-    execPaused = (!execPaused);
+    if (!execPaused)
+        pauseEnded.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// waitWhilePaused()
+//
+//-----------------------------------------------------------------------------
+void ThreadManager::waitWhilePaused()
+{
+    std::unique_lock<std::mutex> lock(csPause);
+
+    pauseEnded.wait(lock, [this] { return !execPaused; });
 }
 
 //-----------------------------------------------------------------------------
@@ -268,7 +175,7 @@ bool ThreadManager::wasExecCancelled()
 uint32_t ThreadManager::getThreadNumber()
 {
     // locals
-    DWORD curThreadId = GetCurrentThreadId();
+    const std::thread::id curThreadId = std::this_thread::get_id();
     uint32_t thd;
 
     for (thd = 0; thd < threadCount; thd++) {
@@ -281,59 +188,57 @@ uint32_t ThreadManager::getThreadNumber()
 }
 
 //-----------------------------------------------------------------------------
-// execInParallel()
-// lpParam is an array of size threadCount.
+// getThreadManagerOfThisThread()
+//
 //-----------------------------------------------------------------------------
-uint32_t ThreadManager::execInParallel(DWORD threadProc(void *pParam),
-                                       void *pParam, uint32_t paramStructSize)
+ThreadManager *ThreadManager::getThreadManagerOfThisThread()
 {
-    // locals
-    uint32_t thd;
-    SIZE_T dwStackSize = 0;
-
-    // params ok?
-    if (pParam == nullptr)
-        return TM_RETVAL_INVALID_PARAM;
-
-    // globals
-    termineAllThreads = false;
+    return ofThisThread;
+}
 
-    // create threads
-    for (thd = 0; thd < threadCount; thd++) {
-        hThread[thd] = CreateThread(
-            nullptr, dwStackSize, (LPTHREAD_START_ROUTINE)threadProc,
-            (void *)(((char *)pParam) + thd * paramStructSize),
-            CREATE_SUSPENDED, &threadId[thd]);
+//-----------------------------------------------------------------------------
+// runsOnThisThread()
+//
+//-----------------------------------------------------------------------------
+void ThreadManager::runsOnThisThread()
+{
+    ofThisThread = this;
+}
 
-        if (hThread[thd] != nullptr) {
-            SetThreadPriority(hThread[thd], THREAD_PRIORITY_BELOW_NORMAL);
-        }
+//-----------------------------------------------------------------------------
+// runThreads()
+// Runs threadFunc(thd) on 'threadCount' threads and waits for their end. The
+// threads start once all of them are created and their ids are known, and not
+// before the end of a pause.
+//-----------------------------------------------------------------------------
+template <typename F>
+uint32_t ThreadManager::runThreads(F threadFunc)
+{
+    // locals
+    uint32_t thd;
 
-        if (hThread[thd] == nullptr) {
-            for (thd; thd > 0; thd--) {
-                CloseHandle(hThread[thd - 1]);
-                hThread[thd - 1] = nullptr;
-            }
-            return TM_RETVAL_UNEXPECTED_ERROR;
+    {
+        std::lock_guard<std::mutex> lock(csPause);
+
+        // create threads
+        for (thd = 0; thd < threadCount; thd++) {
+            threads.emplace_back([this, threadFunc, thd] {
+                ofThisThread = this;
+                waitWhilePaused();
+                threadFunc(thd);
+            });
+            threadId[thd] = threads.back().get_id();
         }
     }
 
-    // start threads
-    for (thd = 0; thd < threadCount; thd++) {
-        if (!execPaused)
-            ResumeThread(hThread[thd]);
-    }
-
     // wait for every thread to end
-    WaitForMultipleObjects(threadCount, hThread, TRUE, INFINITE);
-
-    // Close all thread handles upon completion.
-    for (thd = 0; thd < threadCount; thd++) {
-        CloseHandle(hThread[thd]);
-        hThread[thd] = nullptr;
-        threadId[thd] = 0;
+    for (auto &th : threads) {
+        th.join();
     }
 
+    threads.clear();
+    threadId.assign(threadCount, std::thread::id());
+
     // everything ok
     if (execCancelled) {
         return TM_RETVAL_EXEC_CANCELLED;
@@ -344,13 +249,38 @@ uint32_t ThreadManager::execInParallel(DWORD threadProc(void *pParam),
 
 //-----------------------------------------------------------------------------
 // execInParallel()
+// lpParam is an array of size threadCount.
+//-----------------------------------------------------------------------------
+uint32_t ThreadManager::execInParallel(uint32_t threadProc(void *pParam),
+                                       void *pParam, uint32_t paramStructSize)
+{
+    // params ok?
+    if (pParam == nullptr)
+        return TM_RETVAL_INVALID_PARAM;
+
+    // globals
+    termineAllThreads = false;
+
+    return runThreads([=](uint32_t thd) {
+        threadProc((void *)(((char *)pParam) + thd * paramStructSize));
+    });
+}
+
+//-----------------------------------------------------------------------------
+// execParallelLoop()
 //
 // lpParam - an array of size threadCount
 // finalValue  - this value is part of the iteration, meaning that index ranges
 // from initValue to finalValue including both border values
+// schedType - TM_SCHED_STATIC gives each thread a fixed contiguous part.
+//     TM_SCHED_DYNAMIC and TM_SCHED_GUIDED start with the same parts, but a
+//     thread takes its iterations in chunks and steals from the others when
+//     its own part is done. DYNAMIC takes chunks of TM_DYNAMIC_CHUNK_SIZE,
+//     GUIDED chunks shrinking with the rest of the part. TM_SCHED_RUNTIME is
+//     the same as GUIDED.
 //-----------------------------------------------------------------------------
-uint32_t ThreadManager::execParallelLoop(DWORD threadProc(void *pParam,
-                                                          unsigned index),
+uint32_t ThreadManager::execParallelLoop(uint32_t threadProc(void *pParam,
+                                                             unsigned index),
                                          void *pParam, uint32_t paramStructSize,
                                          uint32_t schedType, int initValue,
                                          int finalValue, int increment)
@@ -362,7 +292,8 @@ uint32_t ThreadManager::execParallelLoop(DWORD threadProc(void *pParam,
     if (pParam == nullptr)
         return TM_RETVAL_INVALID_PARAM;
 
-    if (schedType >= TM_SCHED_TYPE_COUNT)
+    if (schedType >= TM_SCHED_TYPE_COUNT ||
+        schedType == TM_SCHED_USER_DEFINED)
         return TM_RETVAL_INVALID_PARAM;
 
     if (increment == 0)
@@ -377,21 +308,24 @@ uint32_t ThreadManager::execParallelLoop(DWORD threadProc(void *pParam,
     uint32_t thd;
 
     // total number of iterations
-    int nIterations = (finalValue - initValue) / increment + 1;
+    int nIterations = std::max(0, (finalValue - initValue) / increment + 1);
 
     // number of iterations per chunk
     int chunkSize = 0;
 
-    // initial stack size of each thread. 0 means default size ~1MB
-    SIZE_T dwStackSize = 0;
+    // first iteration of the current thread, counted from 0
+    uint32_t firstIteration = 0;
+
+    std::vector<ForLoop> forLoopParams(threadCount);
+    std::vector<WorkRange> workRanges(threadCount);
 
-    ForLoop *forLoopParams = new ForLoop[threadCount];
-    std::memset(forLoopParams, 0, sizeof(ForLoop) * threadCount);
+    if (schedType == TM_SCHED_RUNTIME)
+        schedType = TM_SCHED_GUIDED;
 
     // globals
     termineAllThreads = false;
 
-    // create threads
+    // prepare the iterations of each thread
     for (thd = 0; thd < threadCount; thd++) {
         forLoopParams[thd].pParam = (pParam != nullptr ?
                                          (void *)(((char *)pParam) +
@@ -401,11 +335,14 @@ uint32_t ThreadManager::execParallelLoop(DWORD threadProc(void *pParam,
         forLoopParams[thd].threadProc = threadProc;
         forLoopParams[thd].increment = increment;
         forLoopParams[thd].schedType = schedType;
+        forLoopParams[thd].threadNo = thd;
+        forLoopParams[thd].workRanges = workRanges.data();
+
+        chunkSize = nIterations / threadCount +
+                    (thd < nIterations % threadCount ? 1 : 0);
 
         switch (schedType) {
         case TM_SCHED_STATIC:
-            chunkSize = nIterations / threadCount +
-                        (thd < nIterations % threadCount ? 1 : 0);
             if (thd == 0) {
                 forLoopParams[thd].initValue = initValue;
             } else {
@@ -416,74 +353,32 @@ uint32_t ThreadManager::execParallelLoop(DWORD threadProc(void *pParam,
                                             chunkSize - 1;
             break;
         case TM_SCHED_DYNAMIC:
-            return TM_RETVAL_INVALID_PARAM;
-            break;
         case TM_SCHED_GUIDED:
-            return TM_RETVAL_INVALID_PARAM;
-            break;
-        case TM_SCHED_RUNTIME:
-            return TM_RETVAL_INVALID_PARAM;
+            forLoopParams[thd].initValue = initValue;
+            forLoopParams[thd].finalValue = finalValue;
+            workRanges[thd].range = (uint64_t)firstIteration << 32 |
+                                    (firstIteration + chunkSize);
+            firstIteration += chunkSize;
             break;
         }
-
-        // create suspended thread
-        hThread[thd] = CreateThread(nullptr, dwStackSize, threadForLoop,
-                                    (LPVOID)(&forLoopParams[thd]),
-                                    CREATE_SUSPENDED, &threadId[thd]);
-
-        if (hThread[thd] != nullptr) {
-            SetThreadPriority(hThread[thd], THREAD_PRIORITY_BELOW_NORMAL);
-        }
-
-        if (hThread[thd] == nullptr) {
-            for (thd; thd > 0; thd--) {
-                CloseHandle(hThread[thd - 1]);
-                hThread[thd - 1] = nullptr;
-            }
-
-            return TM_RETVAL_UNEXPECTED_ERROR;
-        }
-
-#if 0
-        DWORD dwThreadAffinityMask = 1 << thd;
-        SetThreadAffinityMask(hThread[thd], &dwThreadAffinityMask);
-#endif
-    }
-
-    // start threads, but don't resume if in pause mode
-    for (thd = 0; thd < threadCount; thd++) {
-        if (!execPaused)
-            ResumeThread(hThread[thd]);
     }
 
-    // wait for every thread to end
-    WaitForMultipleObjects(threadCount, hThread, TRUE, INFINITE);
-
-    // Close all thread handles upon completion.
-    for (thd = 0; thd < threadCount; thd++) {
-        CloseHandle(hThread[thd]);
-        hThread[thd] = nullptr;
-        threadId[thd] = 0;
-    }
-    delete[] forLoopParams;
-
-    // everything ok
-    if (execCancelled) {
-        return TM_RETVAL_EXEC_CANCELLED;
-    } else {
-        return TM_RETVAL_OK;
-    }
+    // start threads, they wait if in pause mode
+    return runThreads([&](uint32_t threadNo) {
+        threadForLoop(&forLoopParams[threadNo]);
+    });
 }
 
 //-----------------------------------------------------------------------------
 // threadForLoop()
 //
 //-----------------------------------------------------------------------------
-DWORD WINAPI ThreadManager::threadForLoop(LPVOID lpParam)
+uint32_t ThreadManager::threadForLoop(ForLoop *forLoopParams)
 {
     // locals
-    ForLoop *forLoopParams = (ForLoop *)lpParam;
+    ThreadManager *tm = forLoopParams->threadManager;
     int i;
+    uint32_t first, count, k;
 
     switch (forLoopParams->schedType) {
     case TM_SCHED_STATIC:
@@ -495,29 +390,134 @@ DWORD WINAPI ThreadManager::threadForLoop(LPVOID lpParam)
             case TM_RETVAL_OK:
                 break;
             case TM_RETVAL_TERMINATE_ALL_THREADS:
-                forLoopParams->threadManager->termineAllThreads = true;
+                tm->termineAllThreads = true;
                 break;
             default:
                 break;
             }
-            if (forLoopParams->threadManager->termineAllThreads)
+            if (tm->termineAllThreads)
                 break;
+            if (tm->execPaused)
+                tm->waitWhilePaused();
         }
         break;
     case TM_SCHED_DYNAMIC:
-        return TM_RETVAL_INVALID_PARAM;
-        break;
     case TM_SCHED_GUIDED:
-        return TM_RETVAL_INVALID_PARAM;
+        while (!tm->termineAllThreads &&
+               takeIterations(forLoopParams, first, count)) {
+            for (k = first; k < first + count; k++) {
+                i = forLoopParams->initValue +
+                    (int)k * forLoopParams->increment;
+                switch (forLoopParams->threadProc(forLoopParams->pParam, i)) {
+                case TM_RETVAL_OK:
+                    break;
+                case TM_RETVAL_TERMINATE_ALL_THREADS:
+                    tm->termineAllThreads = true;
+                    break;
+                default:
+                    break;
+                }
+                if (tm->termineAllThreads)
+                    break;
+                if (tm->execPaused)
+                    tm->waitWhilePaused();
+            }
+        }
         break;
-    case TM_SCHED_RUNTIME:
+    default:
         return TM_RETVAL_INVALID_PARAM;
-        break;
     }
 
     return TM_RETVAL_OK;
 }
 
+//-----------------------------------------------------------------------------
+// takeIterations()
+// Takes the next chunk of the calling thread's own part. When the part is
+// empty, half of the part of another thread is stolen first. Returns false
+// when no iteration is left anywhere.
+//-----------------------------------------------------------------------------
+bool ThreadManager::takeIterations(ForLoop *forLoopParams, uint32_t &first,
+                                   uint32_t &count)
+{
+    // locals
+    std::atomic<uint64_t> &own =
+        forLoopParams->workRanges[forLoopParams->threadNo].range;
+    const uint32_t nThreads = forLoopParams->threadManager->threadCount;
+    uint64_t range = own.load(std::memory_order_relaxed);
+    uint32_t begin, end;
+
+    do {
+        begin = (uint32_t)(range >> 32);
+        end = (uint32_t)range;
+
+        if (begin >= end) {
+            if (!stealIterations(forLoopParams))
+                return false;
+            range = own.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (forLoopParams->schedType == TM_SCHED_DYNAMIC) {
+            count = TM_DYNAMIC_CHUNK_SIZE;
+        } else {
+            count = std::max<uint32_t>(TM_GUIDED_CHUNK_SIZE_MIN,
+                                       (end - begin) / (2 * nThreads));
+        }
+
+        count = std::min(count, end - begin);
+        first = begin;
+    } while (begin >= end ||
+             !own.compare_exchange_weak(
+                 range, (uint64_t)(begin + count) << 32 | end,
+                 std::memory_order_relaxed));
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// stealIterations()
+// Moves the back half of the first non-empty part of another thread to the
+// empty part of the calling thread. Returns false if all parts are empty.
+// Iterations stolen by a thread that has not stored them yet are not lost,
+// since that thread runs them itself.
+//-----------------------------------------------------------------------------
+bool ThreadManager::stealIterations(ForLoop *forLoopParams)
+{
+    // locals
+    const uint32_t nThreads = forLoopParams->threadManager->threadCount;
+    uint32_t victim, begin, end, stolen;
+    uint64_t range;
+
+    for (uint32_t i = 1; i < nThreads; i++) {
+        victim = (forLoopParams->threadNo + i) % nThreads;
+        std::atomic<uint64_t> &other = forLoopParams->workRanges[victim].range;
+        range = other.load(std::memory_order_relaxed);
+
+        do {
+            begin = (uint32_t)(range >> 32);
+            end = (uint32_t)range;
+
+            if (begin >= end)
+                break;
+
+            stolen = (end - begin + 1) / 2;
+        } while (!other.compare_exchange_weak(
+            range, (uint64_t)begin << 32 | (end - stolen),
+            std::memory_order_relaxed));
+
+        if (begin < end) {
+            // nobody else changes an empty part
+            forLoopParams->workRanges[forLoopParams->threadNo].range.store(
+                (uint64_t)(end - stolen) << 32 | end,
+                std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
 /*** To Do's
 ********************************************************************************
 - Restriction to 'int' can lead to overflow if there are more states in a layer.
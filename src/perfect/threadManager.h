@@ -9,10 +9,15 @@
 #ifndef THREADMANAGER_H_INCLUDED
 #define THREADMANAGER_H_INCLUDED
 
-// standard library & win32 api
+// standard library
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
-#include <windows.h>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 using std::iostream; // use standard library namespace
 
@@ -33,12 +38,29 @@ enum ThreadManagerReturnValue {
     TM_RETVAL_UNEXPECTED_ERROR = 4
 };
 
+// iterations a thread takes at once with TM_SCHED_DYNAMIC, and the smallest
+// number it takes with TM_SCHED_GUIDED
+constexpr auto TM_DYNAMIC_CHUNK_SIZE = 64;
+constexpr auto TM_GUIDED_CHUNK_SIZE_MIN = 16;
+
+// number of times a thread checks the barrier before it goes to sleep
+constexpr auto TM_BARRIER_SPIN_COUNT = 4096;
+
 /*** Structures ******************************************************/
 
 class ThreadManager
 {
 private:
     // structures
+
+    // iterations not taken yet by the owning thread, as 'begin << 32 | end'.
+    // the owner takes chunks from the front and idle threads steal half of
+    // the rest from the back. one cache line per thread.
+    struct alignas(64) WorkRange
+    {
+        std::atomic<uint64_t> range {0};
+    };
+
     struct ForLoop
     {
         uint32_t schedType {0};
@@ -46,33 +68,55 @@ private:
         int initValue {0};
         int finalValue {0};
         void *pParam {nullptr};
-        DWORD(*threadProc)
-        (void *pParam, uint32_t index); // pointer to the user function
-                                        // to be executed by the threads
+        uint32_t (*threadProc)(void *pParam,
+                               uint32_t index); // pointer to the user function
+                                                // to be executed by the threads
         ThreadManager *threadManager {nullptr};
+        uint32_t threadNo {0};
+        WorkRange *workRanges {nullptr}; // of all threads, for stealing
     };
 
     // Variables
-    uint32_t threadCount {0};  // number of threads
-    HANDLE *hThread {nullptr}; // array of size 'threadCount' containing the
-                               // thread
-                               // handles
-    DWORD *threadId {nullptr}; // array of size 'threadCount' containing the
-                               // thread ids
-    bool termineAllThreads {false};
-    bool execPaused {false};    // switch for the
-    bool execCancelled {false}; // true when cancelExec() was called
-
-    // barrier stuff
-    HANDLE hEventBarrierPassedByEverybody {nullptr};
-    HANDLE *hBarrier {nullptr}; // array of size 'threadCount' containing the
-                                // event
-                                // handles for the barrier
-    uint32_t threadPassedBarrierCount {0};
-    CRITICAL_SECTION csBarrier;
+    uint32_t threadCount {0}; // number of threads
+
+    // number of the first thread among the threads of all managers, which
+    // run at the same time. see getThreadSlot()
+    uint32_t firstThreadSlot {0};
+
+    // the manager, whose thread is the calling one
+    static thread_local ThreadManager *ofThisThread;
+
+    // array of size 'threadCount' containing the running threads
+    std::vector<std::thread> threads;
+
+    // array of size 'threadCount' containing the thread ids
+    std::vector<std::thread::id> threadId;
+
+    std::atomic<bool> termineAllThreads {false};
+    std::atomic<bool> execPaused {false};    // switch for the
+    std::atomic<bool> execCancelled {false}; // true when cancelExec() was
+                                             // called
+
+    // pause stuff. the threads are only held between two iterations, since
+    // a thread cannot be suspended from outside
+    std::mutex csPause;
+    std::condition_variable pauseEnded;
+
+    // barrier stuff. the threads spin for a while on 'barrierRound' and only
+    // sleep on 'barrierPassed' if the others take longer
+    std::mutex csBarrier;
+    std::condition_variable barrierPassed;
+    std::atomic<uint32_t> threadPassedBarrierCount {0};
+    std::atomic<uint32_t> barrierRound {0};
 
     // functions
-    static DWORD WINAPI threadForLoop(LPVOID lpParam);
+    template <typename F>
+    uint32_t runThreads(F threadFunc);
+    void waitWhilePaused();
+    static uint32_t threadForLoop(ForLoop *forLoopParams);
+    static bool takeIterations(ForLoop *forLoopParams, uint32_t &first,
+                               uint32_t &count);
+    static bool stealIterations(ForLoop *forLoopParams);
 
 public:
     class ThreadVarsArrayItem
@@ -138,6 +182,21 @@ public:
     uint32_t getThreadCount();
 
     bool setThreadCount(uint32_t newThreadCount);
+
+    // several managers can run at the same time, each on its own part of the
+    // per thread resources of the caller. thread 'threadNo' of this manager
+    // uses the one of number getThreadSlot(threadNo)
+    void setFirstThreadSlot(uint32_t slot) { firstThreadSlot = slot; }
+    uint32_t getThreadSlot(uint32_t threadNo)
+    {
+        return firstThreadSlot + threadNo;
+    }
+
+    // returns the manager running the calling thread, or nullptr. a thread,
+    // which starts the execution of a manager, can declare itself as one of
+    // its threads with runsOnThisThread()
+    static ThreadManager *getThreadManagerOfThisThread();
+    void runsOnThisThread();
     void waitForOtherThreads(uint32_t threadNo);
     void pauseExec();  // un-/suspend all threads
     void cancelExec(); // termineAllThreads auf true
@@ -151,13 +210,14 @@ public:
 // exec between two iterations
 #if 0
     void setCallBackFunction(void userFunction(void *pUser), void *pUser,
-                             DWORD milliseconds);
+                             uint32_t milliseconds);
 #endif
 
     // execute
-    uint32_t execInParallel(DWORD threadProc(void *pParam), void *pParam,
+    uint32_t execInParallel(uint32_t threadProc(void *pParam), void *pParam,
                             uint32_t paramStructSize);
-    uint32_t execParallelLoop(DWORD threadProc(void *pParam, uint32_t index),
+    uint32_t execParallelLoop(uint32_t threadProc(void *pParam,
+                                                  uint32_t index),
                               void *pParam, uint32_t paramStructSize,
                               uint32_t schedType, int initValue, int finalValue,
                               int increment);
@@ -20,38 +20,36 @@
 
 #include "bitboard.h"
 #include "mills.h"
+#include "nnue/evaluate_nnue.h"
 #include "option.h"
 #include "position.h"
+#include "symmetry.h"
 #include "thread.h"
+#include "uci.h"
 
 using std::string;
 
 namespace Zobrist {
-constexpr int KEY_MISC_BIT = 2;
 Key psq[PIECE_TYPE_NB][SQUARE_EXT_NB];
 Key side;
 } // namespace Zobrist
 
 namespace {
-const string PieceToChar(Piece p)
+char PieceToChar(Piece p)
 {
-    if (p == NO_PIECE) {
-        return "*";
-    }
-
     if (p == BAN_PIECE) {
-        return "X";
+        return 'X';
     }
 
     if (W_PIECE <= p && p <= W_PIECE_12) {
-        return "O";
+        return 'O';
     }
 
     if (B_PIECE <= p && p <= B_PIECE_12) {
-        return "@";
+        return '@';
     }
 
-    return "*";
+    return '*';
 }
 
 Piece CharToPiece(char ch) noexcept
@@ -77,6 +75,63 @@ Piece CharToPiece(char ch) noexcept
 
 constexpr PieceType PieceTypes[] = {NO_PIECE_TYPE, WHITE_PIECE, BLACK_PIECE,
                                     BAN};
+
+// The FEN and the commands are parsed in place: bulk jobs replaying game
+// records spend most of their time here.
+
+void skip_spaces(const char *&str)
+{
+    while (*str == ' ' || *str == '\t') {
+        str++;
+    }
+}
+
+// parse_number() reads at most maxDigits decimal digits at str. v is 0 and str
+// is unchanged if there are none.
+
+template <typename T>
+bool parse_number(const char *&str, int maxDigits, T &v)
+{
+    const char *s = str;
+
+    v = 0;
+
+    while (maxDigits-- > 0 && '0' <= *s && *s <= '9') {
+        v = T(v * 10 + (*s++ - '0'));
+    }
+
+    if (s == str) {
+        return false;
+    }
+
+    str = s;
+
+    return true;
+}
+
+// write_number() writes a decimal number at buf and returns a pointer past it.
+
+char *write_number(char *buf, int64_t v)
+{
+    char digits[20];
+    int n = 0;
+
+    if (v < 0) {
+        *buf++ = '-';
+        v = -v;
+    }
+
+    do {
+        digits[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v);
+
+    while (n) {
+        *buf++ = digits[--n];
+    }
+
+    return buf;
+}
 } // namespace
 
 /// operator<<(Position) returns an ASCII representation of the position
@@ -172,6 +227,8 @@ void Position::init()
     Zobrist::side = rng.rand<Key>() << Zobrist::KEY_MISC_BIT >>
                     Zobrist::KEY_MISC_BIT;
 
+    Symmetry::init();
+
     return;
 }
 
@@ -188,7 +245,7 @@ Position::Position()
 /// This function is not very robust - make sure that input FENs are correct,
 /// this is assumed to be the responsibility of the GUI.
 
-Position &Position::set(const string &fenStr, Thread *th)
+Position &Position::set(const char *fenStr, Thread *th)
 {
     /*
        A FEN string defines a particular position using only the ASCII character
@@ -222,35 +279,34 @@ Position &Position::set(const string &fenStr, Thread *th)
           incremented after White's move.
     */
 
-    unsigned char token = '\0';
+    const char *str = fenStr;
     Square sq = SQ_A1;
-    std::istringstream ss(fenStr);
 
     std::memset(this, 0, sizeof(Position));
 
-    ss >> std::noskipws;
-
     // 1. Piece placement
-    while ((ss >> token) && !isspace(token)) {
-        if (token == 'O' || token == '@' || token == 'X') {
-            put_piece(CharToPiece(token), sq);
+    for (; *str && !isspace(static_cast<unsigned char>(*str)); str++) {
+        if (*str == 'O' || *str == '@' || *str == 'X') {
+            put_piece(CharToPiece(*str), sq);
             ++sq;
         }
-        if (token == '*') {
+        if (*str == '*') {
             ++sq;
         }
     }
 
     // 2. Active color
-    ss >> token;
-    sideToMove = (token == 'w' ? WHITE : BLACK);
+    skip_spaces(str);
+    sideToMove = (*str == 'w' ? WHITE : BLACK);
     them = ~sideToMove; // Note: Stockfish do not need to set them
 
     // 3. Phrase
-    ss >> token;
-    ss >> token;
+    if (*str) {
+        str++;
+    }
+    skip_spaces(str);
 
-    switch (token) {
+    switch (*str) {
     case 'r':
         phase = Phase::ready;
         break;
@@ -268,10 +324,12 @@ Position &Position::set(const string &fenStr, Thread *th)
     }
 
     // 4. Action
-    ss >> token;
-    ss >> token;
+    if (*str) {
+        str++;
+    }
+    skip_spaces(str);
 
-    switch (token) {
+    switch (*str) {
     case 'p':
         action = Action::place;
         break;
@@ -285,98 +343,123 @@ Position &Position::set(const string &fenStr, Thread *th)
         action = Action::none;
     }
 
+    if (*str) {
+        str++;
+    }
+
     // 5. White on board / White in hand / Black on board / Black in hand / need
     // to remove
-    ss >> std::skipws >> pieceOnBoardCount[WHITE] >> pieceInHandCount[WHITE] >>
-        pieceOnBoardCount[BLACK] >> pieceInHandCount[BLACK] >>
-        pieceToRemoveCount;
-
     // 6-7. Halfmove clock and fullmove number
-    ss >> std::skipws >> st.rule50 >> gamePly;
+    int *const fields[] = {&pieceOnBoardCount[WHITE], &pieceInHandCount[WHITE],
+                           &pieceOnBoardCount[BLACK], &pieceInHandCount[BLACK],
+                           &pieceToRemoveCount};
+
+    for (int *field : fields) {
+        skip_spaces(str);
+        parse_number(str, 9, *field);
+    }
+
+    skip_spaces(str);
+    parse_number(str, 9, st.rule50);
+    skip_spaces(str);
+    parse_number(str, 9, gamePly);
 
     // Convert from fullmove starting from 1 to gamePly starting from 0,
     // handle also common incorrect FEN with fullmove = 0.
     gamePly = std::max(2 * (gamePly - 1), 0) + (sideToMove == BLACK);
 
+    set_features();
+
     thisThread = th;
 
     return *this;
 }
 
-/// Position::fen() returns a FEN representation of the position.
-/// This is mainly a debugging function.
+/// Position::fen() writes a FEN representation of the position and a
+/// terminating null to buf, which holds at least FEN_LEN_MAX chars. It returns
+/// a pointer to the null.
 
-const string Position::fen() const
+char *Position::fen(char *buf) const
 {
-    std::ostringstream ss;
-
     // Piece placement data
     for (File f = FILE_A; f <= FILE_C; ++f) {
         for (Rank r = RANK_1; r <= RANK_8; ++r) {
-            ss << PieceToChar(piece_on(make_square(f, r)));
+            *buf++ = PieceToChar(piece_on(make_square(f, r)));
         }
 
-        if (f == FILE_C) {
-            ss << " ";
-        } else {
-            ss << "/";
-        }
+        *buf++ = f == FILE_C ? ' ' : '/';
     }
 
     // Active color
-    ss << (sideToMove == WHITE ? "w" : "b");
-
-    ss << " ";
+    *buf++ = sideToMove == WHITE ? 'w' : 'b';
+    *buf++ = ' ';
 
     // Phrase
     switch (phase) {
     case Phase::none:
-        ss << "n";
+        *buf++ = 'n';
         break;
     case Phase::ready:
-        ss << "r";
+        *buf++ = 'r';
         break;
     case Phase::placing:
-        ss << "p";
+        *buf++ = 'p';
         break;
     case Phase::moving:
-        ss << "m";
+        *buf++ = 'm';
         break;
     case Phase::gameOver:
-        ss << "o";
+        *buf++ = 'o';
         break;
     default:
-        ss << "?";
+        *buf++ = '?';
         break;
     }
 
-    ss << " ";
+    *buf++ = ' ';
 
     // Action
     switch (action) {
     case Action::place:
-        ss << "p";
+        *buf++ = 'p';
         break;
     case Action::select:
-        ss << "s";
+        *buf++ = 's';
         break;
     case Action::remove:
-        ss << "r";
+        *buf++ = 'r';
         break;
     default:
-        ss << "?";
+        *buf++ = '?';
         break;
     }
 
-    ss << " ";
+    const int64_t fields[] = {pieceOnBoardCount[WHITE],
+                              pieceInHandCount[WHITE],
+                              pieceOnBoardCount[BLACK],
+                              pieceInHandCount[BLACK],
+                              pieceToRemoveCount,
+                              st.rule50,
+                              1 + (gamePly - (sideToMove == BLACK)) / 2};
 
-    ss << pieceOnBoardCount[WHITE] << " " << pieceInHandCount[WHITE] << " "
-       << pieceOnBoardCount[BLACK] << " " << pieceInHandCount[BLACK] << " "
-       << pieceToRemoveCount << " ";
+    for (const int64_t v : fields) {
+        *buf++ = ' ';
+        buf = write_number(buf, v);
+    }
+
+    *buf = '\0';
 
-    ss << st.rule50 << " " << 1 + (gamePly - (sideToMove == BLACK)) / 2;
+    return buf;
+}
+
+/// Position::fen() returns a FEN representation of the position.
+/// This is mainly a debugging function.
+
+const string Position::fen() const
+{
+    char buf[FEN_LEN_MAX];
 
-    return ss.str();
+    return string(buf, fen(buf));
 }
 
 /// Position::legal() tests whether a pseudo-legal move is legal
@@ -448,6 +531,20 @@ void Position::do_move(Move m)
     move = m;
 }
 
+/// Position::do_null_move() is used to do a "null move": it flips the side to
+/// move without changing the board. It is undone with undo_move() like any
+/// other move, so the caller must push the position onto the stack first.
+
+void Position::do_null_move()
+{
+    change_side_to_move();
+
+    ++st.rule50;
+    st.pliesFromNull = 0;
+
+    move = MOVE_NULL;
+}
+
 /// Position::undo_move() unmakes a move. When it returns, the position should
 /// be restored to exactly the same state as before the move was made.
 
@@ -505,7 +602,8 @@ bool Position::has_repeated(Sanmill::Stack<Position> &ss) const
     int size = ss.size();
 
     for (int i = size - 1; i >= 0; i--) {
-        if (type_of(ss[i].move) == MOVETYPE_REMOVE) {
+        if (type_of(ss[i].move) == MOVETYPE_REMOVE ||
+            ss[i].move == MOVE_NULL) {
             break;
         }
         if (key() == ss[i].st.key) {
@@ -562,16 +660,15 @@ bool Position::reset()
     pieceInHandCount[WHITE] = pieceInHandCount[BLACK] = rule.pieceCount;
     pieceToRemoveCount = 0;
 
-    mobilityDiff = 0;
-
     MoveList<LEGAL>::create();
     create_mill_table();
+    set_features();
     currentSquare = SQ_0;
 
 #ifdef ENDGAME_LEARNING
     if (gameOptions.isEndgameLearningEnabled() && gamesPlayedCount > 0 &&
         gamesPlayedCount % SAVE_ENDGAME_EVERY_N_GAMES == 0) {
-        Thread::saveEndgameHashMapToFile();
+        Thread::compactEndgameFile();
     }
 #endif /* ENDGAME_LEARNING */
 
@@ -630,17 +727,18 @@ bool Position::put_piece(Square s, bool updateRecord)
         pieceInHandCount[us]--;
         pieceOnBoardCount[us]++;
 
+        update_features(s, -1);
+
         const Piece pc = board[s] = piece;
         byTypeBB[ALL_PIECES] |= byTypeBB[type_of(pc)] |= s;
         byColorBB[color_of(pc)] |= s; // TODO(calcitem): Put ban?
 
-        update_key(s);
+        update_features(s, 1);
 
-        updateMobility(MOVETYPE_PLACE, s);
+        update_key(s);
 
         if (updateRecord) {
-            snprintf(record, RECORD_LEN_MAX, "(%1d,%1d)", file_of(s),
-                     rank_of(s));
+            UCI::write_move(Move(s), record);
         }
 
         currentSquare = s;
@@ -743,25 +841,26 @@ bool Position::put_piece(Square s, bool updateRecord)
         }
 
         if (updateRecord) {
-            snprintf(record, RECORD_LEN_MAX, "(%1d,%1d)->(%1d,%1d)",
-                     file_of(currentSquare), rank_of(currentSquare), file_of(s),
-                     rank_of(s));
+            UCI::write_move(make_move(currentSquare, s), record);
             st.rule50++;
         }
 
         const Piece pc = board[currentSquare];
 
+        update_features(currentSquare, -1);
+
         CLEAR_BIT(byTypeBB[ALL_PIECES], currentSquare);
         CLEAR_BIT(byTypeBB[type_of(pc)], currentSquare);
         CLEAR_BIT(byColorBB[color_of(pc)], currentSquare);
 
-        updateMobility(MOVETYPE_REMOVE, currentSquare);
+        update_features(currentSquare, 1);
+        update_features(s, -1);
 
         SET_BIT(byTypeBB[ALL_PIECES], s);
         SET_BIT(byTypeBB[type_of(pc)], s);
         SET_BIT(byColorBB[color_of(pc)], s);
 
-        updateMobility(MOVETYPE_PLACE, s);
+        update_features(s, 1);
 
         board[s] = pc;
         update_key(s);
@@ -823,12 +922,12 @@ bool Position::remove_piece(Square s, bool updateRecord)
 
     Piece pc = board[s];
 
+    update_features(s, -1);
+
     CLEAR_BIT(byTypeBB[type_of(pc)],
               s); // TODO(calcitem): rule.hasBannedLocations and placing need?
     CLEAR_BIT(byColorBB[color_of(pc)], s);
 
-    updateMobility(MOVETYPE_REMOVE, s);
-
     if (rule.hasBannedLocations && phase == Phase::placing) {
         // Remove and put ban
         pc = board[s] = BAN_PIECE;
@@ -840,8 +939,10 @@ bool Position::remove_piece(Square s, bool updateRecord)
         board[s] = NO_PIECE;
     }
 
+    update_features(s, 1);
+
     if (updateRecord) {
-        snprintf(record, RECORD_LEN_MAX, "-(%1d,%1d)", file_of(s), rank_of(s));
+        UCI::write_move(Move(-s), record);
         st.rule50 = 0; // TODO(calcitem): Need to move out?
     }
 
@@ -925,42 +1026,49 @@ bool Position::resign(Color loser)
 
 bool Position::command(const char *cmd)
 {
-    unsigned int ruleNo = 0;
-    unsigned t = 0;
-    int step = 0;
-    File file1 = FILE_A, file2 = FILE_A;
-    Rank rank1 = RANK_1, rank2 = RANK_1;
-    int args = 0;
-
-    if (sscanf(cmd, "r%1u s%3d t%2u", &ruleNo, &step, &t) == 3) {
-        if (set_rule(ruleNo - 1) == false) {
-            return false;
-        }
+    const char *str = cmd;
+    int ruleNo = 0, step = 0, t = 0;
 
-        return reset();
-    }
+    // "r<rule> s<step> t<time>"
+    if (*str == 'r' && parse_number(++str, 1, ruleNo)) {
+        skip_spaces(str);
 
-    args = sscanf(cmd, "(%1u,%1u)->(%1u,%1u)", (unsigned *)&file1,
-                  (unsigned *)&rank1, (unsigned *)&file2, (unsigned *)&rank2);
+        if (*str == 's' && parse_number(++str, 3, step)) {
+            skip_spaces(str);
 
-    if (args >= 4) {
-        return move_piece(file1, rank1, file2, rank2);
-    }
+            if (*str == 't' && parse_number(++str, 2, t)) {
+                if (set_rule(ruleNo - 1) == false) {
+                    return false;
+                }
 
-    args = sscanf(cmd, "-(%1u,%1u)", (unsigned *)&file1, (unsigned *)&rank1);
-    if (args >= 2) {
-        return remove_piece(file1, rank1);
+                return reset();
+            }
+        }
     }
 
-    args = sscanf(cmd, "(%1u,%1u)", (unsigned *)&file1, (unsigned *)&rank1);
-    if (args >= 2) {
-        return put_piece(file1, rank1);
+    str = cmd;
+    const Move m = UCI::parse_move(str);
+
+    if (m != MOVE_NONE) {
+        const Square to = to_sq(m);
+
+        switch (type_of(m)) {
+        case MOVETYPE_MOVE:
+            return move_piece(file_of(from_sq(m)), rank_of(from_sq(m)),
+                              file_of(to), rank_of(to));
+        case MOVETYPE_REMOVE:
+            return remove_piece(file_of(to), rank_of(to));
+        default:
+            return put_piece(file_of(to), rank_of(to));
+        }
     }
 
-    args = sscanf(cmd, "Player%1u give up!", &t);
+    if (!strncmp(cmd, "Player", 6)) {
+        str = cmd + 6;
 
-    if (args == 1) {
-        return resign((Color)t);
+        if (parse_number(str, 1, t)) {
+            return resign((Color)t);
+        }
     }
 
     if (rule.threefoldRepetitionRule) {
@@ -1044,33 +1152,6 @@ bool Position::check_if_game_is_over()
     return false;
 }
 
-int Position::calculate_mobility_diff()
-{
-    // TODO(calcitem): Deal with rule is no ban location
-    int mobilityWhite = 0;
-    int mobilityBlack = 0;
-
-    for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
-        if (board[s] == NO_PIECE || board[s] == BAN_PIECE) {
-            Square moveSquare;
-            for (MoveDirection d = MD_BEGIN; d < MD_NB; ++d) {
-                moveSquare = static_cast<Square>(
-                    MoveList<LEGAL>::adjacentSquares[s][d]);
-                if (moveSquare) {
-                    if (board[moveSquare] & W_PIECE) {
-                        mobilityWhite++;
-                    }
-                    if (board[moveSquare] & B_PIECE) {
-                        mobilityBlack++;
-                    }
-                }
-            }
-        }
-    }
-
-    return mobilityWhite - mobilityBlack;
-}
-
 void Position::remove_ban_pieces()
 {
     assert(rule.hasBannedLocations);
@@ -1090,6 +1171,8 @@ void Position::remove_ban_pieces()
             }
         }
     }
+
+    set_features();
 }
 
 inline void Position::set_side_to_move(Color c)
@@ -1382,45 +1465,132 @@ void Position::reset_bb()
         byTypeBB[ALL_PIECES] |= byTypeBB[type_of(pc)] |= s;
         byColorBB[color_of(pc)] |= s;
     }
+
+    set_features();
 }
 
-void Position::updateMobility(MoveType mt, Square s)
+/// Position::update_features() keeps the evaluation features up to date when
+/// the content of square s changes. It is called with sign -1 just before and
+/// with sign 1 just after the change, so that only the pieces next to s and
+/// the lines through s have to be looked at.
+
+void Position::update_features(Square s, int sign)
 {
-    if (!gameOptions.getConsiderMobility()) {
-        return;
-    }
+    const Bitboard empty = ~byTypeBB[ALL_PIECES];
 
-    Bitboard adjacentWhiteBB = byColorBB[WHITE] &
-                               MoveList<LEGAL>::adjacentSquaresBB[s];
-    Bitboard adjacentBlackBB = byColorBB[BLACK] &
-                               MoveList<LEGAL>::adjacentSquaresBB[s];
-    Bitboard adjacentNoColorBB = (~(byColorBB[BLACK] | byColorBB[WHITE])) &
-                                 MoveList<LEGAL>::adjacentSquaresBB[s];
-    int adjacentWhiteBBCount = popcount(adjacentWhiteBB);
-    int adjacentBlackBBCount = popcount(adjacentBlackBB);
-    int adjacentNoColorBBCount = popcount(adjacentNoColorBB);
+    // Piece of the NNUE accumulator
+    if (Eval::NNUE::is_valid(accumulator)) {
+        for (const Color c : {WHITE, BLACK}) {
+            if (byColorBB[c] & s) {
+                Eval::NNUE::update(accumulator, c, s, sign);
+            }
+        }
+    }
 
-    if (mt == MOVETYPE_PLACE) {
-        mobilityDiff -= adjacentWhiteBBCount;
-        mobilityDiff += adjacentBlackBBCount;
+    // Mobility and blocked pieces of s and its neighbours
+    // The bitboards are the reference here, board[] is updated afterwards
+    const auto update = [&](Square t) {
+        Color c;
 
-        if (side_to_move() == WHITE) {
-            mobilityDiff += adjacentNoColorBBCount;
+        if (byColorBB[WHITE] & t) {
+            c = WHITE;
+        } else if (byColorBB[BLACK] & t) {
+            c = BLACK;
         } else {
-            mobilityDiff -= adjacentNoColorBBCount;
+            return;
         }
-    } else if (mt == MOVETYPE_REMOVE) {
-        mobilityDiff += adjacentWhiteBBCount;
-        mobilityDiff -= adjacentBlackBBCount;
 
-        if (color_of(board[s]) == WHITE) {
-            mobilityDiff -= adjacentNoColorBBCount;
-        } else {
-            mobilityDiff += adjacentNoColorBBCount;
+        const int n = popcount(MoveList<LEGAL>::adjacentSquaresBB[t] & empty);
+
+        mobilityCount[c] += sign * n;
+
+        if (n == 0) {
+            blockedCount[c] += sign;
+        }
+    };
+
+    update(s);
+
+    for (MoveDirection d = MD_BEGIN; d < MD_NB; ++d) {
+        const Square t = MoveList<LEGAL>::adjacentSquares[s][d];
+
+        if (t) {
+            update(t);
+        }
+    }
+
+    // Lines through s with two pieces of the same color and an empty square
+    for (int ld = 0; ld < LD_NB; ld++) {
+        const Bitboard mt = millTableBB[s][ld];
+
+        if (mt == ~0U) {
+            continue;
+        }
+
+        const Bitboard line = mt | s;
+
+        if (popcount(line & empty) != 1) {
+            continue;
+        }
+
+        for (const Color c : {WHITE, BLACK}) {
+            if (popcount(line & byColorBB[c]) == 2) {
+                openTwoCount[c] += sign;
+            }
+        }
+    }
+}
+
+/// Position::set_features() computes the evaluation features from scratch.
+/// Only needed when the board is set up without put_piece() and friends.
+
+void Position::set_features()
+{
+    memset(mobilityCount, 0, sizeof(mobilityCount));
+    memset(blockedCount, 0, sizeof(blockedCount));
+    memset(openTwoCount, 0, sizeof(openTwoCount));
+
+    const Bitboard empty = ~byTypeBB[ALL_PIECES];
+
+    for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
+        for (const Color c : {WHITE, BLACK}) {
+            if (!(byColorBB[c] & s)) {
+                continue;
+            }
+
+            const int n = popcount(MoveList<LEGAL>::adjacentSquaresBB[s] &
+                                   empty);
+
+            mobilityCount[c] += n;
+
+            if (n == 0) {
+                blockedCount[c]++;
+            }
+        }
+
+        // Each line is counted from its lowest square
+        for (int ld = 0; ld < LD_NB; ld++) {
+            const Bitboard mt = millTableBB[s][ld];
+
+            if (mt == ~0U || (mt & (square_bb(s) - 1))) {
+                continue;
+            }
+
+            const Bitboard line = mt | s;
+
+            if (popcount(line & empty) != 1) {
+                continue;
+            }
+
+            for (const Color c : {WHITE, BLACK}) {
+                if (popcount(line & byColorBB[c]) == 2) {
+                    openTwoCount[c]++;
+                }
+            }
         }
-    } else {
-        assert(0);
     }
+
+    Eval::NNUE::refresh(*this);
 }
 
 void Position::mirror(vector<string> &moveHistory, bool cmdChange /*= true*/)
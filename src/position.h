@@ -23,10 +23,21 @@
 #include <string>
 #include <vector>
 
+#include "nnue/nnue_architecture.h"
 #include "rule.h"
 #include "stack.h"
 #include "types.h"
 
+/// The keys of the positions xor the Zobrist keys of their pieces and of the
+/// side to move, which leave the KEY_MISC_BIT high bits to the number of
+/// pieces to remove.
+
+namespace Zobrist {
+constexpr int KEY_MISC_BIT = 2;
+extern Key psq[PIECE_TYPE_NB][SQUARE_EXT_NB];
+extern Key side;
+} // namespace Zobrist
+
 /// StateInfo struct stores information needed to restore a Position object to
 /// its previous state when we retract a move. Whenever a move is made on the
 /// board (by calling Position::do_move), a StateInfo object must be passed.
@@ -58,7 +69,10 @@ public:
     Position &operator=(const Position &) = delete;
 
     // FEN string input/output
+    static const int FEN_LEN_MAX = 128;
+    Position &set(const char *fenStr, Thread *th);
     Position &set(const std::string &fenStr, Thread *th);
+    char *fen(char *buf) const;
     const std::string fen() const;
 
     // Position representation
@@ -74,6 +88,7 @@ public:
 
     // Doing and undoing moves
     void do_move(Move m);
+    void do_null_move();
     void undo_move(Sanmill::Stack<Position> &ss);
 
     // Accessing hash keys
@@ -144,10 +159,13 @@ public:
 
     int piece_to_remove_count() const;
 
+    // Evaluation features
     int get_mobility_diff() const;
-    void updateMobility(MoveType mt, Square s);
-    // template <typename Mt> void updateMobility(Square from, Square to);
-    int calculate_mobility_diff();
+    int mobility(Color c) const;
+    int blocked_count(Color c) const;
+    int open_two_count(Color c) const;
+    void update_features(Square s, int sign);
+    void set_features();
 
     bool is_three_endgame() const;
 
@@ -176,7 +194,10 @@ public:
     int pieceInHandCount[COLOR_NB] {0, 9, 9};
     int pieceOnBoardCount[COLOR_NB] {0, 0, 0};
     int pieceToRemoveCount {0};
-    int mobilityDiff {0};
+    int mobilityCount[COLOR_NB] {0};
+    int blockedCount[COLOR_NB] {0};
+    int openTwoCount[COLOR_NB] {0};
+    Eval::NNUE::Accumulator accumulator;
     int gamePly {0};
     Color sideToMove {NOCOLOR};
     Thread *thisThread {nullptr};
@@ -207,6 +228,11 @@ public:
 
 extern std::ostream &operator<<(std::ostream &os, const Position &pos);
 
+inline Position &Position::set(const std::string &fenStr, Thread *th)
+{
+    return set(fenStr.c_str(), th);
+}
+
 inline Color Position::side_to_move() const
 {
     return sideToMove;
@@ -351,7 +377,22 @@ inline int Position::piece_to_remove_count() const
 
 inline int Position::get_mobility_diff() const
 {
-    return mobilityDiff;
+    return mobilityCount[WHITE] - mobilityCount[BLACK];
+}
+
+inline int Position::mobility(Color c) const
+{
+    return mobilityCount[c];
+}
+
+inline int Position::blocked_count(Color c) const
+{
+    return blockedCount[c];
+}
+
+inline int Position::open_two_count(Color c) const
+{
+    return openTwoCount[c];
 }
 
 inline bool Position::is_three_endgame() const
@@ -0,0 +1,453 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "mills.h"
+#include "movegen.h"
+#include "record.h"
+#include "rule.h"
+#include "uci.h"
+
+using std::string;
+
+namespace {
+
+const char *ResultStr[] = {"0-1", "1/2-1/2", "1-0", "*"};
+
+// rule_index() returns the index in RULES of the current rule
+int rule_index()
+{
+    for (int r = 0; r < N_RULES; r++) {
+        if (!strcmp(rule.name, RULES[r].name)) {
+            return r;
+        }
+    }
+
+    return 0;
+}
+
+// history_rule() returns the index in RULES of the rule in the first line of a
+// move history saved by the GUI, "r<rule> s<step> t<time>", or -1 if the line
+// is not such a header.
+
+int history_rule(const string &line)
+{
+    int r, step, t;
+
+    if (sscanf(line.c_str(), " r%d s%d t%d", &r, &step, &t) != 3 || r < 1 ||
+        r > N_RULES) {
+        return -1;
+    }
+
+    return r - 1;
+}
+
+// history_result() maps the game over line of a move history, as appended by
+// the GUI, to the result of the game.
+
+Record::Result history_result(const string &line)
+{
+    char str[Position::RECORD_LEN_MAX];
+
+    for (const Color c : {WHITE, BLACK}) {
+        const Record::Result wins = c == WHITE ? Record::Result::whiteWins :
+                                                 Record::Result::blackWins;
+        const Record::Result loses = c == WHITE ? Record::Result::blackWins :
+                                                  Record::Result::whiteWins;
+
+        snprintf(str, sizeof(str), loseReasonlessThanThreeStr, c);
+        if (strstr(line.c_str(), str)) {
+            return wins;
+        }
+
+        snprintf(str, sizeof(str), loseReasonResignStr, c);
+        if (strstr(line.c_str(), str)) {
+            return loses;
+        }
+    }
+
+    if (strstr(line.c_str(), "Draw!") || strstr(line.c_str(), "draw!")) {
+        return Record::Result::draw;
+    }
+
+    return Record::Result::unknown;
+}
+
+// import_history() reads the rest of a move history saved by the GUI. Its
+// lines are the records of the moves, replayed by Position::command() up to
+// the first one which is not legal, followed by the game over reason.
+
+bool import_history(std::istream &in, const char *startFen, int ruleIdx,
+                    Record::Writer &out)
+{
+    Position pos;
+    std::vector<Move> moves;
+    Record::Result result = Record::Result::unknown;
+    string line;
+    bool legal = true;
+
+    pos.set(startFen, nullptr);
+
+    while (std::getline(in, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+
+        const char *str = line.c_str();
+        const Move m = UCI::parse_move(str);
+
+        if (m == MOVE_NONE) {
+            if (!line.empty()) {
+                result = history_result(line);
+            }
+        } else if (legal) {
+            legal = pos.command(line.c_str());
+
+            if (legal) {
+                moves.push_back(m);
+            }
+        }
+    }
+
+    return out.write(ruleIdx, result, moves.data(), moves.size());
+}
+
+// import_games() converts a file of text game records to a record file. Each
+// line is a game, its result followed by its moves, as read by the "book"
+// command. The games are of the current rule, their moves are read up to the
+// first one which is not legal. A move history saved by the GUI is imported
+// as one game if it is of the current rule.
+
+void import_games(const string &textFile, const string &recordFile)
+{
+    std::ifstream in(textFile);
+    Record::Writer out;
+
+    if (!in || !out.open(recordFile)) {
+        sync_cout << "info string Cannot convert " << textFile << sync_endl;
+        return;
+    }
+
+    char startFen[Position::FEN_LEN_MAX];
+    snprintf(startFen, sizeof(startFen),
+             "********/********/******** w p p 0 %d 0 %d 0 0 1",
+             rule.pieceCount, rule.pieceCount);
+
+    const int ruleIdx = rule_index();
+    Position pos;
+    std::vector<Move> moves;
+    string line;
+    size_t gameCount = 0, skipCount = 0;
+
+    std::getline(in, line);
+    const int historyRule = history_rule(line);
+
+    if (historyRule < 0) {
+        in.clear();
+        in.seekg(0);
+    } else if (historyRule != ruleIdx) {
+        // The tables of the position depend on the rule, see Reader::start()
+        skipCount++;
+    } else if (import_history(in, startFen, ruleIdx, out)) {
+        gameCount++;
+    }
+
+    while (historyRule < 0 && std::getline(in, line)) {
+        const char *str = line.c_str();
+
+        while (*str == ' ' || *str == '\t') {
+            str++;
+        }
+
+        const size_t len = strcspn(str, " \t\r");
+        int result = 0;
+
+        while (result < 4 && (strlen(ResultStr[result]) != len ||
+                              strncmp(str, ResultStr[result], len))) {
+            result++;
+        }
+
+        if (result == 4) {
+            continue;
+        }
+
+        str += len;
+        pos.set(startFen, nullptr);
+        moves.clear();
+
+        for (Move m; (m = UCI::to_move(&pos, str)) != MOVE_NONE;) {
+            moves.push_back(m);
+            pos.do_move(m);
+        }
+
+        if (out.write(ruleIdx, static_cast<Record::Result>(result),
+                      moves.data(), moves.size())) {
+            gameCount++;
+        }
+    }
+
+    if (!out.close()) {
+        sync_cout << "info string Cannot write " << recordFile << sync_endl;
+        return;
+    }
+
+    sync_cout << "info string " << gameCount << " games written to "
+              << recordFile << ", " << skipCount << " of other rules skipped"
+              << sync_endl;
+}
+
+// export_games() converts the games of the current rule of a record file back
+// to text game records.
+
+void export_games(const string &recordFile, const string &textFile)
+{
+    Record::Reader in;
+    std::ofstream out(textFile);
+
+    if (!in.open(recordFile) || !out) {
+        sync_cout << "info string Cannot convert " << recordFile << sync_endl;
+        return;
+    }
+
+    Position pos;
+    char buf[UCI::MOVE_LEN_MAX];
+    size_t gameCount = 0, skipCount = 0;
+
+    while (in.next()) {
+        // The text records do not tell their rule
+        if (in.rule() != rule_index()) {
+            skipCount++;
+            continue;
+        }
+
+        string line = ResultStr[std::min(int(in.result()), 3)];
+
+        in.replay(pos, [&](const Position &, Move m) {
+            line += ' ';
+            line.append(buf, UCI::write_move(m, buf));
+            return true;
+        });
+
+        out << line << '\n';
+        gameCount++;
+    }
+
+    if (!out.flush()) {
+        sync_cout << "info string Cannot write " << textFile << sync_endl;
+        return;
+    }
+
+    sync_cout << "info string " << gameCount << " games written to "
+              << textFile << ", " << skipCount << " of other rules skipped"
+              << sync_endl;
+}
+
+// replay_games() plays the games of the current rule of a record file and
+// reports the replay speed.
+
+void replay_games(const string &recordFile)
+{
+    Record::Reader in;
+
+    if (!in.open(recordFile)) {
+        sync_cout << "info string Cannot read " << recordFile << sync_endl;
+        return;
+    }
+
+    Position pos;
+    size_t gameCount = 0, skipCount = 0, plies = 0, errors = 0;
+    const auto count = [&plies](const Position &, Move) {
+        plies++;
+        return true;
+    };
+    const TimePoint start = now();
+
+    while (in.next()) {
+        if (in.rule() != rule_index()) {
+            skipCount++;
+            continue;
+        }
+
+        gameCount++;
+
+        if (!in.replay(pos, count)) {
+            errors++;
+        }
+    }
+
+    const TimePoint elapsed = now() - start + 1;
+
+    sync_cout << "info string " << gameCount << " games, " << skipCount
+              << " of other rules skipped, " << plies << " plies, " << errors
+              << " errors, " << elapsed << " ms, " << plies * 1000 / elapsed
+              << " plies/s" << sync_endl;
+}
+
+} // namespace
+
+namespace Record {
+
+/// Writer::open() creates a record file, with its header.
+
+bool Writer::open(const string &fileName)
+{
+    const FileHeader fh {FILE_MAGIC, 0};
+
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&fh), sizeof(fh));
+
+    return bool(file);
+}
+
+/// Writer::write() appends a game of the given rule and result. The moves are
+/// assumed to be legal.
+
+bool Writer::write(int ruleIdx, Result result, const Move *m, size_t count)
+{
+    buffer.resize(sizeof(GameHeader) + 2 * count);
+
+    uint8_t *p = buffer.data() + sizeof(GameHeader);
+
+    for (size_t i = 0; i < count; i++) {
+        p += encode(m[i], p);
+    }
+
+    const size_t size = p - buffer.data() - sizeof(GameHeader);
+
+    if (size > UINT16_MAX || ruleIdx < 0 || ruleIdx >= N_RULES) {
+        return false;
+    }
+
+    const GameHeader gh {uint8_t(ruleIdx), result, uint16_t(size)};
+
+    std::memcpy(buffer.data(), &gh, sizeof(gh));
+    file.write(reinterpret_cast<const char *>(buffer.data()),
+               std::streamsize(sizeof(gh) + size));
+
+    return bool(file);
+}
+
+bool Writer::close()
+{
+    file.close();
+
+    return bool(file);
+}
+
+/// Reader::open() maps a record file. There are no games if the file is
+/// missing or not valid.
+
+bool Reader::open(const string &fileName)
+{
+    FileHeader fh;
+
+    close();
+
+    if (!file.map(fileName) || file.size() < sizeof(fh)) {
+        file.unmap();
+        return false;
+    }
+
+    std::memcpy(&fh, file.data(), sizeof(fh));
+
+    if (fh.magic != FILE_MAGIC) {
+        file.unmap();
+        return false;
+    }
+
+    cur = static_cast<const uint8_t *>(file.data()) + sizeof(fh);
+    end = static_cast<const uint8_t *>(file.data()) + file.size();
+
+    return true;
+}
+
+void Reader::close()
+{
+    file.unmap();
+    cur = end = moves = nullptr;
+}
+
+/// Reader::next() moves to the next game. It returns false at the end of the
+/// file, or if the rest of the file is truncated.
+
+bool Reader::next()
+{
+    if (size_t(end - cur) < sizeof(GameHeader)) {
+        return false;
+    }
+
+    std::memcpy(&header, cur, sizeof(header));
+
+    if (size_t(end - cur) - sizeof(header) < header.size) {
+        cur = end;
+        return false;
+    }
+
+    moves = cur + sizeof(header);
+    cur = moves + header.size;
+
+    return true;
+}
+
+/// Reader::start() sets the start position of the current game. A game of
+/// another rule than the one of the engine is not started, the tables of the
+/// position depend on the rule and changing it would change the engine's.
+
+bool Reader::start(Position &pos) const
+{
+    if (header.rule != rule_index()) {
+        return false;
+    }
+
+    char fen[Position::FEN_LEN_MAX];
+    snprintf(fen, sizeof(fen),
+             "********/********/******** w p p 0 %d 0 %d 0 0 1",
+             ::rule.pieceCount, ::rule.pieceCount);
+
+    pos.set(fen, pos.this_thread());
+
+    return true;
+}
+
+/// command() converts game records between the text format read by the
+/// "book" command and record files, imports a move history saved by the GUI,
+/// or replays the games of a record file to measure its speed. The command
+/// is:
+///
+/// records import <text file> <record file>
+/// records export <record file> <text file>
+/// records replay <record file>
+
+void command(std::istream &is)
+{
+    string action, from, to;
+
+    is >> action >> from;
+
+    if (action == "import" && is >> to) {
+        import_games(from, to);
+    } else if (action == "export" && is >> to) {
+        export_games(from, to);
+    } else if (action == "replay") {
+        replay_games(from);
+    } else {
+        sync_cout << "info string Unknown records command" << sync_endl;
+    }
+}
+
+} // namespace Record
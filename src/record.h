@@ -0,0 +1,167 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef RECORD_H_INCLUDED
+#define RECORD_H_INCLUDED
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "misc.h"
+#include "position.h"
+
+namespace Record {
+
+/// A game record file is a FileHeader followed by the games, each of them a
+/// GameHeader followed by its moves. A placement or a removal takes one byte,
+/// the square with REMOVE_FLAG for a removal, and a move two bytes, the from
+/// square with MOVE_FLAG then the to square. All the fields are little-endian.
+
+enum class Result : uint8_t { blackWins, draw, whiteWins, unknown };
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t reserved;
+};
+
+struct GameHeader
+{
+    uint8_t rule;   // Index of the rule in RULES
+    Result result;
+    uint16_t size;  // Size of the moves in bytes
+};
+
+constexpr uint32_t FILE_MAGIC = 0x31524753; // "SGR1"
+
+constexpr uint8_t REMOVE_FLAG = 0x40;
+constexpr uint8_t MOVE_FLAG = 0x80;
+constexpr uint8_t SQUARE_MASK = 0x3F;
+
+inline int encode(Move m, uint8_t *buf)
+{
+    if (m < 0) {
+        buf[0] = uint8_t(REMOVE_FLAG | int(to_sq(m)));
+        return 1;
+    }
+
+    if (type_of(m) == MOVETYPE_MOVE) {
+        buf[0] = uint8_t(MOVE_FLAG | int(from_sq(m)));
+        buf[1] = uint8_t(to_sq(m));
+        return 2;
+    }
+
+    buf[0] = uint8_t(to_sq(m));
+    return 1;
+}
+
+/// Writer writes the games of a record file.
+
+class Writer
+{
+public:
+    bool open(const std::string &fileName);
+    bool write(int ruleIdx, Result result, const Move *moves, size_t count);
+    bool close();
+
+private:
+    std::ofstream file;
+    std::vector<uint8_t> buffer;
+};
+
+/// Reader maps a record file and walks through its games. replay() plays the
+/// moves of the current game from the start position, calling f(pos, m)
+/// before each of them, and stops when f returns false. It returns false for
+/// a game of another rule than the current one, which is left unchanged. The
+/// moves are not checked for legality, Writer is given the legal moves only.
+
+class Reader
+{
+public:
+    bool open(const std::string &fileName);
+    void close();
+
+    bool next();
+    int rule() const { return header.rule; }
+    Result result() const { return header.result; }
+
+    template <typename F>
+    bool replay(Position &pos, const F &f) const;
+
+private:
+    bool start(Position &pos) const;
+
+    MappedFile file;
+    const uint8_t *cur {nullptr};
+    const uint8_t *end {nullptr};
+    const uint8_t *moves {nullptr};
+    GameHeader header {};
+};
+
+template <typename F>
+bool Reader::replay(Position &pos, const F &f) const
+{
+    if (!start(pos)) {
+        return false;
+    }
+
+    const uint8_t *p = moves;
+    const uint8_t *const last = moves + header.size;
+
+    while (p < last) {
+        const int b = *p++;
+        Square from = SQ_NONE;
+        Square to = Square(b & SQUARE_MASK);
+
+        if (b & MOVE_FLAG) {
+            if (p == last) {
+                return false;
+            }
+
+            from = to;
+            to = Square(*p++ & SQUARE_MASK);
+
+            if (from < SQ_BEGIN || from >= SQ_END || from == to) {
+                return false;
+            }
+        }
+
+        if (to < SQ_BEGIN || to >= SQ_END) {
+            return false;
+        }
+
+        const Move m = from != SQ_NONE ? make_move(from, to) :
+                       b & REMOVE_FLAG ? Move(-to) :
+                                         Move(to);
+
+        if (!f(pos, m)) {
+            break;
+        }
+
+        pos.do_move(m);
+    }
+
+    return true;
+}
+
+void command(std::istream &is);
+
+} // namespace Record
+
+#endif // #ifndef RECORD_H_INCLUDED
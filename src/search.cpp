@@ -14,14 +14,38 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <cstring>
+
 #include "endgame.h"
 #include "evaluate.h"
 #include "option.h"
+#include "symmetry.h"
 #include "thread.h"
+#include "uci.h"
 
 using Eval::evaluate;
 using std::string;
 
+namespace Search {
+
+LimitsType Limits;
+
+} // namespace Search
+
+using Search::Limits;
+
+namespace {
+
+// Forward pruning parameters
+constexpr Depth NULL_MOVE_MIN_DEPTH = 3;
+constexpr Depth NULL_MOVE_REDUCTION = 2;
+constexpr Depth LMR_MIN_DEPTH = 3;
+constexpr int LMR_MIN_MOVE_INDEX = 3;
+constexpr Value FUTILITY_MARGIN = VALUE_EACH_PIECE;
+
+} // namespace
+
 Value MTDF(Position *pos, Sanmill::Stack<Position> &ss, Value firstguess,
            Depth depth, Depth originDepth, Move &bestMove);
 
@@ -60,6 +84,10 @@ int Thread::search()
     Value value = VALUE_ZERO;
     Depth d = get_depth();
 
+    // Result of the last iteration which was not interrupted
+    Move completedMove = MOVE_NONE;
+    Value completedValue = VALUE_ZERO;
+
     if (gameOptions.getAiIsLazy()) {
         int np = bestvalue / VALUE_EACH_PIECE;
         if (np > 1) {
@@ -77,8 +105,17 @@ int Thread::search()
         originDepth = d;
     }
 
-    const time_t time0 = time(nullptr);
-    srand(static_cast<unsigned int>(time0));
+    // A depth or node limit of the "go" command replaces the skill level
+    if (Limits.depth) {
+        originDepth = Limits.depth;
+    } else if (Limits.nodes) {
+        originDepth = DEPTH_MAX;
+    }
+
+    nmpMinPly = 0;
+    rootPos->thisThread = this;
+    rootMoves.clear();
+    bestMove = MOVE_NONE;
 
 #ifdef TIME_STAT
     auto timeStart = chrono::steady_clock::now();
@@ -139,7 +176,13 @@ int Thread::search()
         beta = VALUE_INFINITE;
     }
 
-    if (gameOptions.getMoveTime() > 0 || gameOptions.getIDSEnabled()) {
+    if (gameOptions.getMultiPV() > 1) {
+        value = multipv_search();
+        goto out;
+    }
+
+    if (gameOptions.getMoveTime() > 0 || gameOptions.getIDSEnabled() ||
+        Limits.nodes) {
         debugPrintf("IDS: ");
 
         const Depth depthBegin = 2;
@@ -161,11 +204,17 @@ int Thread::search()
                 value = qsearch(rootPos, ss, i, i, alpha, beta, bestMove);
             }
 
+            if (Threads.stop.load(std::memory_order_relaxed)) {
+                goto out;
+            }
+
             debugPrintf("%d(%d) ", value, value - lastValue);
 
             lastValue = value;
+            completedMove = bestMove;
+            completedValue = value;
 
-            if (is_timeout(startTime)) {
+            if (Limits.use_time_management() && is_timeout(startTime)) {
                 debugPrintf("originDepth = %d, depth = %d\n", originDepth, i);
                 goto out;
             }
@@ -194,11 +243,29 @@ int Thread::search()
     if (gameOptions.getAlgorithm() == 2 /* MTD(f) */) {
         value = MTDF(rootPos, ss, value, originDepth, originDepth, bestMove);
     } else {
-        value = qsearch(rootPos, ss, d, originDepth, alpha, beta, bestMove);
+        value = qsearch(rootPos, ss, originDepth, originDepth, alpha, beta,
+                        bestMove);
     }
 
 out:
 
+    // An iteration interrupted by "stop" or by the node limit cannot be
+    // trusted, fall back on the last complete one.
+    if (Threads.stop.load(std::memory_order_relaxed) &&
+        completedMove != MOVE_NONE) {
+        bestMove = completedMove;
+        value = completedValue;
+    }
+
+    // A tiny node budget may run out before any move has been searched
+    if (bestMove == MOVE_NONE && rootPos->get_phase() != Phase::gameOver) {
+        MoveList<LEGAL> ml(*rootPos);
+
+        if (ml.size() > 0) {
+            bestMove = ml.begin()->move;
+        }
+    }
+
 #ifdef TIME_STAT
     timeEnd = chrono::steady_clock::now();
     debugPrintf(
@@ -212,6 +279,156 @@ out:
     return 0;
 }
 
+/// Thread::multipv_search() is the iterative deepening loop of the multi-PV
+/// analysis mode. The root moves are dealt out to the threads of the pool,
+/// each thread finds the best lines among its own root moves, and the merged
+/// ranking is sent as info lines after every iteration.
+
+Value Thread::multipv_search()
+{
+    Search::RootMoves lines;
+
+    for (const auto &m : MoveList<LEGAL>(*rootPos)) {
+        lines.emplace_back(m.move);
+    }
+
+    if (lines.empty()) {
+        bestMove = MOVE_NONE;
+        return VALUE_ZERO;
+    }
+
+    // Only the main thread of the pool hands out work to the others
+    const bool useHelpers = !Threads.empty() && this == Threads.main();
+    const size_t threadCount = useHelpers ?
+                                   std::min(Threads.size(), lines.size()) :
+                                   1;
+    const size_t pvCount = std::min(size_t(gameOptions.getMultiPV()),
+                                    lines.size());
+    const TimePoint startTime = now();
+    Value value = VALUE_ZERO;
+
+    bestMove = lines[0].move;
+
+    for (Depth d = std::min(Depth(2), originDepth); d <= originDepth; d++) {
+        // Deal the root moves out in rank order, so that every thread gets
+        // some of the best moves of the previous iteration
+        for (size_t t = 0; t < threadCount; t++) {
+            Thread *th = useHelpers ? Threads[t] : this;
+
+            th->rootMoves.clear();
+            th->multiPV = pvCount;
+
+            for (size_t i = t; i < lines.size(); i += threadCount) {
+                th->rootMoves.push_back(lines[i]);
+            }
+        }
+
+        for (size_t t = 1; t < threadCount; t++) {
+            Thread *th = Threads[t];
+
+            std::memcpy(static_cast<void *>(&th->linePos), rootPos,
+                        sizeof(Position));
+            th->linePos.thisThread = th;
+            th->lineDepth = d;
+            th->start_searching();
+        }
+
+        search_lines(rootPos, d);
+
+        for (size_t t = 1; t < threadCount; t++) {
+            Threads[t]->wait_for_search_finished();
+        }
+
+        // Keep the ranking of the last completed iteration
+        if (Threads.stop.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        // The global best lines are among the best lines of each thread,
+        // which search_lines() left at the front of its root moves.
+        Search::RootMoves ranked;
+
+        for (size_t t = 0; t < threadCount; t++) {
+            const Thread *th = useHelpers ? Threads[t] : this;
+            const size_t n = std::min(pvCount, th->rootMoves.size());
+
+            ranked.insert(ranked.end(), th->rootMoves.begin(),
+                          th->rootMoves.begin() + n);
+        }
+
+        std::stable_sort(ranked.begin(), ranked.end());
+
+        for (const auto &rm : lines) {
+            if (std::find(ranked.begin(), ranked.end(), rm.move) ==
+                ranked.end()) {
+                ranked.push_back(rm);
+            }
+        }
+
+        lines.swap(ranked);
+
+        for (size_t i = 0; i < pvCount; i++) {
+            sync_cout << "info depth " << int(d) << " multipv " << i + 1
+                      << " score " << UCI::value(lines[i].value)
+                      << " nodes " << Threads.nodes_searched() << " pv "
+                      << UCI::move(lines[i].move) << sync_endl;
+        }
+
+        bestMove = lines[0].move;
+        value = lines[0].value;
+
+        if (Limits.use_time_management() && gameOptions.getMoveTime() > 0 &&
+            is_timeout(startTime)) {
+            break;
+        }
+    }
+
+    for (size_t t = 0; t < threadCount; t++) {
+        (useHelpers ? Threads[t] : this)->rootMoves.clear();
+    }
+
+    return value;
+}
+
+/// Thread::search_lines() searches the root moves assigned to this thread to
+/// the given depth. Each line is searched with the root moves of the previous
+/// lines excluded and its best move is moved to the front, so that the first
+/// multiPV root moves end up sorted by score.
+
+void Thread::search_lines(Position *pos, Depth depth)
+{
+    Sanmill::Stack<Position> ss;
+    const size_t lineCount = std::min(multiPV, rootMoves.size());
+
+    for (pvIdx = 0; pvIdx < lineCount; ++pvIdx) {
+        Move move = MOVE_NONE;
+        Value value;
+
+        if (gameOptions.getAlgorithm() == 2 /* MTD(f) */) {
+            // The previous line is a good guess, since it is an upper bound
+            const Value guess = pvIdx ? rootMoves[pvIdx - 1].value : VALUE_ZERO;
+            value = MTDF(pos, ss, guess, depth, depth, move);
+        } else {
+            value = qsearch(pos, ss, depth, depth, -VALUE_INFINITE,
+                            VALUE_INFINITE, move);
+        }
+
+        if (Threads.stop.load(std::memory_order_relaxed) ||
+            move == MOVE_NONE) {
+            break;
+        }
+
+        const auto it = std::find(rootMoves.begin() + pvIdx, rootMoves.end(),
+                                  move);
+        assert(it != rootMoves.end());
+
+        it->value = value;
+        std::rotate(rootMoves.begin() + pvIdx, it, it + 1);
+    }
+
+    pvIdx = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 extern ThreadPool Threads;
@@ -226,6 +443,19 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
 
     Depth epsilon;
 
+    Thread *thisThread = pos->this_thread();
+
+    // The root is found by ply, since a depth extension can give a child the
+    // depth of the root
+    const bool rootNode = ss.size() == 0;
+
+    thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+
+    // Stop as soon as the node budget of "go nodes" is spent
+    if (Limits.nodes && Threads.nodes_searched() >= Limits.nodes) {
+        Threads.stop = true;
+    }
+
 #ifdef RULE_50
     if ((pos->rule50_count() > rule.nMoveRule) ||
         (rule.endgameNMoveRule < rule.nMoveRule && pos->is_three_endgame() &&
@@ -241,7 +471,7 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
     // Check if we have an upcoming move which draws by repetition, or
     // if the opponent had an alternative move earlier to this position.
     if (/* alpha < VALUE_DRAW && */
-        depth != originDepth && pos->has_repeated(ss)) {
+        !rootNode && pos->has_repeated(ss)) {
         alpha = VALUE_DRAW;
         if (alpha >= beta) {
             return alpha;
@@ -256,9 +486,19 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
     // Transposition table lookup
 
 #if defined(TRANSPOSITION_TABLE_ENABLE) || defined(ENDGAME_LEARNING)
-    const Key posKey = pos->key();
+    // With canonical keys, the symmetric positions share their entries. The
+    // moves of the entries are those of the canonical image of the position,
+    // which keySym maps it to.
+    const bool canonicalKeys = gameOptions.getCanonicalKeys();
+    int keySym = 0;
+    const Key posKey = canonicalKeys ? Symmetry::canonical_key(*pos, keySym) :
+                                       pos->key();
 #endif
 
+    // At the root of a multi-PV line only some of the root moves are searched,
+    // so the result must not be shared through the transposition table.
+    const bool lineRoot = rootNode && !thisThread->rootMoves.empty();
+
 #ifdef ENDGAME_LEARNING
     Endgame endgame;
 
@@ -298,7 +538,11 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
 #endif // TT_MOVE_ENABLE
     );
 
-    if (probeVal != VALUE_UNKNOWN) {
+#ifdef TT_MOVE_ENABLE
+    ttMove = Symmetry::transform(ttMove, Symmetry::inverse(keySym));
+#endif // TT_MOVE_ENABLE
+
+    if (probeVal != VALUE_UNKNOWN && !lineRoot) {
 #ifdef TRANSPOSITION_TABLE_DEBUG
         Threads.main()->ttHitCount++;
 #endif
@@ -338,18 +582,79 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
     // to pick a move and can't simply return VALUE_DRAW) then check to
     // see if the position is a repeat. if so, we can assume that
     // this line is a draw and return VALUE_DRAW.
-    if (rule.threefoldRepetitionRule && depth != originDepth &&
-        pos->has_repeated(ss)) {
+    if (rule.threefoldRepetitionRule && !rootNode && pos->has_repeated(ss)) {
         return VALUE_DRAW;
     }
 
+    const bool pvNode = int(beta) - int(alpha) > VALUE_PVS_WINDOW;
+    const Action action = pos->get_action();
+    Value staticEval = VALUE_NONE;
+
+    if (gameOptions.getFutilityPruning() ||
+        gameOptions.getVerifiedNullMove()) {
+        staticEval = Eval::evaluate(*pos);
+    }
+
+    // Verified null move pruning. Mill games are full of zugzwang positions,
+    // where every move spoils the position, so a fail high of the null move
+    // search is only trusted after a reduced depth search of the real moves
+    // confirms it.
+    if (gameOptions.getVerifiedNullMove() && !rootNode && !pvNode &&
+        depth >= NULL_MOVE_MIN_DEPTH && pos->move != MOVE_NULL &&
+        ss.size() >= thisThread->nmpMinPly &&
+        pos->get_phase() == Phase::moving && action == Action::select &&
+        !pos->is_three_endgame() &&
+        !(rule.mayFly && pos->piece_on_board_count(pos->side_to_move()) <=
+                             rule.flyPieceCount) &&
+        beta < VALUE_MATE_IN_MAX_PLY && staticEval >= beta) {
+        ss.push(*(pos));
+        pos->do_null_move();
+        Value nullValue = -qsearch(pos, ss, depth - 1 - NULL_MOVE_REDUCTION,
+                                   originDepth, -beta, -beta + 1, bestMove);
+        pos->undo_move(ss);
+
+        if (Threads.stop.load(std::memory_order_relaxed))
+            return VALUE_ZERO;
+
+        if (nullValue >= beta) {
+            // Do not return unproven mate scores
+            if (nullValue >= VALUE_MATE_IN_MAX_PLY) {
+                nullValue = beta;
+            }
+
+            // Verification search with null move pruning disabled for the
+            // first plies of the subtree
+            thisThread->nmpMinPly = ss.size() +
+                                    2 * (depth - NULL_MOVE_REDUCTION);
+            value = qsearch(pos, ss, depth - NULL_MOVE_REDUCTION, originDepth,
+                            beta - 1, beta, bestMove);
+            thisThread->nmpMinPly = 0;
+
+            if (value >= beta) {
+                return nullValue;
+            }
+        }
+    }
+
+    // Futility pruning at frontier nodes: if the static evaluation is so far
+    // below alpha that even winning a piece cannot raise it, moves which do
+    // not close a mill are not searched.
+    const bool futilityNode = gameOptions.getFutilityPruning() && !rootNode &&
+                              depth == 1 && action != Action::remove &&
+                              alpha > VALUE_MATED_IN_MAX_PLY &&
+                              alpha < VALUE_MATE_IN_MAX_PLY &&
+                              int(staticEval) + FUTILITY_MARGIN <= alpha;
+    const Value futilityValue = futilityNode ?
+                                    Value(int(staticEval) + FUTILITY_MARGIN) :
+                                    VALUE_NONE;
+
     // Initialize a MovePicker object for the current position, and prepare
     // to search the moves.
     MovePicker mp(*pos);
     Move nextMove = mp.next_move();
     const int moveCount = mp.move_count();
 
-    if (moveCount == 1 && depth == originDepth) {
+    if (moveCount == 1 && rootNode && !lineRoot) {
         bestMove = nextMove;
         bestValue = VALUE_UNIQUE;
         return bestValue;
@@ -371,7 +676,15 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
 #ifdef TRANSPOSITION_TABLE_ENABLE
 #ifndef DISABLE_PREFETCH
     for (int i = 0; i < moveCount; i++) {
-        TranspositionTable::prefetch(pos->key_after(mp.moves[i].move));
+        const Key key = pos->key_after(mp.moves[i].move);
+
+        // The canonical keys of the children are not worth computing here
+        if (!canonicalKeys) {
+            TranspositionTable::prefetch(key);
+        }
+#ifdef EVALUATION_CACHE_ENABLE
+        prefetch(thisThread->evalTable[key]);
+#endif
     }
 
 #ifdef PREFETCH_DEBUG
@@ -380,13 +693,98 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
     }
 #endif // PREFETCH_DEBUG
 #endif // !DISABLE_PREFETCH
+
+#ifdef TRANSPOSITION_TABLE_CUTOFF
+    // Enhanced transposition cutoffs: before searching any child, look up
+    // the children prefetched above. If one of them is stored with an upper
+    // bound that already proves a fail high here, there is no need to search
+    // the subtree. key_after() ignores the remove count and phase change, so
+    // only moves which certainly hand the turn to the opponent are probed.
+    if (!rootNode && depth >= 2 && action != Action::remove &&
+        (pos->get_phase() == Phase::moving ||
+         pos->piece_in_hand_count(WHITE) + pos->piece_in_hand_count(BLACK) >
+             1)) {
+        for (int i = 0; i < moveCount; i++) {
+            const Move move = mp.moves[i].move;
+
+            if (pos->potential_mills_count(to_sq(move), pos->side_to_move(),
+                                           from_sq(move))) {
+                continue;
+            }
+
+            Bound childType = BOUND_NONE;
+#ifdef TT_MOVE_ENABLE
+            Move childTTMove = MOVE_NONE;
+#endif // TT_MOVE_ENABLE
+
+            const Key childKey = canonicalKeys ?
+                                     Symmetry::canonical_key_after(*pos, move) :
+                                     pos->key_after(move);
+            const Value childVal = TranspositionTable::probe(
+                childKey, depth - 1, -beta, -alpha, childType
+#ifdef TT_MOVE_ENABLE
+                ,
+                childTTMove
+#endif // TT_MOVE_ENABLE
+            );
+
+            if (childVal == VALUE_UNKNOWN ||
+                !(childType & BOUND_UPPER) || -childVal < beta) {
+                continue;
+            }
+
+#ifdef TRANSPOSITION_TABLE_DEBUG
+            Threads.main()->ttCutoffCount++;
+#endif
+
+            bestValue = -childVal;
+
+            TranspositionTable::save(bestValue, depth, BOUND_LOWER, posKey
+#ifdef TT_MOVE_ENABLE
+                                     ,
+                                     Symmetry::transform(move, keySym)
+#endif // TT_MOVE_ENABLE
+            );
+
+            return bestValue;
+        }
+    }
+#endif // TRANSPOSITION_TABLE_CUTOFF
 #endif // TRANSPOSITION_TABLE_ENABLE
 
     // Loop through the moves until no moves remain or a beta cutoff occurs
     for (int i = 0; i < moveCount; i++) {
+        Move move = mp.moves[i].move;
+
+        // Skip the root moves of the previous lines and those assigned to
+        // other threads
+        if (lineRoot &&
+            std::find(thisThread->rootMoves.begin() + thisThread->pvIdx,
+                      thisThread->rootMoves.end(),
+                      move) == thisThread->rootMoves.end()) {
+            continue;
+        }
+
+        // A quiet move neither removes a piece nor closes a mill
+        bool quietMove = false;
+
+        if ((futilityNode || gameOptions.getLateMoveReduction()) &&
+            action != Action::remove) {
+            quietMove = pos->potential_mills_count(to_sq(move),
+                                                   pos->side_to_move(),
+                                                   from_sq(move)) == 0;
+        }
+
+        if (futilityNode && quietMove) {
+            if (futilityValue > bestValue) {
+                bestValue = futilityValue;
+            }
+
+            continue;
+        }
+
         ss.push(*(pos));
         const Color before = pos->sideToMove;
-        Move move = mp.moves[i].move;
 
         // Make and search the move
         pos->do_move(move);
@@ -400,7 +798,31 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
 
         // epsilon += pos->piece_to_remove_count();
 
-        if (gameOptions.getAlgorithm() == 1 /* PVS */) {
+        bool doFullDepthSearch = true;
+
+        // Late move reductions: MovePicker puts mill closing and blocking
+        // moves first, so quiet moves late in the list are first searched
+        // with reduced depth and a null window, and only searched again at
+        // full depth if they beat alpha.
+        if (gameOptions.getLateMoveReduction() && !rootNode && quietMove &&
+            epsilon == 0 && depth >= LMR_MIN_DEPTH && i >= LMR_MIN_MOVE_INDEX &&
+            mp.moves[i].value <= 0) {
+            const Depth r = (depth >= 6 && i >= 3 * LMR_MIN_MOVE_INDEX) ? 2 : 1;
+
+            if (after != before) {
+                value = -qsearch(pos, ss, depth - 1 - r, originDepth,
+                                 -alpha - VALUE_PVS_WINDOW, -alpha, bestMove);
+            } else {
+                value = qsearch(pos, ss, depth - 1 - r, originDepth, alpha,
+                                alpha + VALUE_PVS_WINDOW, bestMove);
+            }
+
+            doFullDepthSearch = value > alpha;
+        }
+
+        if (!doFullDepthSearch) {
+            // The reduced search failed low, the move is refuted
+        } else if (gameOptions.getAlgorithm() == 1 /* PVS */) {
             // debugPrintf("Algorithm: PVS.\n");
 
             if (i == 0) {
@@ -460,7 +882,7 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
             bestValue = value;
 
             if (value > alpha) {
-                if (depth == originDepth) {
+                if (rootNode) {
                     bestMove = move;
                 }
 
@@ -475,14 +897,16 @@ Value qsearch(Position *pos, Sanmill::Stack<Position> &ss, Depth depth,
     }
 
 #ifdef TRANSPOSITION_TABLE_ENABLE
-    TranspositionTable::save(
-        bestValue, depth,
-        TranspositionTable::boundType(bestValue, oldAlpha, beta), posKey
+    if (!lineRoot) {
+        TranspositionTable::save(
+            bestValue, depth,
+            TranspositionTable::boundType(bestValue, oldAlpha, beta), posKey
 #ifdef TT_MOVE_ENABLE
-        ,
-        bestMove
+            ,
+            Symmetry::transform(bestMove, keySym)
 #endif // TT_MOVE_ENABLE
-    );
+        );
+    }
 #endif /* TRANSPOSITION_TABLE_ENABLE */
 
     // assert(bestValue > -VALUE_INFINITE && bestValue < VALUE_INFINITE);
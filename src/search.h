@@ -29,6 +29,40 @@ using std::vector;
 
 namespace Search {
 
+/// RootMove struct is used for moves at the root of the tree. For each root
+/// move the multi-PV search stores the score of the line starting with it.
+
+struct RootMove
+{
+    explicit RootMove(Move m)
+        : move(m)
+    { }
+
+    bool operator==(const Move &m) const noexcept { return move == m; }
+
+    // Sort in descending order
+    bool operator<(const RootMove &m) const noexcept { return m.value < value; }
+
+    Value value {-VALUE_INFINITE};
+    Move move {MOVE_NONE};
+};
+
+using RootMoves = vector<RootMove>;
+
+/// LimitsType struct stores the limits sent by the GUI with the "go" command.
+/// A search with a depth or node limit ignores the move time, so that it gives
+/// the same result on every run.
+
+struct LimitsType
+{
+    bool use_time_management() const noexcept { return !depth && !nodes; }
+
+    Depth depth {DEPTH_NONE};
+    uint64_t nodes {0};
+};
+
+extern LimitsType Limits;
+
 void init() noexcept;
 void clear();
 
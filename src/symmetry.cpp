@@ -0,0 +1,255 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <climits>
+
+#include "symmetry.h"
+#include "bitboard.h"
+#include "position.h"
+#include "rule.h"
+
+namespace Symmetry {
+
+Square SquareTable[SYMMETRY_NB][SQUARE_EXT_NB];
+int InverseTable[SYMMETRY_NB];
+
+} // namespace Symmetry
+
+using namespace Symmetry;
+
+namespace {
+
+// The 8 rotations and reflections of a ring. Each ring of the Bitboard is a
+// byte, whose bit r is the square of rank r + 1.
+constexpr int DIHEDRAL_NB = 8;
+
+// The three kinds of pieces which are hashed: White, Black and banned
+constexpr int HASHED_NB = 3;
+
+uint8_t RingTable[DIHEDRAL_NB][256];
+Key RingKeys[HASHED_NB][FILE_NB + 1][256];
+
+/// dihedral() returns the image of rank index r by a rotation of the rings by
+/// (d & 3) quarter turns, preceded by a reflection if d & 4.
+
+constexpr int dihedral(int r, int d)
+{
+    if (d & 4) {
+        r = (8 - r) & 7;
+    }
+
+    return (r + 2 * (d & 3)) & 7;
+}
+
+constexpr int ring_of(File f, int sym)
+{
+    return sym & DIHEDRAL_NB ? FILE_NB + 1 - f : f;
+}
+
+/// Rings holds the rings of the bitboards of a position.
+
+struct Rings
+{
+    uint8_t bytes[HASHED_NB][FILE_NB + 1];
+
+    Rings(Bitboard white, Bitboard black, Bitboard ban)
+    {
+        const Bitboard bb[HASHED_NB] = {white, black, ban};
+
+        for (int pt = 0; pt < HASHED_NB; pt++) {
+            for (File f = FILE_A; f <= FILE_C; ++f) {
+                bytes[pt][f] = static_cast<uint8_t>(bb[pt] >> (8 * f));
+            }
+        }
+    }
+};
+
+/// misc_key() returns the part of the key of a position which does not depend
+/// on its pieces, as Position::update_key_misc() does. It is not taken from
+/// the key itself, which is not complete when set from a FEN string.
+
+Key misc_key(const Position &pos, Color sideToMove)
+{
+    return (static_cast<Key>(pos.piece_to_remove_count())
+            << (CHAR_BIT * sizeof(Key) - Zobrist::KEY_MISC_BIT)) ^
+           (sideToMove == BLACK ? Zobrist::side : Key(0));
+}
+
+/// canonical() returns the smallest key of the images of the pieces, xored
+/// with the part of the key which does not depend on them. Both images of a
+/// rotation or reflection, with and without swapping the rings, are computed
+/// from the same permuted bytes.
+
+Key canonical(const Rings &rings, Key rest, int &sym)
+{
+    Key best = ~Key(0);
+
+    for (int d = 0; d < DIHEDRAL_NB; d++) {
+        uint8_t p[HASHED_NB][FILE_NB + 1];
+
+        for (int pt = 0; pt < HASHED_NB; pt++) {
+            for (File f = FILE_A; f <= FILE_C; ++f) {
+                p[pt][f] = RingTable[d][rings.bytes[pt][f]];
+            }
+        }
+
+        Key k = rest, swapped = rest;
+
+        for (int pt = 0; pt < HASHED_NB; pt++) {
+            for (File f = FILE_A; f <= FILE_C; ++f) {
+                k ^= RingKeys[pt][f][p[pt][f]];
+                swapped ^= RingKeys[pt][FILE_NB + 1 - f][p[pt][f]];
+            }
+        }
+
+        if (k < best) {
+            best = k;
+            sym = d;
+        }
+
+        if (swapped < best) {
+            best = swapped;
+            sym = d | DIHEDRAL_NB;
+        }
+    }
+
+    return best;
+}
+
+} // namespace
+
+namespace Symmetry {
+
+/// init() fills the tables of the symmetries. It is called by
+/// Position::init(), once the Zobrist keys are known.
+
+void init()
+{
+    for (int d = 0; d < DIHEDRAL_NB; d++) {
+        for (int b = 0; b < 256; b++) {
+            RingTable[d][b] = 0;
+
+            for (int r = 0; r < 8; r++) {
+                if (b & (1 << r)) {
+                    RingTable[d][b] |= static_cast<uint8_t>(1
+                                                            << dihedral(r, d));
+                }
+            }
+        }
+    }
+
+    for (int sym = 0; sym < SYMMETRY_NB; sym++) {
+        for (int s = 0; s < SQUARE_EXT_NB; s++) {
+            SquareTable[sym][s] = static_cast<Square>(s);
+        }
+
+        for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
+            SquareTable[sym][s] = static_cast<Square>(
+                8 * ring_of(file_of(s), sym) +
+                dihedral(rank_of(s) - 1, sym & 7));
+        }
+    }
+
+    for (int sym = 0; sym < SYMMETRY_NB; sym++) {
+        for (int inv = 0; inv < SYMMETRY_NB; inv++) {
+            bool identity = true;
+
+            for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
+                identity &= transform(transform(s, sym), inv) == s;
+            }
+
+            if (identity) {
+                InverseTable[sym] = inv;
+            }
+        }
+    }
+
+    // The banned squares are hashed as the pieces of no color
+    const PieceType hashed[HASHED_NB] = {WHITE_PIECE, BLACK_PIECE,
+                                         NO_PIECE_TYPE};
+
+    for (int pt = 0; pt < HASHED_NB; pt++) {
+        for (File f = FILE_A; f <= FILE_C; ++f) {
+            for (int b = 0; b < 256; b++) {
+                RingKeys[pt][f][b] = 0;
+
+                for (int r = 0; r < 8; r++) {
+                    if (b & (1 << r)) {
+                        RingKeys[pt][f][b] ^= Zobrist::psq[hashed[pt]][8 * f +
+                                                                        r];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// transform() returns the image of a bitboard by a symmetry.
+
+Bitboard transform(Bitboard b, int sym)
+{
+    Bitboard t = 0;
+
+    for (File f = FILE_A; f <= FILE_C; ++f) {
+        t |= Bitboard(RingTable[sym & 7][(b >> (8 * f)) & 0xFF])
+             << (8 * ring_of(f, sym));
+    }
+
+    return t;
+}
+
+/// canonical_key() returns the canonical key of a position, and the symmetry
+/// which maps the position to its canonical image. The moves of the image are
+/// mapped back to the position by the inverse symmetry.
+
+Key canonical_key(const Position &pos, int &sym)
+{
+    const Rings rings(pos.byColorBB[WHITE], pos.byColorBB[BLACK],
+                      pos.byTypeBB[BAN]);
+
+    return canonical(rings, misc_key(pos, pos.side_to_move()), sym);
+}
+
+/// canonical_key_after() returns the canonical key of the position after a
+/// move, the same way as Position::key_after() does for the key.
+
+Key canonical_key_after(const Position &pos, Move m)
+{
+    const Color us = pos.side_to_move();
+    Bitboard bb[COLOR_NB] = {pos.byTypeBB[BAN], pos.byColorBB[WHITE],
+                             pos.byColorBB[BLACK]};
+    const Square s = to_sq(m);
+    int sym;
+
+    if (type_of(m) == MOVETYPE_REMOVE) {
+        bb[~us] ^= s;
+
+        if (rule.hasBannedLocations && pos.get_phase() == Phase::placing) {
+            bb[NOCOLOR] ^= s;
+        }
+    } else {
+        bb[us] ^= s;
+
+        if (type_of(m) == MOVETYPE_MOVE) {
+            bb[us] ^= from_sq(m);
+        }
+    }
+
+    return canonical(Rings(bb[WHITE], bb[BLACK], bb[NOCOLOR]),
+                     misc_key(pos, ~us), sym);
+}
+
+} // namespace Symmetry
@@ -0,0 +1,73 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SYMMETRY_H_INCLUDED
+#define SYMMETRY_H_INCLUDED
+
+#include "types.h"
+
+class Position;
+
+/// The board has 16 symmetries: the 8 rotations and reflections of the
+/// squares, each of them with or without swapping the inner and the outer
+/// rings. Symmetry 0 is the identity. The canonical key of a position is the
+/// smallest of the keys of its 16 images, so that the positions which only
+/// differ by a symmetry share their entries in the transposition table, the
+/// opening book and the endgame database.
+
+namespace Symmetry {
+
+constexpr int SYMMETRY_NB = 16;
+
+extern Square SquareTable[SYMMETRY_NB][SQUARE_EXT_NB];
+extern int InverseTable[SYMMETRY_NB];
+
+void init();
+
+inline Square transform(Square s, int sym)
+{
+    return SquareTable[sym][s];
+}
+
+inline Move transform(Move m, int sym)
+{
+    if (m == MOVE_NONE || m == MOVE_NULL) {
+        return m;
+    }
+
+    if (m < 0) {
+        return static_cast<Move>(-transform(to_sq(m), sym));
+    }
+
+    if (m & 0x7f00) {
+        return make_move(transform(from_sq(m), sym), transform(to_sq(m), sym));
+    }
+
+    return static_cast<Move>(transform(static_cast<Square>(m), sym));
+}
+
+inline int inverse(int sym)
+{
+    return InverseTable[sym];
+}
+
+Bitboard transform(Bitboard b, int sym);
+Key canonical_key(const Position &pos, int &sym);
+Key canonical_key_after(const Position &pos, Move m);
+
+} // namespace Symmetry
+
+#endif // #ifndef SYMMETRY_H_INCLUDED
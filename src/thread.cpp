@@ -17,8 +17,10 @@
 #include <iomanip>
 #include <utility>
 
+#include "book.h"
 #include "mills.h"
 #include "option.h"
+#include "symmetry.h"
 #include "thread.h"
 #include "uci.h"
 
@@ -30,10 +32,6 @@
 #include "engine_main.h"
 #endif
 
-#ifdef OPENING_BOOK
-#include <deque>
-#endif
-
 using std::cout;
 using std::fixed;
 using std::setprecision;
@@ -78,7 +76,10 @@ Thread::~Thread()
 void Thread::clear() noexcept
 {
     // TODO(calcitem): Reset histories
-    return;
+
+#ifdef EVALUATION_CACHE_ENABLE
+    evalTable.clear();
+#endif
 }
 
 /// Thread::start_searching() wakes up the thread that will start the search
@@ -128,6 +129,13 @@ void Thread::idle_loop()
 
         lk.unlock();
 
+        // Helper threads only search the root lines handed out by the main
+        // thread in multi-PV mode
+        if (idx != 0) {
+            search_lines(&linePos, lineDepth);
+            continue;
+        }
+
         // Note: Stockfish doesn't have this
         if (rootPos == nullptr || rootPos->side_to_move() != us) {
             continue;
@@ -143,15 +151,12 @@ void Thread::idle_loop()
             }
         } else {
 #endif // MADWEASEL_MUEHLE_PERFECT_AI
-#ifdef OPENING_BOOK
-            // gameOptions.getOpeningBook()
-            if (!openingBookDeque.empty()) {
-                char obc[16] = {0};
-                sq2str(obc);
-                strCommand = obc;
+            // No search time is spent in the positions of the book
+            if (gameOptions.getOpeningBook() &&
+                (bestMove = Book::probe(*rootPos)) != MOVE_NONE) {
+                strCommand = UCI::move(bestMove);
                 emitCommand();
             } else {
-#endif
                 int ret = search();
 
                 if (ret == 3 || ret == 50 || ret == 10) {
@@ -164,9 +169,7 @@ void Thread::idle_loop()
                         emitCommand();
                     }
                 }
-#ifdef OPENING_BOOK
             }
-#endif
 #ifdef MADWEASEL_MUEHLE_PERFECT_AI
         }
 #endif // MADWEASEL_MUEHLE_PERFECT_AI
@@ -224,46 +227,6 @@ void Thread::emitCommand()
 #endif // QT_GUI_LIB
 }
 
-#ifdef OPENING_BOOK
-deque<int> openingBookDeque({
-    /* B W */
-    21,
-    23,
-    19,
-    20,
-    17,
-    18,
-    15,
-});
-
-deque<int> openingBookDequeBak;
-
-void sq2str(char *str)
-{
-    int sq = openingBookDeque.front();
-    openingBookDeque.pop_front();
-    openingBookDequeBak.push_back(sq);
-
-    File file = FILE_A;
-    Rank rank = RANK_1;
-    int sig = 1;
-
-    if (sq < 0) {
-        sq = -sq;
-        sig = 0;
-    }
-
-    file = file_of(sq);
-    rank = rank_of(sq);
-
-    if (sig == 1) {
-        snprintf(str, Position::RECORD_LEN_MAX, 16, "(%d,%d)", file, rank);
-    } else {
-        snprintf(str, Position::RECORD_LEN_MAX, "-(%d,%d)", file, rank);
-    }
-}
-#endif // OPENING_BOOK
-
 void Thread::analyze(Color c)
 {
     static float nWhiteWin = 0;
@@ -433,8 +396,11 @@ string Thread::next_move()
             endgame.type = rootPos->side_to_move() == WHITE ?
                                EndGameType::blackWin :
                                EndGameType::whiteWin;
-            Key endgameHash = rootPos->key(); // TODO(calcitem): Do not generate
-                                              // hash repeatedly
+            int sym;
+            Key endgameHash = gameOptions.getCanonicalKeys() ?
+                                  Symmetry::canonical_key(*rootPos, sym) :
+                                  rootPos->key(); // TODO(calcitem): Do not
+                                                  // generate hash repeatedly
             saveEndgameHash(endgameHash, endgame);
         }
     }
@@ -459,47 +425,56 @@ string Thread::next_move()
                     hashProbeCount, ttHitCount, ttMissCount,
                     ttHitCount * 100 / hashProbeCount);
     }
+#ifdef TRANSPOSITION_TABLE_CUTOFF
+    debugPrintf("[posKey] enhanced transposition cutoffs: %zu\n",
+                ttCutoffCount);
+#endif // TRANSPOSITION_TABLE_CUTOFF
 #endif // TRANSPOSITION_TABLE_DEBUG
 #endif // TRANSPOSITION_TABLE_ENABLE
 
+#ifdef EVALUATION_CACHE_DEBUG
+    size_t evalProbeCount = evalCacheHitCount + evalCacheMissCount;
+    if (evalProbeCount) {
+        debugPrintf("[eval] probe: %zu, hit: %zu, miss: %zu, hit rate: "
+                    "%zu%%\n",
+                    evalProbeCount, evalCacheHitCount, evalCacheMissCount,
+                    evalCacheHitCount * 100 / evalProbeCount);
+    }
+#endif // EVALUATION_CACHE_DEBUG
+
     return UCI::move(bestMove);
 }
 
 #ifdef ENDGAME_LEARNING
+static const string endgameFileName = "endgame.bin";
+
 bool Thread::probeEndgameHash(Key posKey, Endgame &endgame)
 {
-    return endgameHashMap.find(posKey, endgame);
+    return endgameDB.probe(posKey, endgame);
 }
 
 int Thread::saveEndgameHash(Key posKey, const Endgame &endgame)
 {
-    Key hashValue = endgameHashMap.insert(posKey, endgame);
-    unsigned addr = hashValue * (sizeof(posKey) + sizeof(endgame));
+    endgameDB.record(posKey, endgame);
 
-    debugPrintf("[endgame] Record 0x%08I32x (%d) to Endgame hash map, TTEntry: "
-                "0x%08I32x, Address: 0x%08I32x\n",
-                posKey, endgame.type, hashValue, addr);
+    debugPrintf("[endgame] Record 0x%08x (%d) to endgame log\n",
+                static_cast<unsigned>(posKey), static_cast<int>(endgame.type));
 
     return 0;
 }
 
-void Thread::clearEndgameHashMap()
+void Thread::compactEndgameFile()
 {
-    endgameHashMap.clear();
-}
-
-void Thread::saveEndgameHashMapToFile()
-{
-    const string filename = "endgame.txt";
-    endgameHashMap.dump(filename);
-
-    debugPrintf("[endgame] Dump hash map to file\n");
+    if (!endgameDB.compact()) {
+        debugPrintf("[endgame] Cannot write %s\n", endgameFileName.c_str());
+    }
 }
 
-void Thread::loadEndgameFileToHashMap()
+void Thread::openEndgameFile()
 {
-    const string filename = "endgame.txt";
-    endgameHashMap.load(filename);
+    if (!endgameDB.open(endgameFileName)) {
+        debugPrintf("[endgame] %s is not valid\n", endgameFileName.c_str());
+    }
 }
 
 #endif // ENDGAME_LEARNING
@@ -546,13 +521,20 @@ void ThreadPool::clear()
 /// returns immediately. Main thread will wake up other threads and start the
 /// search.
 
-void ThreadPool::start_thinking(Position *pos, bool ponderMode)
+void ThreadPool::start_thinking(Position *pos,
+                                const Search::LimitsType &limits,
+                                bool ponderMode)
 {
     main()->wait_for_search_finished();
 
     main()->stopOnPonderhit = stop = false;
     increaseDepth = true;
     main()->ponder = ponderMode;
+    Search::Limits = limits;
+
+    for (Thread *th : *this) {
+        th->nodes = 0;
+    }
 
     // We use Position::set() to set root position across threads.
     for (Thread *th : *this) {
@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 
+#include "evaluate.h"
 #include "movepick.h"
 #include "position.h"
 #include "search.h"
@@ -59,12 +60,15 @@ public:
     );
     virtual ~Thread();
     int search();
+    Value multipv_search();
+    void search_lines(Position *pos, Depth depth);
     void clear() noexcept;
     void idle_loop();
     void start_searching();
     void wait_for_search_finished();
 
     Position *rootPos {nullptr};
+    std::atomic<uint64_t> nodes {0};
 
     // Mill Game
 
@@ -94,9 +98,8 @@ public:
 #ifdef ENDGAME_LEARNING
     static bool probeEndgameHash(Key key, Endgame &endgame);
     static int saveEndgameHash(Key key, const Endgame &endgame);
-    void clearEndgameHashMap();
-    static void saveEndgameHashMapToFile();
-    static void loadEndgameFileToHashMap();
+    static void compactEndgameFile();
+    static void openEndgameFile();
 #endif // ENDGAME_LEARNING
 
 #ifdef TRANSPOSITION_TABLE_ENABLE
@@ -108,12 +111,36 @@ public:
     size_t ttAddrHitCount {0};
     size_t ttReplaceCozDepthCount {0};
     size_t ttReplaceCozHashCount {0};
+    size_t ttCutoffCount {0};
 #endif // TRANSPOSITION_TABLE_DEBUG
 #endif // TRANSPOSITION_TABLE_ENABLE
 
+#ifdef EVALUATION_CACHE_ENABLE
+    Eval::Table evalTable;
+#ifdef EVALUATION_CACHE_DEBUG
+    size_t evalCacheHitCount {0};
+    size_t evalCacheMissCount {0};
+#endif // EVALUATION_CACHE_DEBUG
+#endif // EVALUATION_CACHE_ENABLE
+
 public:
     Depth originDepth {0};
 
+    // Null move pruning is disabled below this ply while a verification
+    // search is running
+    int nmpMinPly {0};
+
+    // Multi-PV search: root moves assigned to this thread, the index of the
+    // line being searched and the number of lines wanted. Root moves before
+    // pvIdx are excluded from the search.
+    Search::RootMoves rootMoves;
+    size_t pvIdx {0};
+    size_t multiPV {1};
+
+    // Private copy of the root position for helper threads
+    Position linePos;
+    Depth lineDepth {0};
+
     Move bestMove {MOVE_NONE};
     Value bestvalue {VALUE_ZERO};
     Value lastvalue {VALUE_ZERO};
@@ -154,11 +181,13 @@ struct MainThread : public Thread
 
 struct ThreadPool : public std::vector<Thread *>
 {
-    void start_thinking(Position *, bool = false);
+    void start_thinking(Position *, const Search::LimitsType &,
+                        bool = false);
     void clear();
     void set(size_t);
 
     MainThread *main() const { return static_cast<MainThread *>(front()); }
+    uint64_t nodes_searched() const { return accumulate(&Thread::nodes); }
 
     std::atomic_bool stop, increaseDepth;
 
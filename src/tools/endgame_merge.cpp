@@ -0,0 +1,307 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Standalone tool which merges the endgame files learned by several engines
+// into one, e.g. the 0/endgame.bin .. 9/endgame.bin of a self-play farm:
+//
+// sanmill-merge [-o output] [-p last|first|majority|agree] [-t threads]
+//               input...
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../endgame.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+using std::string;
+
+namespace {
+
+/// Policy decides the result of a key which is in several inputs. The inputs
+/// are ordered as on the command line, the later ones being the newer.
+
+enum class Policy {
+    last,     // The result of the last input
+    first,    // The result of the first input
+    majority, // The most frequent result, the later input breaking ties
+    agree     // The key is dropped unless all the inputs agree
+};
+
+struct Part
+{
+    std::vector<EndgameFile::Entry> entries;
+    size_t conflicts {0};
+    size_t dropped {0};
+};
+
+/// resolve() applies the policy to the results of a key, in input order. It
+/// returns false if the key is dropped.
+
+bool resolve(Policy policy, const std::vector<EndGameType> &results,
+             EndGameType &type)
+{
+    switch (policy) {
+    case Policy::last:
+        type = results.back();
+        return true;
+    case Policy::first:
+        type = results.front();
+        return true;
+    case Policy::majority: {
+        int counts[4] = {0, 0, 0, 0};
+        int best = 0;
+
+        for (const EndGameType r : results) {
+            const int c = ++counts[static_cast<int>(r) & 3];
+
+            if (c >= best) {
+                best = c;
+                type = r;
+            }
+        }
+
+        return true;
+    }
+    case Policy::agree:
+        type = results.front();
+        return std::all_of(results.begin(), results.end(),
+                           [&](EndGameType r) { return r == type; });
+    }
+
+    return false;
+}
+
+/// splitters() samples the keys of the inputs and returns the keys which
+/// split them in parts of about the same size, one per thread.
+
+std::vector<Key> splitters(const std::vector<std::unique_ptr<EndgameFile>> &in,
+                           size_t partCount)
+{
+    constexpr size_t SAMPLES_PER_PART = 64;
+    std::vector<Key> samples, split;
+
+    for (const auto &f : in) {
+        const size_t n = std::min(f->size(), partCount * SAMPLES_PER_PART);
+
+        for (size_t i = 0; i < n; i++) {
+            samples.push_back(f->key(i * f->size() / n));
+        }
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    for (size_t p = 1; p < partCount && !samples.empty(); p++) {
+        split.push_back(samples[p * samples.size() / partCount]);
+    }
+
+    split.erase(std::unique(split.begin(), split.end()), split.end());
+
+    return split;
+}
+
+/// merge_part() runs a k-way merge of the keys in [lo, hi) of all the inputs,
+/// or from lo to the end when last is set.
+
+void merge_part(const std::vector<std::unique_ptr<EndgameFile>> &in, Key lo,
+                Key hi, bool first, bool last, Policy policy, Part &part)
+{
+    using Head = std::pair<Key, size_t>; // Key and input index
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+    std::vector<size_t> pos(in.size()), end(in.size());
+    std::vector<EndGameType> results;
+
+    for (size_t i = 0; i < in.size(); i++) {
+        pos[i] = first ? 0 : in[i]->lower_bound(lo);
+        end[i] = last ? in[i]->size() : in[i]->lower_bound(hi);
+
+        if (pos[i] < end[i]) {
+            heap.emplace(in[i]->key(pos[i]), i);
+        }
+    }
+
+    while (!heap.empty()) {
+        const Key key = heap.top().first;
+
+        // Equal keys come out in input order
+        results.clear();
+
+        while (!heap.empty() && heap.top().first == key) {
+            const size_t i = heap.top().second;
+            heap.pop();
+
+            results.push_back(in[i]->result(pos[i]));
+
+            if (++pos[i] < end[i]) {
+                heap.emplace(in[i]->key(pos[i]), i);
+            }
+        }
+
+        if (std::any_of(results.begin(), results.end(),
+                        [&](EndGameType r) { return r != results.front(); })) {
+            part.conflicts++;
+        }
+
+        EndGameType type = EndGameType::none;
+
+        if (resolve(policy, results, type)) {
+            part.entries.emplace_back(key, type);
+        } else {
+            part.dropped++;
+        }
+    }
+}
+
+int usage()
+{
+    std::cerr << "Usage: sanmill-merge [-o output = endgame.bin] "
+                 "[-p last|first|majority|agree] [-t threads] input..."
+              << std::endl;
+
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    string output = "endgame.bin";
+    Policy policy = Policy::last;
+    size_t threadCount = std::max(1U, std::thread::hardware_concurrency());
+    std::vector<string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        const string arg = argv[i];
+
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "-t" && i + 1 < argc) {
+            threadCount = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "-p" && i + 1 < argc) {
+            const string p = argv[++i];
+
+            if (p == "last") {
+                policy = Policy::last;
+            } else if (p == "first") {
+                policy = Policy::first;
+            } else if (p == "majority") {
+                policy = Policy::majority;
+            } else if (p == "agree") {
+                policy = Policy::agree;
+            } else {
+                return usage();
+            }
+        } else if (arg[0] == '-') {
+            return usage();
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty()) {
+        return usage();
+    }
+
+    // The inputs are memory mapped and read sequentially by the merge
+    std::vector<std::unique_ptr<EndgameFile>> in;
+    size_t inputEntries = 0;
+
+    for (const string &name : inputs) {
+        auto f = std::make_unique<EndgameFile>();
+
+        if (!f->open(name)) {
+            std::cerr << "Skipping " << name << ": not an endgame file"
+                      << std::endl;
+            continue;
+        }
+
+        inputEntries += f->size();
+        in.push_back(std::move(f));
+    }
+
+    const std::vector<Key> split = splitters(in, threadCount);
+    std::vector<Part> parts(split.size() + 1);
+    std::vector<std::thread> threads;
+
+    for (size_t p = 0; p < parts.size(); p++) {
+        const bool first = p == 0, last = p == split.size();
+        const Key lo = first ? 0 : split[p - 1];
+        const Key hi = last ? 0 : split[p];
+
+        threads.emplace_back(merge_part, std::cref(in), lo, hi, first, last,
+                             policy, std::ref(parts[p]));
+    }
+
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    std::vector<EndgameFile::Entry> merged;
+    size_t conflicts = 0, dropped = 0, total = 0;
+
+    for (const Part &part : parts) {
+        total += part.entries.size();
+    }
+
+    merged.reserve(total);
+
+    for (Part &part : parts) {
+        merged.insert(merged.end(), part.entries.begin(), part.entries.end());
+        conflicts += part.conflicts;
+        dropped += part.dropped;
+        part.entries = {};
+    }
+
+    // The output may be one of the inputs, which must be unmapped first
+    in.clear();
+
+    const string tmpName = output + ".tmp";
+
+    if (!EndgameFile::write(tmpName, merged)) {
+        std::cerr << "Cannot write " << tmpName << std::endl;
+        std::remove(tmpName.c_str());
+        return 1;
+    }
+
+    // The output is replaced in one step, so it is never missing
+#ifdef _WIN32
+    if (!MoveFileExA(tmpName.c_str(), output.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+#else
+    if (std::rename(tmpName.c_str(), output.c_str()) != 0) {
+#endif
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+
+    std::cout << inputEntries << " entries merged into " << merged.size()
+              << " (" << conflicts << " conflicts, " << dropped
+              << " dropped) with " << parts.size() << " threads" << std::endl;
+
+    return 0;
+}
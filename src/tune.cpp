@@ -0,0 +1,332 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bitboard.h"
+#include "evaluate.h"
+#include "misc.h"
+#include "position.h"
+#include "tune.h"
+#include "uci.h"
+
+using std::string;
+
+namespace {
+
+using Eval::GRAIN;
+using Eval::TERM_NB;
+
+// The samples are evaluated in blocks which stay in the L1 cache
+constexpr size_t BLOCK_SIZE = 1024;
+
+constexpr int VALUE_RANGE = 2 * int(VALUE_MATE) - 1;
+
+/// Data holds the traced terms of the samples, one array per term, so that
+/// a block of samples is evaluated with vectorizable loops.
+
+struct Data
+{
+    size_t size {0};
+    std::vector<int16_t> terms[TERM_NB];
+    std::vector<float> results;
+};
+
+/// parallel_for() splits [0, n) in one range per thread and calls
+/// f(begin, end, idx) on each of them.
+
+template <typename F>
+void parallel_for(size_t n, size_t threadCount, const F &f)
+{
+    std::vector<std::thread> threads;
+    const size_t chunk = (n + threadCount - 1) / threadCount;
+
+    for (size_t idx = 0; idx < threadCount; idx++) {
+        const size_t begin = std::min(n, idx * chunk);
+        const size_t end = std::min(n, begin + chunk);
+
+        threads.emplace_back(f, begin, end, idx);
+    }
+
+    for (auto &th : threads) {
+        th.join();
+    }
+}
+
+/// to_fen() converts a sample to the FEN string read by Position::set().
+
+string to_fen(const Tune::Sample &s)
+{
+    string fen;
+
+    for (File f = FILE_A; f <= FILE_C; ++f) {
+        for (Rank r = RANK_1; r <= RANK_8; ++r) {
+            const Bitboard b = square_bb(make_square(f, r));
+
+            fen += (s.white & b) ? 'O' :
+                   (s.black & b) ? '@' :
+                   (s.ban & b)   ? 'X' :
+                                   '*';
+        }
+
+        fen += f == FILE_C ? ' ' : '/';
+    }
+
+    fen += s.sideToMove == BLACK ? "b " : "w ";
+    fen += static_cast<Phase>(s.phase) == Phase::moving ? "m " : "p ";
+
+    switch (static_cast<Action>(s.action)) {
+    case Action::place:
+        fen += "p ";
+        break;
+    case Action::remove:
+        fen += "r ";
+        break;
+    default:
+        fen += "s ";
+        break;
+    }
+
+    fen += std::to_string(popcount(s.white)) + " " +
+           std::to_string(s.whiteInHand) + " " +
+           std::to_string(popcount(s.black)) + " " +
+           std::to_string(s.blackInHand) + " " + std::to_string(s.toRemove) +
+           " 0 1";
+
+    return fen;
+}
+
+/// read_samples() reads the binary training file and traces the terms of its
+/// placing and moving positions.
+
+bool read_samples(const string &fileName, Data &data, size_t threadCount)
+{
+    std::ifstream file(fileName, std::ios::binary);
+
+    if (!file) {
+        return false;
+    }
+
+    std::vector<Tune::Sample> samples;
+    Tune::Sample s;
+
+    while (file.read(reinterpret_cast<char *>(&s), sizeof(s))) {
+        const Phase phase = static_cast<Phase>(s.phase);
+
+        if ((phase == Phase::placing || phase == Phase::moving) &&
+            s.result <= 2) {
+            samples.push_back(s);
+        }
+    }
+
+    data.size = samples.size();
+    data.results.resize(data.size);
+
+    for (auto &t : data.terms) {
+        t.resize(data.size);
+    }
+
+    parallel_for(data.size, threadCount,
+                 [&](size_t begin, size_t end, size_t) {
+                     Position pos;
+                     int terms[TERM_NB];
+
+                     for (size_t i = begin; i < end; i++) {
+                         pos.set(to_fen(samples[i]), nullptr);
+                         Eval::trace(pos, terms);
+
+                         for (int t = 0; t < TERM_NB; t++) {
+                             data.terms[t][i] = static_cast<int16_t>(terms[t]);
+                         }
+
+                         data.results[i] = samples[i].result / 2.0f;
+                     }
+                 });
+
+    return true;
+}
+
+/// error() returns the mean squared error between the game results and the
+/// winning probabilities of the evaluations, scaled by k. It evaluates the
+/// samples exactly as Eval::evaluate() does, one block at a time.
+
+double error(const Data &data, const int w[TERM_NB], double k,
+             size_t threadCount)
+{
+    // Winning probability of each Value from White's point of view
+    float sigmoid[VALUE_RANGE];
+
+    for (int v = 0; v < VALUE_RANGE; v++) {
+        sigmoid[v] = static_cast<float>(
+            1.0 / (1.0 + std::exp(-k * (v - int(VALUE_MATE) + 1))));
+    }
+
+    std::vector<double> sums(threadCount, 0.0);
+
+    parallel_for(data.size, threadCount,
+                 [&](size_t begin, size_t end, size_t idx) {
+                     int score[BLOCK_SIZE];
+                     double sum = 0.0;
+
+                     for (size_t b = begin; b < end; b += BLOCK_SIZE) {
+                         const size_t n = std::min(BLOCK_SIZE, end - b);
+
+                         std::fill(score, score + n, 0);
+
+                         for (int t = 0; t < TERM_NB; t++) {
+                             const int16_t *x = &data.terms[t][b];
+                             const int wt = w[t];
+
+                             for (size_t i = 0; i < n; i++) {
+                                 score[i] += wt * x[i];
+                             }
+                         }
+
+                         for (size_t i = 0; i < n; i++) {
+                             const int v = std::clamp(score[i] / GRAIN,
+                                                      -int(VALUE_MATE) + 1,
+                                                      int(VALUE_MATE) - 1);
+                             const float e = data.results[b + i] -
+                                             sigmoid[v + int(VALUE_MATE) - 1];
+                             sum += e * e;
+                         }
+                     }
+
+                     sums[idx] = sum;
+                 });
+
+    return std::accumulate(sums.begin(), sums.end(), 0.0) / data.size;
+}
+
+/// fit_k() finds the scaling constant which minimizes the error of the given
+/// weights, by a ternary search.
+
+double fit_k(const Data &data, const int w[TERM_NB], size_t threadCount)
+{
+    double lo = 0.001, hi = 2.0;
+
+    for (int i = 0; i < 40; i++) {
+        const double m1 = lo + (hi - lo) / 3;
+        const double m2 = hi - (hi - lo) / 3;
+
+        if (error(data, w, m1, threadCount) < error(data, w, m2, threadCount)) {
+            hi = m2;
+        } else {
+            lo = m1;
+        }
+    }
+
+    return (lo + hi) / 2;
+}
+
+} // namespace
+
+namespace Tune {
+
+/// tune() runs a Texel tuning of the evaluation weights: a local search which
+/// changes one weight at a time by one grain, as long as the error between
+/// the game results and the evaluations of the sampled positions decreases.
+/// The move ordering ratings are copied as they are. The command is:
+///
+/// tune <samples file> [weights file = tuned.weights] [epochs = 100]
+
+void tune(std::istream &is)
+{
+    string samplesFile, weightsFile = "tuned.weights", token;
+    int epochs = 100;
+
+    is >> samplesFile;
+
+    if (is >> token) {
+        weightsFile = token;
+    }
+
+    if (is >> token) {
+        std::istringstream ss(token);
+
+        if (!(ss >> epochs) || !ss.eof() || epochs <= 0) {
+            sync_cout << "info string Invalid epochs " << token << sync_endl;
+            return;
+        }
+    }
+
+    const size_t threadCount = std::max<size_t>(1, size_t(Options["Threads"]));
+    Data data;
+
+    if (!read_samples(samplesFile, data, threadCount) || data.size == 0) {
+        sync_cout << "info string No samples read from " << samplesFile
+                  << sync_endl;
+        return;
+    }
+
+    int w[TERM_NB];
+    std::copy(Eval::weights.term, Eval::weights.term + TERM_NB, w);
+
+    const TimePoint start = now();
+    const double k = fit_k(data, w, threadCount);
+    double best = error(data, w, k, threadCount);
+
+    sync_cout << "info string " << data.size << " samples, k " << k
+              << ", error " << best << sync_endl;
+
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        bool improved = false;
+
+        for (int t = 0; t < TERM_NB; t++) {
+            for (const int delta : {1, -1}) {
+                w[t] += delta;
+
+                const double e = error(data, w, k, threadCount);
+
+                if (e < best) {
+                    best = e;
+                    improved = true;
+                    break;
+                }
+
+                w[t] -= delta;
+            }
+        }
+
+        sync_cout << "info string epoch " << epoch << " error " << best
+                  << sync_endl;
+
+        if (!improved) {
+            break;
+        }
+    }
+
+    Eval::Weights tuned = Eval::weights;
+    std::copy(w, w + TERM_NB, tuned.term);
+
+    if (!Eval::save_weights(weightsFile, tuned)) {
+        sync_cout << "info string Cannot write " << weightsFile << sync_endl;
+        return;
+    }
+
+    sync_cout << "info string Weights written to " << weightsFile << " in "
+              << (now() - start) << " ms" << sync_endl;
+}
+
+} // namespace Tune
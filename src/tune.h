@@ -0,0 +1,50 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef TUNE_H_INCLUDED
+#define TUNE_H_INCLUDED
+
+#include <cstdint>
+#include <istream>
+
+namespace Tune {
+
+/// Tune::Sample is a record of the binary training file read by the tuner: a
+/// placing or moving position and the result of the game it was taken from.
+/// The bitboards use the Square numbering, the fields are little-endian.
+
+struct Sample
+{
+    uint32_t white; // Bitboard of the White pieces
+    uint32_t black; // Bitboard of the Black pieces
+    uint32_t ban;   // Bitboard of the banned squares
+    uint8_t sideToMove;
+    uint8_t phase;  // Phase::placing or Phase::moving
+    uint8_t action; // Action::select, place or remove
+    uint8_t whiteInHand;
+    uint8_t blackInHand;
+    uint8_t toRemove;
+    uint8_t result; // 0 Black wins, 1 draw, 2 White wins
+    uint8_t reserved;
+};
+
+static_assert(sizeof(Sample) == 20, "Sample must be packed");
+
+void tune(std::istream &is);
+
+} // namespace Tune
+
+#endif // #ifndef TUNE_H_INCLUDED
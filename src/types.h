@@ -281,6 +281,10 @@ using Depth = int8_t;
 
 enum : int { DEPTH_NONE = 0, DEPTH_OFFSET = DEPTH_NONE };
 
+// Deepest iteration the search is asked for, the depth of the strongest skill
+// level. Deeper searches would overflow the mate scores.
+constexpr Depth DEPTH_MAX = 30;
+
 enum Square : int {
     SQ_0 = 0,
     SQ_1 = 1,
@@ -14,10 +14,15 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <sstream>
 #include <vector>
 
+#include "book.h"
+#include "evaluate.h"
+#include "record.h"
 #include "thread.h"
+#include "tune.h"
 #include "uci.h"
 
 #ifdef FLUTTER_UI
@@ -76,8 +81,13 @@ void position(Position *pos, istringstream &is)
 
     pos->set(fen, Threads.main());
 
-    // Parse move list (if any)
-    while (is >> token && (m = UCI::to_move(pos, token)) != MOVE_NONE) {
+    // Parse move list (if any), in place: long game records are replayed
+    // without a string per move
+    string moves;
+    std::getline(is, moves);
+    const char *str = moves.c_str();
+
+    while ((m = UCI::to_move(pos, str)) != MOVE_NONE) {
         pos->do_move(m);
         if (type_of(m) == MOVETYPE_MOVE) {
             posKeyHistory.push_back(pos->key());
@@ -117,15 +127,28 @@ void setoption(istringstream &is)
 // the thinking time and other parameters from the input string, then starts
 // the search.
 
-void go(Position *pos)
+void go(Position *pos, istringstream &is)
 {
+    Search::LimitsType limits;
+    string token;
+
+    while (is >> token) {
+        if (token == "depth") {
+            int depth = 0;
+            is >> depth;
+            limits.depth = Depth(std::clamp(depth, 1, int(DEPTH_MAX)));
+        } else if (token == "nodes") {
+            is >> limits.nodes;
+        }
+    }
+
 #ifdef UCI_AUTO_RE_GO
 begin:
 #endif
 
     repetition = 0;
 
-    Threads.start_thinking(pos);
+    Threads.start_thinking(pos, limits);
 
     if (pos->get_phase() == Phase::gameOver) {
 #ifdef UCI_AUTO_RESTART
@@ -149,6 +172,208 @@ begin:
 #endif
 }
 
+// measure() calls f, which handles n items, until at least a second has passed
+// and reports the number of items handled per second.
+
+template <typename F>
+void measure(const char *what, size_t n, const F &f)
+{
+    size_t count = 0;
+    const TimePoint start = now();
+    TimePoint elapsed;
+
+    do {
+        f();
+        count += n;
+    } while ((elapsed = now() - start) < 1000);
+
+    sync_cout << "info string " << what << ": " << count * 1000 / elapsed
+              << "/s" << sync_endl;
+}
+
+// notation_bench() is called when engine receives the "notationbench" command.
+// It plays random games from the start position, then reports the throughput
+// of the FEN and move text parsers and formatters on their positions and
+// moves, and of the replay of the games as done by the "position" command:
+//
+// notationbench [games = 1000]
+
+void notation_bench(istringstream &is)
+{
+    int games = 1000;
+    string token;
+
+    if (is >> token) {
+        istringstream ss(token);
+
+        if (!(ss >> games) || !ss.eof() || games <= 0) {
+            sync_cout << "info string Invalid games " << token << sync_endl;
+            return;
+        }
+    }
+
+    PRNG rng(1070372);
+    Position pos;
+    vector<string> fens, records;
+    vector<Move> moves;
+
+    for (int g = 0; g < games; g++) {
+        string record;
+
+        pos.set(StartFEN, nullptr);
+
+        for (int ply = 0; ply < 200 && pos.get_phase() != Phase::gameOver;
+             ply++) {
+            const MoveList<LEGAL> legal(pos);
+
+            if (legal.size() == 0) {
+                break;
+            }
+
+            const Move m = legal.begin()[rng.rand<uint32_t>() % legal.size()];
+
+            fens.push_back(pos.fen());
+            moves.push_back(m);
+            record += UCI::move(m) + " ";
+            pos.do_move(m);
+        }
+
+        records.push_back(record);
+    }
+
+    sync_cout << "info string " << games << " games, " << moves.size()
+              << " moves" << sync_endl;
+
+    char buf[Position::FEN_LEN_MAX];
+    size_t checksum = 0;
+
+    measure("FEN parsed", fens.size(), [&] {
+        for (const auto &fen : fens) {
+            checksum += pos.set(fen, nullptr).key();
+        }
+    });
+
+    measure("FEN written", fens.size(), [&] {
+        for (size_t i = 0; i < fens.size(); i++) {
+            checksum += pos.fen(buf) - buf;
+        }
+    });
+
+    measure("Moves parsed", moves.size(), [&] {
+        for (const auto &record : records) {
+            const char *str = record.c_str();
+
+            while (*str) {
+                checksum += UCI::parse_move(str);
+                str++; // Space
+            }
+        }
+    });
+
+    measure("Moves written", moves.size(), [&] {
+        for (const Move m : moves) {
+            checksum += UCI::write_move(m, buf) - buf;
+        }
+    });
+
+    measure("Moves replayed", moves.size(), [&] {
+        for (const auto &record : records) {
+            const char *str = record.c_str();
+            Move m;
+
+            pos.set(StartFEN, nullptr);
+
+            while ((m = UCI::to_move(&pos, str)) != MOVE_NONE) {
+                pos.do_move(m);
+            }
+
+            checksum += pos.key();
+        }
+    });
+
+    sync_cout << "info string Checksum " << checksum << sync_endl;
+}
+
+// eval_bench() is called when engine receives the "evalbench" command. It
+// plays random games from the start position, checks that evaluate_batch()
+// scores their placing and moving positions like evaluate(), then reports the
+// throughput of both:
+//
+// evalbench [games = 500]
+
+void eval_bench(istringstream &is)
+{
+    int games = 500;
+    string token;
+
+    if (is >> token) {
+        istringstream ss(token);
+
+        if (!(ss >> games) || !ss.eof() || games <= 0) {
+            sync_cout << "info string Invalid games " << token << sync_endl;
+            return;
+        }
+    }
+
+    PRNG rng(1070372);
+    Position pos;
+    vector<string> fens;
+
+    for (int g = 0; g < games; g++) {
+        pos.set(StartFEN, nullptr);
+
+        for (int ply = 0; ply < 200 && pos.get_phase() != Phase::gameOver;
+             ply++) {
+            const MoveList<LEGAL> legal(pos);
+
+            if (legal.size() == 0) {
+                break;
+            }
+
+            if (pos.get_phase() == Phase::placing ||
+                pos.get_phase() == Phase::moving) {
+                fens.push_back(pos.fen());
+            }
+
+            pos.do_move(legal.begin()[rng.rand<uint32_t>() % legal.size()]);
+        }
+    }
+
+    vector<Position> positions(fens.size());
+    Eval::Batch batch;
+
+    for (size_t i = 0; i < fens.size(); i++) {
+        positions[i].set(fens[i], nullptr);
+        batch.add(positions[i]);
+    }
+
+    vector<Value> values(batch.size());
+    size_t mismatches = 0;
+    int64_t checksum = 0;
+
+    Eval::evaluate_batch(batch, values.data());
+
+    for (size_t i = 0; i < positions.size(); i++) {
+        mismatches += Eval::evaluate(positions[i]) != values[i];
+    }
+
+    sync_cout << "info string " << games << " games, " << positions.size()
+              << " positions, " << mismatches << " mismatches" << sync_endl;
+
+    measure("Positions evaluated", positions.size(), [&] {
+        for (auto &p : positions) {
+            checksum += Eval::evaluate(p);
+        }
+    });
+
+    measure("Positions evaluated in batch", positions.size(), [&] {
+        Eval::evaluate_batch(batch, values.data());
+        checksum += values.back();
+    });
+
+    sync_cout << "info string Checksum " << checksum << sync_endl;
+}
+
 } // namespace
 
 /// UCI::loop() waits for a command from stdin, parses it and calls the
@@ -245,7 +470,7 @@ void UCI::loop(int argc, char *argv[])
         else if (token == "setoption")
             setoption(is);
         else if (token == "go")
-            go(pos);
+            go(pos, is);
         else if (token == "position")
             position(pos, is);
         else if (token == "ucinewgame")
@@ -259,6 +484,16 @@ void UCI::loop(int argc, char *argv[])
             sync_cout << *pos << sync_endl;
         else if (token == "compiler")
             sync_cout << compiler_info() << sync_endl;
+        else if (token == "tune")
+            Tune::tune(is);
+        else if (token == "book")
+            Book::build(is, StartFEN);
+        else if (token == "notationbench")
+            notation_bench(is);
+        else if (token == "evalbench")
+            eval_bench(is);
+        else if (token == "records")
+            Record::command(is);
         else
             sync_cout << "Unknown command: " << cmd << sync_endl;
     } while (token != "quit" && argc == 1); // Command line args are one-shot
@@ -275,14 +510,16 @@ void UCI::loop(int argc, char *argv[])
 
 string UCI::value(Value v)
 {
-    assert(-VALUE_INFINITE < v && v < VALUE_INFINITE);
+    // A side left without legal moves is scored -VALUE_INFINITE by the search
+    assert(-VALUE_INFINITE <= v && v <= VALUE_INFINITE);
 
     stringstream ss;
 
     if (abs(v) < VALUE_MATE_IN_MAX_PLY)
         ss << "cp " << v / PieceValue;
     else
-        ss << "mate " << (v > 0 ? VALUE_MATE - v + 1 : -VALUE_MATE - v) / 2;
+        ss << "mate "
+           << int(v > 0 ? VALUE_MATE - v + 1 : -VALUE_MATE - v) / 2;
 
     return ss.str();
 }
@@ -296,40 +533,143 @@ std::string UCI::square(Square s)
                         char('0' + rank_of(s)), char(')')};
 }
 
+/// UCI::write_move() writes a Move in algebraic notation ((1,2), -(1,2) or
+/// (1,2)->(1,3)) and a terminating null to buf, which holds at least
+/// MOVE_LEN_MAX chars. It returns a pointer to the null.
+
+char *UCI::write_move(Move m, char *buf)
+{
+    const auto write_square = [&buf](Square s) {
+        buf[0] = '(';
+        buf[1] = char('0' + file_of(s));
+        buf[2] = ',';
+        buf[3] = char('0' + rank_of(s));
+        buf[4] = ')';
+        buf += 5;
+    };
+
+    if (m == MOVE_NONE || m == MOVE_NULL) {
+        const char *str = m == MOVE_NONE ? "(none)" : "0000";
+
+        while (*str) {
+            *buf++ = *str++;
+        }
+    } else if (m < 0) {
+        *buf++ = '-';
+        write_square(to_sq(m));
+    } else if (m & 0x7f00) {
+        write_square(from_sq(m));
+        *buf++ = '-';
+        *buf++ = '>';
+        write_square(to_sq(m));
+    } else {
+        write_square(to_sq(m));
+    }
+
+    *buf = '\0';
+
+    return buf;
+}
+
 /// UCI::move() converts a Move to a string in algebraic notation ((1,2), etc.).
 
 string UCI::move(Move m)
 {
-    string move;
+    char buf[MOVE_LEN_MAX];
 
-    const Square to = to_sq(m);
+    return string(buf, write_move(m, buf));
+}
 
-    if (m == MOVE_NONE)
-        return "(none)";
+/// UCI::parse_move() reads a move in algebraic notation at str, without
+/// checking that it is legal, and advances str past it. It returns MOVE_NONE,
+/// leaving str as it is, if there is no valid move text at str.
 
-    if (m == MOVE_NULL)
-        return "0000";
+Move UCI::parse_move(const char *&str)
+{
+    const auto parse_square = [](const char *&s) {
+        if (s[0] != '(' || s[1] < '1' || s[1] > '3' || s[2] != ',' ||
+            s[3] < '1' || s[3] > '8' || s[4] != ')') {
+            return SQ_NONE;
+        }
 
-    if (m < 0) {
-        move = "-" + UCI::square(to);
-    } else if (m & 0x7f00) {
-        const Square from = from_sq(m);
-        move = UCI::square(from) + "->" + UCI::square(to);
+        const Square sq = make_square(File(s[1] - '0'), Rank(s[3] - '0'));
+        s += 5;
+
+        return sq;
+    };
+
+    const char *s = str;
+    Move m;
+
+    if (*s == '-') {
+        const Square to = parse_square(++s);
+
+        if (to == SQ_NONE) {
+            return MOVE_NONE;
+        }
+
+        m = Move(-to);
     } else {
-        move = UCI::square(to);
+        const Square from = parse_square(s);
+
+        if (from == SQ_NONE) {
+            return MOVE_NONE;
+        }
+
+        if (s[0] == '-' && s[1] == '>') {
+            s += 2;
+
+            const Square to = parse_square(s);
+
+            if (to == SQ_NONE) {
+                return MOVE_NONE;
+            }
+
+            m = make_move(from, to);
+        } else {
+            m = Move(from);
+        }
     }
 
-    return move;
+    str = s;
+
+    return m;
+}
+
+/// UCI::to_move() reads the next space separated move of str, advances str
+/// past it and returns the corresponding legal Move. It returns MOVE_NONE at
+/// the end of str or if the move is not valid.
+
+Move UCI::to_move(Position *pos, const char *&str)
+{
+    const char *s = str;
+
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+
+    const Move m = parse_move(s);
+
+    if (m == MOVE_NONE || (*s != '\0' && *s != ' ' && *s != '\t' &&
+                           *s != '\r' && *s != '\n') ||
+        !MoveList<LEGAL>(*pos).contains(m)) {
+        return MOVE_NONE;
+    }
+
+    str = s;
+
+    return m;
 }
 
 /// UCI::to_move() converts a string representing a move in coordinate notation
 /// to the corresponding legal Move, if any.
 
-Move UCI::to_move(Position *pos, string &str)
+Move UCI::to_move(Position *pos, const string &str)
 {
-    for (const auto &m : MoveList<LEGAL>(*pos))
-        if (str == UCI::move(m))
-            return m;
+    const char *s = str.c_str();
+    const Move m = parse_move(s);
 
-    return MOVE_NONE;
+    return m != MOVE_NONE && *s == '\0' && MoveList<LEGAL>(*pos).contains(m) ?
+               m :
+               MOVE_NONE;
 }
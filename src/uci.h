@@ -70,7 +70,14 @@ void loop(int argc, char *argv[]);
 std::string value(Value v);
 std::string square(Square s);
 std::string move(Move m);
-Move to_move(Position *pos, std::string &str);
+Move to_move(Position *pos, const std::string &str);
+Move to_move(Position *pos, const char *&str);
+
+// Longest move text, "(f,r)->(f,r)", with its terminating null
+constexpr int MOVE_LEN_MAX = 13;
+
+Move parse_move(const char *&str);
+char *write_move(Move m, char *buf);
 
 } // namespace UCI
 
@@ -16,10 +16,17 @@
 
 #include <sstream>
 
+#include "book.h"
+#include "evaluate.h"
+#include "nnue/evaluate_nnue.h"
 #include "option.h"
 #include "thread.h"
 #include "uci.h"
 
+#ifdef MADWEASEL_MUEHLE_PERFECT_AI
+#include "perfect/perfect.h"
+#endif
+
 using std::string;
 
 UCI::OptionsMap Options; // Global object
@@ -56,6 +63,11 @@ void on_skill_level(const Option &o)
     gameOptions.setSkillLevel((int)o);
 }
 
+void on_multiPV(const Option &o)
+{
+    gameOptions.setMultiPV((int)o);
+}
+
 void on_move_time(const Option &o)
 {
     gameOptions.setMoveTime((int)o);
@@ -71,6 +83,11 @@ void on_random_move(const Option &o)
     gameOptions.setShufflingEnabled((bool)o);
 }
 
+void on_shuffling_seed(const Option &o)
+{
+    gameOptions.setShufflingSeed((int)o);
+}
+
 void on_algorithm(const Option &o)
 {
     gameOptions.setAlgorithm((int)o);
@@ -84,6 +101,9 @@ void on_drawOnHumanExperience(const Option &o)
 void on_considerMobility(const Option &o)
 {
     gameOptions.setConsiderMobility((bool)o);
+
+    // Cached evaluations are stale now
+    Search::clear();
 }
 
 void on_developerMode(const Option &o)
@@ -91,6 +111,92 @@ void on_developerMode(const Option &o)
     gameOptions.setDeveloperMode((bool)o);
 }
 
+void on_futilityPruning(const Option &o)
+{
+    gameOptions.setFutilityPruning((bool)o);
+}
+
+void on_lateMoveReduction(const Option &o)
+{
+    gameOptions.setLateMoveReduction((bool)o);
+}
+
+void on_verifiedNullMove(const Option &o)
+{
+    gameOptions.setVerifiedNullMove((bool)o);
+}
+
+void on_eval_file(const Option &o)
+{
+    const string fileName = o;
+
+    if (!Eval::load_weights(fileName)) {
+        sync_cout << "info string Failed to load weights from " << fileName
+                  << sync_endl;
+        return;
+    }
+
+    sync_cout << "info string Weights loaded from " << fileName << sync_endl;
+
+    // Cached evaluations and search results are stale now
+    Search::clear();
+}
+
+void on_use_nnue(const Option &o)
+{
+    Eval::NNUE::set_enabled((bool)o);
+    Search::clear();
+}
+
+void on_nnue_file(const Option &o)
+{
+    const string fileName = o;
+
+    if (!Eval::NNUE::load(fileName)) {
+        sync_cout << "info string Failed to load network from " << fileName
+                  << sync_endl;
+        return;
+    }
+
+    sync_cout << "info string Network loaded from " << fileName << sync_endl;
+
+    Search::clear();
+}
+
+void on_opening_book(const Option &o)
+{
+    gameOptions.setOpeningBook((bool)o);
+}
+
+void on_canonical_keys(const Option &o)
+{
+    gameOptions.setCanonicalKeys((bool)o);
+
+    // The keys of the transposition table change
+    Search::clear();
+}
+
+void on_book_file(const Option &o)
+{
+    const string fileName = o;
+
+    if (!Book::open(fileName)) {
+        sync_cout << "info string Failed to open book " << fileName
+                  << sync_endl;
+        return;
+    }
+
+    sync_cout << "info string Book opened from " << fileName << sync_endl;
+}
+
+#ifdef MADWEASEL_MUEHLE_PERFECT_AI
+void on_perfect_database_memory(const Option &o)
+{
+    gameOptions.setPerfectDatabaseMemory((int)o);
+    perfect_set_memory_budget();
+}
+#endif
+
 // Rules
 
 void on_piecesCount(const Option &o)
@@ -196,7 +302,7 @@ void init(OptionsMap &o)
     o["Hash"] << Option(16, 1, MaxHashMB, on_hash_size);
     o["Clear Hash"] << Option(on_clear_hash);
     o["Ponder"] << Option(false);
-    o["MultiPV"] << Option(1, 1, 500);
+    o["MultiPV"] << Option(1, 1, 500, on_multiPV);
     o["SkillLevel"] << Option(1, 0, 30, on_skill_level);
     o["MoveTime"] << Option(1, 0, 60, on_move_time);
     o["AiIsLazy"] << Option(false, on_aiIsLazy);
@@ -208,10 +314,24 @@ void init(OptionsMap &o)
     o["UCI_Elo"] << Option(1350, 1350, 2850);
 
     o["Shuffling"] << Option(true, on_random_move);
+    o["ShufflingSeed"] << Option(0, 0, 9999999, on_shuffling_seed);
     o["Algorithm"] << Option(2, 0, 2, on_algorithm);
     o["DrawOnHumanExperience"] << Option(true, on_drawOnHumanExperience);
     o["ConsiderMobility"] << Option(true, on_considerMobility);
     o["DeveloperMode"] << Option(true, on_developerMode);
+    o["FutilityPruning"] << Option(false, on_futilityPruning);
+    o["LateMoveReduction"] << Option(false, on_lateMoveReduction);
+    o["VerifiedNullMove"] << Option(false, on_verifiedNullMove);
+    o["EvalFile"] << Option("sanmill.weights", on_eval_file);
+    o["UseNNUE"] << Option(false, on_use_nnue);
+    o["NNUEFile"] << Option("", on_nnue_file);
+    o["OpeningBook"] << Option(false, on_opening_book);
+    o["BookFile"] << Option("book.bin", on_book_file);
+    o["CanonicalKeys"] << Option(false, on_canonical_keys);
+#ifdef MADWEASEL_MUEHLE_PERFECT_AI
+    o["PerfectDatabaseMemory"]
+        << Option(0, 0, MaxHashMB, on_perfect_database_memory);
+#endif
 
     // Rules
     o["PiecesCount"] << Option(9, 9, 12, on_piecesCount);
@@ -33,6 +33,7 @@
 #include <QTimer>
 
 #include "boarditem.h"
+#include "book.h"
 #include "client.h"
 #include "game.h"
 #include "graphicsconst.h"
@@ -95,7 +96,7 @@ Game::Game(GameScene &scene, QObject *parent)
 
 #ifdef ENDGAME_LEARNING_FORCE
     if (gameOptions.isEndgameLearningEnabled()) {
-        Thread::loadEndgameFileToHashMap();
+        Thread::openEndgameFile();
     }
 #endif
 
@@ -166,7 +167,7 @@ Game::~Game()
 
 #ifdef ENDGAME_LEARNING
     if (gameOptions.isEndgameLearningEnabled()) {
-        Thread::saveEndgameHashMapToFile();
+        Thread::compactEndgameFile();
     }
 #endif /* ENDGAME_LEARNING */
 
@@ -195,11 +196,6 @@ const map<int, QStringList> Game::getActions()
     return actions;
 }
 
-#ifdef OPENING_BOOK
-extern deque<int> openingBookDeque;
-extern deque<int> openingBookDequeBak;
-#endif
-
 void Game::gameStart()
 {
     // moveHistory.clear();
@@ -213,13 +209,6 @@ void Game::gameStart()
 
     gameStartTime = now();
     gameStartCycle = stopwatch::rdtscp_clock::now();
-
-#ifdef OPENING_BOOK
-    if (openingBookDeque.empty() && !openingBookDequeBak.empty()) {
-        openingBookDeque = openingBookDequeBak;
-        openingBookDequeBak.clear();
-    }
-#endif
 }
 
 void Game::gameReset()
@@ -687,7 +676,7 @@ void Game::setLearnEndgame(bool enabled)
 
 #ifdef ENDGAME_LEARNING
     if (gameOptions.isEndgameLearningEnabled()) {
-        Thread::loadEndgameFileToHashMap();
+        Thread::openEndgameFile();
     }
 #endif
 }
@@ -724,6 +713,10 @@ void Game::setOpeningBook(bool enabled)
 {
     gameOptions.setOpeningBook(enabled);
     settings->setValue("Options/OpeningBook", enabled);
+
+    if (enabled) {
+        Book::open("book.bin");
+    }
 }
 
 void Game::setDeveloperMode(bool enabled)
@@ -0,0 +1,119 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "bitboard.h"
+#include "book.h"
+#include "movegen.h"
+#include "option.h"
+#include "position.h"
+#include "uci.h"
+
+namespace {
+
+const char *StartFEN = "********/********/******** w p p 0 9 0 9 0 0 1";
+const char *GamesFile = "book_test_games.txt";
+const char *BookFile = "book_test.bin";
+
+class BookTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        UCI::init(Options);
+        Bitboards::init();
+        Position::init();
+    }
+
+    // Writes a book in which the first move a is played in two won games and
+    // the first move b in a drawn one, i.e. a weighs 4 and b weighs 1
+    void SetUp() override
+    {
+        pos.set(StartFEN, nullptr);
+
+        const MoveList<LEGAL> legal(pos);
+        ASSERT_GE(legal.size(), 2U);
+
+        a = legal.begin()[0];
+        b = legal.begin()[1];
+
+        std::ofstream games(GamesFile);
+        games << "1-0 " << UCI::move(a) << "\n"
+              << "1-0 " << UCI::move(a) << "\n"
+              << "1/2-1/2 " << UCI::move(b) << "\n";
+        games.close();
+
+        std::istringstream is(std::string(GamesFile) + " " + BookFile);
+        Book::build(is, StartFEN);
+        ASSERT_TRUE(Book::open(BookFile));
+
+        shuffling = gameOptions.getShufflingEnabled();
+        seed = gameOptions.getShufflingSeed();
+    }
+
+    void TearDown() override
+    {
+        gameOptions.setShufflingEnabled(shuffling);
+        gameOptions.setShufflingSeed(seed);
+        Book::open("");
+        std::remove(GamesFile);
+        std::remove(BookFile);
+    }
+
+    Position pos;
+    Move a {MOVE_NONE};
+    Move b {MOVE_NONE};
+    bool shuffling {true};
+    int seed {0};
+};
+
+// Without shuffling the heaviest move is always played
+TEST_F(BookTest, probeWithoutShufflingPlaysHeaviestMove)
+{
+    gameOptions.setShufflingEnabled(false);
+
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(Book::probe(pos), a);
+    }
+}
+
+// A fixed seed repeats the pick, different seeds pick both moves
+TEST_F(BookTest, probeFollowsShufflingSeed)
+{
+    std::set<Move> picked;
+
+    gameOptions.setShufflingEnabled(true);
+
+    for (int s = 1; s <= 50; s++) {
+        gameOptions.setShufflingSeed(s);
+
+        const Move m = Book::probe(pos);
+        EXPECT_TRUE(m == a || m == b);
+        EXPECT_EQ(Book::probe(pos), m) << "seed " << s;
+        picked.insert(m);
+    }
+
+    EXPECT_EQ(picked.size(), 2U);
+}
+
+} // namespace
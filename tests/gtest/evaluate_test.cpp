@@ -0,0 +1,121 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "bitboard.h"
+#include "evaluate.h"
+#include "misc.h"
+#include "movegen.h"
+#include "option.h"
+#include "position.h"
+#include "rule.h"
+#include "uci.h"
+
+namespace {
+
+class EvaluateTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        UCI::init(Options);
+        Bitboards::init();
+        Position::init();
+    }
+
+    // Plays random games of the current rule and adds their placing and
+    // moving positions to the batch, with their evaluation by evaluate()
+    static void play_games(int games, Eval::Batch &batch,
+                           std::vector<Value> &expected)
+    {
+        PRNG rng(1070372);
+        char fen[Position::FEN_LEN_MAX];
+        Position pos;
+
+        snprintf(fen, sizeof(fen),
+                 "********/********/******** w p p 0 %d 0 %d 0 0 1",
+                 rule.pieceCount, rule.pieceCount);
+
+        for (int g = 0; g < games; g++) {
+            pos.set(fen, nullptr);
+
+            for (int ply = 0; ply < 200 && pos.get_phase() != Phase::gameOver;
+                 ply++) {
+                const MoveList<LEGAL> legal(pos);
+
+                if (legal.size() == 0) {
+                    break;
+                }
+
+                if (pos.get_phase() == Phase::placing ||
+                    pos.get_phase() == Phase::moving) {
+                    batch.add(pos);
+                    expected.push_back(Eval::evaluate(pos));
+                }
+
+                pos.do_move(
+                    legal.begin()[rng.rand<uint32_t>() % legal.size()]);
+            }
+        }
+    }
+};
+
+// evaluate_batch() must score every position exactly like evaluate(), for the
+// rules with and without diagonal lines, banned locations and flying, with and
+// without mobility
+TEST_F(EvaluateTest, batchMatchesEvaluate)
+{
+    const Rule saved = rule;
+    const bool mobility = gameOptions.getConsiderMobility();
+
+    for (int r = 1; r < N_RULES; r++) {
+        ASSERT_TRUE(set_rule(r));
+        Position().reset(); // Tables of the rule
+
+        for (const bool considerMobility : {true, false}) {
+            gameOptions.setConsiderMobility(considerMobility);
+
+            Eval::Batch batch;
+            std::vector<Value> expected;
+            play_games(200, batch, expected);
+
+            std::vector<Value> values(batch.size(), VALUE_NONE);
+            Eval::evaluate_batch(batch, values.data());
+
+            ASSERT_GT(batch.size(), 0U);
+
+            size_t mismatches = 0;
+
+            for (size_t i = 0; i < batch.size(); i++) {
+                mismatches += values[i] != expected[i];
+            }
+
+            EXPECT_EQ(mismatches, 0U)
+                << RULES[r].name << ", mobility " << considerMobility << ", "
+                << batch.size() << " positions";
+        }
+    }
+
+    gameOptions.setConsiderMobility(mobility);
+    std::memcpy(&rule, &saved, sizeof(Rule));
+    Position().reset();
+}
+
+} // namespace
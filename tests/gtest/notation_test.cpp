@@ -0,0 +1,114 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "option.h"
+#include "position.h"
+#include "uci.h"
+
+namespace {
+
+const char *StartFEN = "********/********/******** w p p 0 9 0 9 0 0 1";
+
+class NotationTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        UCI::init(Options);
+        Bitboards::init();
+        Position::init();
+    }
+
+    // Writes m and parses it back, which must read the whole text
+    static void expectRoundTrip(Move m)
+    {
+        char buf[UCI::MOVE_LEN_MAX];
+        const char *end = UCI::write_move(m, buf);
+        const char *str = buf;
+
+        EXPECT_LT(end - buf, UCI::MOVE_LEN_MAX);
+        EXPECT_EQ(size_t(end - buf), strlen(buf));
+        EXPECT_EQ(UCI::parse_move(str), m) << buf;
+        EXPECT_EQ(str, end) << buf;
+    }
+};
+
+// Placements, removals and moves on all the squares read back unchanged
+TEST_F(NotationTest, moveTextRoundTrip)
+{
+    for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
+        expectRoundTrip(Move(s));
+        expectRoundTrip(Move(-s));
+
+        for (Square t = SQ_BEGIN; t < SQ_END; ++t) {
+            if (t != s) {
+                expectRoundTrip(make_move(s, t));
+            }
+        }
+    }
+}
+
+TEST_F(NotationTest, parseMoveRejectsMalformedText)
+{
+    for (const char *text : {"", "(0,1)", "(4,1)", "(1,0)", "(1,9)", "(1,2",
+                             "1,2)", "-(1,2", "--(1,2)", "(1,2)->",
+                             "(1,2)->(1,9)"}) {
+        const char *str = text;
+
+        EXPECT_EQ(UCI::parse_move(str), MOVE_NONE) << '"' << text << '"';
+    }
+}
+
+// The FEN of each position of a game sets the same position, and the text of
+// each legal move reads back as that move
+TEST_F(NotationTest, fenAndLegalMovesRoundTrip)
+{
+    Position pos;
+    Position copy;
+    char fen[Position::FEN_LEN_MAX];
+    char buf[UCI::MOVE_LEN_MAX];
+
+    pos.set(StartFEN, nullptr);
+    EXPECT_EQ(std::string(fen, pos.fen(fen)), StartFEN);
+
+    for (int ply = 0; ply < 40; ply++) {
+        pos.fen(fen);
+        copy.set(fen, nullptr);
+        EXPECT_EQ(copy.fen(), std::string(fen)) << "ply " << ply;
+
+        const MoveList<LEGAL> legal(pos);
+
+        if (legal.size() == 0) {
+            break;
+        }
+
+        for (const auto &m : legal) {
+            UCI::write_move(m, buf);
+            EXPECT_EQ(UCI::to_move(&pos, std::string(buf)), Move(m)) << buf;
+        }
+
+        pos.do_move(legal.begin()[ply % legal.size()]);
+    }
+}
+
+} // namespace
@@ -0,0 +1,126 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "option.h"
+#include "position.h"
+#include "record.h"
+#include "rule.h"
+#include "uci.h"
+
+namespace {
+
+const char *StartFEN = "********/********/******** w p p 0 9 0 9 0 0 1";
+const char *HistoryFile = "record_test_history.txt";
+const char *RecordFile = "record_test.bin";
+
+class RecordTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        UCI::init(Options);
+        Bitboards::init();
+        Position::init();
+    }
+
+    // Plays the first legal move of each position through the placing phase
+    // and writes the game as the GUI saves its move history
+    void SetUp() override
+    {
+        int ruleNo = 0;
+        char header[Position::RECORD_LEN_MAX];
+        char buf[UCI::MOVE_LEN_MAX];
+        Position pos;
+
+        while (ruleNo < N_RULES && strcmp(rule.name, RULES[ruleNo].name)) {
+            ruleNo++;
+        }
+
+        snprintf(header, sizeof(header), "r%1d s%03u t%02d", ruleNo + 1,
+                 rule.nMoveRule, 0);
+
+        std::ofstream history(HistoryFile);
+        history << header << "\n";
+
+        pos.set(StartFEN, nullptr);
+
+        while (pos.get_phase() == Phase::placing) {
+            const MoveList<LEGAL> legal(pos);
+
+            if (legal.size() == 0) {
+                break;
+            }
+
+            const Move m = legal.begin()[0];
+
+            keys.push_back(pos.key());
+            UCI::write_move(m, buf);
+            history << buf << "\n";
+            pos.do_move(m);
+        }
+
+        keys.push_back(pos.key());
+        history << "Player1 win!\n";
+    }
+
+    void TearDown() override
+    {
+        std::remove(HistoryFile);
+        std::remove(RecordFile);
+    }
+
+    std::vector<Key> keys;
+};
+
+// A move history imported to a record file replays to the same positions
+TEST_F(RecordTest, importedHistoryReplaysToSamePositions)
+{
+    std::istringstream is(std::string("import ") + HistoryFile + " " +
+                          RecordFile);
+    Record::command(is);
+
+    Record::Reader in;
+    Position pos;
+    std::vector<Key> replayed;
+
+    ASSERT_TRUE(in.open(RecordFile));
+    ASSERT_TRUE(in.next());
+    EXPECT_EQ(in.result(), Record::Result::whiteWins);
+
+    pos.set(StartFEN, nullptr);
+    EXPECT_TRUE(in.replay(pos, [&replayed](const Position &p, Move) {
+        replayed.push_back(p.key());
+        return true;
+    }));
+    replayed.push_back(pos.key());
+
+    EXPECT_GT(replayed.size(), 18U);
+    EXPECT_EQ(replayed, keys);
+    EXPECT_FALSE(in.next());
+}
+
+} // namespace
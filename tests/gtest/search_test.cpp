@@ -0,0 +1,170 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "option.h"
+#include "position.h"
+#include "search.h"
+#include "thread.h"
+#include "uci.h"
+
+namespace {
+
+class SearchTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        UCI::init(Options);
+        Bitboards::init();
+        Position::init();
+        Threads.set(1);
+        Search::clear();
+
+        // Keep the move order the same for every search
+        gameOptions.setShufflingEnabled(false);
+        MoveList<LEGAL>::shuffle();
+    }
+
+    static void TearDownTestSuite() { Threads.set(0); }
+
+    void TearDown() override
+    {
+        gameOptions.setAlgorithm(2);
+        gameOptions.setMultiPV(1);
+    }
+
+    // Searches the position like "go depth <depth>" and returns the move
+    static Move go_depth(Position &pos, int depth)
+    {
+        Search::LimitsType limits;
+
+        limits.depth = Depth(depth);
+        Threads.main()->us = pos.side_to_move();
+        Threads.start_thinking(&pos, limits);
+        Threads.main()->wait_for_search_finished();
+
+        return Threads.main()->bestMove;
+    }
+
+    // Returns true if the side to move can close a mill
+    static bool can_close_mill(const Position &pos)
+    {
+        Sanmill::Stack<Position> ss;
+        Position p;
+
+        std::memcpy(static_cast<void *>(&p), &pos, sizeof(Position));
+
+        for (const auto &m : MoveList<LEGAL>(p)) {
+            ss.push(p);
+            p.do_move(m.move);
+            const bool mill = p.get_action() == Action::remove;
+            p.undo_move(ss);
+
+            if (mill) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Returns true if the mover closes a mill on the next turn whatever the
+    // opponent replies to the move
+    static bool forces_mill(const Position &pos, Move move)
+    {
+        Sanmill::Stack<Position> ss;
+        Position p;
+
+        std::memcpy(static_cast<void *>(&p), &pos, sizeof(Position));
+        p.do_move(move);
+
+        for (const auto &m : MoveList<LEGAL>(p)) {
+            ss.push(p);
+            p.do_move(m.move);
+            const bool mill = p.get_action() != Action::remove &&
+                              can_close_mill(p);
+            p.undo_move(ss);
+
+            if (!mill) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+// Black forces a mill in three plies. The skill level searches one ply and
+// plays another move, so only a search to the depth of "go depth" finds it.
+constexpr auto ForcedMillFEN = "*@*@*@@*/*@**O@*O/@OOO**O* b m p 6 0 7 0 0 0 "
+                               "24";
+
+TEST_F(SearchTest, goDepthReplacesSkillLevel)
+{
+    gameOptions.setSkillLevel(1);
+
+    for (int algorithm = 0; algorithm <= 2; algorithm++) {
+        gameOptions.setAlgorithm(algorithm);
+
+        Position shallow;
+        shallow.set(ForcedMillFEN, Threads.main());
+        const Move skillMove = go_depth(shallow, 1);
+
+        for (int depth : {3, 5}) {
+            Position pos;
+            pos.set(ForcedMillFEN, Threads.main());
+            const Move move = go_depth(pos, depth);
+            EXPECT_NE(move, skillMove)
+                << "algorithm " << algorithm << ", depth " << depth;
+            EXPECT_TRUE(forces_mill(pos, move))
+                << "algorithm " << algorithm << ", depth " << depth;
+        }
+    }
+}
+
+// Black has only one legal move. The depth extension searches its reply at
+// the depth of the root, which must not be taken for the root of a line.
+constexpr auto OneLegalMoveFEN = "@OO***O@/OO**O@O@/***O@@@@ b m p 8 0 8 0 0 1 "
+                                 "12";
+
+TEST_F(SearchTest, multiPVWithOneLegalMove)
+{
+    gameOptions.setMultiPV(2);
+
+    for (int algorithm = 0; algorithm <= 2; algorithm++) {
+        gameOptions.setAlgorithm(algorithm);
+
+        Position pos;
+        pos.set(OneLegalMoveFEN, Threads.main());
+        MoveList<LEGAL> ml(pos);
+        ASSERT_EQ(ml.size(), 1U);
+
+        EXPECT_EQ(go_depth(pos, 4), ml.begin()->move)
+            << "algorithm " << algorithm;
+        EXPECT_GT(Threads.main()->bestvalue, -VALUE_INFINITE)
+            << "algorithm " << algorithm;
+        EXPECT_LT(Threads.main()->bestvalue, VALUE_INFINITE)
+            << "algorithm " << algorithm;
+    }
+}
+
+} // namespace
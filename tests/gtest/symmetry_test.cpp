@@ -0,0 +1,106 @@
+// This file is part of Sanmill.
+// Copyright (C) 2019-2021 The Sanmill developers (see AUTHORS file)
+//
+// Sanmill is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Sanmill is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "option.h"
+#include "position.h"
+#include "symmetry.h"
+#include "uci.h"
+
+using Symmetry::SYMMETRY_NB;
+
+namespace {
+
+const char *StartFEN = "********/********/******** w p p 0 9 0 9 0 0 1";
+
+class SymmetryTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        UCI::init(Options);
+        Bitboards::init();
+        Position::init();
+    }
+};
+
+// Each symmetry is a permutation of the squares, undone by its inverse
+TEST_F(SymmetryTest, inverseUndoesTransform)
+{
+    for (int sym = 0; sym < SYMMETRY_NB; sym++) {
+        Bitboard image = 0;
+
+        for (Square s = SQ_BEGIN; s < SQ_END; ++s) {
+            const Square t = Symmetry::transform(s, sym);
+
+            ASSERT_TRUE(SQ_BEGIN <= t && t < SQ_END);
+            EXPECT_EQ(Symmetry::transform(t, Symmetry::inverse(sym)), s);
+            EXPECT_EQ(Symmetry::transform(square_bb(s), sym), square_bb(t));
+            image |= t;
+        }
+
+        EXPECT_EQ(popcount(image), SQ_END - SQ_BEGIN) << "symmetry " << sym;
+    }
+}
+
+// The images of a game under all the symmetries share their canonical keys
+// at every ply, and canonical_key_after() predicts the key after a move
+TEST_F(SymmetryTest, imagesShareCanonicalKey)
+{
+    Position images[SYMMETRY_NB];
+    int sym;
+
+    for (auto &pos : images) {
+        pos.set(StartFEN, nullptr);
+    }
+
+    for (int ply = 0; ply < 30; ply++) {
+        Position &pos = images[0];
+        const MoveList<LEGAL> legal(pos);
+
+        if (legal.size() == 0) {
+            break;
+        }
+
+        const Key key = Symmetry::canonical_key(pos, sym);
+
+        for (int i = 1; i < SYMMETRY_NB; i++) {
+            EXPECT_EQ(Symmetry::canonical_key(images[i], sym), key)
+                << "ply " << ply << ", symmetry " << i;
+        }
+
+        const Move m = legal.begin()[ply % legal.size()];
+        const Color us = pos.side_to_move();
+        const int removeCount = pos.piece_to_remove_count();
+        const Key predicted = Symmetry::canonical_key_after(pos, m);
+
+        for (int i = 0; i < SYMMETRY_NB; i++) {
+            images[i].do_move(Symmetry::transform(m, i));
+        }
+
+        // Like key_after(), the prediction assumes that the side changes
+        if (pos.side_to_move() != us &&
+            pos.piece_to_remove_count() == removeCount) {
+            EXPECT_EQ(Symmetry::canonical_key(pos, sym), predicted)
+                << "ply " << ply;
+        }
+    }
+}
+
+} // namespace